@@ -26,6 +26,13 @@
 #include <stdarg.h>
 #include <errno.h>
 #include <syslog.h>
+#include <limits.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/uio.h>
 
 #include <skygw_debug.h>
 #include <skygw_types.h>
@@ -35,7 +42,6 @@
 #define MAX_PREFIXLEN 250
 #define MAX_SUFFIXLEN 250
 #define MAX_PATHLEN   512
-#define MAXNBLOCKBUFS 10
 
 /** for procname */
 #if !defined(_GNU_SOURCE)
@@ -47,7 +53,6 @@ extern char *program_invocation_short_name;
 
 #if defined(SS_DEBUG) 
 static int write_index;
-static int block_start_index;
 static int prevval;
 static simple_mutex_t msg_mutex;
 #endif
@@ -88,6 +93,8 @@ const char* shm_pathname_prefix = "/dev/shm/";
 
 /** Logfile ids from call argument '-s' */
 char* shmem_id_str     = NULL;
+/** Logfile ids from call argument '-x', written in binary format */
+char* binary_id_str    = NULL;
 /** Errors are written to syslog too by default */
 char* syslog_id_str    = strdup("LOGFILE_ERROR");
 char* syslog_ident_str = NULL;
@@ -100,7 +107,104 @@ static int lmlock;
 static logmanager_t* lm;
 static bool flushall_flag;
 static bool flushall_started_flag;
-static bool flushall_done_flag;
+
+/**
+ * Every thread that logs writes its formatted log strings to a ring of its
+ * own, from where the file writer thread drains the rings of all threads.
+ * Each ring has a single producer, the owning thread, and a single
+ * consumer, the file writer, so neither side takes a lock.
+ *
+ * The ring size must be a power of two. Records are aligned to the size of
+ * the record header and never wrap around the end of the ring; the space
+ * left at the end is filled with a padding record instead.
+ */
+#define LOGRING_SIZE   (64*1024)
+/** The file writer is woken up when this much is waiting in a ring */
+#define LOGRING_WAKEUP MAX_LOGSTRLEN
+/** Space for the records the file writer adds to binary logs */
+#define LOGARENA_SIZE  (64*1024)
+/** Maximum number of distinct format strings in binary logs */
+#define LOGFMT_MAX     4096
+/** Maximum number of arguments of a format string in binary logs */
+#define LOGFMT_MAXARGS 32
+/** Maximum number of log strings written with one writev */
+#define LOGRING_IOVMAX (IOV_MAX < 1024 ? IOV_MAX : 1024)
+
+typedef struct logrec_st {
+        uint64_t     lr_time;   /**< Merge key, log_clock of the write */
+        uint32_t     lr_size;   /**< Record size including header and padding */
+        uint16_t     lr_len;    /**< Length of the log string */
+        uint8_t      lr_fileid; /**< Target logfile id, 0 for padding */
+        uint8_t      lr_type;   /**< log_binary_type_t, 0 for a text line */
+} logrec_t;
+
+#define LOGREC_SIZE(len) \
+        ((sizeof(logrec_t) + (len) + sizeof(logrec_t) - 1) & ~(sizeof(logrec_t) - 1))
+
+typedef struct logring_st {
+        /** Read offset, only advanced by the file writer */
+        volatile size_t    lr_head;
+        char               lr_pad1[64 - sizeof(size_t)];
+        /** Write offset, only advanced by the owning thread */
+        volatile size_t    lr_tail;
+        char               lr_pad2[64 - sizeof(size_t)];
+        size_t             lr_cursor; /**< File writer's read position */
+        size_t             lr_end;    /**< Write offset seen by the file writer */
+        bool               lr_orphan; /**< Owning thread has exited */
+        struct logring_st* lr_next;
+        char               lr_buf[LOGRING_SIZE];
+} logring_t;
+
+/**
+ * All log rings. New rings are added to the head of the list under
+ * logrings_lock, only the file writer removes them.
+ */
+static logring_t*     logrings;
+static int            logrings_lock;
+static pthread_key_t  logring_key;
+static pthread_once_t logring_once = PTHREAD_ONCE_INIT;
+static __thread logring_t* tls_logring;
+static __thread bool  tls_is_filewriter;
+
+/**
+ * Format strings of binary log events. A format is registered when it is
+ * first logged and identified by its index in logfmts. Lookup is lock-free
+ * by format string address, registration is done under logfmts_lock.
+ */
+#define LOGFMT_HASHSIZE (2*LOGFMT_MAX)
+
+typedef struct logfmt_st {
+        const char* fmt_ptr;   /**< Address of the caller's format string */
+        char*       fmt_str;   /**< Copy of the format string */
+        int         fmt_nargs; /**< Number of arguments */
+        /** Argument types, see logfmt_spec_t */
+        char        fmt_types[LOGFMT_MAXARGS];
+        /** Precision of string arguments, -1 if none, -2 if given as '*' */
+        short       fmt_prec[LOGFMT_MAXARGS];
+} logfmt_t;
+
+/** Conversion specification parsed from a format string */
+typedef struct logfmt_spec_st {
+        const char* fs_end;      /**< First character after the conversion */
+        char        fs_flags[8]; /**< Flag characters */
+        int         fs_width;    /**< Width, -1 if none, -2 if given as '*' */
+        int         fs_prec;     /**< Precision, -1 if none, -2 if given as '*' */
+        char        fs_length;   /**< Length modifier, 'H' for hh and 'q' for ll */
+        char        fs_conv;     /**< Conversion character */
+        /**
+         * Argument type: 'i' int, 'l' long, 'q' long long, 'j' intmax_t,
+         * 'z' size_t, 't' ptrdiff_t, 'd' double, 's' string, 'p' pointer
+         * and 0 for %%.
+         */
+        char        fs_type;
+} logfmt_spec_t;
+
+static logfmt_t       logfmts[LOGFMT_MAX];
+static volatile int   logfmts_hash[LOGFMT_HASHSIZE]; /**< Format index + 1 */
+static int            logfmts_count;
+static int            logfmts_lock;
+/** Clock ticks per second */
+static uint64_t       log_clock_hz;
 
 /** Writer thread structure */
 struct filewriter_st {
@@ -116,33 +220,19 @@ struct filewriter_st {
         /** fwr_clientmes is for messages to log clients */
         skygw_message_t*   fwr_clientmes;
         skygw_thread_t*    fwr_thread;
+        /** Log strings collected from the rings for each log file */
+        struct iovec       fwr_iov[LOGFILE_LAST+1][LOGRING_IOVMAX];
+        int                fwr_niov[LOGFILE_LAST+1];
+        /** Binary record headers written by the file writer itself */
+        uint64_t           fwr_arena[LOGARENA_SIZE/sizeof(uint64_t)];
+        size_t             fwr_arena_used;
+        /** Formats already written to each binary log file */
+        uint8_t            fwr_defined[LOGFILE_LAST+1][LOGFMT_MAX/8];
 #if defined(SS_DEBUG)
         skygw_chk_t        fwr_chk_tail;
 #endif
 };
 
-/**
- * Log client's string is copied to block-sized log buffer, which is passed
- * to file writer thread.
- */
-typedef struct blockbuf_st {
-#if defined(SS_DEBUG)
-        skygw_chk_t    bb_chk_top;
-#endif
-        logfile_id_t   bb_fileid;
-  blockbuf_state_t bb_state; /**State of the block buffer*/
-        simple_mutex_t bb_mutex;    /**< bb_buf_used, bb_isfull */
-        int            bb_refcount; /**< protected by list mutex. #of clients */
-//        int            bb_blankcount; /**< # of blanks used btw strings */
-        size_t         bb_buf_size;
-        size_t         bb_buf_left;
-        size_t         bb_buf_used;
-        char           bb_buf[MAX_LOGSTRLEN];
-#if defined(SS_DEBUG)
-        skygw_chk_t    bb_chk_tail;
-#endif
-} blockbuf_t;
-
 /**
  * logfile object corresponds to physical file(s) where
  * certain log is written.
@@ -156,6 +246,7 @@ struct logfile_st {
         bool             lf_enabled;
         bool             lf_store_shmem;
         bool             lf_write_syslog;
+        bool             lf_binary; /**< written in binary format */
         logmanager_t*    lf_lmgr;
         /** fwr_logmes is for messages from log clients */
         skygw_message_t* lf_logmes;
@@ -169,8 +260,6 @@ struct logfile_st {
         char*            lf_full_link_name; /**< complete symlink name */
         int              lf_nfiles_max;
         size_t           lf_file_size;
-        /** list of block-sized log buffers */
-        mlist_t          lf_blockbuf_list;
         size_t           lf_buf_size;
         bool             lf_flushflag;
 	bool		 lf_rotateflag;
@@ -240,7 +329,8 @@ static bool logfile_init(
         logfile_id_t   logfile_id,
         logmanager_t*  logmanager,
         bool           store_shmem,
-        bool           write_syslog);
+        bool           write_syslog,
+        bool           binary);
 static void logfile_done(logfile_t* logfile);
 static void logfile_free_memory(logfile_t* lf);
 static void logfile_flush(logfile_t* lf);
@@ -277,16 +367,45 @@ static int  logmanager_write_log(
         const char*	str,
         va_list      	valist);
 
-static blockbuf_t* blockbuf_init(logfile_id_t id);
-static void        blockbuf_node_done(void* bb_data);
-static char*       blockbuf_get_writepos(
-        blockbuf_t** p_bb,
+static logring_t* logring_get(void);
+static void       logring_orphan(void* data);
+static char*      logring_reserve(logring_t* ring, size_t len);
+static void       logring_commit(
+        logring_t*   ring,
         logfile_id_t id,
-        size_t       str_len,
-        bool         flush);
-
-static void  blockbuf_register(blockbuf_t* bb);
-static void  blockbuf_unregister(blockbuf_t* bb);
+        size_t       len,
+        bool         flush,
+        int          type);
+static int        logmanager_write_binary(
+        logfile_id_t id,
+        bool         flush,
+        bool         use_valist,
+        const char*  str,
+        va_list      valist);
+static bool       logfmt_next(const char* p, logfmt_spec_t* spec);
+static logfmt_t*  logfmt_get(const char* str);
+static size_t     logfmt_encode(
+        logfmt_t*    fmt,
+        char*        buf,
+        size_t       size,
+        va_list      valist);
+static uint64_t   log_clock(void);
+static void       log_clock_calibrate(void);
+static char*      filewriter_arena_alloc(filewriter_t* fwr, size_t size);
+static void       filewriter_add_iov(
+        filewriter_t* fwr,
+        int           id,
+        void*         base,
+        size_t        len);
+static void       filewriter_add_binary(
+        filewriter_t* fwr,
+        int           id,
+        logrec_t*     rec,
+        bool*         clocked);
+static void       filewriter_write_all(filewriter_t* fwr, bool* flush);
+static void       logring_key_init(void);
+static void       logrings_write(filewriter_t* fwr, bool* flush);
+static void       logfile_write_failed(logfile_id_t id, int err);
 static bool  logfile_set_enabled(logfile_id_t id, bool val);
 static char* add_slash(char* str);
 
@@ -371,7 +490,6 @@ static bool logmanager_init_nomutex(
         lm->lm_chk_top   = CHK_NUM_LOGMANAGER;
         lm->lm_chk_tail  = CHK_NUM_LOGMANAGER;
 	write_index = 0;
-	block_start_index = 0;
 	prevval = -1;
 	simple_mutex_init(&msg_mutex, "Message mutex");
 #endif
@@ -402,6 +520,8 @@ static bool logmanager_init_nomutex(
             syslog_id_str = NULL;
         }
 
+        log_clock_calibrate();
+
         /** Initialize configuration including log file naming info */
         if (!fnames_conf_init(fn, argc, argv)) 
 	{
@@ -641,10 +761,8 @@ static int logmanager_write_log(
         logfile_t*   lf;
         char*        wp;
         int          err = 0;
-        blockbuf_t*  bb;
-        blockbuf_t*  bb_c;
+        logring_t*   ring = NULL;
         size_t       timestamp_len;
-        int          i;
 
         CHK_LOGMANAGER(lm);
         
@@ -687,10 +805,17 @@ static int logmanager_write_log(
 			logfile_rotate(lf); /*< wakes up file writer */ 
 		}
         }
+        else if (lf->lf_binary && do_maxscalelog)
+        {
+                /** Formatting is left to the decoder */
+                err = logmanager_write_binary(id, flush, use_valist, str, valist);
+        }
         else
 	{
                 /** Length of string that will be written, limited by bufsize */
                 size_t safe_str_len; 
+                /** Length of the record in the log ring */
+                size_t rec_len;
 		/** Length of session id */
 		size_t sesid_str_len;
 		size_t cmplen = 0;
@@ -751,13 +876,17 @@ static int logmanager_write_log(
 			simple_mutex_unlock(&msg_mutex);
 		}
 #endif
-		/** Book space for log string from buffer */
+		rec_len = safe_str_len;
+
+		/** Book space for log string from the thread's log ring */
                 if(do_maxscalelog)
                 {
-                wp = blockbuf_get_writepos(&bb,
-                                           id,
-                                           safe_str_len,
-                                           flush);
+                    if ((ring = logring_get()) == NULL ||
+                        (wp = logring_reserve(ring, rec_len)) == NULL)
+                    {
+                        err = -1;
+                        goto return_err;
+                    }
                 }
                 else
                 {
@@ -831,404 +960,1107 @@ static int logmanager_write_log(
 		}
 		wp[safe_str_len-1] = '\n';
 
-                if(do_maxscalelog)
-                {
-                    blockbuf_unregister(bb);
-                }
-                else
-                {
-                free(wp);
-                }
-                /**
-                 * disable because cross-blockbuffer locking either causes deadlock
-                 * or run out of memory blocks.
-                 */
-                if (spread_down && false) {
-                        /**
-                         * Write to target log. If spread_down == true, then
-                         * write also to all logs with greater logfile id.
-                         * LOGFILE_ERROR   = 1,
-                         * LOGFILE_MESSAGE = 2,
-                         * LOGFILE_TRACE   = 4,
-                         * LOGFILE_DEBUG   = 8
-                         *
-                         * So everything written to error log will appear in
-                         * message, trace and debuglog. Messages will be
-                         * written in trace and debug log.
-                         */
-                        for (i=(id<<1); i<=LOGFILE_LAST; i<<=1)
+                if(do_maxscalelog)
+                {
+                    logring_commit(ring, id, rec_len, flush, 0);
+                }
+                else
+                {
+                free(wp);
+                }
+        } /* if (str == NULL) */
+        
+return_err:
+        return err;
+}
+
+/**
+ * Return the log ring of the calling thread, creating it on first use.
+ *
+ * @return the ring or NULL if memory allocation failed
+ */
+static logring_t* logring_get(void)
+{
+        logring_t* ring = tls_logring;
+
+        if (ring != NULL)
+        {
+                return ring;
+        }
+        pthread_once(&logring_once, logring_key_init);
+
+        if ((ring = (logring_t *)calloc(1, sizeof(logring_t))) == NULL)
+        {
+                fprintf(stderr, "Error : Memory allocation for log ring failed.\n");
+                return NULL;
+        }
+        acquire_lock(&logrings_lock);
+        ring->lr_next = logrings;
+        logrings = ring;
+        release_lock(&logrings_lock);
+        /** The ring is released by the file writer once the thread exits */
+        pthread_setspecific(logring_key, ring);
+        tls_logring = ring;
+        return ring;
+}
+
+/**
+ * Create the key whose destructor detaches a ring from an exiting thread.
+ */
+static void logring_key_init(void)
+{
+        pthread_key_create(&logring_key, logring_orphan);
+}
+
+/**
+ * Thread exit handler which marks the thread's ring orphaned. The file
+ * writer frees it once it has been drained.
+ *
+ * @param data	the ring of the exiting thread
+ */
+static void logring_orphan(
+        void* data)
+{
+        logring_t* ring = (logring_t *)data;
+
+        ring->lr_orphan = true;
+}
+
+/**
+ * Reserve space for a log string of len bytes from the end of a ring.
+ * If the ring is full the file writer is woken up and the caller waits
+ * until there is space.
+ *
+ * @param ring	the ring of the calling thread
+ * @param len	length of the log string
+ *
+ * @return write position for the log string, or NULL if the file writer
+ * itself logs to a full ring
+ */
+static char* logring_reserve(
+        logring_t* ring,
+        size_t     len)
+{
+        size_t    size = LOGREC_SIZE(len);
+        size_t    off;
+        size_t    room;
+        size_t    need;
+        logrec_t* pad;
+
+        ss_dassert(size <= LOGRING_SIZE/2);
+
+        while (true)
+        {
+                off = ring->lr_tail & (LOGRING_SIZE - 1);
+                room = LOGRING_SIZE - off;
+                need = size <= room ? size : room + size;
+
+                if (LOGRING_SIZE - (ring->lr_tail - ring->lr_head) >= need)
+                {
+                        break;
+                }
+                if (tls_is_filewriter)
+                {
+                        return NULL;
+                }
+                skygw_message_send(lm->lm_logmes);
+                sched_yield();
+        }
+
+        if (size > room)
+        {
+                /** Skip the end of the ring */
+                pad = (logrec_t *)&ring->lr_buf[off];
+                pad->lr_size = room;
+                pad->lr_len = 0;
+                pad->lr_fileid = 0;
+                __sync_synchronize();
+                ring->lr_tail += room;
+                off = 0;
+        }
+        return &ring->lr_buf[off + sizeof(logrec_t)];
+}
+
+/**
+ * Publish the log string written to the position returned by
+ * logring_reserve to the file writer.
+ *
+ * @param ring	the ring of the calling thread
+ * @param id	logfile object identifier
+ * @param len	length of the log string
+ * @param flush	wake up the file writer immediately
+ * @param type	log_binary_type_t of a binary record, 0 for a text line
+ */
+static void logring_commit(
+        logring_t*   ring,
+        logfile_id_t id,
+        size_t       len,
+        bool         flush,
+        int          type)
+{
+        logrec_t*       rec;
+
+        rec = (logrec_t *)&ring->lr_buf[ring->lr_tail & (LOGRING_SIZE - 1)];
+        rec->lr_time = log_clock();
+        rec->lr_size = LOGREC_SIZE(len);
+        rec->lr_len = len;
+        rec->lr_fileid = id;
+        rec->lr_type = type;
+        /** Record must be complete before it becomes visible */
+        __sync_synchronize();
+        ring->lr_tail += rec->lr_size;
+
+        if (flush || ring->lr_tail - ring->lr_head >= LOGRING_WAKEUP)
+        {
+                skygw_message_send(lm->lm_logmes);
+        }
+}
+
+/**
+ * Write a log event to a binary log file. Only the id of the format
+ * string, the session id and the arguments are stored. Formats that can't
+ * be deferred, and plain strings, are formatted here and stored as text.
+ *
+ * @param id		logfile object identifier
+ * @param flush		wake up the file writer immediately
+ * @param use_valist	str is a format string for valist
+ * @param str		format string or the string to be logged
+ * @param valist	arguments for the format string
+ *
+ * @return 0 if succeed, -1 otherwise
+ */
+static int logmanager_write_binary(
+        logfile_id_t id,
+        bool         flush,
+        bool         use_valist,
+        const char*  str,
+        va_list      valist)
+{
+        logring_t*        ring;
+        logfmt_t*         fmt = NULL;
+        char*             wp;
+        char              buf[MAX_LOGSTRLEN];
+        size_t            len;
+        int               n;
+        int               type;
+        uint64_t          sesid = tls_log_info.li_sesid;
+        const size_t      hdrlen = sizeof(log_binary_rec_t);
+
+        if (use_valist)
+        {
+                fmt = logfmt_get(str);
+        }
+
+        if (fmt != NULL)
+        {
+                len = logfmt_encode(fmt, buf, sizeof(buf), valist);
+                type = LOG_BINARY_EVENT;
+        }
+        else
+        {
+                memcpy(buf, &sesid, sizeof(sesid));
+
+                if (use_valist)
+                {
+                        n = vsnprintf(buf + sizeof(sesid),
+                                      sizeof(buf) - sizeof(sesid),
+                                      str,
+                                      valist);
+                }
+                else
+                {
+                        n = snprintf(buf + sizeof(sesid),
+                                     sizeof(buf) - sizeof(sesid),
+                                     "%s",
+                                     str);
+                }
+                if (n < 0)
+                {
+                        n = 0;
+                }
+                else if ((size_t)n >= sizeof(buf) - sizeof(sesid))
+                {
+                        n = sizeof(buf) - sizeof(sesid) - 1;
+                }
+                len = sizeof(sesid) + n;
+                type = LOG_BINARY_TEXT;
+        }
+
+        /** The file writer fills in the record header */
+        if ((ring = logring_get()) == NULL ||
+            (wp = logring_reserve(ring, hdrlen + len)) == NULL)
+        {
+                return -1;
+        }
+        memcpy(wp + hdrlen, buf, len);
+        logring_commit(ring, id, hdrlen + len, flush, type);
+        return 0;
+}
+
+/**
+ * Parse a conversion specification of a format string.
+ *
+ * @param p	pointer to the '%' character
+ * @param spec	the parsed specification
+ *
+ * @return true if the argument can be stored for deferred formatting,
+ * false for %n, %m, wide characters, long double and positional arguments
+ */
+static bool logfmt_next(
+        const char*    p,
+        logfmt_spec_t* spec)
+{
+        size_t nflags = 0;
+
+        memset(spec, 0, sizeof(*spec));
+        spec->fs_width = -1;
+        spec->fs_prec = -1;
+        p += 1;
+
+        while (strchr("-+ #0'I", *p) != NULL && *p != '\0')
+        {
+                if (nflags < sizeof(spec->fs_flags) - 1)
+                {
+                        spec->fs_flags[nflags++] = *p;
+                }
+                p += 1;
+        }
+
+        if (*p == '*')
+        {
+                spec->fs_width = -2;
+                p += 1;
+        }
+        else if (isdigit(*p))
+        {
+                spec->fs_width = 0;
+
+                while (isdigit(*p))
+                {
+                        spec->fs_width = spec->fs_width * 10 + (*p++ - '0');
+                }
+        }
+
+        if (*p == '.')
+        {
+                p += 1;
+                spec->fs_prec = 0;
+
+                if (*p == '*')
+                {
+                        spec->fs_prec = -2;
+                        p += 1;
+                }
+                else
+                {
+                        while (isdigit(*p))
+                        {
+                                spec->fs_prec = spec->fs_prec * 10 + (*p++ - '0');
+                        }
+                }
+        }
+
+        switch (*p) {
+        case 'h':
+                spec->fs_length = *++p == 'h' ? (p++, 'H') : 'h';
+                break;
+
+        case 'l':
+                spec->fs_length = *++p == 'l' ? (p++, 'q') : 'l';
+                break;
+
+        case 'q':
+        case 'L':
+        case 'j':
+        case 'z':
+        case 't':
+                spec->fs_length = *p++;
+                break;
+
+        default:
+                break;
+        }
+        spec->fs_conv = *p;
+        spec->fs_end = *p == '\0' ? p : p + 1;
+
+        switch (*p) {
+        case 'd':
+        case 'i':
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+                switch (spec->fs_length) {
+                case 0:
+                case 'h':
+                case 'H':
+                        spec->fs_type = 'i';
+                        break;
+
+                case 'L':
+                        /** Same as ll for integers */
+                        spec->fs_type = 'q';
+                        break;
+
+                default:
+                        spec->fs_type = spec->fs_length;
+                        break;
+                }
+                return true;
+
+        case 'c':
+                spec->fs_type = 'i';
+                return spec->fs_length == 0;
+
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+                spec->fs_type = 'd';
+                return spec->fs_length == 0 || spec->fs_length == 'l';
+
+        case 's':
+                spec->fs_type = 's';
+                return spec->fs_length == 0;
+
+        case 'p':
+                spec->fs_type = 'p';
+                return spec->fs_length == 0;
+
+        case '%':
+                spec->fs_type = 0;
+                return spec->fs_end == p + 1 && p[-1] == '%';
+
+        default:
+                /** %n, %m, %C, %S, positional arguments */
+                return false;
+        }
+}
+
+/**
+ * Find or register the format of a binary log event.
+ *
+ * @param str	the format string
+ *
+ * @return the format or NULL if it must be logged as text
+ */
+static logfmt_t* logfmt_get(
+        const char* str)
+{
+        logfmt_t*     fmt;
+        logfmt_spec_t spec;
+        const char*   p;
+        size_t        h;
+        int           idx;
+        int           nargs = 0;
+
+        h = ((uintptr_t)str >> 3) % LOGFMT_HASHSIZE;
+
+        while ((idx = logfmts_hash[h]) != 0)
+        {
+                fmt = &logfmts[idx - 1];
+
+                if (fmt->fmt_ptr == str)
+                {
+                        /** A buffer reused for different formats is logged as text */
+                        return fmt->fmt_str != NULL && strcmp(fmt->fmt_str, str) == 0 ?
+                                fmt : NULL;
+                }
+                h = (h + 1) % LOGFMT_HASHSIZE;
+        }
+        acquire_lock(&logfmts_lock);
+
+        /** Another thread may have registered it meanwhile */
+        while ((idx = logfmts_hash[h]) != 0 && logfmts[idx - 1].fmt_ptr != str)
+        {
+                h = (h + 1) % LOGFMT_HASHSIZE;
+        }
+
+        if (idx != 0)
+        {
+                fmt = &logfmts[idx - 1];
+                release_lock(&logfmts_lock);
+                return fmt->fmt_str != NULL && strcmp(fmt->fmt_str, str) == 0 ?
+                        fmt : NULL;
+        }
+
+        if (logfmts_count == LOGFMT_MAX)
+        {
+                release_lock(&logfmts_lock);
+                return NULL;
+        }
+        fmt = &logfmts[logfmts_count];
+        fmt->fmt_ptr = str;
+        fmt->fmt_str = NULL;
+
+        for (p = strchr(str, '%'); p != NULL; p = strchr(p, '%'))
+        {
+                if (!logfmt_next(p, &spec) || nargs + 3 > LOGFMT_MAXARGS)
+                {
+                        nargs = -1;
+                        break;
+                }
+                if (spec.fs_width == -2)
+                {
+                        fmt->fmt_prec[nargs] = -1;
+                        fmt->fmt_types[nargs++] = 'i';
+                }
+                if (spec.fs_prec == -2)
+                {
+                        fmt->fmt_prec[nargs] = -1;
+                        fmt->fmt_types[nargs++] = 'i';
+                }
+                if (spec.fs_type != 0)
+                {
+                        fmt->fmt_prec[nargs] = spec.fs_prec;
+                        fmt->fmt_types[nargs++] = spec.fs_type;
+                }
+                p = spec.fs_end;
+        }
+        fmt->fmt_nargs = nargs;
+
+        /**
+         * Unsupported formats are registered too, so that they are looked
+         * up only once, but their fmt_str stays NULL.
+         */
+        if (nargs >= 0)
+        {
+                fmt->fmt_str = strdup(str);
+        }
+        logfmts_count += 1;
+        /** Format must be complete before it can be found */
+        __sync_synchronize();
+        logfmts_hash[h] = logfmts_count;
+        release_lock(&logfmts_lock);
+
+        return fmt->fmt_str != NULL ? fmt : NULL;
+}
+
+/**
+ * Store the format id, session id and arguments of a binary log event.
+ * Strings are truncated so that the event fits in the buffer.
+ *
+ * @param fmt		the format of the event
+ * @param buf		the buffer
+ * @param size		size of the buffer
+ * @param valist	the arguments
+ *
+ * @return length of the stored event
+ */
+static size_t logfmt_encode(
+        logfmt_t* fmt,
+        char*     buf,
+        size_t    size,
+        va_list   valist)
+{
+        char*       p = buf;
+        char*       end = buf + size;
+        uint32_t    u32[2];
+        uint64_t    sesid = tls_log_info.li_sesid;
+        int         prec = -1;
+        int         i;
+        int32_t     i32;
+        int64_t     i64;
+        double      d;
+        const char* str;
+        size_t      len;
+        ssize_t     room;
+
+        ss_dassert(size >= 16 + LOGFMT_MAXARGS * sizeof(int64_t));
+        u32[0] = fmt - logfmts;
+        u32[1] = 0;
+        memcpy(p, u32, sizeof(u32));
+        p += sizeof(u32);
+        memcpy(p, &sesid, sizeof(sesid));
+        p += sizeof(sesid);
+
+        for (i = 0; i < fmt->fmt_nargs; i++)
+        {
+                switch (fmt->fmt_types[i]) {
+                case 'i':
+                        i32 = va_arg(valist, int);
+                        /** Remember a '*' precision for the next string */
+                        prec = i32;
+                        memcpy(p, &i32, sizeof(i32));
+                        p += sizeof(i32);
+                        continue;
+
+                case 'l':
+                        i64 = va_arg(valist, long);
+                        break;
+
+                case 'q':
+                        i64 = va_arg(valist, long long);
+                        break;
+
+                case 'j':
+                        i64 = va_arg(valist, intmax_t);
+                        break;
+
+                case 'z':
+                        i64 = va_arg(valist, size_t);
+                        break;
+
+                case 't':
+                        i64 = va_arg(valist, ptrdiff_t);
+                        break;
+
+                case 'p':
+                        i64 = (uintptr_t)va_arg(valist, void*);
+                        break;
+
+                case 'd':
+                        d = va_arg(valist, double);
+                        memcpy(p, &d, sizeof(d));
+                        p += sizeof(d);
+                        continue;
+
+                case 's':
+                        if ((str = va_arg(valist, const char*)) == NULL)
+                        {
+                                str = "(null)";
+                        }
+                        if (fmt->fmt_prec[i] >= 0)
+                        {
+                                prec = fmt->fmt_prec[i];
+                        }
+                        else if (fmt->fmt_prec[i] == -1)
+                        {
+                                prec = -1;
+                        }
+                        len = prec >= 0 ? strnlen(str, prec) : strlen(str);
+                        /** Leave room for the remaining arguments */
+                        room = (end - p) - sizeof(uint32_t) -
+                                (fmt->fmt_nargs - i - 1) * sizeof(int64_t);
+
+                        if ((ssize_t)len > room)
+                        {
+                                len = room > 0 ? room : 0;
+                        }
+                        u32[0] = len;
+                        memcpy(p, &u32[0], sizeof(uint32_t));
+                        memcpy(p + sizeof(uint32_t), str, len);
+                        p += sizeof(uint32_t) + len;
+                        continue;
+
+                default:
+                        ss_dassert(false);
+                        continue;
+                }
+                memcpy(p, &i64, sizeof(i64));
+                p += sizeof(i64);
+        }
+        return p - buf;
+}
+
+/**
+ * Render a binary log event to text.
+ *
+ * @param format	the format string of the event
+ * @param args		the stored arguments of the event
+ * @param len		length of the arguments
+ * @param buf		buffer for the text
+ * @param size		size of the buffer
+ *
+ * @return length of the text, truncated to size - 1, or -1 if the
+ * arguments don't match the format
+ */
+int skygw_log_binary_render(
+        const char*    format,
+        const uint8_t* args,
+        size_t         len,
+        char*          buf,
+        size_t         size)
+{
+        const uint8_t* end = args + len;
+        const char*    p = format;
+        const char*    next;
+        logfmt_spec_t  spec;
+        char           conv[64];
+        size_t         used = 0;
+        size_t         n;
+        int            c;
+        int32_t        width;
+        int32_t        prec;
+        int32_t        i32;
+        int64_t        i64;
+        uint32_t       slen;
+        double         d;
+
+        if (size == 0)
+        {
+                return -1;
+        }
+
+        while (*p != '\0')
+        {
+                if ((next = strchr(p, '%')) == NULL)
+                {
+                        next = p + strlen(p);
+                }
+                n = next - p;
+
+                if (n > size - used - 1)
+                {
+                        n = size - used - 1;
+                }
+                memcpy(buf + used, p, n);
+                used += n;
+
+                if (*next == '\0')
+                {
+                        break;
+                }
+
+                if (!logfmt_next(next, &spec))
+                {
+                        return -1;
+                }
+                p = spec.fs_end;
+
+                if (spec.fs_type == 0)
+                {
+                        if (used < size - 1)
+                        {
+                                buf[used++] = '%';
+                        }
+                        continue;
+                }
+                width = spec.fs_width;
+                prec = spec.fs_prec;
+
+                if (width == -2)
+                {
+                        if (end - args < (ssize_t)sizeof(width))
+                        {
+                                return -1;
+                        }
+                        memcpy(&width, args, sizeof(width));
+                        args += sizeof(width);
+                }
+
+                if (prec == -2)
+                {
+                        if (end - args < (ssize_t)sizeof(prec))
+                        {
+                                return -1;
+                        }
+                        memcpy(&prec, args, sizeof(prec));
+                        args += sizeof(prec);
+                }
+                /** Rebuild the conversion with the resolved width and precision */
+                c = snprintf(conv, sizeof(conv), "%%%s", spec.fs_flags);
+
+                if (width != -1)
+                {
+                        c += snprintf(conv + c, sizeof(conv) - c, "%d", width);
+                }
+
+                switch (spec.fs_type) {
+                case 'i':
+                        if (end - args < (ssize_t)sizeof(i32))
+                        {
+                                return -1;
+                        }
+                        memcpy(&i32, args, sizeof(i32));
+                        args += sizeof(i32);
+
+                        if (prec >= 0)
+                        {
+                                c += snprintf(conv + c, sizeof(conv) - c, ".%d", prec);
+                        }
+                        snprintf(conv + c, sizeof(conv) - c, "%s%c",
+                                 spec.fs_length == 'H' ? "hh" :
+                                 spec.fs_length == 'h' ? "h" : "",
+                                 spec.fs_conv);
+                        n = snprintf(buf + used, size - used, conv, i32);
+                        break;
+
+                case 'd':
+                        if (end - args < (ssize_t)sizeof(d))
+                        {
+                                return -1;
+                        }
+                        memcpy(&d, args, sizeof(d));
+                        args += sizeof(d);
+
+                        if (prec >= 0)
+                        {
+                                c += snprintf(conv + c, sizeof(conv) - c, ".%d", prec);
+                        }
+                        snprintf(conv + c, sizeof(conv) - c, "%c", spec.fs_conv);
+                        n = snprintf(buf + used, size - used, conv, d);
+                        break;
+
+                case 's':
+                        if (end - args < (ssize_t)sizeof(slen))
+                        {
+                                return -1;
+                        }
+                        memcpy(&slen, args, sizeof(slen));
+                        args += sizeof(slen);
+
+                        if ((size_t)(end - args) < slen)
+                        {
+                                return -1;
+                        }
+                        /** The stored string isn't terminated, limit it by precision */
+                        snprintf(conv + c, sizeof(conv) - c, ".%us", slen);
+                        n = snprintf(buf + used, size - used, conv, (const char *)args);
+                        args += slen;
+                        break;
+
+                default:
+                        if (end - args < (ssize_t)sizeof(i64))
+                        {
+                                return -1;
+                        }
+                        memcpy(&i64, args, sizeof(i64));
+                        args += sizeof(i64);
+
+                        if (spec.fs_type == 'p')
+                        {
+                                snprintf(conv + c, sizeof(conv) - c, "p");
+                                n = snprintf(buf + used, size - used, conv,
+                                             (void *)(uintptr_t)i64);
+                                break;
+                        }
+
+                        if (prec >= 0)
                         {
-                                /** pointer to write buffer of larger-id log */
-                                char* wp_c;
-                            
-                                /**< Check if particular log is enabled */
-                                if (!(lm->lm_enabled_logfiles & i))
-                                {
-                                        continue;
-                                }
-                                /**
-                                 * Seek write position and register to block
-                                 * buffer. Then print formatted string to
-                                 * write position.
-                                 */
-                                wp_c = blockbuf_get_writepos(
-                                        &bb_c,
-                                        (logfile_id_t)i,
-                                        timestamp_len-1+str_len,
-                                        flush);
-                                /**
-                                 * Copy original string from block buffer to
-                                 * other logs' block buffers.
-                                 */
-                                snprintf(wp_c, timestamp_len+str_len, "%s", wp);
-                            
-                                /** remove double line feed */
-                                if (wp_c[timestamp_len-1+str_len-2] == '\n')
-                                {
-                                        wp_c[timestamp_len-1+str_len-2]=' ';
-                                }
-                                wp_c[timestamp_len-1+str_len-1]='\n';
-                            
-                                /** lock-free unregistration, includes flush if
-                                 * bb_state == BB_FULL */
-                                blockbuf_unregister(bb_c);
+                                c += snprintf(conv + c, sizeof(conv) - c, ".%d", prec);
                         }
-                } /* if (spread_down) */
-        } /* if (str == NULL) */
-        
-return_err:
-        return err;
+                        snprintf(conv + c, sizeof(conv) - c, "ll%c", spec.fs_conv);
+                        n = snprintf(buf + used, size - used, conv, (long long)i64);
+                        break;
+                }
+                used += n < size - used ? n : size - used - 1;
+        }
+        buf[used] = '\0';
+        return used;
 }
 
 /**
- * Register writer to a block buffer. When reference counter is non-zero the
- * flusher thread doesn't write the block to disk.
- * 
- * @param bb	block buffer
+ * Read the clock used for ordering log records and for binary log event
+ * times. The time stamp counter is used where available since it is
+ * cheaper than clock_gettime.
+ *
+ * @return current clock value in ticks
  */
-static void blockbuf_register(
-        blockbuf_t* bb)
+static uint64_t log_clock(void)
 {
-        CHK_BLOCKBUF(bb);
-        ss_dassert(bb->bb_refcount >= 0);
-        atomic_add(&bb->bb_refcount, 1);
+#if defined(__x86_64__) || defined(__i386__)
+        uint32_t lo;
+        uint32_t hi;
+
+        __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+        return ((uint64_t)hi << 32) | lo;
+#else
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
 }
 
 /**
- * Unregister writer from block buffer. If the buffer got filled up and there
- * are no other registered writers anymore, notify the flusher thread.
- * 
- * @param bb	block buffer
+ * Measure the frequency of log_clock. It only has to be roughly right
+ * since binary log files are resynchronized with the real time clock
+ * every time the file writer writes to them.
  */
-static void blockbuf_unregister(
-        blockbuf_t* bb)
+static void log_clock_calibrate(void)
 {
-        logfile_t* lf;
-        
-        CHK_BLOCKBUF(bb);
-        ss_dassert(bb->bb_refcount >= 1);
-        lf = &lm->lm_logfile[bb->bb_fileid];
-        CHK_LOGFILE(lf);
-        /**
-         * if this is the last client in a full buffer, send write request.
-         */
-        if (atomic_add(&bb->bb_refcount, -1) == 1 && bb->bb_state == BB_FULL) {
-            skygw_message_send(lf->lf_logmes);
-        }
-        ss_dassert(bb->bb_refcount >= 0);
+#if defined(__x86_64__) || defined(__i386__)
+        struct timespec ts1;
+        struct timespec ts2;
+        struct timespec delay = {0, 10000000};
+        uint64_t        c1;
+        uint64_t        c2;
+        uint64_t        ns;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts1);
+        c1 = log_clock();
+        nanosleep(&delay, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &ts2);
+        c2 = log_clock();
+        ns = (uint64_t)(ts2.tv_sec - ts1.tv_sec) * 1000000000 +
+                ts2.tv_nsec - ts1.tv_nsec;
+        log_clock_hz = ns > 0 ? (c2 - c1) * 1000000000 / ns : 1000000000;
+#else
+        log_clock_hz = 1000000000;
+#endif
 }
 
-
-/** 
- * @node (write brief function description here) 
- *
- * Parameters:
- * @param id - <usage>
- *          <description>
- *
- * @param str_len - <usage>
- *          <description>
- *
- * @return 
- *
- * 
- * @details List mutex now protects both the list and the contents of it.
- * TODO : It should be so that adding and removing nodes of the list is protected
- * by the list mutex. Buffer modifications should be protected by buffer
- * mutex.
- *
+/**
+ * Write the log strings of all rings to the log files. The strings of the
+ * different rings are merged in the order they were written and written
+ * to each file with as few writev calls as possible. Ring space is given
+ * back only after everything has been written since the iovecs point to
+ * the rings. Rings of exited threads are freed once they are empty.
+ *
+ * @param fwr	the file writer
+ * @param flush	array indexed by logfile id, true if the file must also
+ * 		be synced to disk
  */
-static char* blockbuf_get_writepos(
-        blockbuf_t** p_bb,
-        logfile_id_t id,
-        size_t       str_len,
-        bool         flush)
+static void logrings_write(
+        filewriter_t* fwr,
+        bool*         flush)
 {
-  logfile_t*     lf;
-  mlist_t*       bb_list;
-  char*          pos = NULL;
-  mlist_node_t*  node;
-  blockbuf_t*    bb;
-  ss_debug(bool  succp;)
+        logring_t*  first;
+        logring_t*  ring;
+        logring_t*  best;
+        logring_t** prev;
+        logrec_t*   rec = NULL;
+        logrec_t*   best_rec;
+        int         i;
+        bool        clocked[LOGFILE_LAST+1] = {false};
+
+        acquire_lock(&logrings_lock);
+        first = logrings;
+        release_lock(&logrings_lock);
+
+        for (ring = first; ring != NULL; ring = ring->lr_next)
+        {
+                ring->lr_cursor = ring->lr_head;
+                ring->lr_end = ring->lr_tail;
+        }
+        /** Read records only after the write offsets */
+        __sync_synchronize();
 
-            
-        CHK_LOGMANAGER(lm);
-        lf = &lm->lm_logfile[id];
-        CHK_LOGFILE(lf);
-        bb_list = &lf->lf_blockbuf_list;
+        while (true)
+        {
+                best = NULL;
+                best_rec = NULL;
 
-        /** Lock list */
-        simple_mutex_lock(&bb_list->mlist_mutex, true);
-        CHK_MLIST(bb_list);
+                for (ring = first; ring != NULL; ring = ring->lr_next)
+                {
+                        while (ring->lr_cursor != ring->lr_end)
+                        {
+                                rec = (logrec_t *)&ring->lr_buf[ring->lr_cursor &
+                                                                (LOGRING_SIZE - 1)];
+                                if (rec->lr_fileid != 0)
+                                {
+                                        break;
+                                }
+                                ring->lr_cursor += rec->lr_size;
+                        }
+                        if (ring->lr_cursor != ring->lr_end &&
+                            (best_rec == NULL || rec->lr_time < best_rec->lr_time))
+                        {
+                                best = ring;
+                                best_rec = rec;
+                        }
+                }
+                if (best == NULL)
+                {
+                        break;
+                }
+                i = best_rec->lr_fileid;
 
-        if (bb_list->mlist_nodecount > 0) {
-            /**
-             * At least block buffer exists on the list. 
-             */
-            node = bb_list->mlist_first;
-	    
-            
-            /** Loop over blockbuf list to find write position */
-            while (true) {
-                CHK_MLIST_NODE(node);
+                if (best_rec->lr_type != 0)
+                {
+                        filewriter_add_binary(fwr, i, best_rec, clocked);
+                }
+                else
+                {
+                        filewriter_add_iov(fwr, i, best_rec + 1, best_rec->lr_len);
+                }
+                best->lr_cursor += best_rec->lr_size;
+        }
+        filewriter_write_all(fwr, flush);
 
-                /** Unlock list */
-                simple_mutex_unlock(&bb_list->mlist_mutex);
-                
-                bb = (blockbuf_t *)node->mlnode_data;
-                CHK_BLOCKBUF(bb);
+        /** Strings are written, release ring space to the log clients */
+        __sync_synchronize();
 
-                /** Lock buffer */
-                simple_mutex_lock(&bb->bb_mutex, true);
-                
-                if (bb->bb_state == BB_FULL || bb->bb_buf_left < str_len) {
-                    /**
-                     * This block buffer is too full.
-                     * Send flush request to file writer thread. This causes
-                     * flushing all buffers, and (eventually) frees buffer space.
-                     */
-		  blockbuf_register(bb);
-		  
-		  bb->bb_state = BB_FULL;
-
-		  blockbuf_unregister(bb);
-		  
-		  /** Unlock buffer */
-		  simple_mutex_unlock(&bb->bb_mutex);
-
-		  /** Lock list */
-		    simple_mutex_lock(&bb_list->mlist_mutex, true);
-
-
-                    /**
-                     * If next node exists move forward. Else check if there is
-                     * space for a new block buffer on the list.
-                     */
-                    if (node != bb_list->mlist_last) {
-                        node = node->mlnode_next;
-                        continue;
-                    }
-                    /**
-                     * All buffers on the list are full.
-                     */
-                    if (bb_list->mlist_nodecount <
-                        bb_list->mlist_nodecount_max)
-                    {
-                        /**
-                         * New node is created
-                         */
-                        bb = blockbuf_init(id);
-                        CHK_BLOCKBUF(bb);
+        for (ring = first; ring != NULL; ring = ring->lr_next)
+        {
+                ring->lr_head = ring->lr_cursor;
+        }
+        /** Free the drained rings of exited threads */
+        acquire_lock(&logrings_lock);
+        prev = &logrings;
 
-                        /**
-                         * Increase version to odd to mark list update active
-                         * update.
-                         */
-                        bb_list->mlist_versno += 1;
-                        ss_dassert(bb_list->mlist_versno%2 == 1);
-                        
-                        ss_debug(succp =)
-                            mlist_add_data_nomutex(bb_list, bb);
-                        ss_dassert(succp);
+        while ((ring = *prev) != NULL)
+        {
+                if (ring->lr_orphan && ring->lr_head == ring->lr_tail)
+                {
+                        *prev = ring->lr_next;
+                        free(ring);
+                }
+                else
+                {
+                        prev = &ring->lr_next;
+                }
+        }
+        release_lock(&logrings_lock);
+}
 
-                        /**
-                         * Increase version to even to mark completion of update.
-                         */
-                        bb_list->mlist_versno += 1;
-                        ss_dassert(bb_list->mlist_versno%2 == 0);
-                    } else {
-                        /**
-                         * List and buffers are full.
-                         * Reset to the beginning of the list, and wait until
-                         * there is a block buffer with enough space.
-                         */
-                        simple_mutex_unlock(&bb_list->mlist_mutex);
-                        simple_mutex_lock(&bb_list->mlist_mutex, true);
+/**
+ * Add a string to be written to a log file. The pending strings of the
+ * file are written if there is no room for more.
+ *
+ * @param fwr	the file writer
+ * @param id	logfile object identifier
+ * @param base	the string, must stay valid until it is written
+ * @param len	length of the string
+ */
+static void filewriter_add_iov(
+        filewriter_t* fwr,
+        int           id,
+        void*         base,
+        size_t        len)
+{
+        int err;
 
-                        node = bb_list->mlist_first;
-                        continue;
-                    }
-		 
-
-		}else if(bb->bb_state == BB_CLEARED){
-
-		  /**
-		   *Move the cleared buffer to the end of the list if it is the first one in the list
-		   */
-
-		      simple_mutex_unlock(&bb->bb_mutex);
-		      simple_mutex_lock(&bb_list->mlist_mutex, true);
-		      
-		      if(node == bb_list->mlist_first)
-				  {
-
-					  if(bb_list->mlist_nodecount > 1 &&
-						 node != bb_list->mlist_last){
-						  bb_list->mlist_last->mlnode_next = bb_list->mlist_first;
-						  bb_list->mlist_first = bb_list->mlist_first->mlnode_next;
-						  bb_list->mlist_last->mlnode_next->mlnode_next = NULL;
-						  bb_list->mlist_last = bb_list->mlist_last->mlnode_next;
-					  }
-
-					  ss_dassert(node == bb_list->mlist_last);
-
-					  simple_mutex_unlock(&bb_list->mlist_mutex);
-					  simple_mutex_lock(&bb->bb_mutex, true);
-
-					  bb->bb_state = BB_READY;
-
-					  simple_mutex_unlock(&bb->bb_mutex);
-					  simple_mutex_lock(&bb_list->mlist_mutex, true);
-					  node = bb_list->mlist_first;
-				  }
-			  else
-				  {
-					  if(node->mlnode_next){
-						  node = node->mlnode_next;
-					  }else{
-						  node = bb_list->mlist_first;
-					  }
-					  continue;
-				  }
-
-
-			  
-
-		    }else if (bb->bb_state == BB_READY){
-                    /**
-                     * There is space for new log string.
-                     */
-                    break;
-                }
-            } /** while (true) */
-        } else {
+        fwr->fwr_iov[id][fwr->fwr_niov[id]].iov_base = base;
+        fwr->fwr_iov[id][fwr->fwr_niov[id]].iov_len = len;
+        fwr->fwr_niov[id] += 1;
 
-            /**
-             * Create the first block buffer to logfile's blockbuf list.
-             */
+        if (fwr->fwr_niov[id] == LOGRING_IOVMAX)
+        {
+                err = skygw_file_writev(fwr->fwr_file[id],
+                                        fwr->fwr_iov[id],
+                                        fwr->fwr_niov[id],
+                                        false);
+                fwr->fwr_niov[id] = 0;
 
-            bb = blockbuf_init(id);
-            CHK_BLOCKBUF(bb);
+                if (err)
+                {
+                        logfile_write_failed((logfile_id_t)id, err);
+                }
+        }
+}
 
-            /** Lock buffer */
-            simple_mutex_lock(&bb->bb_mutex, true);
-            /**
-             * Increase version to odd to mark list update active update.
-             */
-            bb_list->mlist_versno += 1;
-            ss_dassert(bb_list->mlist_versno%2 == 1);
+/**
+ * Write the pending strings of all log files and release the arena.
+ *
+ * @param fwr	the file writer
+ * @param flush	array indexed by logfile id, true if the file must also
+ * 		be synced to disk, or NULL
+ */
+static void filewriter_write_all(
+        filewriter_t* fwr,
+        bool*         flush)
+{
+        int  i;
+        int  err;
+        bool sync;
 
-            ss_debug(succp =)mlist_add_data_nomutex(bb_list, bb);
-            ss_dassert(succp);
+        for (i = LOGFILE_FIRST; i <= LOGFILE_LAST; i <<= 1)
+        {
+                sync = flush != NULL && flush[i];
 
-            /**
-             * Increase version to even to mark completion of update.
-             */
-            bb_list->mlist_versno += 1;
-            ss_dassert(bb_list->mlist_versno%2 == 0);
-            
-            /** Unlock list */
-            simple_mutex_unlock(&bb_list->mlist_mutex);
-        } /* if (bb_list->mlist_nodecount > 0) */
-        
-        ss_dassert(pos == NULL);
-        ss_dassert(!(bb->bb_state == BB_FULL || bb->bb_buf_left < str_len));
-        ss_dassert(bb_list->mlist_nodecount <= bb_list->mlist_nodecount_max);
+                if (fwr->fwr_niov[i] == 0 && !sync)
+                {
+                        continue;
+                }
+                err = skygw_file_writev(fwr->fwr_file[i],
+                                        fwr->fwr_iov[i],
+                                        fwr->fwr_niov[i],
+                                        sync);
+                fwr->fwr_niov[i] = 0;
 
-        /**
-         * Registration to blockbuf adds reference for the write operation.
-         * It indicates that client has allocated space from the buffer,
-         * but not written yet. As long as refcount > 0 buffer can't be
-         * written to disk.
-         */
-        blockbuf_register(bb);
-        *p_bb = bb;
-        /**
-         * At this point list mutex is held and bb points to a node with
-         * enough space available. pos is not yet set.
-         */
-        pos = &bb->bb_buf[bb->bb_buf_used];
-        bb->bb_buf_used += str_len;
-        bb->bb_buf_left -= str_len;
-        
-        ss_dassert(pos >= &bb->bb_buf[0] &&
-                   pos <= &bb->bb_buf[MAX_LOGSTRLEN-str_len]);
-        
-        /** read checkmark */
-        /** TODO: add buffer overflow checkmark
-        chk_val = (int)bb->bb_buf[bb->bb_buf_used-count_len];
-        ss_dassert(chk_val == bb->bb_strcount);
-        */
-        
-        /** TODO : write next checkmark
-        bb->bb_strcount += 1;
-        memcpy(&bb->bb_buf[bb->bb_buf_used], &bb->bb_strcount, count_len);
-        bb->bb_buf_used += count_len;
-        bb->bb_buf_left -= count_len;
-        */
-        
-        /**
-         * If flush flag is set, set buffer full. As a consequence, no-one
-         * can write to it before it is flushed to disk.
-         */
-        bb->bb_state = (flush == true ? BB_FULL : bb->bb_state);
-        
-        /** Unlock buffer */
-        simple_mutex_unlock(&bb->bb_mutex);
-        return pos;
+                if (err)
+                {
+                        logfile_write_failed((logfile_id_t)i, err);
+                }
+        }
+        fwr->fwr_arena_used = 0;
 }
 
-static void blockbuf_node_done(
-        void* bb_data)
+/**
+ * Allocate space for a record the file writer adds to a binary log. If
+ * the arena is full everything pending is written first.
+ *
+ * @param fwr	the file writer
+ * @param size	size of the record
+ *
+ * @return the allocated space
+ */
+static char* filewriter_arena_alloc(
+        filewriter_t* fwr,
+        size_t        size)
 {
-        blockbuf_t* bb = (blockbuf_t *)bb_data;
-        simple_mutex_done(&bb->bb_mutex);
-}
+        char* p;
 
+        size = (size + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+        ss_dassert(size <= LOGARENA_SIZE);
 
-static blockbuf_t* blockbuf_init(
-        logfile_id_t id)
+        if (fwr->fwr_arena_used + size > LOGARENA_SIZE)
+        {
+                filewriter_write_all(fwr, NULL);
+        }
+        p = (char *)fwr->fwr_arena + fwr->fwr_arena_used;
+        fwr->fwr_arena_used += size;
+        return p;
+}
+
+/**
+ * Add a binary record to be written to a binary log file. The record
+ * header is filled in here. A clock record is written before the first
+ * record of each drain and a format record before the first event that
+ * uses the format in the current file.
+ *
+ * @param fwr		the file writer
+ * @param id		logfile object identifier
+ * @param rec		the record in the log ring
+ * @param clocked	array indexed by logfile id, true if the clock
+ *			record has been written
+ */
+static void filewriter_add_binary(
+        filewriter_t* fwr,
+        int           id,
+        logrec_t*     rec,
+        bool*         clocked)
 {
-        blockbuf_t* bb;
+        log_binary_rec_t* br = (log_binary_rec_t *)(rec + 1);
+        log_binary_rec_t* hdr;
+        uint64_t          clk[2];
+        uint32_t          fmtid;
+        size_t            len;
+        struct timespec   ts;
+
+        if (!clocked[id])
+        {
+                hdr = (log_binary_rec_t *)filewriter_arena_alloc(fwr,
+                                                                 sizeof(*hdr) + sizeof(clk));
+                clock_gettime(CLOCK_REALTIME, &ts);
+                hdr->br_time = log_clock();
+                hdr->br_size = sizeof(*hdr) + sizeof(clk);
+                hdr->br_type = LOG_BINARY_CLOCK;
+                clk[0] = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+                clk[1] = log_clock_hz;
+                memcpy(hdr + 1, clk, sizeof(clk));
+                filewriter_add_iov(fwr, id, hdr, hdr->br_size);
+                clocked[id] = true;
+        }
 
-        bb = (blockbuf_t *)calloc(1, sizeof(blockbuf_t));
-        bb->bb_fileid = id;
-#if defined(SS_DEBUG)
-        bb->bb_chk_top = CHK_NUM_BLOCKBUF;
-        bb->bb_chk_tail = CHK_NUM_BLOCKBUF;
-#endif
-        simple_mutex_init(&bb->bb_mutex, "Blockbuf mutex");
-        bb->bb_buf_left = MAX_LOGSTRLEN;
-        bb->bb_buf_size = MAX_LOGSTRLEN;
-
-#if defined(SS_LOG_DEBUG)
-	sprintf(bb->bb_buf,"[block:%d]",atomic_add(&block_start_index,1));
-	bb->bb_buf_used += strlen(bb->bb_buf);
-	bb->bb_buf_left -= strlen(bb->bb_buf);
-#endif
+        if (rec->lr_type == LOG_BINARY_EVENT)
+        {
+                memcpy(&fmtid, br + 1, sizeof(fmtid));
 
-        CHK_BLOCKBUF(bb);
-        return bb;
+                if ((fwr->fwr_defined[id][fmtid / 8] & (1 << (fmtid % 8))) == 0)
+                {
+                        len = strlen(logfmts[fmtid].fmt_str) + 1;
+                        hdr = (log_binary_rec_t *)filewriter_arena_alloc(fwr,
+                                                                         sizeof(*hdr) + sizeof(fmtid));
+                        hdr->br_size = sizeof(*hdr) + sizeof(fmtid) + len;
+                        hdr->br_type = LOG_BINARY_FORMAT;
+                        hdr->br_time = rec->lr_time;
+                        memcpy(hdr + 1, &fmtid, sizeof(fmtid));
+                        filewriter_add_iov(fwr, id, hdr, sizeof(*hdr) + sizeof(fmtid));
+                        filewriter_add_iov(fwr, id, logfmts[fmtid].fmt_str, len);
+                        fwr->fwr_defined[id][fmtid / 8] |= 1 << (fmtid % 8);
+                }
+        }
+        br->br_size = rec->lr_len;
+        br->br_type = rec->lr_type;
+        br->br_time = rec->lr_time;
+        filewriter_add_iov(fwr, id, br, rec->lr_len);
 }
 
 
@@ -1372,7 +2204,7 @@ int skygw_log_write_flush(
 {
         int     i,err = 0;
         va_list valist;
-        size_t  len;
+        size_t  len = 0;
 
         if (!logmanager_register(true)) 
 	{
@@ -1381,16 +2213,6 @@ int skygw_log_write_flush(
         }
         CHK_LOGMANAGER(lm);
 
-        /**
-         * Find out the length of log string (to be formatted str).
-         */
-        va_start(valist, str);
-        len = sizeof(char) * vsnprintf(NULL, 0, str, valist);
-        va_end(valist);
-        /**
-         * Add one for line feed.
-         */
-        len += sizeof(char);
         /**
          * Write log string to buffer and add to file write list.
          */
@@ -1405,6 +2227,20 @@ int skygw_log_write_flush(
                 continue;
             }
 
+            /**
+             * Find out the length of log string (to be formatted str).
+             * Binary log files don't need it.
+             */
+            if (len == 0 && !(lm->lm_logfile[i].lf_binary && do_maxscalelog))
+            {
+                va_start(valist, str);
+                len = sizeof(char) * vsnprintf(NULL, 0, str, valist);
+                va_end(valist);
+                /**
+                 * Add one for line feed.
+                 */
+                len += sizeof(char);
+            }
             va_start(valist, str);
             err = logmanager_write_log((logfile_id_t)i, true, true, true, false, len, str, valist);
             va_end(valist);
@@ -1429,7 +2265,7 @@ int skygw_log_write(
 {
         int     i,err = 0;
         va_list valist;
-        size_t  len;
+        size_t  len = 0;
         
         if (!logmanager_register(true)) 
 	{
@@ -1443,16 +2279,6 @@ int skygw_log_write(
 	 * the current session, then unregister and return.
          */
 
-        /**
-         * Find out the length of log string (to be formatted str).
-         */
-        va_start(valist, str);
-            len = vsnprintf(NULL, 0, str, valist);
-        va_end(valist);
-        /**
-         * Add one for line feed.
-         */
-        len += 1;
         /**
          * Write log string to buffer and add to file write list.
          */
@@ -1468,6 +2294,20 @@ int skygw_log_write(
                 continue;
             }
 
+            /**
+             * Find out the length of log string (to be formatted str).
+             * Binary log files don't need it.
+             */
+            if (len == 0 && !(lm->lm_logfile[i].lf_binary && do_maxscalelog))
+            {
+                va_start(valist, str);
+                len = vsnprintf(NULL, 0, str, valist);
+                va_end(valist);
+                /**
+                 * Add one for line feed.
+                 */
+                len += 1;
+            }
             va_start(valist, str);
             err = logmanager_write_log((logfile_id_t)i, false, true, true, false, len, str, valist);
             va_end(valist);
@@ -1687,6 +2527,7 @@ static bool fnames_conf_init(
                 "-l <syslog log file ids> .......(no default)\n"
                 "-m <syslog ident>   ............(argv[0])\n"
                 "-s <shmem log file ids>  .......(no default)\n"
+                "-x <binary log file ids> .......(no default)\n"
                 "-o                       .......(write logs to stdout)\n";
 
         /**
@@ -1698,7 +2539,7 @@ static bool fnames_conf_init(
         fn->fn_chk_tail = CHK_NUM_FNAMES;
 #endif
         optind = 1; /**<! reset getopt index */
-        while ((opt = getopt(argc, argv, "+a:b:c:d:e:f:g:h:i:j:l:m:s:o")) != -1)
+        while ((opt = getopt(argc, argv, "+a:b:c:d:e:f:g:h:i:j:l:m:s:x:o")) != -1)
         {
                 switch (opt) {
                 case 'o':
@@ -1763,6 +2604,11 @@ static bool fnames_conf_init(
                         /** record list of log file ids for later use */
                         shmem_id_str = optarg;
                         break;
+
+                case 'x':
+                        /** record list of log file ids written in binary */
+                        binary_id_str = optarg;
+                        break;
                 case 'h':
                 default:
                         fprintf(stderr,
@@ -1922,6 +2768,7 @@ static bool logfiles_init(
         int   i     = 0;
         bool  store_shmem;
         bool  write_syslog;
+        bool  binary;
 
 	/** Open syslog immediately. Print pid of loggind process. */
         if (syslog_id_str != NULL)
@@ -1959,11 +2806,19 @@ static bool logfiles_init(
                 {
                         write_syslog = false;
                 }
+                /**
+                 * Check if file is written in binary format.
+                 */
+                binary = (binary_id_str != NULL &&
+                          strcasestr(binary_id_str,
+                                     STRLOGID(logfile_id_t(lid))) != NULL);
+
                 succp = logfile_init(&lm->lm_logfile[lid],
                                      (logfile_id_t)lid,
                                      lm,
                                      store_shmem,
-                                     write_syslog);
+                                     write_syslog,
+                                     binary);
                
                 if (!succp) {
                         fprintf(stderr, "*\n* Error : Initializing log files failed.\n");
@@ -2219,6 +3074,26 @@ static bool logfile_open_file(
             }
             free(start_msg_str);
         }
+
+        if (lf->lf_binary)
+        {
+                /** Records follow the magic, formats are rewritten to each file */
+                err = skygw_file_write(fw->fwr_file[lf->lf_id],
+                                       (void *)LOG_BINARY_MAGIC,
+                                       LOG_BINARY_MAGIC_LEN,
+                                       true);
+                if (err != 0)
+                {
+                        fprintf(stderr,
+                                "Error : writing to file %s failed due to %d, %s.\n",
+                                lf->lf_full_file_name,
+                                err,
+                                strerror(err));
+                        succp = false;
+                        goto return_succp;
+                }
+                memset(fw->fwr_defined[lf->lf_id], 0, sizeof(fw->fwr_defined[lf->lf_id]));
+        }
 	succp = true;
 	
 return_succp:
@@ -2499,7 +3374,8 @@ static bool logfile_init(
         logfile_id_t   logfile_id,
         logmanager_t*  logmanager,
         bool           store_shmem,
-        bool           write_syslog)
+        bool           write_syslog,
+        bool           binary)
 {
         bool           succp = false;
         fnames_conf_t* fn = &logmanager->lm_fnames_conf;
@@ -2520,6 +3396,20 @@ static bool logfile_init(
         logfile->lf_spinlock = 0;
         logfile->lf_store_shmem = store_shmem;
         logfile->lf_write_syslog = write_syslog;
+        logfile->lf_binary = binary;
+
+        if (binary && logfile->lf_name_suffix != NULL)
+        {
+                /** Binary files are named <prefix><seqno><suffix>.bin */
+                char* suffix = (char *)malloc(strlen(logfile->lf_name_suffix) + 5);
+
+                if (suffix != NULL)
+                {
+                        sprintf(suffix, "%s.bin", logfile->lf_name_suffix);
+                        free(logfile->lf_name_suffix);
+                        logfile->lf_name_suffix = suffix;
+                }
+        }
         logfile->lf_buf_size = MAX_LOGSTRLEN;
         logfile->lf_enabled = logmanager->lm_enabled_logfiles & logfile_id;
         /**
@@ -2564,22 +3454,6 @@ static bool logfile_init(
 	{
 		goto return_with_succp;
 	}
-        /**
-         * Create a block buffer list for log file. Clients' writes go to buffers
-         * from where separate log flusher thread writes them to disk.
-         */
-        if (mlist_init(&logfile->lf_blockbuf_list,
-                       NULL,
-                       strdup("logfile block buffer list"),
-                       blockbuf_node_done,
-                       MAXNBLOCKBUFS) == NULL)
-        {
-                ss_dfprintf(stderr,
-                            "*\n* Error : Initializing buffers for log files "
-                            "failed.");
-                logfile_free_memory(logfile);
-                goto return_with_succp;
-        }
 
 #if defined(SS_DEBUG)
         if (store_shmem && !use_stdout)
@@ -2637,11 +3511,6 @@ static void logfile_done(
 		    ss_dassert(lf->lf_npending_writes == 0);
 		    /** fallthrough */
             case INIT:
-		    /** Test if list is initialized before freeing it */
-		    if (lf->lf_blockbuf_list.mlist_versno != 0)
-		    {
-			mlist_done(&lf->lf_blockbuf_list);
-		    }
 		    logfile_free_memory(lf);
 		    lf->lf_state = DONE;
 		    /** fallthrough */
@@ -2758,7 +3627,7 @@ static void filewriter_done(
 
 
 /** 
- * @node Writes block buffers of logfiles to physical log files on disk.
+ * @node Writes the log rings of all threads to physical log files on disk.
  *
  * Parameters:
  * @param data - thread context, skygw_thread_t
@@ -2767,38 +3636,21 @@ static void filewriter_done(
  * @return 
  *
  * 
- * @details Waits until receives wake-up message. Scans through block buffer
- * lists of each logfile object.
+ * @details Waits until receives wake-up message. Log clients send it when
+ * a write is flushed, when their ring fills up past LOGRING_WAKEUP or when
+ * a logfile is flushed or rotated.
+ *
+ * Pending rotations are done first. Then everything in the rings is merged
+ * and written to the log files, see logrings_write.
  *
- * Block buffer is written to log file if
- * 1. bb_state == true,
- * 2. logfile object's lf_flushflag == true, or
+ * Log file is flushed (fsync'd) if
+ * 1. logfile object's lf_flushflag == true,
+ * 2. all logfiles are flushed with skygw_log_sync_all, or
  * 3. skygw_thread_must_exit returns true.
- * 
- * Log file is flushed (fsync'd) in cases #2 and #3.
- *
- * Concurrency control : block buffer is accessed by file writer (this) and
- * log clients. File writer reads and sets each logfile object's flushflag
- * with spinlock. Another protected section is when block buffer's metadata is
- * read, and optionally the write operation.
- *
- * When block buffer is marked full, logfile's flushflag is set, other
- * log clients don't try to access buffer(s). There may, however, be
- * active writes, on the block in parallel with file writer operations.
- * Each active write corresponds to bb_refcounter values.
- * On the other hand, file writer doesn't process the block buffer before
- * its refcount is zero.
- *
- * Every log file obj. has its own block buffer (linked) list.
- * List is accessed by log clients, which add nodes if necessary, and
- * by file writer which traverses the list and accesses block buffers
- * included in list nodes.
- * List modifications are protected with version numbers.
- * Before
- modification, version is increased by one to be odd. After the
- * completion, it is increased again to even. List can be read only when
- * version is even and read is consistent only if version hasn't changed
- * during the read.
+ *
+ * Concurrency control : file writer reads and sets each logfile object's
+ * flush- and rotateflag with spinlock. The rings need no locking since the
+ * file writer is the only reader of each of them.
  */
 static void* thr_filewriter_fun(
         void* data)
@@ -2807,21 +3659,15 @@ static void* thr_filewriter_fun(
         filewriter_t*   fwr;
         skygw_file_t*   file;
         logfile_t*      lf;
-            
-        mlist_t*      bb_list;
-        blockbuf_t*   bb;
-        mlist_node_t* node;
-        int           i;
-        blockbuf_state_t          flush_blockbuf;   /**< flush single block buffer. */
-        bool          flush_logfile;    /**< flush logfile */
-		bool		  do_flushall = false;
-        bool          rotate_logfile;   /*< close current and open new file */
-        size_t        vn1;
-        size_t        vn2;
+        int             i;
+        bool            flush_logfile[LOGFILE_LAST+1];
+        bool            do_flushall = false;
+        bool            rotate_logfile;   /*< close current and open new file */
 
         thr = (skygw_thread_t *)data;
         fwr = (filewriter_t *)skygw_thread_get_data(thr);
-		flushall_logfiles(false);
+        tls_is_filewriter = true;
+	flushall_logfiles(false);
 
         CHK_FILEWRITER(fwr);
         ss_debug(skygw_thread_set_state(thr, THR_RUNNING));
@@ -2835,21 +3681,13 @@ static void* thr_filewriter_fun(
                  * Reset message to avoid redundant calls.
                  */
                 skygw_message_wait(fwr->fwr_logmes);
-				if(skygw_thread_must_exit(thr)){
-				    flushall_logfiles(true);
-				}
-            
-                /** Process all logfiles which have buffered writes. */
+		do_flushall = thr_flushall_check();
+
                 for (i=LOGFILE_FIRST; i<=LOGFILE_LAST; i <<= 1)
 		{
-                retry_flush_on_exit:
                         /**
                          * Get file pointer of current logfile.
                          */
-
-
-
-						do_flushall = thr_flushall_check();
                         file = fwr->fwr_file[i];
                         lf = &lm->lm_logfile[(logfile_id_t)i];
 
@@ -2857,7 +3695,7 @@ static void* thr_filewriter_fun(
                          * read and reset logfile's flush- and rotateflag
                          */
                         acquire_lock(&lf->lf_spinlock);
-                        flush_logfile     = lf->lf_flushflag;
+                        flush_logfile[i]  = lf->lf_flushflag || do_flushall;
 			rotate_logfile    = lf->lf_rotateflag;
                         lf->lf_flushflag  = false;
 			lf->lf_rotateflag = false;
@@ -2894,131 +3732,53 @@ static void* thr_filewriter_fun(
 						"logging to existing file.",
 						lf->lf_full_file_name)));
 				}
-				continue;
 			}
-                        /**
-                         * get logfile's block buffer list
-                         */
-                        bb_list = &lf->lf_blockbuf_list;
-#if defined(SS_DEBUG)
-                        simple_mutex_lock(&bb_list->mlist_mutex, true);
-                        CHK_MLIST(bb_list);
-                        simple_mutex_unlock(&bb_list->mlist_mutex);
-#endif
-                        node = bb_list->mlist_first;
-                
-                        while (node != NULL) 
-			{
-				int err = 0;
-				
-                                CHK_MLIST_NODE(node);
-                                bb = (blockbuf_t *)node->mlnode_data;
-                                CHK_BLOCKBUF(bb);
-
-                                /** Lock block buffer */
-                                simple_mutex_lock(&bb->bb_mutex, true);
-
-                                flush_blockbuf = bb->bb_state;
-                    
-                                if (bb->bb_buf_used != 0 &&
-                                    (flush_blockbuf == BB_FULL ||
-                                     flush_logfile ||
-                                     do_flushall))
-                                {
-                                        /**
-                                         * buffer is at least half-full
-                                         * -> write to disk
-                                         */
-                                        while(bb->bb_refcount > 0) 
-					{
-                                                simple_mutex_unlock(
-                                                        &bb->bb_mutex);
-                                                simple_mutex_lock(
-                                                        &bb->bb_mutex,
-                                                        true);
-                                        }
-                                        err = skygw_file_write(
-						file,
-						(void *)bb->bb_buf,
-						bb->bb_buf_used,
-						(flush_logfile || 
-						    do_flushall));
-					if (err)
-					{
-						fprintf(stderr,
-							"Error : Write to %s log "
-							": %s failed due to %d, "
-							"%s. Disabling the log.",
-							STRLOGNAME((logfile_id_t)i),
-							lf->lf_full_file_name,
-							err,
-							strerror(err));
-						/** Force log off */
-						skygw_log_disable_raw((logfile_id_t)i, true);
-					}
-                                        /**
-                                         * Reset buffer's counters and mark
-                                         * not full.
-                                         */
-                                        bb->bb_buf_left = bb->bb_buf_size;
-                                        bb->bb_buf_used = 0;
-                                        memset(bb->bb_buf, 0, bb->bb_buf_size);
-                                        bb->bb_state = BB_CLEARED;
-#if defined(SS_LOG_DEBUG)
-					sprintf(bb->bb_buf,"[block:%d]",atomic_add(&block_start_index,1));
-					bb->bb_buf_used += strlen(bb->bb_buf);
-					bb->bb_buf_left -= strlen(bb->bb_buf);
-#endif
+                }/* for */
 
-                                }
-                                /** Release lock to block buffer */
-                                simple_mutex_unlock(&bb->bb_mutex);
-                    
-                                /** Consistent lock-free read on the list */
-                                do {
-                                        while ((vn1 = bb_list->mlist_versno)%2
-                                               != 0);
-                                        node = node->mlnode_next;
-                                        vn2 = bb_list->mlist_versno;
-                                } while (vn1 != vn2);
-                    
-                        } /* while (node != NULL) */
+                logrings_write(fwr, flush_logfile);
 
-                        /**
-                         * Writer's exit flag was set after checking it.
-                         * Loop is restarted to ensure that all logfiles are
-                         * flushed.
-                         */
+		if(flushall_started_flag){
+			flushall_started_flag = false;
+			flushall_logfiles(false);
+			skygw_message_send(fwr->fwr_clientmes);
+		}
+        } /* while (!skygw_thread_must_exit) */
 
-						if(flushall_started_flag){
-							flushall_started_flag = false;
-							flushall_done_flag = true;
-							i = LOGFILE_FIRST;
-							    goto retry_flush_on_exit;
-						}
+        /** Write what was logged after the last wake-up */
+        for (i=LOGFILE_FIRST; i<=LOGFILE_LAST; i <<= 1)
+        {
+                flush_logfile[i] = true;
+        }
+        logrings_write(fwr, flush_logfile);
 
-                        if (!thr_flushall_check() && skygw_thread_must_exit(thr))
-                        {
-							    flushall_logfiles(true);
-                                i = LOGFILE_FIRST;
-                                goto retry_flush_on_exit;
-                        }
-                }/* for */
-				
-				if(flushall_done_flag){
-					flushall_done_flag = false;
-					flushall_logfiles(false);
-					skygw_message_send(fwr->fwr_clientmes);
-				}
-				
-        } /* while (!skygw_thread_must_exit) */
-        
         ss_debug(skygw_thread_set_state(thr, THR_STOPPED));
         /** Inform log manager that file writer thread has stopped. */
         skygw_message_send(fwr->fwr_clientmes);
         return NULL;
 }
 
+/**
+ * Report a failed write to a log file and disable the log.
+ *
+ * @param id	logfile object identifier
+ * @param err	error number of the failed write
+ */
+static void logfile_write_failed(
+        logfile_id_t id,
+        int          err)
+{
+        fprintf(stderr,
+                "Error : Write to %s log "
+                ": %s failed due to %d, "
+                "%s. Disabling the log.",
+                STRLOGNAME(id),
+                lm->lm_logfile[id].lf_full_file_name,
+                err,
+                strerror(err));
+        /** Force log off */
+        skygw_log_disable_raw(id, true);
+}
+
 
 static void fnames_conf_done(
         fnames_conf_t* fn)
@@ -3117,7 +3877,7 @@ bool thr_flushall_check()
 	bool rval = false;
 	simple_mutex_lock(&lm->lm_mutex,true);	
 	rval = flushall_flag;
-	if(rval && !flushall_started_flag && !flushall_done_flag){
+	if(rval && !flushall_started_flag){
 		flushall_started_flag = true;
 	}
 	simple_mutex_unlock(&lm->lm_mutex);
@@ -18,17 +18,14 @@
 #if !defined(LOG_MANAGER_H)
 # define LOG_MANAGER_H
 
+#include <stdint.h>
+#include <stddef.h>
+
 typedef struct filewriter_st  filewriter_t;
 typedef struct logfile_st     logfile_t;
 typedef struct fnames_conf_st fnames_conf_t;
 typedef struct logmanager_st  logmanager_t;
 
-typedef enum {
-  BB_READY = 0x00,
-  BB_FULL,
-  BB_CLEARED
-} blockbuf_state_t;
-
 typedef enum {
     LOGFILE_ERROR = 1,
     LOGFILE_FIRST = LOGFILE_ERROR,
@@ -51,6 +48,43 @@ typedef struct log_info_st
 	int    li_enabled_logs;
 } log_info_t;
     
+/**
+ * Binary log files. The log manager writes the log files given with the
+ * -x option as binary records instead of text. The caller only stores the
+ * id of the format string, the clock and the raw arguments, and the
+ * formatting is done afterwards by the maxlogdecode tool.
+ *
+ * A binary log file starts with the normal text header followed by
+ * LOG_BINARY_MAGIC and a stream of records. All integers are in host
+ * byte order.
+ *
+ * LOG_BINARY_CLOCK	uint64_t realtime in ns at br_time, uint64_t clock
+ *			ticks per second
+ * LOG_BINARY_FORMAT	uint32_t format id, nul-terminated format string;
+ *			written before the first event using the format
+ * LOG_BINARY_EVENT	uint32_t format id, uint32_t unused, uint64_t
+ *			session id and the arguments: int as int32_t, long
+ *			and long long as int64_t, double, pointers as
+ *			uint64_t and strings as uint32_t length and data
+ * LOG_BINARY_TEXT	uint64_t session id and the formatted string, used
+ *			when the format can't be deferred
+ */
+#define LOG_BINARY_MAGIC     "MXSBLOG1"
+#define LOG_BINARY_MAGIC_LEN 8
+
+typedef enum {
+    LOG_BINARY_CLOCK = 1,
+    LOG_BINARY_FORMAT,
+    LOG_BINARY_EVENT,
+    LOG_BINARY_TEXT
+} log_binary_type_t;
+
+typedef struct log_binary_rec_st {
+        uint32_t br_size;  /**< Record size including this header */
+        uint32_t br_type;  /**< log_binary_type_t */
+        uint64_t br_time;  /**< Clock ticks when the record was written */
+} log_binary_rec_t;
+
 #define LE LOGFILE_ERROR
 #define LM LOGFILE_MESSAGE
 #define LT LOGFILE_TRACE
@@ -122,6 +156,12 @@ void skygw_log_sync_all(void);
 void skygw_set_highp(int);
 void logmanager_enable_syslog(int);
 void logmanager_enable_maxscalelog(int);
+int  skygw_log_binary_render(
+        const char*    format,
+        const uint8_t* args,
+        size_t         len,
+        char*          buf,
+        size_t         size);
 
 EXTERN_C_BLOCK_END
 
@@ -0,0 +1,317 @@
+/*
+ * This file is distributed as part of the MariaDB Corporation MaxScale.  It is free
+ * software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation,
+ * version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright MariaDB Corporation Ab 2013-2014
+ */
+
+/**
+ * @file maxlogdecode.c - Render binary log files as text
+ *
+ * Reads log files written in binary format, see the -x option of the log
+ * manager, and prints them in the same format as the text log files.
+ */
+#if !defined(_GNU_SOURCE)
+#  define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <skygw_utils.h>
+#include <log_manager.h>
+
+#define MAXFORMATS 4096
+#define TEXTLEN    (64*1024)
+
+typedef struct decoder_st {
+	char*		formats[MAXFORMATS];	/*< Format strings by id */
+	uint64_t	realtime;		/*< Real time in ns of the last clock record */
+	uint64_t	clock;			/*< Clock ticks of the last clock record */
+	uint64_t	hz;			/*< Clock ticks per second */
+	char		text[TEXTLEN];
+} DECODER;
+
+/**
+ * Print the time stamp and session id of a log event.
+ *
+ * @param dec	The decoder
+ * @param ticks	Clock ticks when the event was written
+ * @param sesid	Session id, not printed if zero
+ */
+static void
+print_prefix(DECODER *dec, uint64_t ticks, uint64_t sesid)
+{
+	double		diff;
+	uint64_t	ns;
+	time_t		sec;
+	struct tm	tm;
+
+	diff = ((double)ticks - (double)dec->clock) * 1000000000.0 /
+		(double)(dec->hz ? dec->hz : 1000000000);
+	ns = dec->realtime + (int64_t)diff;
+	sec = ns / 1000000000;
+	localtime_r(&sec, &tm);
+	printf("%04d-%02d-%02d %02d:%02d:%02d.%03d   ",
+		tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+		tm.tm_hour, tm.tm_min, tm.tm_sec,
+		(int)((ns % 1000000000) / 1000000));
+
+	if (sesid != 0)
+	{
+		printf("[%llu]  ", (unsigned long long)sesid);
+	}
+}
+
+/**
+ * Print a log string ending with a line feed. As in text log files, the
+ * line feed of a string that already ends with one is replaced by a space.
+ *
+ * @param text	The log string
+ * @param len	Length of the string
+ */
+static void
+print_text(const char *text, size_t len)
+{
+	if (len > 0 && text[len - 1] == '\n')
+	{
+		fwrite(text, 1, len - 1, stdout);
+		putchar(' ');
+	}
+	else
+	{
+		fwrite(text, 1, len, stdout);
+	}
+	putchar('\n');
+}
+
+/**
+ * Decode one record of a binary log file.
+ *
+ * @param dec	The decoder
+ * @param rec	The record header
+ * @param data	The record payload
+ * @param len	Length of the payload
+ * @return False if the record is invalid
+ */
+static bool
+decode_record(DECODER *dec, log_binary_rec_t *rec, const uint8_t *data, size_t len)
+{
+	uint32_t	fmtid;
+	uint64_t	u64[2];
+	int		n;
+
+	switch (rec->br_type)
+	{
+	case LOG_BINARY_CLOCK:
+		if (len < sizeof(u64))
+			return false;
+		memcpy(u64, data, sizeof(u64));
+		dec->realtime = u64[0];
+		dec->hz = u64[1];
+		dec->clock = rec->br_time;
+		return true;
+
+	case LOG_BINARY_FORMAT:
+		if (len <= sizeof(fmtid) || data[len - 1] != '\0')
+			return false;
+		memcpy(&fmtid, data, sizeof(fmtid));
+		if (fmtid >= MAXFORMATS)
+			return false;
+		free(dec->formats[fmtid]);
+		dec->formats[fmtid] = strdup((const char *)data + sizeof(fmtid));
+		return true;
+
+	case LOG_BINARY_EVENT:
+		if (len < 2 * sizeof(uint32_t) + sizeof(uint64_t))
+			return false;
+		memcpy(&fmtid, data, sizeof(fmtid));
+		memcpy(u64, data + 2 * sizeof(uint32_t), sizeof(uint64_t));
+		if (fmtid >= MAXFORMATS || dec->formats[fmtid] == NULL)
+			return false;
+		data += 2 * sizeof(uint32_t) + sizeof(uint64_t);
+		len -= 2 * sizeof(uint32_t) + sizeof(uint64_t);
+		if ((n = skygw_log_binary_render(dec->formats[fmtid], data, len,
+			dec->text, sizeof(dec->text))) < 0)
+			return false;
+		print_prefix(dec, rec->br_time, u64[0]);
+		print_text(dec->text, n);
+		return true;
+
+	case LOG_BINARY_TEXT:
+		if (len < sizeof(uint64_t))
+			return false;
+		memcpy(u64, data, sizeof(uint64_t));
+		print_prefix(dec, rec->br_time, u64[0]);
+		print_text((const char *)data + sizeof(uint64_t), len - sizeof(uint64_t));
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+/**
+ * Check if data is text written by the log manager itself, like the file
+ * headers and the line written when a file is closed.
+ *
+ * @param p	The data
+ * @param len	Length of the data
+ * @return True if all characters are printable
+ */
+static bool
+is_text(const uint8_t *p, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+	{
+		if (!isprint(p[i]) && p[i] != '\n' && p[i] != '\t')
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Decode a binary log file. A file that has been reopened contains a
+ * header and the magic for each time it was opened. Text between the
+ * records is printed as such, decoding continues from the next magic
+ * after any data that is not a valid record.
+ *
+ * @param dec	The decoder
+ * @param buf	Contents of the file
+ * @param size	Size of the file
+ * @return Number of invalid records skipped
+ */
+static int
+decode_file(DECODER *dec, uint8_t *buf, size_t size)
+{
+	log_binary_rec_t	rec;
+	uint8_t			*p = buf;
+	uint8_t			*end = buf + size;
+	uint8_t			*magic;
+	int			nerrors = 0;
+
+	while (p < end)
+	{
+		magic = memmem(p, end - p, LOG_BINARY_MAGIC, LOG_BINARY_MAGIC_LEN);
+
+		if (magic == NULL)
+		{
+			magic = end;
+		}
+
+		if (is_text(p, magic - p))
+		{
+			fwrite(p, 1, magic - p, stdout);
+		}
+		else
+		{
+			nerrors++;
+		}
+
+		if (magic == end)
+		{
+			break;
+		}
+		p = magic + LOG_BINARY_MAGIC_LEN;
+
+		while (end - p >= (ssize_t)sizeof(rec))
+		{
+			memcpy(&rec, p, sizeof(rec));
+
+			if (rec.br_size < sizeof(rec) || rec.br_size > (size_t)(end - p) ||
+				!decode_record(dec, &rec, p + sizeof(rec), rec.br_size - sizeof(rec)))
+			{
+				break;
+			}
+			p += rec.br_size;
+		}
+	}
+	return nerrors;
+}
+
+/**
+ * Render binary log files as text to the standard output
+ *
+ * @param argc	Argument count
+ * @param argv	Argument vector
+ */
+int
+main(int argc, char **argv)
+{
+	DECODER	*dec;
+	FILE	*fp;
+	uint8_t	*buf;
+	long	size;
+	int	i;
+	int	rval = 0;
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "Usage: %s <binary log file>...\n", argv[0]);
+		return 1;
+	}
+
+	if ((dec = calloc(1, sizeof(DECODER))) == NULL)
+	{
+		fprintf(stderr, "Error: Memory allocation failed.\n");
+		return 1;
+	}
+
+	for (i = 1; i < argc; i++)
+	{
+		if ((fp = fopen(argv[i], "r")) == NULL)
+		{
+			fprintf(stderr, "Error: Failed to open %s.\n", argv[i]);
+			rval = 1;
+			continue;
+		}
+		fseek(fp, 0, SEEK_END);
+		size = ftell(fp);
+		rewind(fp);
+
+		buf = size >= 0 ? malloc(size + 1) : NULL;
+
+		if (buf == NULL || fread(buf, 1, size, fp) != (size_t)size)
+		{
+			fprintf(stderr, "Error: Failed to read %s.\n", argv[i]);
+			free(buf);
+			fclose(fp);
+			rval = 1;
+			continue;
+		}
+		fclose(fp);
+
+		if (decode_file(dec, buf, size) > 0)
+		{
+			fprintf(stderr, "Warning: Invalid records in %s were skipped.\n",
+				argv[i]);
+			rval = 1;
+		}
+		free(buf);
+	}
+
+	for (i = 0; i < MAXFORMATS; i++)
+	{
+		free(dec->formats[i]);
+	}
+	free(dec);
+	return rval;
+}
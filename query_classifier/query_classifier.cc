@@ -60,6 +60,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#include <ctype.h>
+
+EXTERN_C_BLOCK_BEGIN
+#include <spinlock.h>
+#include <atomic.h>
+#include <maxconfig.h>
+EXTERN_C_BLOCK_END
 
 extern int            lm_enabled_logfiles_bitmask;
 extern size_t         log_ses_count[];
@@ -79,6 +86,89 @@ static int is_autocommit_stmt(LEX* lex);
 static void parsing_info_set_plain_str(void* ptr, char* str);
 static void* skygw_get_affected_tables(void* lexptr);
 
+/** Number of independently locked partitions of the classification cache */
+#define QC_CACHE_STRIPES	16
+/** Length of the longest canonical statement that is cached */
+#define QC_CACHE_MAX_KEY	2048
+/**
+ * Query types that depend on the values of the literals, for example
+ * SET autocommit=0 and SET autocommit=1, or on the state of the session.
+ * Statements of these types are always parsed.
+ */
+#define QC_CACHE_UNCACHEABLE	(QUERY_TYPE_SESSION_WRITE | \
+				 QUERY_TYPE_GSYSVAR_WRITE | \
+				 QUERY_TYPE_ENABLE_AUTOCOMMIT | \
+				 QUERY_TYPE_DISABLE_AUTOCOMMIT | \
+				 QUERY_TYPE_PREPARE_NAMED_STMT | \
+				 QUERY_TYPE_PREPARE_STMT | \
+				 QUERY_TYPE_CREATE_TMP_TABLE)
+
+/**
+ * A cached classification of a statement. The entry is shared by the cache
+ * and the buffers it has been attached to, the last one to let go of it
+ * frees it.
+ */
+typedef struct qc_cache_entry {
+	char*			key;		/*< Statement without literals */
+	int			keylen;		/*< Length of the key */
+	uint64_t		hash;		/*< Hash of the key */
+	skygw_query_type_t	qtype;		/*< Type of the statement */
+	skygw_query_op_t	op;		/*< Operation of the statement */
+	char**			tables;		/*< Table names as written */
+	int			n_tables;
+	char**			fulltables;	/*< Table names with the database */
+	int			n_fulltables;
+	bool			has_tables;	/*< False if the tables need parsing */
+	int			refcount;	/*< Cache and buffer references */
+	struct qc_cache_entry*	next;		/*< Next entry in the hash chain */
+	struct qc_cache_entry*	lru_prev;	/*< More recently used entry */
+	struct qc_cache_entry*	lru_next;	/*< Less recently used entry */
+} QC_CACHE_ENTRY;
+
+/**
+ * A partition of the cache with its own lock, hash table and LRU list
+ */
+typedef struct {
+	SPINLOCK		lock;
+	QC_CACHE_ENTRY**	buckets;
+	int			n_buckets;
+	int			n_entries;
+	int			max_entries;
+	QC_CACHE_ENTRY*		lru_head;	/*< Most recently used */
+	QC_CACHE_ENTRY*		lru_tail;	/*< Next to be evicted */
+} QC_CACHE_STRIPE;
+
+static QC_CACHE_STRIPE	qc_cache[QC_CACHE_STRIPES];
+static SPINLOCK		qc_cache_lock = SPINLOCK_INIT;
+static int		qc_cache_size = -1;	/*< -1 until the cache is initialised */
+static int		qc_cache_hits;
+static int		qc_cache_misses;
+static int		qc_cache_evictions;
+static int		qc_cache_uncacheable;
+static int		qc_fast_hits;
+
+static QC_CACHE_ENTRY* qc_cache_find(
+        GWBUF*    querybuf,
+        char*     key,
+        int*      keylen,
+        uint64_t* hash);
+static void qc_cache_add(
+        GWBUF*             querybuf,
+        char*              key,
+        int                keylen,
+        uint64_t           hash,
+        skygw_query_type_t qtype);
+static QC_CACHE_ENTRY* qc_cache_entry_of(GWBUF* querybuf);
+static bool qc_parse_cached(GWBUF* querybuf);
+static char* qc_query_str(GWBUF* querybuf, int* len);
+static int qc_digest(
+        const char* sql,
+        int         len,
+        char*       dest,
+        int         size,
+        uint64_t*   hash);
+static QC_CACHE_ENTRY* qc_fast_find(GWBUF* querybuf);
+
 
 /**
  * Calls parser for the query includede in the buffer. Creates and adds parsing 
@@ -94,6 +184,9 @@ skygw_query_type_t query_classifier_get_type(
         MYSQL*             mysql;
         skygw_query_type_t qtype = QUERY_TYPE_UNKNOWN;
         bool               succp;
+        char               key[QC_CACHE_MAX_KEY];
+        int                keylen = -1;
+        uint64_t           hash = 0;
         
         ss_info_dassert(querybuf != NULL, ("querybuf is NULL"));
         
@@ -107,6 +200,18 @@ skygw_query_type_t query_classifier_get_type(
         
         if (!succp)
         {
+                QC_CACHE_ENTRY* entry;
+
+                /**
+                 * A trivial statement that the tokenizer can classify or a
+                 * statement of the same shape that was classified earlier
+                 */
+                if ((entry = qc_fast_find(querybuf)) != NULL ||
+                        (entry = qc_cache_find(querybuf, key, &keylen, &hash)) != NULL)
+                {
+                        qtype = entry->qtype;
+                        goto retblock;
+                }
                 succp = parse_query(querybuf);
         }
         /** Read thd pointer and resolve the query type with it. */
@@ -125,6 +230,11 @@ skygw_query_type_t query_classifier_get_type(
                         if (mysql != NULL)
                         {
                                 qtype = resolve_query_type((THD *)mysql->thd);
+
+                                if (keylen >= 0)
+                                {
+                                        qc_cache_add(querybuf, key, keylen, hash, qtype);
+                                }
                         }
                 }
         }
@@ -973,7 +1083,8 @@ LEX* get_lex(GWBUF* querybuf)
 	MYSQL*          mysql;
 	THD*            thd;
 		
-	if (querybuf == NULL || !GWBUF_IS_PARSED(querybuf))
+	if (querybuf == NULL || 
+		(!GWBUF_IS_PARSED(querybuf) && !qc_parse_cached(querybuf)))
 	{
 		return NULL;
 	}
@@ -1034,6 +1145,31 @@ char** skygw_get_table_names(GWBUF* querybuf, int* tblsize, bool fullnames)
 			currtblsz = 0;
 	char		**tables = NULL,
 			**tmp = NULL;
+	QC_CACHE_ENTRY*	entry;
+
+	if (querybuf != NULL && tblsize != NULL &&
+		(entry = qc_cache_entry_of(querybuf)) != NULL &&
+		entry->has_tables)
+	{
+		char**	names = fullnames ? entry->fulltables : entry->tables;
+
+		i = fullnames ? entry->n_fulltables : entry->n_tables;
+
+		if (i > 0 && (tables = (char**)malloc(sizeof(char*) * i)) != NULL)
+		{
+			int x;
+
+			for (x = 0; x < i; x++)
+			{
+				tables[x] = strdup(names[x]);
+			}
+		}
+		else
+		{
+			i = 0;
+		}
+		goto retblock;
+	}
 
 	if(querybuf == NULL || 
 		tblsize == NULL || 
@@ -1191,7 +1327,12 @@ retblock:
 bool is_drop_table_query(GWBUF* querybuf)
 {
 	LEX* lex;
-        
+	QC_CACHE_ENTRY* entry;
+
+	if (querybuf != NULL && (entry = qc_cache_entry_of(querybuf)) != NULL)
+	{
+		return entry->op == QUERY_OP_DROP_TABLE;
+	}
 	return (querybuf != NULL &&
 		(lex = get_lex(querybuf)) != NULL &&
 		lex->sql_command == SQLCOM_DROP_TABLE);
@@ -1323,96 +1464,62 @@ bool skygw_query_has_clause(GWBUF* buf)
 	return clause;
 }
 
-/*
- * Replace user-provided literals with question marks. Return a copy of the
- * querystr with replacements.
- * 
- * @param querybuf      GWBUF buffer including necessary parsing info
- * 
- * @return Copy of querystr where literals are replaces with question marks or
- * NULL if querystr is NULL, thread context or lex are NULL or if replacement
- * function fails.
- * 
- * Replaced literal types are STRING_ITEM,INT_ITEM,DECIMAL_ITEM,REAL_ITEM,
- * VARBIN_ITEM,NULL_ITEM
+/**
+ * Return the canonical form of the query, the query with the literal values
+ * replaced with question marks. The query does not need to be parsed.
+ *
+ * @param querybuf	The query buffer
+ * @return The canonical form, to be freed by the caller, or NULL
  */
 char* skygw_get_canonical(
         GWBUF* querybuf)
 {
-        parsing_info_t* pi;
-        MYSQL*          mysql;
-        THD*            thd;
-        LEX*            lex;
-        Item*           item;
-        char*           querystr;
-        
-        if (querybuf == NULL ||
-		!GWBUF_IS_PARSED(querybuf))
-        {
-                querystr = NULL;
-                goto retblock;
-        }
-        pi = (parsing_info_t *)gwbuf_get_buffer_object_data(querybuf, 
-                                                            GWBUF_PARSING_INFO);
-	CHK_PARSING_INFO(pi);
-	
-        if (pi == NULL)
-        {
-                querystr = NULL;
-                goto retblock;                
-        }
-        
-        if (pi->pi_query_plain_str == NULL || 
-                (mysql = (MYSQL *)pi->pi_handle) == NULL || 
-                (thd = (THD *)mysql->thd) == NULL ||
-                (lex = thd->lex) == NULL)
-        {
-                ss_dassert(pi->pi_query_plain_str != NULL &&
-                        mysql != NULL && 
-                        thd != NULL && 
-                        lex != NULL);
-                querystr = NULL;
-                goto retblock;
-        }
-        querystr = strdup(pi->pi_query_plain_str);
+	char*		sql;
+	char*		querystr;
+	int		len;
+	int		size;
+	uint64_t	hash;
 
-	for (item=thd->free_list; item != NULL; item=item->next) 
-        {
-                Item::Type itype;
-                
-		if (item->name == NULL)
-		{
-			continue;
-		}
-		itype = item->type();
+	if (querybuf == NULL || (sql = qc_query_str(querybuf, &len)) == NULL)
+	{
+		return NULL;
+	}
+	/** An empty string literal grows from two characters to three */
+	size = len + len / 2 + 1;
 
-		if (itype == Item::STRING_ITEM)
-		{
-			String tokenstr;
-			String* res = item->val_str_ascii(&tokenstr);
-			
-			if (res->is_empty()) /*< empty string */
-			{
-				querystr = replace_literal(querystr, "\"\"", "\"?\"");
-			}
-			else
-			{
-				querystr = replace_literal(querystr, res->ptr(), "?");
-			}
-		}
-		else if (itype == Item::INT_ITEM ||
-			itype == Item::DECIMAL_ITEM ||
-			itype == Item::REAL_ITEM ||
-			itype == Item::VARBIN_ITEM ||
-			itype == Item::NULL_ITEM)
-		{
-			querystr = replace_literal(querystr, item->name, "?");
-		}
-        } /*< for */
-retblock:
-        return querystr;
+	if ((querystr = (char*)malloc(size)) != NULL)
+	{
+		qc_digest(sql, len, querystr, size, &hash);
+	}
+	return querystr;
 }
 
+/**
+ * Compute the canonical form of a query and its hash in a single pass over
+ * the packet, without parsing or allocating memory. Queries that differ
+ * only in their literal values have the same digest.
+ *
+ * @param querybuf	The query buffer
+ * @param digest	Buffer for the digest, truncated if it does not fit
+ * @param size		Size of the buffer
+ * @param hash		Set to the 64-bit hash of the whole digest
+ * @return Length of the whole digest or -1 if the buffer holds no query
+ */
+int query_classifier_get_digest(
+        GWBUF*    querybuf,
+        char*     digest,
+        int       size,
+        uint64_t* hash)
+{
+	char*	sql;
+	int	len;
+
+	if (querybuf == NULL || (sql = qc_query_str(querybuf, &len)) == NULL)
+	{
+		return -1;
+	}
+	return qc_digest(sql, len, digest, size, hash);
+}
 
 /**
  * Create parsing information; initialize mysql handle, allocate parsing info 
@@ -1633,10 +1740,102 @@ retblock:
 	return databases;
 }
 
+/**
+ * Find the aggregate functions in the select list of a query whose result
+ * sets from several servers can be merged. This is the case for a single
+ * SELECT from tables without GROUP BY, HAVING, ORDER BY, LIMIT, DISTINCT
+ * or INTO, the rows of which can be concatenated or, if every column is
+ * an aggregate, combined into a single row.
+ * @param querybuf Buffer with the query
+ * @param aggs Set to an array with the aggregate function of each item of
+ * the select list, the caller must free it
+ * @return Number of items in the select list or -1 if the result sets of
+ * the query can't be merged
+ */
+int skygw_get_aggregates(GWBUF* querybuf, skygw_query_agg_t** aggs)
+{
+	LEX*			lex;
+	SELECT_LEX*		select;
+	Item*			item;
+	skygw_query_agg_t*	rval;
+	int			n = 0;
+
+	*aggs = NULL;
+
+	if((lex = get_lex(querybuf)) == NULL ||
+	   lex->sql_command != SQLCOM_SELECT ||
+	   lex->result != NULL ||
+	   (select = lex->all_selects_list) == NULL ||
+	   select->next_select_in_list() != NULL ||
+	   select->table_list.elements == 0 ||
+	   select->group_list.elements > 0 ||
+	   select->order_list.elements > 0 ||
+	   select->having != NULL ||
+	   select->select_limit != NULL ||
+	   (select->options & SELECT_DISTINCT))
+	{
+		return -1;
+	}
+
+	rval = (skygw_query_agg_t*)malloc(sizeof(skygw_query_agg_t) *
+					  (select->item_list.elements + 1));
+	if(rval == NULL)
+	{
+		return -1;
+	}
+
+	List_iterator<Item> ilist(select->item_list);
+
+	while((item = ilist++))
+	{
+		if(item->type() == Item::SUM_FUNC_ITEM)
+		{
+			switch(((Item_sum*)item)->sum_func())
+			{
+			case Item_sum::COUNT_FUNC:
+				rval[n] = QUERY_AGG_COUNT;
+				break;
+			case Item_sum::SUM_FUNC:
+				rval[n] = QUERY_AGG_SUM;
+				break;
+			case Item_sum::MIN_FUNC:
+				rval[n] = QUERY_AGG_MIN;
+				break;
+			case Item_sum::MAX_FUNC:
+				rval[n] = QUERY_AGG_MAX;
+				break;
+			default:
+				rval[n] = QUERY_AGG_OTHER;
+				break;
+			}
+		}
+		else if(item->with_sum_func)
+		{
+			/** An expression of aggregates, e.g. COUNT(*) + 1 */
+			rval[n] = QUERY_AGG_OTHER;
+		}
+		else
+		{
+			rval[n] = QUERY_AGG_NONE;
+		}
+		n++;
+	}
+	*aggs = rval;
+	return n;
+}
+
 skygw_query_op_t query_classifier_get_operation(GWBUF* querybuf)
 {
-	LEX* lex = get_lex(querybuf);
+	LEX* lex;
 	skygw_query_op_t operation = QUERY_OP_UNDEFINED;
+	QC_CACHE_ENTRY* entry;
+
+	if (querybuf != NULL && (entry = qc_cache_entry_of(querybuf)) != NULL)
+	{
+		return entry->op;
+	}
+	lex = get_lex(querybuf);
+
 	if(lex){
 		switch(lex->sql_command){
 		case SQLCOM_SELECT:
@@ -1675,6 +1874,12 @@ skygw_query_op_t query_classifier_get_operation(GWBUF* querybuf)
                 case SQLCOM_CHANGE_DB:
                     operation = QUERY_OP_CHANGE_DB;
                     break;
+                case SQLCOM_CREATE_DB:
+                    operation = QUERY_OP_CREATE_DB;
+                    break;
+                case SQLCOM_DROP_DB:
+                    operation = QUERY_OP_DROP_DB;
+                    break;
 
 		default:
 	    operation = QUERY_OP_UNDEFINED;
@@ -1682,3 +1887,1210 @@ skygw_query_op_t query_classifier_get_operation(GWBUF* querybuf)
   }
 	return operation;
 }
+
+/**
+ * Initialise the query classification cache. The first call decides the
+ * size, later calls have no effect. If the cache is used before it has been
+ * initialised, the size is taken from the MaxScale configuration.
+ *
+ * @param size	Maximum number of statements in the cache, 0 disables it
+ * @return true if the cache was initialised by this call
+ */
+bool query_classifier_cache_init(
+        int size)
+{
+	bool	rval = false;
+	int	per_stripe;
+	int	i;
+
+	spinlock_acquire(&qc_cache_lock);
+
+	if (qc_cache_size < 0)
+	{
+		per_stripe = size > 0 ? (size + QC_CACHE_STRIPES - 1) / QC_CACHE_STRIPES : 0;
+
+		for (i = 0; i < QC_CACHE_STRIPES; i++)
+		{
+			spinlock_init(&qc_cache[i].lock);
+			qc_cache[i].n_entries = 0;
+			qc_cache[i].lru_head = qc_cache[i].lru_tail = NULL;
+			qc_cache[i].buckets = NULL;
+
+			if (per_stripe > 0)
+			{
+				qc_cache[i].buckets = (QC_CACHE_ENTRY**)calloc(per_stripe,
+						sizeof(QC_CACHE_ENTRY*));
+			}
+			if (qc_cache[i].buckets == NULL)
+			{
+				per_stripe = 0;
+			}
+			qc_cache[i].n_buckets = per_stripe;
+			qc_cache[i].max_entries = per_stripe;
+		}
+		if (size > 0 && per_stripe == 0)
+		{
+			LOGIF(LE, (skygw_log_write_flush(
+				LOGFILE_ERROR,
+				"Error : Failed to allocate the query classification "
+				"cache, statements will always be parsed.")));
+
+			for (i = 0; i < QC_CACHE_STRIPES; i++)
+			{
+				free(qc_cache[i].buckets);
+				qc_cache[i].buckets = NULL;
+				qc_cache[i].n_buckets = qc_cache[i].max_entries = 0;
+			}
+		}
+		qc_cache_size = per_stripe * QC_CACHE_STRIPES;
+		rval = true;
+	}
+	spinlock_release(&qc_cache_lock);
+
+	return rval;
+}
+
+/**
+ * Fill in the statistics of the query classification cache
+ *
+ * @param stats	The statistics structure to fill in
+ */
+void query_classifier_cache_stats(
+        QC_CACHE_STATS* stats)
+{
+	int	i;
+
+	memset(stats, 0, sizeof(QC_CACHE_STATS));
+	stats->size = qc_cache_size > 0 ? qc_cache_size : 0;
+
+	for (i = 0; stats->size > 0 && i < QC_CACHE_STRIPES; i++)
+	{
+		stats->entries += qc_cache[i].n_entries;
+	}
+	stats->hits = qc_cache_hits;
+	stats->misses = qc_cache_misses;
+	stats->evictions = qc_cache_evictions;
+	stats->uncacheable = qc_cache_uncacheable;
+	stats->fastpath = qc_fast_hits;
+}
+
+/**
+ * Is the character part of an unquoted identifier
+ */
+static bool qc_is_ident_char(
+        char c)
+{
+	return isalnum((unsigned char)c) || c == '_' || c == '$';
+}
+
+/**
+ * Check if a token that starts with a digit or a dot is a number and not
+ * an identifier such as 1st_table.
+ *
+ * @param tok	The token
+ * @param len	Length of the token
+ * @return true if the token is a numeric literal
+ */
+static bool qc_is_number(
+        const char* tok,
+        int         len)
+{
+	int	i = 0;
+	bool	digits = false;
+
+	if (len > 2 && tok[0] == '0' && (tok[1] == 'x' || tok[1] == 'b'))
+	{
+		for (i = 2; i < len && isxdigit((unsigned char)tok[i]); i++)
+			;
+		return i == len;
+	}
+	for (; i < len && isdigit((unsigned char)tok[i]); i++)
+		digits = true;
+	if (i < len && tok[i] == '.')
+	{
+		for (i++; i < len && isdigit((unsigned char)tok[i]); i++)
+			digits = true;
+	}
+	if (digits && i < len && (tok[i] == 'e' || tok[i] == 'E'))
+	{
+		i++;
+		if (i < len && (tok[i] == '+' || tok[i] == '-'))
+			i++;
+		if (i == len)
+			return false;
+		for (; i < len && isdigit((unsigned char)tok[i]); i++)
+			;
+	}
+	return digits && i == len;
+}
+
+/** State of the digest being built by qc_digest */
+typedef struct {
+	char*		dest;	/*< Output buffer */
+	int		size;	/*< Size of the output buffer */
+	int		len;	/*< Length of the whole digest */
+	uint64_t	hash;	/*< FNV-1a hash of the whole digest */
+} QC_DIGEST;
+
+/**
+ * Append a character to a digest. Characters that do not fit in the output
+ * buffer are still counted and hashed.
+ */
+static inline void qc_digest_put(
+        QC_DIGEST* d,
+        char       c)
+{
+	if (d->len + 1 < d->size)
+	{
+		d->dest[d->len] = c;
+	}
+	d->len++;
+	d->hash = (d->hash ^ (unsigned char)c) * 1099511628211ULL;
+}
+
+/**
+ * Append a run of characters to a digest
+ */
+static inline void qc_digest_append(
+        QC_DIGEST*  d,
+        const char* str,
+        const char* end)
+{
+	while (str < end)
+	{
+		qc_digest_put(d, *str++);
+	}
+}
+
+/**
+ * Check if an unquoted word is the given keyword
+ */
+static bool qc_word_is(
+        const char* word,
+        int         len,
+        const char* keyword)
+{
+	return word != NULL && (int)strlen(keyword) == len &&
+		strncasecmp(word, keyword, len) == 0;
+}
+
+/**
+ * Check if a word is a column type that takes a length, for example the 30
+ * in VARCHAR(30) is not a literal value.
+ */
+static bool qc_is_sized_type(
+        const char* word,
+        int         len)
+{
+	static const char* types[] = {
+		"CHAR", "VARCHAR", "BINARY", "VARBINARY", "BIT", "INT", "INTEGER",
+		"TINYINT", "SMALLINT", "MEDIUMINT", "BIGINT", "DECIMAL", "DEC",
+		"NUMERIC", "FLOAT", "DOUBLE", "REAL", "TIME", "DATETIME",
+		"TIMESTAMP", "YEAR", NULL
+	};
+	int	i;
+
+	for (i = 0; types[i] != NULL; i++)
+	{
+		if (qc_word_is(word, len, types[i]))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Build the canonical form of a statement in a single pass. String literals
+ * keep their quotes but their content is replaced with a question mark,
+ * numeric literals and NULL values are replaced with a question mark.
+ * Everything else, including white space and comments, is kept as it is.
+ * The lengths in column types of CREATE, ALTER and CAST are not literals.
+ *
+ * The digest is written to dest and terminated if size is larger than zero.
+ * It is truncated if it does not fit but the returned length and the hash
+ * are those of the whole digest.
+ *
+ * @param sql	The statement
+ * @param len	Length of the statement
+ * @param dest	Buffer for the digest
+ * @param size	Size of the buffer
+ * @param hash	Set to the 64-bit FNV-1a hash of the digest
+ * @return Length of the digest
+ */
+static int qc_digest(
+        const char* sql,
+        int         len,
+        char*       dest,
+        int         size,
+        uint64_t*   hash)
+{
+	const char*	start = sql;
+	const char*	end = sql + len;
+	const char*	tok;
+	const char*	word = NULL;	/*< The latest word */
+	const char*	prev = NULL;	/*< The word before it */
+	int		wordlen = 0;
+	int		prevlen = 0;
+	bool		ddl = false;	/*< CREATE or ALTER statement */
+	bool		after_word = false;
+	bool		type_args = false;
+	QC_DIGEST	d;
+	char		c;
+
+	d.dest = dest;
+	d.size = size;
+	d.len = 0;
+	d.hash = 14695981039346656037ULL;
+
+	while (sql < end)
+	{
+		c = *sql;
+
+		if (c == '\'' || c == '"')
+		{
+			/** String literal with backslash escapes or doubled quotes */
+			qc_digest_put(&d, c);
+			qc_digest_put(&d, '?');
+
+			for (sql++; sql < end; sql++)
+			{
+				if (*sql == '\\' && sql + 1 < end)
+				{
+					sql++;
+				}
+				else if (*sql == c)
+				{
+					if (sql + 1 < end && sql[1] == c)
+					{
+						sql++;
+					}
+					else
+					{
+						qc_digest_put(&d, *sql++);
+						break;
+					}
+				}
+			}
+			after_word = false;
+		}
+		else if (c == '`')
+		{
+			/** Quoted identifier, doubled backticks are part of it */
+			for (tok = sql++; sql < end; sql++)
+			{
+				if (*sql == '`')
+				{
+					if (sql + 1 < end && sql[1] == '`')
+					{
+						sql++;
+					}
+					else
+					{
+						sql++;
+						break;
+					}
+				}
+			}
+			qc_digest_append(&d, tok, sql);
+			after_word = false;
+		}
+		else if (c == '/' && sql + 1 < end && sql[1] == '*')
+		{
+			/** Comments may hold version dependent code */
+			for (tok = sql, sql += 2;
+			     sql < end && !(*sql == '*' && sql + 1 < end && sql[1] == '/');
+			     sql++)
+				;
+			sql = sql < end ? sql + 2 : end;
+			qc_digest_append(&d, tok, sql);
+		}
+		else if (c == '#' ||
+			(c == '-' && sql + 2 < end && sql[1] == '-' && isspace((unsigned char)sql[2])))
+		{
+			for (tok = sql; sql < end && *sql != '\n'; sql++)
+				;
+			qc_digest_append(&d, tok, sql);
+		}
+		else if (qc_is_ident_char(c) || (c == '.' && sql + 1 < end &&
+			isdigit((unsigned char)sql[1])))
+		{
+			bool qualified = sql > start && (sql[-1] == '.' || qc_is_ident_char(sql[-1]));
+
+			/** A word, number or a qualified name */
+			tok = sql;
+			while (sql < end && (qc_is_ident_char(*sql) || *sql == '.' ||
+				((*sql == '+' || *sql == '-') && sql + 1 < end &&
+				 isdigit((unsigned char)sql[1]) &&
+				 (sql[-1] == 'e' || sql[-1] == 'E') &&
+				 isdigit((unsigned char)*tok))))
+			{
+				sql++;
+			}
+			if (!qualified && (isdigit((unsigned char)*tok) || *tok == '.') &&
+				qc_is_number(tok, sql - tok))
+			{
+				if (type_args)
+				{
+					qc_digest_append(&d, tok, sql);
+				}
+				else
+				{
+					qc_digest_put(&d, '?');
+				}
+				after_word = false;
+			}
+			else if (qc_word_is(tok, sql - tok, "NULL") &&
+				!qc_word_is(word, wordlen, "IS") &&
+				!qc_word_is(word, wordlen, "NOT"))
+			{
+				qc_digest_put(&d, '?');
+				after_word = false;
+			}
+			else
+			{
+				qc_digest_append(&d, tok, sql);
+
+				if (word == NULL)
+				{
+					ddl = qc_word_is(tok, sql - tok, "CREATE") ||
+						qc_word_is(tok, sql - tok, "ALTER");
+				}
+				prev = word;
+				prevlen = wordlen;
+				word = tok;
+				wordlen = sql - tok;
+				after_word = true;
+			}
+		}
+		else
+		{
+			if (c == '(' && after_word && qc_is_sized_type(word, wordlen) &&
+				(ddl || qc_word_is(prev, prevlen, "AS")))
+			{
+				type_args = true;
+			}
+			else if (c == ')')
+			{
+				type_args = false;
+			}
+			if (!isspace((unsigned char)c))
+			{
+				after_word = false;
+			}
+			qc_digest_put(&d, c);
+			sql++;
+		}
+	}
+	if (size > 0)
+	{
+		dest[d.len < size ? d.len : size - 1] = '\0';
+	}
+	*hash = d.hash;
+	return d.len;
+}
+
+/**
+ * Release a reference to a cache entry, the last reference frees it. This
+ * is also the clean-up function of the buffer object holding the entry.
+ *
+ * @param data	The cache entry
+ */
+static void qc_cache_entry_release(
+        void* data)
+{
+	QC_CACHE_ENTRY*	entry = (QC_CACHE_ENTRY*)data;
+	int		i;
+
+	if (atomic_add(&entry->refcount, -1) == 1)
+	{
+		for (i = 0; i < entry->n_tables; i++)
+		{
+			free(entry->tables[i]);
+		}
+		for (i = 0; i < entry->n_fulltables; i++)
+		{
+			free(entry->fulltables[i]);
+		}
+		free(entry->tables);
+		free(entry->fulltables);
+		free(entry->key);
+		free(entry);
+	}
+}
+
+/**
+ * Return the cache entry attached to a buffer by an earlier cache hit or
+ * by the tokenizer
+ *
+ * @param querybuf	The query buffer
+ * @return The entry or NULL if the query was classified by the parser
+ */
+static QC_CACHE_ENTRY* qc_cache_entry_of(
+        GWBUF* querybuf)
+{
+	if (querybuf->gwbuf_bufobj == NULL)
+	{
+		return NULL;
+	}
+	return (QC_CACHE_ENTRY*)gwbuf_get_buffer_object_data(querybuf,
+							GWBUF_CLASSIFIER_CACHE);
+}
+
+/**
+ * Parse a query that was classified from the cache or by the tokenizer when
+ * a function needs the parse tree after all.
+ *
+ * @param querybuf	The query buffer
+ * @return true if the query was parsed
+ */
+static bool qc_parse_cached(
+        GWBUF* querybuf)
+{
+	return qc_cache_entry_of(querybuf) != NULL && parse_query(querybuf);
+}
+
+/**
+ * Look up the classification of a query from the cache. On a hit the entry
+ * is attached to the buffer so that the table names and the operation can
+ * be served without parsing. On a miss the key is left for qc_cache_add.
+ *
+ * @param querybuf	The query buffer
+ * @param key		Buffer of QC_CACHE_MAX_KEY bytes for the key
+ * @param keylen	Set to the key length, -1 if the query is not cached
+ * @param hash		Set to the hash of the key
+ * @return The cache entry or NULL
+ */
+static QC_CACHE_ENTRY* qc_cache_find(
+        GWBUF*    querybuf,
+        char*     key,
+        int*      keylen,
+        uint64_t* hash)
+{
+	QC_CACHE_STRIPE*	stripe;
+	QC_CACHE_ENTRY*		entry;
+	char*			sql;
+	int			len;
+
+	*keylen = -1;
+
+	if ((entry = qc_cache_entry_of(querybuf)) != NULL)
+	{
+		return entry;
+	}
+	if (qc_cache_size < 0)
+	{
+		query_classifier_cache_init(config_qc_cache_size());
+	}
+	if (qc_cache_size == 0 || (sql = qc_query_str(querybuf, &len)) == NULL)
+	{
+		return NULL;
+	}
+	if ((*keylen = qc_digest(sql, len, key, QC_CACHE_MAX_KEY, hash)) >= QC_CACHE_MAX_KEY)
+	{
+		*keylen = -1;
+		atomic_add(&qc_cache_uncacheable, 1);
+		return NULL;
+	}
+	stripe = &qc_cache[*hash % QC_CACHE_STRIPES];
+
+	spinlock_acquire(&stripe->lock);
+	for (entry = stripe->buckets[(*hash / QC_CACHE_STRIPES) % stripe->n_buckets];
+	     entry != NULL;
+	     entry = entry->next)
+	{
+		if (entry->hash == *hash && entry->keylen == *keylen &&
+			memcmp(entry->key, key, *keylen) == 0)
+		{
+			break;
+		}
+	}
+	if (entry != NULL)
+	{
+		/** Move to the head of the LRU list */
+		if (entry != stripe->lru_head)
+		{
+			entry->lru_prev->lru_next = entry->lru_next;
+			if (entry->lru_next)
+				entry->lru_next->lru_prev = entry->lru_prev;
+			else
+				stripe->lru_tail = entry->lru_prev;
+			entry->lru_prev = NULL;
+			entry->lru_next = stripe->lru_head;
+			stripe->lru_head->lru_prev = entry;
+			stripe->lru_head = entry;
+		}
+		atomic_add(&entry->refcount, 1);
+	}
+	spinlock_release(&stripe->lock);
+
+	if (entry != NULL)
+	{
+		atomic_add(&qc_cache_hits, 1);
+		gwbuf_add_buffer_object(querybuf,
+					GWBUF_CLASSIFIER_CACHE,
+					(void *)entry,
+					qc_cache_entry_release);
+	}
+	else
+	{
+		atomic_add(&qc_cache_misses, 1);
+	}
+	return entry;
+}
+
+/**
+ * Remove the least recently used entry of a stripe. The stripe must be
+ * locked by the caller.
+ *
+ * @param stripe	The stripe to evict from
+ */
+static void qc_cache_evict(
+        QC_CACHE_STRIPE* stripe)
+{
+	QC_CACHE_ENTRY*	victim = stripe->lru_tail;
+	QC_CACHE_ENTRY**	pp;
+
+	pp = &stripe->buckets[(victim->hash / QC_CACHE_STRIPES) % stripe->n_buckets];
+	while (*pp != victim)
+	{
+		pp = &(*pp)->next;
+	}
+	*pp = victim->next;
+
+	stripe->lru_tail = victim->lru_prev;
+	if (stripe->lru_tail)
+		stripe->lru_tail->lru_next = NULL;
+	else
+		stripe->lru_head = NULL;
+	stripe->n_entries--;
+	atomic_add(&qc_cache_evictions, 1);
+	qc_cache_entry_release(victim);
+}
+
+/**
+ * Add the classification of a freshly parsed query to the cache
+ *
+ * @param querybuf	The parsed query buffer
+ * @param key		The key built by qc_cache_find
+ * @param keylen	Length of the key
+ * @param hash		Hash of the key
+ * @param qtype		The resolved query type
+ */
+static void qc_cache_add(
+        GWBUF*             querybuf,
+        char*              key,
+        int                keylen,
+        uint64_t           hash,
+        skygw_query_type_t qtype)
+{
+	QC_CACHE_STRIPE*	stripe;
+	QC_CACHE_ENTRY*		entry;
+	QC_CACHE_ENTRY*		old;
+	int			bucket;
+
+	if (qtype == QUERY_TYPE_UNKNOWN || (qtype & QC_CACHE_UNCACHEABLE) != 0)
+	{
+		atomic_add(&qc_cache_uncacheable, 1);
+		return;
+	}
+	if ((entry = (QC_CACHE_ENTRY*)calloc(1, sizeof(QC_CACHE_ENTRY))) == NULL ||
+		(entry->key = (char*)malloc(keylen)) == NULL)
+	{
+		free(entry);
+		return;
+	}
+	memcpy(entry->key, key, keylen);
+	entry->keylen = keylen;
+	entry->hash = hash;
+	entry->qtype = qtype;
+	entry->op = query_classifier_get_operation(querybuf);
+	entry->tables = skygw_get_table_names(querybuf, &entry->n_tables, false);
+	entry->fulltables = skygw_get_table_names(querybuf, &entry->n_fulltables, true);
+	entry->has_tables = true;
+	entry->refcount = 1;
+
+	stripe = &qc_cache[hash % QC_CACHE_STRIPES];
+	bucket = (hash / QC_CACHE_STRIPES) % stripe->n_buckets;
+
+	spinlock_acquire(&stripe->lock);
+	for (old = stripe->buckets[bucket]; old != NULL; old = old->next)
+	{
+		if (old->hash == hash && old->keylen == keylen &&
+			memcmp(old->key, key, keylen) == 0)
+		{
+			break;
+		}
+	}
+	if (old == NULL)
+	{
+		if (stripe->n_entries >= stripe->max_entries)
+		{
+			qc_cache_evict(stripe);
+		}
+		entry->next = stripe->buckets[bucket];
+		stripe->buckets[bucket] = entry;
+		entry->lru_next = stripe->lru_head;
+		if (stripe->lru_head)
+			stripe->lru_head->lru_prev = entry;
+		else
+			stripe->lru_tail = entry;
+		stripe->lru_head = entry;
+		stripe->n_entries++;
+		entry = NULL;
+	}
+	spinlock_release(&stripe->lock);
+
+	/** Another thread added the same statement first */
+	if (entry != NULL)
+	{
+		qc_cache_entry_release(entry);
+	}
+}
+
+/**
+ * Return the SQL text of a COM_QUERY or COM_STMT_PREPARE packet
+ *
+ * @param querybuf	The query buffer
+ * @param len		Set to the length of the statement
+ * @return Pointer to the statement or NULL if the buffer holds none
+ */
+static char* qc_query_str(
+        GWBUF* querybuf,
+        int*   len)
+{
+	uint8_t*	data;
+
+	if (GWBUF_LENGTH(querybuf) <= 5)
+	{
+		return NULL;
+	}
+	data = (uint8_t*)GWBUF_DATA(querybuf);
+
+	if (data[4] != MYSQL_COM_QUERY && data[4] != MYSQL_COM_STMT_PREPARE)
+	{
+		return NULL;
+	}
+	*len = MYSQL_GET_PACKET_LEN(data) - 1;
+
+	if (*len > (int)GWBUF_LENGTH(querybuf) - 5)
+	{
+		*len = GWBUF_LENGTH(querybuf) - 5;
+	}
+	return *len > 0 ? (char*)&data[5] : NULL;
+}
+
+/** Tokens of the fast path classifier */
+typedef enum {
+	QC_TOK_END,	/*< End of the statement */
+	QC_TOK_WORD,	/*< Keyword or unquoted identifier */
+	QC_TOK_IDENT,	/*< Quoted identifier */
+	QC_TOK_STRING,	/*< String literal */
+	QC_TOK_NUMBER,	/*< Numeric literal */
+	QC_TOK_PUNCT,	/*< Operator or other single character */
+	QC_TOK_UNSURE	/*< Executable comment or unterminated quote */
+} qc_token_t;
+
+typedef struct {
+	qc_token_t	type;
+	const char*	start;
+	int		len;
+} QC_TOKEN;
+
+/** Statements that the tokenizer classifies without the parser */
+enum {
+	QC_FAST_SELECT,
+	QC_FAST_BEGIN,
+	QC_FAST_COMMIT,
+	QC_FAST_ROLLBACK,
+	QC_FAST_ENABLE_AUTOCOMMIT,
+	QC_FAST_DISABLE_AUTOCOMMIT,
+	QC_FAST_USE
+};
+
+/**
+ * The classifications of the trivial statements. The types are the ones that
+ * resolve_query_type gives for the same statements. The table names of a
+ * SELECT are not known, they are parsed if someone asks for them.
+ */
+static QC_CACHE_ENTRY qc_fast_entries[] = {
+	{ NULL, 0, 0, QUERY_TYPE_READ, QUERY_OP_SELECT,
+	  NULL, 0, NULL, 0, false, 1, NULL, NULL, NULL },
+	{ NULL, 0, 0, QUERY_TYPE_BEGIN_TRX, QUERY_OP_UNDEFINED,
+	  NULL, 0, NULL, 0, true, 1, NULL, NULL, NULL },
+	{ NULL, 0, 0, QUERY_TYPE_COMMIT, QUERY_OP_UNDEFINED,
+	  NULL, 0, NULL, 0, true, 1, NULL, NULL, NULL },
+	{ NULL, 0, 0, QUERY_TYPE_ROLLBACK, QUERY_OP_UNDEFINED,
+	  NULL, 0, NULL, 0, true, 1, NULL, NULL, NULL },
+	{ NULL, 0, 0, (skygw_query_type_t)(QUERY_TYPE_COMMIT |
+					   QUERY_TYPE_ENABLE_AUTOCOMMIT |
+					   QUERY_TYPE_GSYSVAR_WRITE),
+	  QUERY_OP_UNDEFINED, NULL, 0, NULL, 0, true, 1, NULL, NULL, NULL },
+	{ NULL, 0, 0, (skygw_query_type_t)(QUERY_TYPE_BEGIN_TRX |
+					   QUERY_TYPE_DISABLE_AUTOCOMMIT |
+					   QUERY_TYPE_GSYSVAR_WRITE),
+	  QUERY_OP_UNDEFINED, NULL, 0, NULL, 0, true, 1, NULL, NULL, NULL },
+	{ NULL, 0, 0, QUERY_TYPE_SESSION_WRITE, QUERY_OP_CHANGE_DB,
+	  NULL, 0, NULL, 0, true, 1, NULL, NULL, NULL }
+};
+
+/**
+ * Words that make a SELECT something else than a plain read: the NOW_FUNC
+ * keywords that need no parentheses and the clauses that write the result.
+ */
+static const char* qc_fast_select_stop[] = {
+	"INTO", "PROCEDURE", "CURRENT_DATE", "CURRENT_TIME",
+	"CURRENT_TIMESTAMP", "CURRENT_USER", "LOCALTIME", "LOCALTIMESTAMP",
+	"UTC_DATE", "UTC_TIME", "UTC_TIMESTAMP", NULL
+};
+
+/**
+ * Read the next token of a statement. White space and plain comments are
+ * skipped. Executable comments, which may hold any SQL, make the token
+ * QC_TOK_UNSURE.
+ *
+ * @param p	Current position
+ * @param end	End of the statement
+ * @param tok	The token that was read
+ * @return Position after the token
+ */
+static const char* qc_fast_token(
+        const char* p,
+        const char* end,
+        QC_TOKEN*   tok)
+{
+	char	c;
+
+	for (;;)
+	{
+		while (p < end && isspace((unsigned char)*p))
+		{
+			p++;
+		}
+		if (p + 1 < end && p[0] == '/' && p[1] == '*')
+		{
+			if (p + 2 < end && (p[2] == '!' ||
+				(p[2] == 'M' && p + 3 < end && p[3] == '!')))
+			{
+				break;
+			}
+			for (p += 2; p + 1 < end && !(p[0] == '*' && p[1] == '/'); p++)
+				;
+			if (p + 1 >= end)
+			{
+				tok->type = QC_TOK_UNSURE;
+				tok->start = p;
+				tok->len = 0;
+				return end;
+			}
+			p += 2;
+		}
+		else if (p < end && (*p == '#' ||
+			(p + 1 < end && p[0] == '-' && p[1] == '-' &&
+			 (p + 2 == end || isspace((unsigned char)p[2])))))
+		{
+			while (p < end && *p != '\n')
+			{
+				p++;
+			}
+		}
+		else
+		{
+			break;
+		}
+	}
+	tok->start = p;
+
+	if (p == end)
+	{
+		tok->type = QC_TOK_END;
+	}
+	else if (*p == '/')
+	{
+		/** Only an executable comment stops the loop above at a slash */
+		tok->type = p + 1 < end && p[1] == '*' ? QC_TOK_UNSURE : QC_TOK_PUNCT;
+		p++;
+	}
+	else if (qc_is_ident_char(*p) || (*p & 0x80))
+	{
+		tok->type = isdigit((unsigned char)*p) ? QC_TOK_NUMBER : QC_TOK_WORD;
+
+		while (p < end && (qc_is_ident_char(*p) || (*p & 0x80) ||
+			(tok->type == QC_TOK_NUMBER && *p == '.')))
+		{
+			p++;
+		}
+	}
+	else if (*p == '`' || *p == '\'' || *p == '"')
+	{
+		/** Quotes are escaped by doubling them, strings also by backslash */
+		c = *p++;
+		tok->type = QC_TOK_UNSURE;
+
+		while (p < end)
+		{
+			if (*p == '\\' && c != '`' && p + 1 < end)
+			{
+				p += 2;
+			}
+			else if (*p == c && p + 1 < end && p[1] == c)
+			{
+				p += 2;
+			}
+			else if (*p++ == c)
+			{
+				tok->type = c == '`' ? QC_TOK_IDENT : QC_TOK_STRING;
+				break;
+			}
+		}
+	}
+	else
+	{
+		tok->type = QC_TOK_PUNCT;
+		p++;
+	}
+	tok->len = p - tok->start;
+	return p;
+}
+
+/**
+ * Check if a token is the given keyword
+ */
+static bool qc_fast_is(
+        const QC_TOKEN* tok,
+        const char*     word)
+{
+	return tok->type == QC_TOK_WORD && (int)strlen(word) == tok->len &&
+		strncasecmp(tok->start, word, tok->len) == 0;
+}
+
+/**
+ * Check if a token is the given punctuation character
+ */
+static bool qc_fast_is_punct(
+        const QC_TOKEN* tok,
+        char            c)
+{
+	return tok->type == QC_TOK_PUNCT && *tok->start == c;
+}
+
+/**
+ * Skip an optional keyword
+ *
+ * @param p	Current position
+ * @param end	End of the statement
+ * @param word	The keyword
+ * @return Position after the keyword or p if the next token is not it
+ */
+static const char* qc_fast_skip(
+        const char* p,
+        const char* end,
+        const char* word)
+{
+	QC_TOKEN	tok;
+	const char*	next = qc_fast_token(p, end, &tok);
+
+	return qc_fast_is(&tok, word) ? next : p;
+}
+
+/**
+ * Check that only an optional semicolon is left of the statement
+ */
+static bool qc_fast_at_end(
+        const char* p,
+        const char* end)
+{
+	QC_TOKEN	tok;
+
+	p = qc_fast_token(p, end, &tok);
+
+	if (qc_fast_is_punct(&tok, ';'))
+	{
+		qc_fast_token(p, end, &tok);
+	}
+	return tok.type == QC_TOK_END;
+}
+
+/**
+ * Check if the rest of a SELECT is a plain read: no functions, variables,
+ * subqueries, placeholders or INTO clause, and only one statement.
+ *
+ * @param p	Position after the SELECT keyword
+ * @param end	End of the statement
+ * @return true if the statement is of type QUERY_TYPE_READ
+ */
+static bool qc_fast_select(
+        const char* p,
+        const char* end)
+{
+	QC_TOKEN	tok;
+	int		ntok = 0;
+	int		i;
+
+	for (p = qc_fast_token(p, end, &tok);
+	     tok.type != QC_TOK_END;
+	     p = qc_fast_token(p, end, &tok), ntok++)
+	{
+		switch (tok.type)
+		{
+		case QC_TOK_UNSURE:
+			return false;
+
+		case QC_TOK_PUNCT:
+			if (qc_fast_is_punct(&tok, ';'))
+			{
+				return ntok > 0 && qc_fast_at_end(p, end);
+			}
+			if (qc_fast_is_punct(&tok, '(') ||
+				qc_fast_is_punct(&tok, '@') ||
+				qc_fast_is_punct(&tok, '?'))
+			{
+				return false;
+			}
+			break;
+
+		case QC_TOK_WORD:
+			for (i = 0; qc_fast_select_stop[i] != NULL; i++)
+			{
+				if (qc_fast_is(&tok, qc_fast_select_stop[i]))
+				{
+					return false;
+				}
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+	return ntok > 0;
+}
+
+/**
+ * Classify SET [SESSION|LOCAL] autocommit = 0|1|ON|OFF|TRUE|FALSE and the
+ * same with @@autocommit, @@session.autocommit or @@local.autocommit.
+ *
+ * @param p	Position after the SET keyword
+ * @param end	End of the statement
+ * @return QC_FAST_ENABLE_AUTOCOMMIT, QC_FAST_DISABLE_AUTOCOMMIT or -1
+ */
+static int qc_fast_set(
+        const char* p,
+        const char* end)
+{
+	QC_TOKEN	tok;
+	const char*	prev;
+	int		rval = -1;
+
+	p = qc_fast_token(p, end, &tok);
+
+	if (qc_fast_is(&tok, "SESSION") || qc_fast_is(&tok, "LOCAL"))
+	{
+		p = qc_fast_token(p, end, &tok);
+	}
+	else if (qc_fast_is_punct(&tok, '@'))
+	{
+		/** The @@ and the optional scope must be written together */
+		prev = p;
+		p = qc_fast_token(p, end, &tok);
+		if (!qc_fast_is_punct(&tok, '@') || tok.start != prev)
+		{
+			return -1;
+		}
+		prev = p;
+		p = qc_fast_token(p, end, &tok);
+		if (tok.start != prev)
+		{
+			return -1;
+		}
+		if (qc_fast_is(&tok, "SESSION") || qc_fast_is(&tok, "LOCAL"))
+		{
+			prev = p;
+			p = qc_fast_token(p, end, &tok);
+			if (!qc_fast_is_punct(&tok, '.') || tok.start != prev)
+			{
+				return -1;
+			}
+			prev = p;
+			p = qc_fast_token(p, end, &tok);
+			if (tok.start != prev)
+			{
+				return -1;
+			}
+		}
+	}
+	if (!qc_fast_is(&tok, "autocommit"))
+	{
+		return -1;
+	}
+	p = qc_fast_token(p, end, &tok);
+	if (!qc_fast_is_punct(&tok, '='))
+	{
+		return -1;
+	}
+	p = qc_fast_token(p, end, &tok);
+
+	if ((tok.type == QC_TOK_NUMBER && tok.len == 1 && *tok.start == '1') ||
+		qc_fast_is(&tok, "ON") || qc_fast_is(&tok, "TRUE"))
+	{
+		rval = QC_FAST_ENABLE_AUTOCOMMIT;
+	}
+	else if ((tok.type == QC_TOK_NUMBER && tok.len == 1 && *tok.start == '0') ||
+		qc_fast_is(&tok, "OFF") || qc_fast_is(&tok, "FALSE"))
+	{
+		rval = QC_FAST_DISABLE_AUTOCOMMIT;
+	}
+	return rval != -1 && qc_fast_at_end(p, end) ? rval : -1;
+}
+
+/**
+ * Classify a trivial statement with the tokenizer
+ *
+ * @param sql	The statement
+ * @param len	Length of the statement
+ * @return The classification or NULL if the statement must be parsed
+ */
+static QC_CACHE_ENTRY* qc_fast_classify(
+        const char* sql,
+        int         len)
+{
+	const char*	end = sql + len;
+	const char*	p;
+	QC_TOKEN	tok;
+	int		rval = -1;
+
+	p = qc_fast_token(sql, end, &tok);
+
+	if (qc_fast_is(&tok, "SELECT"))
+	{
+		if (qc_fast_select(p, end))
+		{
+			rval = QC_FAST_SELECT;
+		}
+	}
+	else if (qc_fast_is(&tok, "BEGIN"))
+	{
+		if (qc_fast_at_end(qc_fast_skip(p, end, "WORK"), end))
+		{
+			rval = QC_FAST_BEGIN;
+		}
+	}
+	else if (qc_fast_is(&tok, "START"))
+	{
+		p = qc_fast_token(p, end, &tok);
+
+		if (qc_fast_is(&tok, "TRANSACTION"))
+		{
+			const char* with = qc_fast_skip(p, end, "WITH");
+			const char* consistent;
+
+			/** START TRANSACTION WITH CONSISTENT SNAPSHOT */
+			if (with != p)
+			{
+				consistent = qc_fast_skip(with, end, "CONSISTENT");
+				if (consistent == with ||
+					(p = qc_fast_skip(consistent, end, "SNAPSHOT")) == consistent)
+				{
+					return NULL;
+				}
+			}
+			if (qc_fast_at_end(p, end))
+			{
+				rval = QC_FAST_BEGIN;
+			}
+		}
+	}
+	else if (qc_fast_is(&tok, "COMMIT"))
+	{
+		if (qc_fast_at_end(qc_fast_skip(p, end, "WORK"), end))
+		{
+			rval = QC_FAST_COMMIT;
+		}
+	}
+	else if (qc_fast_is(&tok, "ROLLBACK"))
+	{
+		if (qc_fast_at_end(qc_fast_skip(p, end, "WORK"), end))
+		{
+			rval = QC_FAST_ROLLBACK;
+		}
+	}
+	else if (qc_fast_is(&tok, "SET"))
+	{
+		rval = qc_fast_set(p, end);
+	}
+	else if (qc_fast_is(&tok, "USE"))
+	{
+		p = qc_fast_token(p, end, &tok);
+
+		if ((tok.type == QC_TOK_WORD || tok.type == QC_TOK_IDENT) &&
+			qc_fast_at_end(p, end))
+		{
+			rval = QC_FAST_USE;
+		}
+	}
+	return rval >= 0 ? &qc_fast_entries[rval] : NULL;
+}
+
+/**
+ * The buffer object clean-up function of the static fast path entries
+ */
+static void qc_fast_entry_done(
+        void* data)
+{
+}
+
+/**
+ * Classify a trivial statement without parsing it. The classification is
+ * attached to the buffer so that the operation is known without parsing.
+ *
+ * @param querybuf	The query buffer
+ * @return The classification or NULL if the statement must be parsed
+ */
+static QC_CACHE_ENTRY* qc_fast_find(
+        GWBUF* querybuf)
+{
+	QC_CACHE_ENTRY*	entry;
+	char*		sql;
+	int		len;
+
+	if ((entry = qc_cache_entry_of(querybuf)) != NULL)
+	{
+		return entry;
+	}
+	if ((sql = qc_query_str(querybuf, &len)) == NULL ||
+		(entry = qc_fast_classify(sql, len)) == NULL)
+	{
+		return NULL;
+	}
+	atomic_add(&qc_fast_hits, 1);
+	gwbuf_add_buffer_object(querybuf,
+				GWBUF_CLASSIFIER_CACHE,
+				(void *)entry,
+				qc_fast_entry_done);
+	return entry;
+}
+
+/**
+ * Classify a statement with the tokenizer alone. This is the fast path of
+ * query_classifier_get_type, exposed for testing it against the parser.
+ *
+ * @param querybuf	The query buffer
+ * @param qtype		Set to the query type when the statement was classified
+ * @return true if the tokenizer classified the statement
+ */
+bool query_classifier_fast_classify(
+        GWBUF*              querybuf,
+        skygw_query_type_t* qtype)
+{
+	QC_CACHE_ENTRY*	entry;
+	char*		sql;
+	int		len;
+
+	if (querybuf == NULL || (sql = qc_query_str(querybuf, &len)) == NULL ||
+		(entry = qc_fast_classify(sql, len)) == NULL)
+	{
+		return false;
+	}
+	*qtype = entry->qtype;
+	return true;
+}
@@ -75,9 +75,23 @@ typedef enum {
 	QUERY_OP_CREATE_INDEX		= (1 << 8),
 	QUERY_OP_DROP_TABLE			= (1 << 9),
 	QUERY_OP_DROP_INDEX			= (1 << 10),
-        QUERY_OP_CHANGE_DB              = (1 << 11)
+        QUERY_OP_CHANGE_DB              = (1 << 11),
+        QUERY_OP_CREATE_DB              = (1 << 12),
+        QUERY_OP_DROP_DB                = (1 << 13)
 }skygw_query_op_t;
 
+/**
+ * The aggregate function of a column in the select list of a query
+ */
+typedef enum {
+	QUERY_AGG_NONE,		/*< Not an aggregate */
+	QUERY_AGG_COUNT,	/*< COUNT() */
+	QUERY_AGG_SUM,		/*< SUM() */
+	QUERY_AGG_MIN,		/*< MIN() */
+	QUERY_AGG_MAX,		/*< MAX() */
+	QUERY_AGG_OTHER		/*< Any other use of an aggregate function */
+} skygw_query_agg_t;
+
 typedef struct parsing_info_st {
 #if defined(SS_DEBUG)
         skygw_chk_t pi_chk_top;     
@@ -93,6 +107,19 @@ typedef struct parsing_info_st {
 
 #define QUERY_IS_TYPE(mask,type) ((mask & type) == type)
 
+/**
+ * Statistics of the query classification cache
+ */
+typedef struct {
+	int	size;		/*< Maximum number of cached statements */
+	int	entries;	/*< Statements in the cache */
+	int	hits;		/*< Classifications served from the cache */
+	int	misses;		/*< Cacheable statements that had to be parsed */
+	int	evictions;	/*< Statements evicted to make room for others */
+	int	uncacheable;	/*< Statements that can not be cached */
+	int	fastpath;	/*< Statements classified by the tokenizer */
+} QC_CACHE_STATS;
+
 /** 
  * Create THD and use it for creating parse tree. Examine parse tree and 
  * classify the query.
@@ -108,6 +135,7 @@ bool		is_drop_table_query(GWBUF* querybuf);
 bool		skygw_is_real_query(GWBUF* querybuf);
 char**		skygw_get_table_names(GWBUF* querybuf, int* tblsize, bool fullnames);
 char*           skygw_get_canonical(GWBUF* querybuf);
+int             query_classifier_get_digest(GWBUF* querybuf, char* digest, int size, uint64_t* hash);
 bool            parse_query (GWBUF* querybuf);
 parsing_info_t* parsing_info_init(void (*donefun)(void *));
 void            parsing_info_done(void* ptr);
@@ -116,6 +144,10 @@ bool			skygw_query_has_clause(GWBUF* buf);
 char*           skygw_get_qtype_str(skygw_query_type_t qtype);
 char*			skygw_get_affected_fields(GWBUF* buf);
 char** skygw_get_database_names(GWBUF* querybuf,int* size);
+int		skygw_get_aggregates(GWBUF* querybuf, skygw_query_agg_t** aggs);
+bool		query_classifier_cache_init(int size);
+void		query_classifier_cache_stats(QC_CACHE_STATS* stats);
+bool		query_classifier_fast_classify(GWBUF* querybuf, skygw_query_type_t* qtype);
 
 EXTERN_C_BLOCK_END
 
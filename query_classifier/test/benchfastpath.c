@@ -0,0 +1,161 @@
+/*
+ * This file is distributed as part of MaxScale.  It is free
+ * software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation,
+ * version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright MariaDB Corporation Ab 2015
+ */
+
+/**
+ * @file benchfastpath.c - Throughput of the query classification
+ *
+ * Classifies the statements of a corpus, one per line, over and over with
+ * the parser and with query_classifier_get_type, which tries the tokenizer
+ * first. The classification cache is disabled so that only the tokenizer
+ * is measured.
+ *
+ * Usage: bench_fastpath <corpus> [iterations]
+ */
+
+#include <my_config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <query_classifier.h>
+#include <buffer.h>
+#include <mysql.h>
+
+#define MAX_QUERIES	1024
+
+static char* server_options[] = {
+	"MariaDB Corporation MaxScale",
+	"--no-defaults",
+	"--datadir=.",
+	"--language=.",
+	"--skip-innodb",
+	"--default-storage-engine=myisam",
+	NULL
+};
+
+const int num_elements = (sizeof(server_options) / sizeof(char *)) - 1;
+
+static char* server_groups[] = {
+	"embedded",
+	"server",
+	"server",
+	NULL
+};
+
+static char* queries[MAX_QUERIES];
+static int n_queries = 0;
+
+static GWBUF* make_query(char* query)
+{
+	int len = strlen(query) + 1;
+	GWBUF* buf = gwbuf_alloc(len + 4);
+	unsigned char* data = GWBUF_DATA(buf);
+
+	data[0] = len;
+	data[1] = len >> 8;
+	data[2] = len >> 16;
+	data[3] = 0x00;
+	data[4] = 0x03;
+	memcpy(data + 5, query, len - 1);
+	return buf;
+}
+
+static double now()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Classify every query of the corpus iterations times
+ *
+ * @param parse	Parse the queries before classifying them
+ * @return Queries per second
+ */
+static double bench(int iterations, bool parse)
+{
+	double start = now();
+	int i, j;
+
+	for(i = 0; i < iterations; i++){
+		for(j = 0; j < n_queries; j++){
+			GWBUF* buf = make_query(queries[j]);
+
+			if(parse){
+				parse_query(buf);
+			}
+			query_classifier_get_type(buf);
+			gwbuf_free(buf);
+		}
+	}
+	return (double)iterations * n_queries / (now() - start);
+}
+
+int main(int argc, char** argv)
+{
+	char line[4096];
+	int iterations = 1000, settled = 0, i;
+	skygw_query_type_t type;
+	FILE* corpus;
+
+	if(argc < 2){
+		fprintf(stderr, "Usage: bench_fastpath <corpus> [iterations]\n");
+		return 1;
+	}
+	if(argc > 2){
+		iterations = atoi(argv[2]);
+	}
+	if((corpus = fopen(argv[1], "rb")) == NULL){
+		printf("Error: Failed to open corpus file %s\n", argv[1]);
+		return 1;
+	}
+	while(n_queries < MAX_QUERIES && fgets(line, sizeof(line), corpus)){
+		line[strcspn(line, "\n")] = '\0';
+
+		if(line[0] != '\0'){
+			queries[n_queries++] = strdup(line);
+		}
+	}
+	fclose(corpus);
+
+	if(mysql_library_init(num_elements, server_options, server_groups)){
+		printf("Error: Cannot initialize Embedded Library.\n");
+		return 1;
+	}
+	query_classifier_cache_init(0);
+
+	for(i = 0; i < n_queries; i++){
+		GWBUF* buf = make_query(queries[i]);
+
+		settled += query_classifier_fast_classify(buf, &type);
+		gwbuf_free(buf);
+	}
+	printf("%d statements, %d classified by the tokenizer, %d iterations\n\n",
+	       n_queries, settled, iterations);
+	printf("%-12s %.0f queries/s\n", "parser", bench(iterations, true));
+	printf("%-12s %.0f queries/s\n", "fast path", bench(iterations, false));
+
+	mysql_library_end();
+
+	for(i = 0; i < n_queries; i++){
+		free(queries[i]);
+	}
+	return 0;
+}
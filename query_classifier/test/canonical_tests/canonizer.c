@@ -32,6 +32,9 @@ int main(int argc, char** argv)
 	GWBUF* qbuff;
 	char *tok;
 	char readbuff[4092];
+	char digest[32];
+	uint64_t hash, tokhash;
+	int len, rval = 0;
 	FILE* infile;
 	FILE* outfile;
 	
@@ -67,6 +70,16 @@ int main(int argc, char** argv)
 				parse_query(qbuff);
 				tok = skygw_get_canonical(qbuff);
 				fprintf(outfile,"%s\n",tok);
+
+				/** A truncated digest has the hash of the whole one */
+				len = query_classifier_get_digest(qbuff, digest, sizeof(digest), &hash);
+				query_classifier_get_digest(qbuff, NULL, 0, &tokhash);
+				if(len != strlen(tok) || hash != tokhash ||
+				   strncmp(digest, tok, sizeof(digest) - 1) != 0){
+					/** Written to the output so that the test fails */
+					fprintf(outfile,"Digest of '%s' does not match the canonical form.\n", tok);
+					rval = 1;
+				}
 				free(tok);
 				gwbuf_free(qbuff);
 			}			
@@ -75,5 +88,5 @@ int main(int argc, char** argv)
 	fclose(outfile);
 	mysql_library_end();
 	
-	return 0;
+	return rval;
 }
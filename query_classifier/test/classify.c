@@ -7,6 +7,7 @@
 #include <buffer.h>
 #include <mysql.h>
 #include <unistd.h>
+#include <maxconfig.h>
 
 static char* server_options[] = {
     "MariaDB Corporation MaxScale",
@@ -27,6 +28,34 @@ static char* server_groups[] = {
 	NULL
 };
 
+/**
+ * Compare the table names of two classified buffers
+ *
+ * @param a	First buffer
+ * @param b	Second buffer
+ * @return	True if both buffers report the same tables
+ */
+static bool same_tables(GWBUF* a, GWBUF* b)
+{
+	int na = 0, nb = 0, i;
+	char **ta = skygw_get_table_names(a, &na, true);
+	char **tb = skygw_get_table_names(b, &nb, true);
+	bool rval = (na == nb);
+
+	for(i = 0; rval && i < na; i++){
+		rval = (strcmp(ta[i], tb[i]) == 0);
+	}
+	for(i = 0; i < na; i++){
+		free(ta[i]);
+	}
+	for(i = 0; i < nb; i++){
+		free(tb[i]);
+	}
+	free(ta);
+	free(tb);
+	return rval;
+}
+
 int main(int argc, char** argv)
 {
 	if(argc < 3){
@@ -43,6 +72,8 @@ int main(int argc, char** argv)
 		    return 1;
 		}
 
+	query_classifier_cache_init(DEFAULT_QC_CACHE_SIZE);
+
 	input = fopen(argv[1],"rb");
 
     if(input == NULL)
@@ -109,6 +140,22 @@ int main(int argc, char** argv)
 			strsz -= qlen;
 			memset(strbuff + strsz,0,buffsz - strsz);
 			skygw_query_type_t type = query_classifier_get_type(buff);
+
+			/** Classify a copy so that the result comes from the cache */
+			GWBUF* cbuff = gwbuf_alloc(qlen+6);
+			memcpy(cbuff->start, buff->start, qlen+6);
+			skygw_query_type_t ctype = query_classifier_get_type(cbuff);
+
+			if(ctype != type){
+				printf("Error: cached classification %#x differs from %#x\n",
+				       ctype, type);
+				ex_val = 1;
+			}
+			else if(!same_tables(buff, cbuff)){
+				printf("Error: cached table names differ\n");
+				ex_val = 1;
+			}
+			gwbuf_free(cbuff);
 			char qtypestr[64];
 			char expbuff[256];
 			int expos = 0;
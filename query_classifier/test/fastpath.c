@@ -0,0 +1,125 @@
+/*
+ * This file is distributed as part of MaxScale.  It is free
+ * software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation,
+ * version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright MariaDB Corporation Ab 2015
+ */
+
+/**
+ * @file fastpath.c - Differential test of the fast path classifier
+ *
+ * Every statement of the corpus, one per line, is classified with the
+ * tokenizer and with the parser. The test fails if the tokenizer settles a
+ * statement to a different type than the parser gives it.
+ *
+ * Usage: fastpath <corpus>
+ */
+
+#include <my_config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <query_classifier.h>
+#include <buffer.h>
+#include <mysql.h>
+
+static char* server_options[] = {
+	"MariaDB Corporation MaxScale",
+	"--no-defaults",
+	"--datadir=.",
+	"--language=.",
+	"--skip-innodb",
+	"--default-storage-engine=myisam",
+	NULL
+};
+
+const int num_elements = (sizeof(server_options) / sizeof(char *)) - 1;
+
+static char* server_groups[] = {
+	"embedded",
+	"server",
+	"server",
+	NULL
+};
+
+/**
+ * Create a COM_QUERY packet of a statement
+ */
+static GWBUF* make_query(char* query)
+{
+	int len = strlen(query) + 1;
+	GWBUF* buf = gwbuf_alloc(len + 4);
+	unsigned char* data = GWBUF_DATA(buf);
+
+	data[0] = len;
+	data[1] = len >> 8;
+	data[2] = len >> 16;
+	data[3] = 0x00;
+	data[4] = 0x03;
+	memcpy(data + 5, query, len - 1);
+	return buf;
+}
+
+int main(int argc, char** argv)
+{
+	char line[4096];
+	int settled = 0, total = 0, failed = 0;
+	FILE* corpus;
+
+	if(argc < 2){
+		fprintf(stderr, "Usage: fastpath <corpus>\n");
+		return 1;
+	}
+	if(mysql_library_init(num_elements, server_options, server_groups)){
+		printf("Error: Cannot initialize Embedded Library.\n");
+		return 1;
+	}
+	if((corpus = fopen(argv[1], "rb")) == NULL){
+		printf("Error: Failed to open corpus file %s\n", argv[1]);
+		mysql_library_end();
+		return 1;
+	}
+	query_classifier_cache_init(0);
+
+	while(fgets(line, sizeof(line), corpus)){
+		skygw_query_type_t fast, parsed;
+		GWBUF* buf;
+
+		line[strcspn(line, "\n")] = '\0';
+
+		if(line[0] == '\0'){
+			continue;
+		}
+		total++;
+		buf = make_query(line);
+
+		if(query_classifier_fast_classify(buf, &fast)){
+			settled++;
+			parse_query(buf);
+			parsed = query_classifier_get_type(buf);
+
+			if(fast != parsed){
+				printf("Error: '%s' is %#x with the tokenizer but %#x "
+				       "with the parser\n", line, fast, parsed);
+				failed++;
+			}
+		}
+		gwbuf_free(buf);
+	}
+	printf("%d statements, %d classified by the tokenizer, %d mismatches\n",
+	       total, settled, failed);
+	fclose(corpus);
+	mysql_library_end();
+	return failed > 0 || settled == 0;
+}
@@ -0,0 +1,58 @@
+SELECT * FROM t1 WHERE id = 1;
+select id, name from t1 where id=42;
+select a, b from db1.t1 join t2 on t1.a = t2.b where t1.c = 'x' and t2.d > 10;
+select * from tst where lname like '%e%' order by fname;
+SELECT DISTINCT a FROM t1 WHERE b IN (1, 2, 3);
+select count(*) from t1;
+select a from t1 union select b from t2;
+select * from t1 where a = 1 for update;
+select * from t1 lock in share mode;
+select 1;
+select 'it''s', "a\"b" from dual;
+select `weird``name` from `db`.`table`;
+/* leading comment */ select a from t1;
+select a from t1 # trailing comment
+select sleep(2);
+select now();
+select current_timestamp;
+select current_user;
+select @@server_id;
+select @@global.max_connections;
+select @OLD_SQL_NOTES;
+select last_insert_id();
+select a into @x from t1 limit 1;
+select * from t1 into outfile '/tmp/x';
+/*!40101 select 1 */;
+select a + 1, b * 2 from t1 where c between 1 and 5;
+select case when a = 1 then 'x' else 'y' end from t1;
+select * from t1 where d > current_date - interval 1 day;
+BEGIN;
+begin work;
+START TRANSACTION;
+start transaction with consistent snapshot;
+COMMIT;
+commit work;
+ROLLBACK;
+rollback work;
+rollback to savepoint s1;
+SET autocommit=1;
+SET autocommit=0;
+set autocommit = ON;
+set autocommit = off;
+set autocommit = true;
+set autocommit = false;
+set session autocommit = 0;
+set local autocommit = 1;
+set @@autocommit = 0;
+set @@session.autocommit = 1;
+set @@local.autocommit = 0;
+set global autocommit = 1;
+set autocommit = 1, sql_mode = '';
+set names utf8;
+USE test;
+use `test`;
+insert into t1 values (1, 'a');
+update t1 set a = 2 where b = 3;
+delete from t1 where a = 1;
+create temporary table tmp as select * from t1;
+show tables;
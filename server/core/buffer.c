@@ -39,11 +39,13 @@
  * @endverbatim
  */
 #include <stdlib.h>
+#include <pthread.h>
 #include <buffer.h>
 #include <atomic.h>
 #include <skygw_debug.h>
 #include <spinlock.h>
 #include <hint.h>
+#include <dcb.h>
 #include <log_manager.h>
 #include <errno.h>
 
@@ -56,13 +58,382 @@ static buffer_object_t* gwbuf_remove_buffer_object(
         GWBUF*           buf,
         buffer_object_t* bufobj);
 
+/**
+ * Control the use of the per-thread buffer pools. Setting this to 0 makes
+ * every buffer block come directly from malloc, which may be useful when
+ * debugging memory problems with valgrind.
+ */
+#define	GWBUF_POOL	1
+
+/**
+ * The memory for buffers is handed out in blocks. A data block holds the
+ * GWBUF header, the SHARED_BUF and the data in a single allocation, a
+ * header block holds only a GWBUF and is used for clones of a buffer.
+ *
+ * Blocks up to the largest size class are taken from a pool owned by the
+ * allocating thread, each pool keeps a free list per size class. A block
+ * freed by a thread other than the owner of its pool is pushed onto the
+ * remote free list of the home pool, the owner reclaims the remote list
+ * when its own free list for a size class runs empty.
+ */
+typedef struct buf_block {
+	struct buf_pool	 *pool;		/*< Home pool, NULL if not pooled */
+	struct buf_block *next;		/*< Next block in a free list */
+	int		 sclass;	/*< The size class, -1 if not pooled */
+} BUF_BLOCK;
+
+/** Size of a block holding only a buffer header */
+#define	BUF_HEADER_BLOCK	(sizeof(BUF_BLOCK) + sizeof(GWBUF))
+/** Size of a block holding a buffer header, shared buffer and the data */
+#define	BUF_DATA_BLOCK(n)	(sizeof(BUF_BLOCK) + sizeof(GWBUF) + \
+				 sizeof(SHARED_BUF) + (n))
+
+/** Largest data area that is allocated from the pools */
+#define	MAX_POOLED_BUFFER	32768
+
+#define	N_BUF_CLASSES	10
+/** Block sizes of the size classes, class 0 is used for header blocks */
+static size_t	buf_class_size[N_BUF_CLASSES] = {
+	BUF_HEADER_BLOCK, 128, 256, 512, 1024, 2048, 4096, 8192, 16384,
+	BUF_DATA_BLOCK(MAX_POOLED_BUFFER)
+};
+
+/** Maximum number of bytes a pool keeps on the free list of a size class */
+#define	BUF_POOL_CLASS_BYTES	(256 * 1024)
+/** Minimum number of blocks a pool keeps on the free list of a size class */
+#define	BUF_POOL_CLASS_MIN	16
+
+/**
+ * A per-thread buffer pool
+ */
+typedef struct buf_pool {
+	BUF_BLOCK	*free[N_BUF_CLASSES];	 /*< Free lists of the owner */
+	int		n_free[N_BUF_CLASSES];	 /*< Lengths of the free lists */
+	BUF_BLOCK	*remote;		 /*< Blocks freed by other threads */
+	int		orphaned;		 /*< The owning thread has exited */
+	GWBUF_POOL_STATS stats;			 /*< Statistics of the pool */
+	struct buf_pool	*next;			 /*< Next pool in the list of all pools */
+} BUF_POOL;
+
+static	BUF_POOL	*allPools = NULL;	/*< All the pools ever created */
+static	SPINLOCK	poolspin = SPINLOCK_INIT;
+static	pthread_key_t	pool_key;
+static	pthread_once_t	pool_key_once = PTHREAD_ONCE_INIT;
+static	__thread BUF_POOL *local_pool = NULL;	/*< The pool of the calling thread */
+
+/**
+ * Return the size class for a block size
+ *
+ * @param size	The size of the block
+ * @return	The size class or -1 if the block is too large to be pooled
+ */
+static int
+buf_size_class(size_t size)
+{
+int	i;
+
+	for (i = 0; i < N_BUF_CLASSES; i++)
+	{
+		if (size <= buf_class_size[i])
+			return i;
+	}
+	return -1;
+}
+
+/**
+ * Free all the blocks on the remote free list of a pool back to malloc.
+ * Used for pools whose owning thread has exited.
+ *
+ * @param pool	The orphaned pool
+ */
+static void
+buf_pool_release_remote(BUF_POOL *pool)
+{
+BUF_BLOCK	*blk, *next;
+
+	blk = __sync_lock_test_and_set(&pool->remote, NULL);
+	while (blk)
+	{
+		next = blk->next;
+		free(blk);
+		blk = next;
+	}
+}
+
+/**
+ * Thread exit handler for the buffer pools. The free lists of the pool are
+ * returned to malloc and the pool is marked as orphaned, blocks from it
+ * that are freed later are returned to malloc by the freeing thread. The
+ * pool structure itself is kept as blocks still in use refer to it.
+ *
+ * @param data	The pool of the exiting thread
+ */
+static void
+buf_pool_thread_exit(void *data)
+{
+BUF_POOL	*pool = (BUF_POOL *)data;
+BUF_BLOCK	*blk;
+int		i;
+
+	for (i = 0; i < N_BUF_CLASSES; i++)
+	{
+		while ((blk = pool->free[i]) != NULL)
+		{
+			pool->free[i] = blk->next;
+			free(blk);
+		}
+		pool->n_free[i] = 0;
+	}
+	__sync_lock_test_and_set(&pool->orphaned, 1);
+	buf_pool_release_remote(pool);
+	local_pool = NULL;
+}
+
+static void
+buf_pool_key_init()
+{
+	pthread_key_create(&pool_key, buf_pool_thread_exit);
+}
+
+/**
+ * Return the pool of the calling thread, creating it on first use.
+ *
+ * @return The pool or NULL if one could not be created
+ */
+static BUF_POOL *
+buf_pool_get()
+{
+BUF_POOL	*pool;
+
+	if (local_pool)
+		return local_pool;
+	if ((pool = (BUF_POOL *)calloc(1, sizeof(BUF_POOL))) == NULL)
+		return NULL;
+	pthread_once(&pool_key_once, buf_pool_key_init);
+	pthread_setspecific(pool_key, pool);
+
+	spinlock_acquire(&poolspin);
+	pool->next = allPools;
+	allPools = pool;
+	spinlock_release(&poolspin);
+
+	local_pool = pool;
+	return pool;
+}
+
+/**
+ * Move the blocks freed by other threads onto the free lists of the pool.
+ * Only called by the owner of the pool.
+ *
+ * @param pool	The pool of the calling thread
+ */
+static void
+buf_pool_reclaim(BUF_POOL *pool)
+{
+BUF_BLOCK	*blk, *next;
+
+	blk = __sync_lock_test_and_set(&pool->remote, NULL);
+	while (blk)
+	{
+		next = blk->next;
+		blk->next = pool->free[blk->sclass];
+		pool->free[blk->sclass] = blk;
+		pool->n_free[blk->sclass]++;
+		blk = next;
+	}
+}
+
+/**
+ * Allocate a buffer block
+ *
+ * @param size	The size of the block
+ * @return	The block or NULL if memory could not be allocated
+ */
+static BUF_BLOCK *
+buf_block_alloc(size_t size)
+{
+BUF_POOL	*pool = NULL;
+BUF_BLOCK	*blk;
+int		sclass = buf_size_class(size);
+
+#if GWBUF_POOL
+	pool = buf_pool_get();
+#endif
+	if (pool == NULL || sclass < 0)
+	{
+		if ((blk = (BUF_BLOCK *)malloc(size)) == NULL)
+			return NULL;
+		if (pool)
+			pool->stats.n_oversize++;
+		blk->pool = NULL;
+		blk->sclass = -1;
+		return blk;
+	}
+
+	pool->stats.n_alloc++;
+	if (pool->free[sclass] == NULL && pool->remote)
+		buf_pool_reclaim(pool);
+	if ((blk = pool->free[sclass]) != NULL)
+	{
+		pool->free[sclass] = blk->next;
+		pool->n_free[sclass]--;
+		pool->stats.n_hit++;
+		return blk;
+	}
+	if ((blk = (BUF_BLOCK *)malloc(buf_class_size[sclass])) == NULL)
+		return NULL;
+	pool->stats.n_miss++;
+	blk->pool = pool;
+	blk->sclass = sclass;
+	return blk;
+}
+
+/**
+ * Free a buffer block, returning it to its home pool
+ *
+ * @param blk	The block to free
+ */
+static void
+buf_block_free(BUF_BLOCK *blk)
+{
+BUF_POOL	*pool = blk->pool;
+BUF_BLOCK	*head;
+int		sclass = blk->sclass;
+
+	if (pool == NULL)
+	{
+		free(blk);
+	}
+	else if (pool == local_pool)
+	{
+		if (pool->n_free[sclass] * buf_class_size[sclass] >= BUF_POOL_CLASS_BYTES
+			&& pool->n_free[sclass] >= BUF_POOL_CLASS_MIN)
+		{
+			pool->stats.n_released++;
+			free(blk);
+		}
+		else
+		{
+			blk->next = pool->free[sclass];
+			pool->free[sclass] = blk;
+			pool->n_free[sclass]++;
+		}
+	}
+	else
+	{
+		do {
+			head = pool->remote;
+			blk->next = head;
+		} while (!__sync_bool_compare_and_swap(&pool->remote, head, blk));
+
+		atomic_add(&pool->stats.n_remote_free, 1);
+		/*
+		 * If the owner has exited no one reclaims the remote list,
+		 * release it here. The check is done after the push so that
+		 * either this thread or the exit handler sees the block.
+		 */
+		if (pool->orphaned)
+			buf_pool_release_remote(pool);
+	}
+}
+
+/**
+ * Allocate a buffer header for a clone of an existing buffer. The header is
+ * zero filled.
+ *
+ * @return The header or NULL if memory could not be allocated
+ */
+static GWBUF *
+gwbuf_alloc_header()
+{
+BUF_BLOCK	*blk;
+GWBUF		*rval;
+
+	if ((blk = buf_block_alloc(BUF_HEADER_BLOCK)) == NULL)
+		return NULL;
+	rval = (GWBUF *)(blk + 1);
+	memset(rval, 0, sizeof(GWBUF));
+	return rval;
+}
+
+/**
+ * Return the block of a buffer header
+ *
+ * The header is either embedded in the data block of its shared buffer,
+ * in which case the block is freed when the last reference to the shared
+ * buffer is released, or it has a header block of its own.
+ *
+ * @param buf	The buffer
+ * @return	The header block or NULL if the header is embedded
+ */
+static BUF_BLOCK *
+gwbuf_header_block(GWBUF *buf)
+{
+	if (buf->sbuf == (SHARED_BUF *)(buf + 1))
+		return NULL;
+	return (BUF_BLOCK *)buf - 1;
+}
+
+/**
+ * Collect the statistics of all the buffer pools
+ *
+ * @param stats	The structure to fill with the summed statistics
+ */
+void
+gwbuf_pool_stats(GWBUF_POOL_STATS *stats)
+{
+BUF_POOL	*pool;
+
+	memset(stats, 0, sizeof(GWBUF_POOL_STATS));
+	spinlock_acquire(&poolspin);
+	for (pool = allPools; pool; pool = pool->next)
+	{
+		stats->n_alloc += pool->stats.n_alloc;
+		stats->n_hit += pool->stats.n_hit;
+		stats->n_miss += pool->stats.n_miss;
+		stats->n_oversize += pool->stats.n_oversize;
+		stats->n_remote_free += pool->stats.n_remote_free;
+		stats->n_released += pool->stats.n_released;
+		if (!pool->orphaned)
+			stats->n_pools++;
+	}
+	spinlock_release(&poolspin);
+}
+
+/**
+ * Print the buffer pool statistics
+ *
+ * @param dcb	The DCB to print to
+ */
+void
+dprintBufferStats(DCB *dcb)
+{
+GWBUF_POOL_STATS	stats;
+
+	gwbuf_pool_stats(&stats);
+	dcb_printf(dcb, "\nBuffer Pool Statistics.\n\n");
+	dcb_printf(dcb, "No. of thread pools:				%d\n",
+							stats.n_pools);
+	dcb_printf(dcb, "No. of pooled block allocations:		%d\n",
+							stats.n_alloc);
+	dcb_printf(dcb, "No. of allocations served from a pool:		%d\n",
+							stats.n_hit);
+	dcb_printf(dcb, "No. of allocations served by malloc:		%d\n",
+							stats.n_miss);
+	dcb_printf(dcb, "No. of allocations too large for a pool:	%d\n",
+							stats.n_oversize);
+	dcb_printf(dcb, "No. of blocks freed to another thread:		%d\n",
+							stats.n_remote_free);
+	dcb_printf(dcb, "No. of blocks released to malloc:		%d\n",
+							stats.n_released);
+}
 
 /**
  * Allocate a new gateway buffer structure of size bytes.
  *
- * For now we allocate memory directly from malloc for buffer the management
- * structure and the actual data buffer itself. We may swap at a future date
- * to a more effecient mechanism.
+ * The buffer header, the shared buffer and the data area are allocated as
+ * a single block, which comes from the buffer pool of the calling thread
+ * unless the data area is larger than the largest size class.
  *
  * @param	size The size in bytes of the data area required
  * @return	Pointer to the buffer structure or NULL if memory could not
@@ -71,32 +442,17 @@ static buffer_object_t* gwbuf_remove_buffer_object(
 GWBUF	*
 gwbuf_alloc(unsigned int size)
 {
-GWBUF		*rval;
+GWBUF		*rval = NULL;
 SHARED_BUF	*sbuf;
+BUF_BLOCK	*blk;
 
-	/* Allocate the buffer header */
-	if ((rval = (GWBUF *)malloc(sizeof(GWBUF))) == NULL)
+	if ((blk = buf_block_alloc(BUF_DATA_BLOCK(size))) == NULL)
 	{
-		goto retblock;;
-	}
-
-	/* Allocate the shared data buffer */
-	if ((sbuf = (SHARED_BUF *)malloc(sizeof(SHARED_BUF))) == NULL)
-	{
-		free(rval);
-		rval = NULL;
-		goto retblock;
-	}
-
-	/* Allocate the space for the actual data */
-	if ((sbuf->data = (unsigned char *)malloc(size)) == NULL)
-	{
-		ss_dassert(sbuf->data != NULL);
-		free(rval);
-		free(sbuf);
-		rval = NULL;
 		goto retblock;
 	}
+	rval = (GWBUF *)(blk + 1);
+	sbuf = (SHARED_BUF *)(rval + 1);
+	sbuf->data = (unsigned char *)(sbuf + 1);
 	spinlock_init(&rval->gwbuf_lock);
 	rval->start = sbuf->data;
 	rval->end = (void *)((char *)rval->start+size);
@@ -121,6 +477,27 @@ retblock:
 	return rval;
 }
 
+/**
+ * Return the number of data bytes a buffer allocated for size bytes could
+ * hold without using a larger block. Callers that do not know how much
+ * data will arrive, such as socket reads, use this to avoid wasting the
+ * tail of the pooled block.
+ *
+ * @param size	The minimum number of data bytes
+ * @return	The usable size, never less than size
+ */
+unsigned int
+gwbuf_pool_fit(unsigned int size)
+{
+#if GWBUF_POOL
+int	sclass = buf_size_class(BUF_DATA_BLOCK(size));
+
+	if (sclass > 0)
+		return buf_class_size[sclass] - BUF_DATA_BLOCK(0);
+#endif
+	return size;
+}
+
 /**
  * Free a gateway buffer
  *
@@ -130,22 +507,12 @@ void
 gwbuf_free(GWBUF *buf)
 {
 BUF_PROPERTY	*prop;
+BUF_BLOCK	*hdr;
+SHARED_BUF	*sbuf;
 
         buffer_object_t* bo;
         
 	CHK_GWBUF(buf);
-	if (atomic_add(&buf->sbuf->refcount, -1) == 1)
-	{
-                free(buf->sbuf->data);
-                free(buf->sbuf);
-		bo = buf->gwbuf_bufobj;
-
-                while (bo != NULL)
-                {
-                        bo = gwbuf_remove_buffer_object(buf, bo);
-                }
-
-	}
 	while (buf->properties)
 	{
 		prop = buf->properties;
@@ -161,7 +528,26 @@ BUF_PROPERTY	*prop;
                 buf->hint = buf->hint->next;
                 hint_free(h);
         }
-	free(buf);
+	/*
+	 * The header may live in the data block, so it must not be used
+	 * after the last reference to the shared buffer has been dropped.
+	 */
+	hdr = gwbuf_header_block(buf);
+	sbuf = buf->sbuf;
+	if (atomic_add(&sbuf->refcount, -1) == 1)
+	{
+		bo = buf->gwbuf_bufobj;
+
+                while (bo != NULL)
+                {
+                        bo = gwbuf_remove_buffer_object(buf, bo);
+                }
+		buf_block_free((BUF_BLOCK *)((GWBUF *)sbuf - 1) - 1);
+	}
+	if (hdr)
+	{
+		buf_block_free(hdr);
+	}
 }
 
 /**
@@ -179,7 +565,7 @@ gwbuf_clone(GWBUF *buf)
 {
 GWBUF	*rval;
 
-	if ((rval = (GWBUF *)calloc(1,sizeof(GWBUF))) == NULL)
+	if ((rval = gwbuf_alloc_header()) == NULL)
 	{
 		ss_dassert(rval != NULL);
 		LOGIF(LE, (skygw_log_write_flush(
@@ -243,7 +629,7 @@ GWBUF *gwbuf_clone_portion(
         CHK_GWBUF(buf);
         ss_dassert(start_offset+length <= GWBUF_LENGTH(buf));
         
-        if ((clonebuf = (GWBUF *)malloc(sizeof(GWBUF))) == NULL)
+        if ((clonebuf = gwbuf_alloc_header()) == NULL)
         {
 		ss_dassert(clonebuf != NULL);
 		LOGIF(LE, (skygw_log_write_flush(
@@ -520,7 +906,10 @@ void gwbuf_add_buffer_object(
         }
         *p_b = newb;
         /** Set flag */
-        buf->gwbuf_info |= GWBUF_INFO_PARSED;
+        if (id == GWBUF_PARSING_INFO)
+        {
+                buf->gwbuf_info |= GWBUF_INFO_PARSED;
+        }
         /** Unlock */
         spinlock_release(&buf->gwbuf_lock);
 }
@@ -723,6 +723,8 @@ hashtable_memory_fns(monitorhash,strdup,NULL,free,NULL);
 			char *protocol;
 			char *monuser;
 			char *monpw;
+			char *persistpoolmax;
+			char *persistmaxtime;
 
                         address = config_get_value(obj->parameters, "address");
 			port = config_get_value(obj->parameters, "port");
@@ -730,6 +732,10 @@ hashtable_memory_fns(monitorhash,strdup,NULL,free,NULL);
 			monuser = config_get_value(obj->parameters,
                                                    "monitoruser");
 			monpw = config_get_value(obj->parameters, "monitorpw");
+			persistpoolmax = config_get_value(obj->parameters,
+						"persistpoolmax");
+			persistmaxtime = config_get_value(obj->parameters,
+						"persistmaxtime");
 
 			if (address && port && protocol)
 			{
@@ -737,6 +743,12 @@ hashtable_memory_fns(monitorhash,strdup,NULL,free,NULL);
                                                             protocol,
                                                             atoi(port));
 				server_set_unique_name(obj->element, obj->object);
+				if (obj->element && persistpoolmax)
+					((SERVER *)obj->element)->persistpoolmax =
+						strtol(persistpoolmax, NULL, 0);
+				if (obj->element && persistmaxtime)
+					((SERVER *)obj->element)->persistmaxtime =
+						strtol(persistmaxtime, NULL, 0);
 			}
 			else
 			{
@@ -776,6 +788,10 @@ hashtable_memory_fns(monitorhash,strdup,NULL,free,NULL);
 								"monitorpw")
 						&& strcmp(params->name,
 								"type")
+						&& strcmp(params->name,
+								"persistpoolmax")
+						&& strcmp(params->name,
+								"persistmaxtime")
 						)
 					{
 						serverAddParameter(obj->element,
@@ -1379,6 +1395,29 @@ config_pollsleep()
 	return gateway.pollsleep;
 }
 
+/**
+ * Return whether the polling threads use their own epoll sets and event
+ * queues with the DCBs of a session bound to a single thread.
+ *
+ * @return Non-zero if poll affinity is enabled
+ */
+int
+config_poll_affinity()
+{
+	return gateway.poll_affinity;
+}
+
+/**
+ * Return the maximum number of statements in the query classification cache
+ *
+ * @return The size of the cache, 0 if the cache is disabled
+ */
+int
+config_qc_cache_size()
+{
+	return gateway.qc_cache_size;
+}
+
 /**
  * Return the feedback config data pointer
  *
@@ -1422,6 +1461,14 @@ int i;
 	{
 		gateway.pollsleep = atoi(value);
         }
+	else if (strcmp(name, "poll_affinity") == 0)
+	{
+		gateway.poll_affinity = config_truth_value((char*)value);
+	}
+	else if (strcmp(name, "query_classifier_cache_size") == 0)
+	{
+		gateway.qc_cache_size = atoi(value);
+	}
 	else if (strcmp(name, "ms_timestamp") == 0)
 	{
 		skygw_set_highp(config_truth_value((char*)value));
@@ -1491,6 +1538,8 @@ global_defaults()
 	gateway.n_threads = 1;
 	gateway.n_nbpoll = DEFAULT_NBPOLLS;
 	gateway.pollsleep = DEFAULT_POLLSLEEP;
+	gateway.poll_affinity = 0;
+	gateway.qc_cache_size = DEFAULT_QC_CACHE_SIZE;
 	if (version_string != NULL)
 		gateway.version_string = strdup(version_string);
 	else
@@ -1796,6 +1845,8 @@ SERVER			*server;
 			char *protocol;
 			char *monuser;
 			char *monpw;
+			char *persistpoolmax;
+			char *persistmaxtime;
                         
 			address = config_get_value(obj->parameters, "address");
 			port = config_get_value(obj->parameters, "port");
@@ -1803,6 +1854,10 @@ SERVER			*server;
 			monuser = config_get_value(obj->parameters,
                                                    "monitoruser");
 			monpw = config_get_value(obj->parameters, "monitorpw");
+			persistpoolmax = config_get_value(obj->parameters,
+						"persistpoolmax");
+			persistmaxtime = config_get_value(obj->parameters,
+						"persistmaxtime");
 
                         if (address && port && protocol)
 			{
@@ -1830,6 +1885,14 @@ SERVER			*server;
                                                                  monpw);
                                         }
 				}
+				if (obj->element)
+				{
+					server = obj->element;
+					server->persistpoolmax = persistpoolmax ?
+						strtol(persistpoolmax, NULL, 0) : 0;
+					server->persistmaxtime = persistmaxtime ?
+						strtol(persistmaxtime, NULL, 0) : 0;
+				}
 			}
 			else
                         {
@@ -91,6 +91,30 @@
 #define LOAD_MYSQL_DATABASE_NAMES "SELECT * FROM ( (SELECT COUNT(1) AS ndbs FROM INFORMATION_SCHEMA.SCHEMATA) AS tbl1, (SELECT GRANTEE,PRIVILEGE_TYPE from INFORMATION_SCHEMA.USER_PRIVILEGES WHERE privilege_type='SHOW DATABASES' AND REPLACE(GRANTEE, \'\\'\',\'\')=CURRENT_USER()) AS tbl2)"
 
 #define ERROR_NO_SHOW_DATABASES "%s: Unable to load database grant information, MaxScale authentication will proceed without including database permissions. To correct this GRANT SHOW DATABASES ON *.* privilege to the user %s."
+/**
+ * A database specific grant of a user@host in the users' index. Grants with
+ * % wildcards are compiled once when the grant is added to the index.
+ */
+typedef struct mysql_db_grant {
+	char			*db;	/**< The database name or pattern */
+	regex_t			*re;	/**< The compiled pattern, NULL for a database name */
+	struct mysql_db_grant	*next;	/**< The next grant of the user@host */
+} MYSQL_DB_GRANT;
+
+/**
+ * A node in the host trie of a user in the users' index. The root node of
+ * the trie is user@%, a node at depth n is the user@host with netmask n * 8
+ * whose first n address bytes are the bytes of the path to the node.
+ */
+typedef struct mysql_host_node {
+	unsigned char		byte;		/**< The address byte of the node */
+	char			*password;	/**< The password, NULL if user@host does not exist */
+	int			anydb;		/**< The user@host has a grant for any database */
+	MYSQL_DB_GRANT		*grants;	/**< The database specific grants */
+	struct mysql_host_node	*child;		/**< The first node of the next address byte */
+	struct mysql_host_node	*next;		/**< The next node with the same parent */
+} MYSQL_HOST_NODE;
+
 /** Defined in log_manager.cc */
 extern int            lm_enabled_logfiles_bitmask;
 extern size_t         log_ses_count[];
@@ -101,6 +125,10 @@ static int uh_cmpfun( void* v1, void* v2);
 static void *uh_keydup(void* key);
 static void uh_keyfree( void* key);
 static int uh_hfun( void* key);
+static int uh_namehash(char *name);
+static int mysql_users_index_add(USERS *users, MYSQL_USER_HOST *key, char *auth);
+static void mysql_users_index_free(void *index);
+static int db_pattern_compile(char *pattern, regex_t *re);
 char *mysql_users_fetch(USERS *users, MYSQL_USER_HOST *key);
 char *mysql_format_user_entry(void *data);
 int add_mysql_users_with_host_ipv4(USERS *users, char *user, char *host, char *passwd, char *anydb, char *db);
@@ -1594,6 +1622,15 @@ USERS	*rval;
 		return NULL;
 	}
 
+	/* the index maps the user name to the root of the user's host trie */
+	if ((rval->index = hashtable_alloc(USERS_HASHTABLE_DEFAULT_SIZE, uh_namehash, strcmp)) == NULL) {
+		hashtable_free(rval->data);
+		free(rval);
+		return NULL;
+	}
+	hashtable_memory_fns(rval->index, (HASHMEMORYFN)strdup, NULL, (HASHMEMORYFN)free, NULL);
+	rval->usersIndexFree = mysql_users_index_free;
+
 	/* set the MySQL user@host print routine for the debug interface */
 	rval->usersCustomUserFormat = mysql_format_user_entry;
 
@@ -1625,6 +1662,13 @@ int     add;
         add = hashtable_add(users->data, key, auth);
         atomic_add(&users->stats.n_entries, add);
 
+	if (add && !mysql_users_index_add(users, key, auth)) {
+		LOGIF(LE, (skygw_log_write_flush(
+			LOGFILE_ERROR,
+			"Error : Failed to add user %s to the users' index.",
+			key->user)));
+	}
+
         return add;
 }
 
@@ -1642,6 +1686,264 @@ char *mysql_users_fetch(USERS *users, MYSQL_USER_HOST *key) {
 	return hashtable_fetch(users->data, key);
 }
 
+/**
+ * Find the password of a MySQL user with the users' index.
+ *
+ * The host trie of the user is walked along the client address and the
+ * user@host entries on the path are checked from the most specific host,
+ * the client address itself, to the least specific one, user@%. The first
+ * user@host that has a grant for the database in key->resource is the match.
+ *
+ * @param users			The MySQL users table
+ * @param key			The user, the client address and the database
+ * @param wildcard_hosts	If zero only the client address itself is checked
+ * @return	The password of the user@host or NULL if there is no match
+ */
+char *
+mysql_users_match(USERS *users, MYSQL_USER_HOST *key, int wildcard_hosts)
+{
+MYSQL_HOST_NODE	*path[5];
+MYSQL_HOST_NODE	*node;
+MYSQL_DB_GRANT	*grant;
+unsigned char	*addr;
+char		*db;
+int		depth;
+
+	if (users == NULL || users->index == NULL || key == NULL || key->user == NULL)
+		return NULL;
+
+        atomic_add(&users->stats.n_fetches, 1);
+
+	if ((path[0] = hashtable_fetch(users->index, key->user)) == NULL)
+		return NULL;
+
+	addr = (unsigned char *)&key->ipv4.sin_addr.s_addr;
+	for (depth = 0; depth < 4; depth++)
+	{
+		for (node = path[depth]->child; node && node->byte != addr[depth]; node = node->next)
+			;
+		if (node == NULL)
+			break;
+		path[depth + 1] = node;
+	}
+
+	db = key->resource;
+	for (; depth >= 0 && (wildcard_hosts || depth == 4); depth--)
+	{
+		node = path[depth];
+
+		if (node->password == NULL)
+			continue;
+
+		/* no database name or a grant for any database */
+		if (db == NULL || *db == '\0' || node->anydb)
+			return node->password;
+
+		for (grant = node->grants; grant; grant = grant->next)
+		{
+			if (grant->re ? regexec(grant->re, db, 0, NULL, 0) == 0 :
+				strcmp(grant->db, db) == 0)
+			{
+				return node->password;
+			}
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Add a user@host and its database grant to the users' index.
+ *
+ * @param users	The MySQL users table
+ * @param key	The user@host and the database grant as stored in the table
+ * @param auth	The password of the user
+ * @return	1 on success, 0 on failure
+ */
+static int
+mysql_users_index_add(USERS *users, MYSQL_USER_HOST *key, char *auth)
+{
+MYSQL_HOST_NODE	*node, *child;
+MYSQL_DB_GRANT	*grant;
+unsigned char	*addr;
+int		depth;
+
+	if (users->index == NULL)
+		return 0;
+
+	if ((node = hashtable_fetch(users->index, key->user)) == NULL)
+	{
+		if ((node = calloc(1, sizeof(MYSQL_HOST_NODE))) == NULL)
+			return 0;
+		if (!hashtable_add(users->index, key->user, node))
+		{
+			free(node);
+			return 0;
+		}
+	}
+
+	addr = (unsigned char *)&key->ipv4.sin_addr.s_addr;
+	for (depth = 0; depth < key->netmask / 8 && depth < 4; depth++)
+	{
+		for (child = node->child; child && child->byte != addr[depth]; child = child->next)
+			;
+		if (child == NULL)
+		{
+			if ((child = calloc(1, sizeof(MYSQL_HOST_NODE))) == NULL)
+				return 0;
+			child->byte = addr[depth];
+			child->next = node->child;
+			node->child = child;
+		}
+		node = child;
+	}
+
+	if (node->password == NULL && (node->password = strdup(auth ? auth : "")) == NULL)
+		return 0;
+
+	/* no database grants at all */
+	if (key->resource == NULL)
+		return 1;
+
+	if (*key->resource == '\0')
+	{
+		node->anydb = 1;
+		return 1;
+	}
+
+	if ((grant = calloc(1, sizeof(MYSQL_DB_GRANT))) == NULL)
+		return 0;
+	if ((grant->db = strdup(key->resource)) == NULL)
+	{
+		free(grant);
+		return 0;
+	}
+	if (strchr(grant->db, '%'))
+	{
+		if ((grant->re = malloc(sizeof(regex_t))) == NULL ||
+			db_pattern_compile(grant->db, grant->re))
+		{
+			LOGIF(LE, (skygw_log_write_flush(
+				LOGFILE_ERROR,
+				"Error : Failed to compile the database grant %s of user %s.",
+				grant->db,
+				key->user)));
+			free(grant->re);
+			free(grant->db);
+			free(grant);
+			return 0;
+		}
+	}
+	grant->next = node->grants;
+	node->grants = grant;
+
+	return 1;
+}
+
+/**
+ * Free a host trie of the users' index
+ *
+ * @param node	The root node of the trie
+ */
+static void
+mysql_host_node_free(MYSQL_HOST_NODE *node)
+{
+MYSQL_HOST_NODE	*next;
+MYSQL_DB_GRANT	*grant;
+
+	while (node)
+	{
+		next = node->next;
+		mysql_host_node_free(node->child);
+		while ((grant = node->grants) != NULL)
+		{
+			node->grants = grant->next;
+			if (grant->re)
+			{
+				regfree(grant->re);
+				free(grant->re);
+			}
+			free(grant->db);
+			free(grant);
+		}
+		free(node->password);
+		free(node);
+		node = next;
+	}
+}
+
+/**
+ * Free the users' index
+ *
+ * @param index	The index of a MySQL users table
+ */
+static void
+mysql_users_index_free(void *index)
+{
+HASHITERATOR	*iter;
+char		*user;
+
+	if (index == NULL)
+		return;
+
+	if ((iter = hashtable_iterator(index)) != NULL)
+	{
+		while ((user = hashtable_next(iter)) != NULL)
+			mysql_host_node_free(hashtable_fetch(index, user));
+		hashtable_iterator_free(iter);
+	}
+	hashtable_free(index);
+}
+
+/**
+ * Compile a database grant with % wildcards into a regular expression.
+ * The % wildcards match any sequence of characters and the match is case
+ * insensitive.
+ *
+ * @param pattern	The database grant
+ * @param re		The regular expression to compile
+ * @return		0 on success, the regcomp() error otherwise
+ */
+static int
+db_pattern_compile(char *pattern, regex_t *re)
+{
+char	db[MYSQL_DATABASE_MAXLEN * 2 + 1];
+char	*p = db;
+
+	while (*pattern && p < db + sizeof(db) - 2)
+	{
+		if (*pattern == '%')
+		{
+			*p++ = '.';
+			*p++ = '*';
+		}
+		else
+		{
+			*p++ = *pattern;
+		}
+		pattern++;
+	}
+	*p = '\0';
+
+	return regcomp(re, db, REG_ICASE|REG_NOSUB);
+}
+
+/**
+ * The hash function of the user names in the users' index
+ *
+ * @param name	The user name
+ * @return	The hash key
+ */
+static int
+uh_namehash(char *name)
+{
+unsigned int	hash = 5381;
+
+	while (*name)
+		hash = hash * 33 + (unsigned char)*name++;
+
+	return (int)hash;
+}
+
 /**
  * The hash function we use for storing MySQL users as: users@hosts.
  * Currently only IPv4 addresses are supported
@@ -1656,7 +1958,8 @@ static int uh_hfun( void* key) {
 	if (key == NULL || hu == NULL || hu->user == NULL) {
 		return 0;
 	} else {
-        	return (*hu->user + *(hu->user + 1) + (unsigned int) (hu->ipv4.sin_addr.s_addr & 0xFF000000 / (256 * 256 * 256)));
+		/* the first address byte is the same for all the wildcard lookups */
+        	return (uh_namehash(hu->user) + (unsigned int) (hu->ipv4.sin_addr.s_addr & 0xFF));
 	}
 }
 
@@ -1701,26 +2004,8 @@ static int uh_cmpfun( void* v1, void* v2) {
 			if(hu2->resource && strlen(hu2->resource) && strchr(hu2->resource,'%') != NULL)
 			{
 			  regex_t re;
-			  char db[MYSQL_DATABASE_MAXLEN*2 +1];
-			  strcpy(db,hu2->resource);
-			  int len = strlen(db);
-			  char* ptr = strrchr(db,'%');
-
-			  if(ptr == NULL)
-			  {
-			    return 1;
-			  }
 
-			  while(ptr)
-			  {
-			    memmove(ptr+1,ptr,(len - (ptr - db)) + 1);
-			    *ptr = '.';
-			    *(ptr + 1) = '*';
-			    len = strlen(db);
-			    ptr = strrchr(db,'%');
-			  }
-
-			  if((regcomp(&re,db,REG_ICASE|REG_NOSUB)))
+			  if(db_pattern_compile(hu2->resource, &re))
 			  {
 			    return 1;
 			  }
@@ -2165,6 +2450,7 @@ int			tmp;
 			free(dbkey);
 			return NULL;
 		}
+		dbkey->resource[tmp] = 0;
 	}
 	else		// NULL is valid, so represent with a length of -1
 	{
@@ -2221,7 +2507,20 @@ dbusers_save(USERS *users, char *filename)
 int
 dbusers_load(USERS *users, char *filename)
 {
-	return hashtable_load(users->data, filename, dbusers_keyread, dbusers_valueread);
+HASHITERATOR	*iter;
+MYSQL_USER_HOST	*key;
+int		rval;
+
+	rval = hashtable_load(users->data, filename, dbusers_keyread, dbusers_valueread);
+
+	/* the entries were not added with mysql_users_add(), index them now */
+	if (rval > 0 && (iter = hashtable_iterator(users->data)) != NULL)
+	{
+		while ((key = hashtable_next(iter)) != NULL)
+			mysql_users_index_add(users, key, hashtable_fetch(users->data, key));
+		hashtable_iterator_free(iter);
+	}
+	return rval;
 }
 
 /**
@@ -65,6 +65,7 @@
 #include <modules.h>
 #include <router.h>
 #include <errno.h>
+#include <sys/uio.h>
 #include <gw.h>
 #include <poll.h>
 #include <atomic.h>
@@ -79,9 +80,21 @@ extern size_t         log_ses_count[];
 extern __thread log_info_t tls_log_info;
 
 static	DCB		*allDCBs = NULL;	/* Diagnostics need a list of DCBs */
+static	DCB		*lastDCB = NULL;	/* The last DCB in the list */
 static	DCB		*zombies = NULL;
 static	SPINLOCK	dcbspin = SPINLOCK_INIT;
-static	SPINLOCK	zombiespin = SPINLOCK_INIT;
+
+/**
+ * Zombie reclamation state. The zombie list is only pushed to and taken
+ * as a whole, so it is updated without locks.
+ */
+static	unsigned long	zombie_epoch = 1;	/*< The current zombie epoch */
+static	unsigned long	*thread_epochs = NULL;	/*< Epoch seen by each polling thread, 0 if not running */
+static	int		n_thread_epochs = 0;	/*< Number of polling threads */
+static	int		zombie_reclaiming = 0;	/*< Set while a thread frees zombies */
+static	unsigned long	zombie_safe = 0;	/*< Safe epoch of the previous reclamation */
+static	int		zombie_retry = 0;	/*< Safe zombies were left on the list */
+static	ZOMBIESTATS	zombiestats;
 
 static void dcb_final_free(DCB *dcb);
 static bool dcb_set_state_nomutex(
@@ -94,6 +107,12 @@ static int  dcb_null_write(DCB *dcb, GWBUF *buf);
 static int  dcb_null_close(DCB *dcb);
 static int  dcb_null_auth(DCB *dcb, SERVER *server, SESSION *session, GWBUF *buf);
 static int  dcb_isvalid_nolock(DCB *dcb);
+static int  dcb_fill_iovec(GWBUF *queue, struct iovec *iov, int *nbytes);
+static GWBUF *dcb_consume_written(GWBUF *queue, int nbytes);
+static bool dcb_persistent_add(DCB *dcb);
+static DCB  *dcb_persistent_get(SERVER *server, const char *user);
+static bool dcb_persistent_healthy(DCB *dcb);
+static void dcb_persistent_dispose(DCB *dcb);
 
 size_t dcb_get_session_id(
 	DCB* dcb)
@@ -200,15 +219,19 @@ DCB	*rval;
 	rval->evq.prev = NULL;
 	rval->evq.pending_events = 0;
 	rval->evq.processing = 0;
+	rval->evq.owner = -1;
 	spinlock_init(&rval->evq.eventqlock);
 
 	memset(&rval->stats, 0, sizeof(DCBSTATS));	// Zero the statistics
 	rval->state = DCB_STATE_ALLOC;
-	bitmask_init(&rval->memdata.bitmask);
+	rval->memdata.epoch = 0;
+	rval->memdata.added = 0;
+	rval->memdata.next = NULL;
 	rval->writeqlen = 0;
 	rval->high_water = 0;
 	rval->low_water = 0;
 	rval->next = NULL;
+	rval->prev = NULL;
 	rval->callbacks = NULL;
 	rval->data = NULL;
 
@@ -217,15 +240,12 @@ DCB	*rval;
 	rval->flags = 0;
 
 	spinlock_acquire(&dcbspin);
-	if (allDCBs == NULL)
+	rval->prev = lastDCB;
+	if (lastDCB == NULL)
 		allDCBs = rval;
 	else
-	{
-		DCB *ptr = allDCBs;
-		while (ptr->next)
-			ptr = ptr->next;
-		ptr->next = rval;
-	}
+		lastDCB->next = rval;
+	lastDCB = rval;
 	spinlock_release(&dcbspin);
 	return rval;
 }
@@ -252,12 +272,32 @@ dcb_free(DCB *dcb)
 	}
 }
 
+/**
+ * Push a chain of zombie DCBs linked through memdata.next to the top of
+ * the zombies list.
+ *
+ * @param first	The first DCB of the chain
+ * @param last	The last DCB of the chain
+ */
+static void
+dcb_push_zombies(DCB *first, DCB *last)
+{
+DCB	*head;
+
+	do {
+		head = zombies;
+		last->memdata.next = head;
+	} while (!__sync_bool_compare_and_swap(&zombies, head, first));
+}
+
 /** 
- * Add the DCB to the end of zombies list. 
+ * Add the DCB to the top of zombies list. 
  *
  * Adding to list occurs once per DCB. This is ensured by changing the
- * state of DCB to DCB_STATE_ZOMBIE after addition. Prior insertion, DCB state
- * is checked and operation proceeds only if state differs from DCB_STATE_ZOMBIE.
+ * state of DCB to DCB_STATE_ZOMBIE under the DCB lock before the addition.
+ * The DCB is stamped with the current zombie epoch, which is then advanced,
+ * so that it is freed only after every polling thread has passed the end
+ * of its polling loop.
  * @param dcb The DCB to add to the zombie list
  * @return none
  */
@@ -269,32 +309,89 @@ dcb_add_to_zombieslist(DCB *dcb)
         
         CHK_DCB(dcb);        
 
-        /*<
-         * Protect zombies list access.
-         */
-	spinlock_acquire(&zombiespin);
+        spinlock_acquire(&dcb->dcb_initlock);
         /*<
          * If dcb is already added to zombies list, return.
          */
         if (dcb->state != DCB_STATE_NOPOLLING) {
                 ss_dassert(dcb->state != DCB_STATE_POLLING &&
                            dcb->state != DCB_STATE_LISTENING);
-                spinlock_release(&zombiespin);
+                spinlock_release(&dcb->dcb_initlock);
                 return;
         }
-        /*<
-         * Add closing dcb to the top of the list.
-         */
-        dcb->memdata.next = zombies;
-        zombies = dcb;
         /*<
          * Set state which indicates that it has been added to zombies
          * list.
          */
-        succp = dcb_set_state(dcb, DCB_STATE_ZOMBIE, &prev_state);
+        succp = dcb_set_state_nomutex(dcb, DCB_STATE_ZOMBIE, &prev_state);
         ss_info_dassert(succp, "Failed to set DCB_STATE_ZOMBIE");
-        
-	spinlock_release(&zombiespin);
+        spinlock_release(&dcb->dcb_initlock);
+
+        /*<
+         * The timer must not expire once the DCB is a zombie, a timer that
+         * has already expired is run before the epoch of its thread moves.
+         */
+        timer_cancel(&dcb->timer);
+        dcb->memdata.epoch = __sync_fetch_and_add(&zombie_epoch, 1);
+        dcb->memdata.added = hkheartbeat;
+        atomic_add(&zombiestats.n_added, 1);
+        atomic_add(&zombiestats.n_zombies, 1);
+        /*<
+         * Add closing dcb to the top of the list.
+         */
+        dcb_push_zombies(dcb, dcb);
+}
+
+/**
+ * Allocate the zombie epochs of the polling threads. This must be called
+ * before the polling threads are started. If it is not called the zombies
+ * are freed on the first call to dcb_process_zombies.
+ *
+ * @param nthreads	The number of polling threads
+ * @return 0 on success, -1 if memory allocation failed
+ */
+int
+dcb_zombies_init(int nthreads)
+{
+	if ((thread_epochs = (unsigned long *)calloc(nthreads,
+					sizeof(unsigned long))) == NULL)
+	{
+		return -1;
+	}
+	n_thread_epochs = nthreads;
+	return 0;
+}
+
+/**
+ * Mark the polling thread as running. The zombies added after this are not
+ * freed before the thread has processed the zombie list.
+ *
+ * @param threadid	The thread ID of the polling thread
+ */
+void
+dcb_zombies_thread_start(int threadid)
+{
+	if (threadid >= 0 && threadid < n_thread_epochs)
+	{
+		thread_epochs[threadid] = zombie_epoch;
+		__sync_synchronize();
+	}
+}
+
+/**
+ * Mark the polling thread as stopped, it no longer holds back the freeing
+ * of zombies.
+ *
+ * @param threadid	The thread ID of the polling thread
+ */
+void
+dcb_zombies_thread_stop(int threadid)
+{
+	if (threadid >= 0 && threadid < n_thread_epochs)
+	{
+		__sync_synchronize();
+		thread_epochs[threadid] = 0;
+	}
 }
 
 /*
@@ -337,8 +434,7 @@ DCB	*clone;
 /**
  * Free a DCB and remove it from the chain of all DCBs
  *
- * NB This is called with the caller holding the zombie queue
- * spinlock
+ * NB This is called once the DCB has been removed from the zombie queue
  *
  * @param dcb The DCB to free
  */
@@ -361,29 +457,18 @@ DCB_CALLBACK		*cb;
 			dcb)));
 	}
 
+	timer_cancel(&dcb->timer);
+
 	/*< First remove this DCB from the chain */
 	spinlock_acquire(&dcbspin);
-	if (allDCBs == dcb)
-	{
-		/*<
-		 * Deal with the special case of removing the DCB at the head of
-		 * the chain.
-		 */
+	if (dcb->prev)
+		dcb->prev->next = dcb->next;
+	else
 		allDCBs = dcb->next;
-	}
+	if (dcb->next)
+		dcb->next->prev = dcb->prev;
 	else
-	{
-		/*<
-		 * We find the DCB that point to the one we are removing and then
-		 * set the next pointer of that DCB to the next pointer of the
-		 * DCB we are removing.
-		 */
-		DCB *ptr = allDCBs;
-		while (ptr && ptr->next != dcb)
-			ptr = ptr->next;
-		if (ptr)
-			ptr->next = dcb->next;
-	}
+		lastDCB = dcb->prev;
 	spinlock_release(&dcbspin);
 
         if (dcb->session) {
@@ -436,7 +521,6 @@ DCB_CALLBACK		*cb;
 	spinlock_release(&dcb->cb_lock);
 	if(dcb->ssl)
 	    SSL_free(dcb->ssl);
-	bitmask_free(&dcb->memdata.bitmask);
 	free(dcb);
 }
 
@@ -444,113 +528,131 @@ DCB_CALLBACK		*cb;
  * Process the DCB zombie queue
  *
  * This routine is called by each of the polling threads with
- * the thread id of the polling thread. It must clear the bit in
- * the memdata bitmask for the polling thread that calls it. If the
- * operation of clearing this bit means that no bits are set in
- * the memdata.bitmask then the DCB is no longer able to be 
- * referenced and it can be finally removed.
+ * the thread id of the polling thread at the end of its polling loop,
+ * where the thread holds no references to DCBs. The thread records the
+ * current zombie epoch as the last epoch it has seen. The zombies stamped
+ * with an epoch before the oldest epoch seen by the running polling threads
+ * are no longer able to be referenced and they are removed in one batch.
+ *
+ * Only one thread at a time frees zombies, the other threads return
+ * without waiting for it.
  *
  * @param	threadid	The thread ID of the caller
  */
 DCB *
 dcb_process_zombies(int threadid)
 {
-DCB	*ptr, *lptr;
-DCB*    dcb_list = NULL;
-DCB*    dcb = NULL;
-bool    succp = false;
+DCB		*ptr, *next;
+DCB		*keep = NULL, *keep_tail = NULL;
+DCB*		dcb_list = NULL;
+DCB*		dcb = NULL;
+bool		succp = false;
+unsigned long	safe, age;
+int		i, nfreed = 0;
+
+	/** This is a quiescent point of the calling thread */
+	if (threadid >= 0 && threadid < n_thread_epochs)
+	{
+		__sync_synchronize();
+		thread_epochs[threadid] = zombie_epoch;
+	}
 
 	/**
 	 * Perform a dirty read to see if there is anything in the queue.
-	 * This avoids threads hitting the queue spinlock when the queue 
-	 * is empty. This will really help when the only entry is being
-	 * freed, since the queue is updated before the expensive call to
-	 * dcb_final_free.
 	 */
 	if (!zombies)
 		return NULL;
 
+	if (__sync_lock_test_and_set(&zombie_reclaiming, 1))
+		return zombies;
+
+	/**
+	 * The zombies older than the oldest epoch seen by a running
+	 * polling thread can be freed.
+	 */
+	safe = zombie_epoch;
+	for (i = 0; i < n_thread_epochs; i++)
+	{
+		unsigned long epoch = thread_epochs[i];
+
+		if (epoch != 0 && epoch < safe)
+			safe = epoch;
+	}
+
+	/** Nothing has become free since the previous reclamation */
+	if (safe == zombie_safe && !zombie_retry)
+	{
+		__sync_lock_release(&zombie_reclaiming);
+		return zombies;
+	}
+	zombie_safe = safe;
+	zombie_retry = 0;
+
 	/*
-	 * Process the zombie queue and create a list of DCB's that can be
-	 * finally freed. This processing is down under a spinlock that
-	 * will prevent new entries being added to the zombie queue. Therefore
-	 * we do not want to do any expensive operations under this spinlock
-	 * as it will block other threads. The expensive operations will be
-	 * performed on the victim queue within holding the zombie queue
-	 * spinlock.
+	 * Take the whole zombie list and put the DCBs that can't be freed yet
+	 * back to it. DCB's that are in the event queue waiting to be
+	 * processed are kept until the next reclamation.
 	 */
-	spinlock_acquire(&zombiespin);
-	ptr = zombies;
-	lptr = NULL;
+	ptr = __sync_lock_test_and_set(&zombies, NULL);
 	while (ptr)
 	{
 		CHK_DCB(ptr);
+		next = ptr->memdata.next;
+		ptr->memdata.next = NULL;
 
-		/*
-		 * Skip processing of DCB's that are
-		 * in the event queue waiting to be processed.
-		 */
-		if (ptr->evq.next || ptr->evq.prev)
+		if (ptr->memdata.epoch >= safe || ptr->evq.next || ptr->evq.prev)
 		{
-			lptr = ptr;
-			ptr = ptr->memdata.next;
+			if (ptr->memdata.epoch < safe)
+				zombie_retry = 1;
+			if (keep == NULL)
+				keep = ptr;
+			else
+				keep_tail->memdata.next = ptr;
+			keep_tail = ptr;
 		}
 		else
 		{
-
-			bitmask_clear(&ptr->memdata.bitmask, threadid);
-			
-			if (bitmask_isallclear(&ptr->memdata.bitmask))
-			{
-				/**
-				 * Remove the DCB from the zombie queue
-				 * and call the final free routine for the
-				 * DCB
-				 *
-				 * ptr is the DCB we are processing
-				 * lptr is the previous DCB on the zombie queue
-				 * or NULL if the DCB is at the head of the
-				 * queue tptr is the DCB after the one we are
-				 * processing on the zombie queue
-				 */
-				DCB	*tptr = ptr->memdata.next;
-				if (lptr == NULL)
-					zombies = tptr;
-				else
-					lptr->memdata.next = tptr;
-				
-				LOGIF(LD, (skygw_log_write_flush(
-					LOGFILE_DEBUG,
-					"%lu [dcb_process_zombies] Remove dcb "
-					"%p fd %d " "in state %s from the "
-					"list of zombies.",
-					pthread_self(),
-					ptr,
-					ptr->fd,
-					STRDCBSTATE(ptr->state)))); 
-				ss_info_dassert(ptr->state == DCB_STATE_ZOMBIE,
-						"dcb not in DCB_STATE_ZOMBIE state.");
-				/*<
-				 * Move dcb to linked list of victim dcbs.
-				 */
-				if (dcb_list == NULL) {
-					dcb_list = ptr;
-					dcb = dcb_list;
-				} else {
-					dcb->memdata.next = ptr;
-					dcb = dcb->memdata.next;
-				}
-				dcb->memdata.next = NULL;
-				ptr = tptr;
-			}
-			else
-			{
-				lptr = ptr;
-				ptr = ptr->memdata.next;
+			LOGIF(LD, (skygw_log_write_flush(
+				LOGFILE_DEBUG,
+				"%lu [dcb_process_zombies] Remove dcb "
+				"%p fd %d " "in state %s from the "
+				"list of zombies.",
+				pthread_self(),
+				ptr,
+				ptr->fd,
+				STRDCBSTATE(ptr->state)))); 
+			ss_info_dassert(ptr->state == DCB_STATE_ZOMBIE,
+					"dcb not in DCB_STATE_ZOMBIE state.");
+			age = hkheartbeat - ptr->memdata.added;
+			zombiestats.total_age += age;
+			if (age > zombiestats.max_age)
+				zombiestats.max_age = age;
+			nfreed++;
+			/*<
+			 * Move dcb to linked list of victim dcbs.
+			 */
+			if (dcb_list == NULL) {
+				dcb_list = ptr;
+				dcb = dcb_list;
+			} else {
+				dcb->memdata.next = ptr;
+				dcb = dcb->memdata.next;
 			}
 		}
+		ptr = next;
 	}
-	spinlock_release(&zombiespin);
+	if (keep != NULL)
+		dcb_push_zombies(keep, keep_tail);
+
+	if (nfreed > 0)
+	{
+		atomic_add(&zombiestats.n_zombies, -nfreed);
+		zombiestats.n_freed += nfreed;
+		zombiestats.n_batches++;
+		if (nfreed > zombiestats.max_batch)
+			zombiestats.max_batch = nfreed;
+	}
+	__sync_lock_release(&zombie_reclaiming);
 
 	/*
 	 * Process the victim queue. These are DCBs that are not in
@@ -560,9 +662,19 @@ bool    succp = false;
 	 */
         dcb = dcb_list;
         while (dcb != NULL) {
-		DCB* dcb_next = NULL;
+		DCB* dcb_next = dcb->memdata.next;
                 int  rc = 0;
 
+		/*<
+		 * A backend DCB that was closed cleanly is put to the
+		 * persistent pool of its server instead of being freed.
+		 */
+		if ((dcb->flags & DCBF_PERSISTENT) && dcb_persistent_add(dcb))
+		{
+			dcb = dcb_next;
+			continue;
+		}
+
 		if (dcb->fd > 0)
 		{
 			/*<
@@ -606,7 +718,6 @@ bool    succp = false;
 
                 succp = dcb_set_state(dcb, DCB_STATE_DISCONNECTED, NULL);
                 ss_dassert(succp);
-		dcb_next = dcb->memdata.next;
                 dcb_final_free(dcb);
                 dcb = dcb_next;
         }
@@ -616,6 +727,300 @@ bool    succp = false;
         return zombies;
 }
 
+/**
+ * Get a snapshot of the zombie reclamation statistics
+ *
+ * @param stats	The statistics are copied here
+ */
+void
+dcb_zombie_stats(ZOMBIESTATS *stats)
+{
+	*stats = zombiestats;
+}
+
+/**
+ * Diagnostic to print the zombie reclamation statistics
+ *
+ * @param pdcb	The DCB to print to
+ */
+void
+dprintZombieStats(DCB *pdcb)
+{
+ZOMBIESTATS	stats;
+
+	dcb_zombie_stats(&stats);
+	dcb_printf(pdcb, "\nZombie DCB Statistics.\n\n");
+	dcb_printf(pdcb, "Current zombie epoch:			%lu\n",
+							zombie_epoch);
+	dcb_printf(pdcb, "Current no. of zombie DCBs:		%d\n",
+							stats.n_zombies);
+	dcb_printf(pdcb, "No. of DCBs added to zombies:		%d\n",
+							stats.n_added);
+	dcb_printf(pdcb, "No. of zombie DCBs freed:		%d\n",
+							stats.n_freed);
+	dcb_printf(pdcb, "No. of batches of zombies freed:	%d\n",
+							stats.n_batches);
+	dcb_printf(pdcb, "Largest batch of zombies freed:		%d\n",
+							stats.max_batch);
+	dcb_printf(pdcb, "Average age of freed zombies:		%.1f seconds\n",
+		stats.n_freed ? (double)stats.total_age / stats.n_freed / 10 : 0.0);
+	dcb_printf(pdcb, "Maximum age of freed zombies:		%.1f seconds\n",
+							(double)stats.max_age / 10);
+}
+
+/**
+ * Mark a backend DCB that is being closed to be kept in the persistent
+ * connection pool of its server. This is called by the protocol module
+ * when the connection is in a state where it can be reused by another
+ * session. The DCB is put to the pool when it is removed from the zombie
+ * list, if the pool is not full by then.
+ *
+ * @param dcb	The backend DCB
+ * @return	True if the DCB will be kept
+ */
+bool
+dcb_persistent_keep(DCB *dcb)
+{
+	CHK_DCB(dcb);
+
+	if (dcb->server && dcb->server->persistpoolmax && dcb->user
+		&& dcb->dcb_role == DCB_ROLE_REQUEST_HANDLER
+		&& !dcb->dcb_errhandle_called && !(dcb->flags & DCBF_HUNG)
+		&& dcb->writeq == NULL && dcb->delayq == NULL
+		&& dcb->dcb_readqueue == NULL)
+	{
+		dcb->flags |= DCBF_PERSISTENT;
+		return true;
+	}
+	dcb->flags &= ~DCBF_PERSISTENT;
+	return false;
+}
+
+/**
+ * Check that a persistent connection is still open and that the server
+ * has not sent anything on it.
+ *
+ * @param dcb	The DCB to check
+ * @return	True if the connection can be reused
+ */
+static bool
+dcb_persistent_healthy(DCB *dcb)
+{
+char	c;
+int	n;
+
+	if (dcb->fd <= 0 || dcb->dcb_errhandle_called || (dcb->flags & DCBF_HUNG))
+	{
+		return false;
+	}
+	n = recv(dcb->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+	return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+/**
+ * Add a DCB taken from the zombie list to the persistent pool of its
+ * server. The DCB is unlinked from its session and the callbacks the
+ * router registered are removed.
+ *
+ * @param dcb	The DCB to add
+ * @return	True if the DCB was added, false if it is to be freed
+ */
+static bool
+dcb_persistent_add(DCB *dcb)
+{
+SERVER		*server = dcb->server;
+SESSION		*local_session;
+DCB_CALLBACK	*cb;
+
+	dcb->flags &= ~DCBF_PERSISTENT;
+
+	if (server == NULL || SERVER_IS_DOWN(server) || SERVER_IN_MAINT(server)
+		|| !dcb_persistent_healthy(dcb)
+		|| dcb_persistent_clean_count(server, false) >= server->persistpoolmax)
+	{
+		return false;
+	}
+
+	if ((local_session = dcb->session) != NULL)
+	{
+		CHK_SESSION(local_session);
+		dcb->session = NULL;
+		session_free(local_session);
+	}
+
+	spinlock_acquire(&dcb->cb_lock);
+	while ((cb = dcb->callbacks) != NULL)
+	{
+		dcb->callbacks = cb->next;
+		free(cb);
+	}
+	spinlock_release(&dcb->cb_lock);
+
+	if (!dcb_set_state(dcb, DCB_STATE_PERSISTENT, NULL))
+	{
+		/** The DCB is closed as any other zombie */
+		return false;
+	}
+
+	/** The owning thread is chosen again when the DCB is reused */
+	dcb->evq.owner = -1;
+	dcb->memdata.next = NULL;
+	dcb->persistentstart = time(NULL);
+
+	spinlock_acquire(&server->persistlock);
+	dcb->nextpersistent = server->persistent;
+	server->persistent = dcb;
+	spinlock_release(&server->persistlock);
+	atomic_add(&server->stats.n_persistent, 1);
+
+	LOGIF(LD, (skygw_log_write(
+		LOGFILE_DEBUG,
+		"%lu [dcb_persistent_add] Added dcb %p fd %d to the persistent "
+		"pool of server %s:%d.",
+		pthread_self(),
+		dcb,
+		dcb->fd,
+		server->name,
+		server->port)));
+	return true;
+}
+
+/**
+ * Close a DCB that has been removed from the persistent pool. The
+ * protocol close routine is called without a session.
+ *
+ * @param dcb	The DCB to close
+ */
+static void
+dcb_persistent_dispose(DCB *dcb)
+{
+	dcb->nextpersistent = NULL;
+	dcb->flags &= ~DCBF_PERSISTENT;
+	dcb_set_state(dcb, DCB_STATE_NOPOLLING, NULL);
+
+	if (dcb->func.close != NULL)
+	{
+		dcb->func.close(dcb);
+	}
+	dcb_add_to_zombieslist(dcb);
+}
+
+/**
+ * Remove the connections that have expired or that can no longer be used
+ * from the persistent pool of a server.
+ *
+ * @param server	The server
+ * @param cleanall	Remove all the connections
+ * @return		The number of connections left in the pool
+ */
+int
+dcb_persistent_clean_count(SERVER *server, bool cleanall)
+{
+DCB	*dcb, *previous = NULL, *next;
+DCB	*disposals = NULL;
+time_t	now = time(NULL);
+int	count = 0;
+
+	if (server == NULL)
+	{
+		return 0;
+	}
+
+	spinlock_acquire(&server->persistlock);
+	dcb = server->persistent;
+	while (dcb)
+	{
+		next = dcb->nextpersistent;
+
+		if (cleanall || SERVER_IS_DOWN(server) || SERVER_IN_MAINT(server)
+			|| (server->persistmaxtime &&
+			now - dcb->persistentstart > server->persistmaxtime))
+		{
+			if (previous)
+				previous->nextpersistent = next;
+			else
+				server->persistent = next;
+			dcb->nextpersistent = disposals;
+			disposals = dcb;
+			atomic_add(&server->stats.n_persistent, -1);
+		}
+		else
+		{
+			previous = dcb;
+			count++;
+		}
+		dcb = next;
+	}
+	spinlock_release(&server->persistlock);
+
+	while (disposals)
+	{
+		next = disposals->nextpersistent;
+		dcb_persistent_dispose(disposals);
+		disposals = next;
+	}
+	return count;
+}
+
+/**
+ * Take a connection of a user from the persistent pool of a server.
+ * Connections that have been closed by the server are removed from the
+ * pool on the way.
+ *
+ * @param server	The server
+ * @param user		The user the connection was authenticated as
+ * @return		The DCB or NULL if there was no connection to reuse
+ */
+static DCB *
+dcb_persistent_get(SERVER *server, const char *user)
+{
+DCB	*dcb, *previous = NULL, *next;
+DCB	*disposals = NULL;
+
+	if (dcb_persistent_clean_count(server, false) == 0)
+	{
+		return NULL;
+	}
+
+	spinlock_acquire(&server->persistlock);
+	dcb = server->persistent;
+	while (dcb)
+	{
+		next = dcb->nextpersistent;
+
+		if (dcb->user && strcmp(dcb->user, user) == 0)
+		{
+			if (previous)
+				previous->nextpersistent = next;
+			else
+				server->persistent = next;
+			dcb->nextpersistent = NULL;
+			atomic_add(&server->stats.n_persistent, -1);
+
+			if (dcb_persistent_healthy(dcb))
+			{
+				break;
+			}
+			dcb->nextpersistent = disposals;
+			disposals = dcb;
+		}
+		else
+		{
+			previous = dcb;
+		}
+		dcb = next;
+	}
+	spinlock_release(&server->persistlock);
+
+	while (disposals)
+	{
+		next = disposals->nextpersistent;
+		dcb_persistent_dispose(disposals);
+		disposals = next;
+	}
+	return dcb;
+}
+
 /**
  * Connect to a server
  * 
@@ -623,6 +1028,10 @@ bool    succp = false;
  * If succesful the new dcb will be put in
  * epoll set by dcb->func.connect
  *
+ * If the server has a persistent connection pool, a connection of the
+ * same user is taken from the pool when there is one. The protocol
+ * connect routine resets it for the new session.
+ *
  * @param server	The server to connect to
  * @param session	The session this connection is being made for
  * @param protocol	The protocol module to use
@@ -635,11 +1044,63 @@ DCB		*dcb;
 GWPROTOCOL	*funcs;
 int             fd;
 int             rc;
+char		*user = NULL;
+
+	if (server->persistpoolmax && session->client)
+	{
+		user = session->client->user;
+	}
+
+	if (user && (dcb = dcb_persistent_get(server, user)) != NULL)
+	{
+		atomic_add(&server->stats.n_pool_hits, 1);
+		dcb->flags = 0;
+		dcb->dcb_errhandle_called = false;
+		dcb->dcb_server_status = server->status;
+
+		if (!session_link_dcb(session, dcb))
+		{
+			LOGIF(LD, (skygw_log_write(
+				LOGFILE_DEBUG,
+				"%lu [dcb_connect] Failed to link to session, the "
+				"session has been removed.",
+				pthread_self())));
+			dcb_persistent_dispose(dcb);
+			return NULL;
+		}
+
+		if (poll_add_dcb(dcb) == 0 &&
+			dcb->func.connect(dcb, server, session) != DCBFD_CLOSED)
+		{
+			LOGIF(LD, (skygw_log_write_flush(
+				LOGFILE_DEBUG,
+				"%lu [dcb_connect] Reusing persistent connection "
+				"%p fd %d to server %s:%d.",
+				pthread_self(),
+				dcb,
+				dcb->fd,
+				server->name,
+				server->port)));
+			atomic_add(&server->stats.n_current, 1);
+			return dcb;
+		}
+		/** Close the connection and make a new one */
+		dcb_close(dcb);
+	}
+	else if (user)
+	{
+		atomic_add(&server->stats.n_pool_misses, 1);
+	}
 
 	if ((dcb = dcb_alloc(DCB_ROLE_REQUEST_HANDLER)) == NULL)
 	{
 		return NULL;
 	}
+
+	if (user)
+	{
+		dcb->user = strdup(user);
+	}
         
 	if ((funcs = (GWPROTOCOL *)load_module(protocol,
                                                MODULE_PROTOCOL)) == NULL)
@@ -738,24 +1199,153 @@ int             rc;
 	return dcb;
 }
 
-
+
+/**
+ * Return the size of the next read buffer of a DCB. The size is rounded up
+ * to fill the pooled block the buffer is allocated from.
+ *
+ * @param dcb	The DCB to read from
+ * @return	The number of bytes to read
+ */
+static int
+dcb_read_size(DCB *dcb)
+{
+	if (dcb->read_size < DCB_MIN_READ_SIZE)
+	{
+		dcb->read_size = DCB_MIN_READ_SIZE;
+	}
+	return MIN(gwbuf_pool_fit(dcb->read_size), MAX_BUFFER_SIZE);
+}
+
+/**
+ * Adapt the read size of a DCB to the amount of data that arrived. A read
+ * that fills its buffer doubles the size of the next one. When all the
+ * data read in one call used less than a quarter of the first buffer, the
+ * size is halved.
+ *
+ * @param dcb		The DCB that was read from
+ * @param n		Number of bytes read
+ * @param bufsize	Size of the read buffer
+ * @param grow		Only grow the read size, used for the individual
+ *			reads within a call
+ */
+static void
+dcb_adapt_read_size(DCB *dcb, int n, int bufsize, bool grow)
+{
+	if (grow)
+	{
+		if (n == bufsize && dcb->read_size < MAX_BUFFER_SIZE)
+		{
+			dcb->read_size = MIN(dcb->read_size * 2, MAX_BUFFER_SIZE);
+		}
+	}
+	else if (n < bufsize / 4 && dcb->read_size > DCB_MIN_READ_SIZE)
+	{
+		dcb->read_size /= 2;
+	}
+}
+
+/**
+ * Read from the socket of a DCB into a new buffer. The buffer is trimmed
+ * to the number of bytes read.
+ *
+ * @param dcb		The DCB to read from
+ * @param bufsize	Maximum number of bytes to read
+ * @param buffer	Set to the buffer holding the data, NULL if nothing
+ *			was read
+ * @return	Number of bytes read, 0 if no data was available or the
+ *		peer has closed the connection and -1 on error
+ */
+static int
+dcb_read_buffer(DCB *dcb, int bufsize, GWBUF **buffer)
+{
+	int	n;
+
+	*buffer = NULL;
+
+	if ((*buffer = gwbuf_alloc(bufsize)) == NULL)
+	{
+		/*<
+		 * This is a fatal error which should cause shutdown.
+		 * Todo shutdown if memory allocation fails.
+		 */
+		LOGIF(LE, (skygw_log_write_flush(
+			LOGFILE_ERROR,
+			"Error : Failed to allocate read buffer "
+			"for dcb %p fd %d, due %d, %s.",
+			dcb,
+			dcb->fd,
+			errno,
+			strerror(errno))));
+		return -1;
+	}
+	GW_NOINTR_CALL(n = read(dcb->fd, GWBUF_DATA(*buffer), bufsize);
+		dcb->stats.n_reads++);
+
+	if (n <= 0)
+	{
+		gwbuf_free(*buffer);
+		*buffer = NULL;
+
+		if (n == 0 || errno == EAGAIN || errno == EWOULDBLOCK)
+		{
+			return 0;
+		}
+		/** A client resetting the connection is not worth an error */
+		if (!(dcb_isclient(dcb) && errno == ECONNRESET))
+		{
+			LOGIF(LE, (skygw_log_write_flush(
+				LOGFILE_ERROR,
+				"Error : Read failed, dcb %p in state "
+				"%s fd %d, due %d, %s.",
+				dcb,
+				STRDCBSTATE(dcb->state),
+				dcb->fd,
+				errno,
+				strerror(errno))));
+		}
+		return -1;
+	}
+	dcb->last_read = hkheartbeat;
+
+	if (n < bufsize)
+	{
+		*buffer = gwbuf_rtrim(*buffer, bufsize - n);
+	}
+	LOGIF(LD, (skygw_log_write(
+		LOGFILE_DEBUG,
+		"%lu [dcb_read] Read %d bytes from dcb %p in state %s "
+		"fd %d.",
+		pthread_self(),
+		n,
+		dcb,
+		STRDCBSTATE(dcb->state),
+		dcb->fd)));
+	return n;
+}
+
 /**
  * General purpose read routine to read data from a socket in the
  * Descriptor Control Block and append it to a linked list of buffers.
  * The list may be empty, in which case *head == NULL
  *
+ * Data is read directly into buffers sized by the recent reads of the
+ * DCB, without asking the kernel how much is available first. A read
+ * that does not fill its buffer has emptied the socket and ends the
+ * loop, otherwise reading continues until the socket would block.
+ *
  * @param dcb	The DCB to read from
  * @param head	Pointer to linked list to append data to
- * @return	-1 on error, otherwise the number of read bytes on the last 
- * iteration of while loop. 0 is returned if no data available.
+ * @return	-1 on error, otherwise the number of bytes read.
+ * 0 is returned if no data available.
  */
 int dcb_read(
         DCB   *dcb, 
         GWBUF **head)
 {
-        GWBUF *buffer = NULL;
-        int   b;
-        int   rc;
+        GWBUF *buffer;
+        int   bufsize;
+        int   first;
         int   n;
         int   nread = 0;
         
@@ -767,146 +1357,62 @@ int dcb_read(
 			LOGFILE_ERROR,
 			"Error : Read failed, dcb is %s.",
 			dcb->fd == DCBFD_CLOSED ? "closed" : "cloned, not readable")));
-		n = 0;
-		goto return_n;
+		return 0;
 	}
 
+        first = bufsize = dcb_read_size(dcb);
+
 	while (true)
         {
-                int bufsize;
-                
-                rc = ioctl(dcb->fd, FIONREAD, &b);
-                
-                if (rc == -1) 
-                {
-                        LOGIF(LE, (skygw_log_write_flush(
-                                LOGFILE_ERROR,
-                                "Error : ioctl FIONREAD for dcb %p in "
-                                "state %s fd %d failed due error %d, %s.",
-                                dcb,
-                                STRDCBSTATE(dcb->state),
-                                dcb->fd,
-                                errno,
-                                strerror(errno))));
-                        n = -1;
-                        goto return_n;
-                }
-
-                if (b == 0 && nread == 0)
-                {                        
-                        /** Handle closed client socket */
-                        if (dcb_isclient(dcb)) 
-                        {
-                                char c;
-                                int l_errno = 0;
-                                int r = -1;
-                                
-                                /* try to read 1 byte, without consuming the socket buffer */
-                                r = recv(dcb->fd, &c, sizeof(char), MSG_PEEK);
-                                l_errno = errno;
-                                
-                                if (r <= 0 && 
-                                        l_errno != EAGAIN && 
-                                        l_errno != EWOULDBLOCK &&
-					l_errno != 0) 
-                                {
-                                        n = -1;
-                                        goto return_n;
-                                }
-                        }
-                        n = 0;
-                        goto return_n;
-                }
-                else if (b == 0)
+                if ((n = dcb_read_buffer(dcb, bufsize, &buffer)) < 0)
                 {
-                        n = 0;
-                        goto return_n;
+                        return -1;
                 }
-
-		dcb->last_read = hkheartbeat;
-
-                bufsize = MIN(b, MAX_BUFFER_SIZE);
-                
-                if ((buffer = gwbuf_alloc(bufsize)) == NULL)
+                else if (n == 0)
                 {
-                        /*<
-                        * This is a fatal error which should cause shutdown.
-                        * Todo shutdown if memory allocation fails.
-                        */
-                        LOGIF(LE, (skygw_log_write_flush(
-                                LOGFILE_ERROR,
-                                "Error : Failed to allocate read buffer "
-                                "for dcb %p fd %d, due %d, %s.",
-                                dcb,
-                                dcb->fd, 
-                                errno,
-                                strerror(errno))));
-                        
-                        n = -1;
-                        goto return_n;
-                }
-                GW_NOINTR_CALL(n = read(dcb->fd, GWBUF_DATA(buffer), bufsize);
-                dcb->stats.n_reads++);
-                
-                if (n <= 0)
-                {                        
-                        if (errno != 0 && errno != EAGAIN && errno != EWOULDBLOCK) 
-                        {
-                                LOGIF(LE, (skygw_log_write_flush(
-                                        LOGFILE_ERROR,
-                                        "Error : Read failed, dcb %p in state "
-                                        "%s fd %d, due %d, %s.",
-                                        dcb,
-                                        STRDCBSTATE(dcb->state),
-                                        dcb->fd, 
-                                        errno,
-                                        strerror(errno))));
-                        }
-			gwbuf_free(buffer);
-                        goto return_n;
+                        break;
                 }
                 nread += n;
-                
-                LOGIF(LD, (skygw_log_write(
-                        LOGFILE_DEBUG,
-                        "%lu [dcb_read] Read %d bytes from dcb %p in state %s "
-                        "fd %d.", 
-                        pthread_self(),
-                        n,
-                        dcb,
-                        STRDCBSTATE(dcb->state),
-                        dcb->fd)));
                 /*< Append read data to the gwbuf */
                 *head = gwbuf_append(*head, buffer);
+
+                if (n < bufsize)
+                {
+                        /*< The socket has been emptied */
+                        break;
+                }
+                dcb_adapt_read_size(dcb, n, bufsize, true);
+                bufsize = dcb_read_size(dcb);
         } /*< while (true) */
-return_n:
-        return n;
+
+        if (nread > 0)
+        {
+                dcb_adapt_read_size(dcb, nread, first, false);
+        }
+        return nread;
 }
 
 
 /**
  * General purpose read routine to read data from a socket in the
  * Descriptor Control Block and append it to a linked list of buffers.
- * This function will read at most nbytes of data.
+ * This function will read at most nbytes of data with a single read.
  * 
- * The list may be empty, in which case *head == NULL. This
+ * The list may be empty, in which case *head == NULL.
  *
  * @param dcb	The DCB to read from
  * @param head	Pointer to linked list to append data to
  * @param nbytes Maximum number of bytes read
- * @return	-1 on error, otherwise the number of read bytes on the last
- * iteration of while loop. 0 is returned if no data available.
+ * @return	-1 on error, otherwise the number of bytes read.
+ * 0 is returned if no data available.
  */
 int dcb_read_n(
         DCB   *dcb,
         GWBUF **head,
         int nbytes)
 {
-        GWBUF *buffer = NULL;
-        int   b;
-        int   rc;
+        GWBUF *buffer;
         int   n;
-        int   nread = 0;
 
         CHK_DCB(dcb);
 
@@ -916,112 +1422,14 @@ int dcb_read_n(
 			LOGFILE_ERROR,
 			"Error : Read failed, dcb is %s.",
 			dcb->fd == DCBFD_CLOSED ? "closed" : "cloned, not readable")));
-		n = 0;
-		goto return_n;
+		return 0;
 	}
 
-                int bufsize;
-
-                rc = ioctl(dcb->fd, FIONREAD, &b);
-
-                if (rc == -1)
-                {
-                        LOGIF(LE, (skygw_log_write_flush(
-                                LOGFILE_ERROR,
-                                "Error : ioctl FIONREAD for dcb %p in "
-                                "state %s fd %d failed due error %d, %s.",
-                                dcb,
-                                STRDCBSTATE(dcb->state),
-                                dcb->fd,
-                                errno,
-                                strerror(errno))));
-                        n = -1;
-                        goto return_n;
-                }
-
-                if (b == 0)
-                {
-                        /** Handle closed client socket */
-                        if (nread == 0 && dcb_isclient(dcb))
-                        {
-                                char c;
-                                int l_errno = 0;
-                                int r = -1;
-
-                                /* try to read 1 byte, without consuming the socket buffer */
-                                r = recv(dcb->fd, &c, sizeof(char), MSG_PEEK);
-                                l_errno = errno;
-
-                                if (r <= 0 &&
-                                        l_errno != EAGAIN &&
-                                        l_errno != EWOULDBLOCK &&
-					l_errno != 0)
-                                {
-                                        n = -1;
-                                        goto return_n;
-                                }
-                        }
-                        n = 0;
-                        goto return_n;
-                }
-
-		dcb->last_read = hkheartbeat;
-
-                bufsize = MIN(b, nbytes);
-
-                if ((buffer = gwbuf_alloc(bufsize)) == NULL)
-                {
-                        /*<
-                        * This is a fatal error which should cause shutdown.
-                        * Todo shutdown if memory allocation fails.
-                        */
-                        LOGIF(LE, (skygw_log_write_flush(
-                                LOGFILE_ERROR,
-                                "Error : Failed to allocate read buffer "
-                                "for dcb %p fd %d, due %d, %s.",
-                                dcb,
-                                dcb->fd,
-                                errno,
-                                strerror(errno))));
-
-                        n = -1;
-                        goto return_n;
-                }
-                GW_NOINTR_CALL(n = read(dcb->fd, GWBUF_DATA(buffer), bufsize);
-                dcb->stats.n_reads++);
-
-                if (n <= 0)
-                {
-                        if (errno != 0 && errno != EAGAIN && errno != EWOULDBLOCK)
-                        {
-                                LOGIF(LE, (skygw_log_write_flush(
-                                        LOGFILE_ERROR,
-                                        "Error : Read failed, dcb %p in state "
-                                        "%s fd %d, due %d, %s.",
-                                        dcb,
-                                        STRDCBSTATE(dcb->state),
-                                        dcb->fd,
-                                        errno,
-                                        strerror(errno))));
-                        }
-			gwbuf_free(buffer);
-                        goto return_n;
-                }
-                nread += n;
-
-                LOGIF(LD, (skygw_log_write(
-                        LOGFILE_DEBUG,
-                        "%lu [dcb_read] Read %d bytes from dcb %p in state %s "
-                        "fd %d.",
-                        pthread_self(),
-                        n,
-                        dcb,
-                        STRDCBSTATE(dcb->state),
-                        dcb->fd)));
+        if ((n = dcb_read_buffer(dcb, nbytes, &buffer)) > 0)
+        {
                 /*< Append read data to the gwbuf */
                 *head = gwbuf_append(*head, buffer);
-
-return_n:
+        }
         return n;
 }
 
@@ -1032,6 +1440,10 @@ return_n:
  * The list may be empty, in which case *head == NULL. The SSL structure should
  * be initialized and the SSL handshake should be done.
  *
+ * SSL_read returns at most one record at a time, so a short read does not
+ * mean the socket is empty. Reading continues until SSL reports that it
+ * needs more data from the socket.
+ *
  * @param dcb	The DCB to read from
  * @param head	Pointer to linked list to append data to
  * @return	-1 on error, otherwise the number of read bytes on the last
@@ -1042,10 +1454,9 @@ int dcb_read_SSL(
         GWBUF **head)
 {
         GWBUF *buffer = NULL;
-        int   b,pending;
-        int   rc;
         int   n;
         int   nread = 0;
+        int   first;
 	int ssl_errno = 0;
         CHK_DCB(dcb);
 
@@ -1058,69 +1469,14 @@ int dcb_read_SSL(
 		n = 0;
 		goto return_n;
 	}
+        first = dcb_read_size(dcb);
 
 	while (true)
         {
                 int bufsize;
 		ssl_errno = 0;
-                rc = ioctl(dcb->fd, FIONREAD, &b);
-		pending = SSL_pending(dcb->ssl);
-                if (rc == -1)
-                {
-                        LOGIF(LE, (skygw_log_write_flush(
-                                LOGFILE_ERROR,
-                                "Error : ioctl FIONREAD for dcb %p in "
-                                "state %s fd %d failed due error %d, %s.",
-                                dcb,
-                                STRDCBSTATE(dcb->state),
-                                dcb->fd,
-                                errno,
-                                strerror(errno))));
-                        n = -1;
-                        goto return_n;
-                }
-
-                if (b == 0 && pending == 0 && nread == 0)
-                {
-                        /** Handle closed client socket */
-                        if (dcb_isclient(dcb))
-                        {
-                                char c = 0;
-                                int r = -1;
-
-                                /* try to read 1 byte, without consuming the socket buffer */
-                                r = SSL_peek(dcb->ssl, &c, sizeof(char));
-                                if (r <= 0)
-                                {
-				    ssl_errno = SSL_get_error(dcb->ssl,r);
-				    if(ssl_errno != SSL_ERROR_WANT_READ &&
-				     ssl_errno != SSL_ERROR_WANT_WRITE &&
-				     ssl_errno != SSL_ERROR_NONE)
-                                        n = -1;
-				    else
-					n = 0;
-				    goto return_n;
-                                }
-                        }
-                        n = 0;
-                        goto return_n;
-                }
-                else if (b == 0 && pending == 0)
-                {
-                        n = 0;
-                        goto return_n;
-                }
-#ifdef SS_DEBUG
-		else
-		{
-		    skygw_log_write_flush(LD,"Total: %d Socket: %d Pending: %d",
-				     nread,b,pending);
-		}
-#endif
-
-		dcb->last_read = hkheartbeat;
 
-                bufsize = MIN(b, MAX_BUFFER_SIZE);
+                bufsize = dcb_read_size(dcb);
 
                 if ((buffer = gwbuf_alloc(bufsize)) == NULL)
                 {
@@ -1191,8 +1547,8 @@ int dcb_read_SSL(
 					     errbuf);
 				}
 			    }
+			    n = -1;
 			}
-			n = -1;
 			gwbuf_free(buffer);
 			goto return_n;
 		    }
@@ -1202,19 +1558,17 @@ int dcb_read_SSL(
 			goto return_n;
 		    }
 
-		    gwbuf_rtrim(buffer,bufsize - n);
-		    if(buffer == NULL)
+		dcb->last_read = hkheartbeat;
+		dcb_adapt_read_size(dcb, n, bufsize, true);
+
+		    if (n < bufsize)
 		    {
-			goto return_n;
+			buffer = gwbuf_rtrim(buffer,bufsize - n);
 		    }
 #ifdef SS_DEBUG
 		    skygw_log_write(LD,"%lu SSL: Truncated buffer from %d to %d bytes. "
-	            "Read %d bytes, %d bytes waiting.\n",pthread_self(),
-		     bufsize,GWBUF_LENGTH(buffer),n,b);
-		    
-		    if(GWBUF_LENGTH(buffer) != n){
-			skygw_log_sync_all();
-		    }
+	            "Read %d bytes, %d bytes pending.\n",pthread_self(),
+		     bufsize,GWBUF_LENGTH(buffer),n,SSL_pending(dcb->ssl));
 		    
 		    ss_info_dassert((buffer->start <= buffer->end),"Buffer start has passed end.");
 		    ss_info_dassert(GWBUF_LENGTH(buffer) == n,"Buffer size not equal to read bytes.");
@@ -1235,6 +1589,10 @@ int dcb_read_SSL(
                 *head = gwbuf_append(*head, buffer);
         } /*< while (true) */
 return_n:
+        if (nread > 0)
+        {
+                dcb_adapt_read_size(dcb, nread, first, false);
+        }
         return nread;
 }
 /**
@@ -1333,6 +1691,8 @@ int	below_water;
 		while (queue != NULL)
 		{
                         int qlen;
+                        int niov;
+                        struct iovec iov[DCB_MAX_IOV];
 #if defined(FAKE_CODE)
                         if (dcb->dcb_role == DCB_ROLE_REQUEST_HANDLER &&
                             dcb->session != NULL)
@@ -1350,9 +1710,9 @@ int	below_water;
                                 }
                         }
 #endif /* FAKE_CODE */
-			qlen = GWBUF_LENGTH(queue);
+			niov = dcb_fill_iovec(queue, iov, &qlen);
 			GW_NOINTR_CALL(
-                                w = gw_write(dcb, GWBUF_DATA(queue), qlen);
+                                w = gw_writev(dcb, iov, niov);
                                 dcb->stats.n_writes++;
                                 );
 
@@ -1401,9 +1761,9 @@ int	below_water;
 			}
 			/*
 			 * Pull the number of bytes we have written from
-			 * queue with have.
+			 * the buffers in the queue.
 			 */
-			queue = gwbuf_consume(queue, w);
+			queue = dcb_consume_written(queue, w);
                         LOGIF(LD, (skygw_log_write(
                                 LOGFILE_DEBUG,
                                 "%lu [dcb_write] Wrote %d Bytes to dcb %p in "
@@ -1750,16 +2110,22 @@ int	above_water;
 
         if (dcb->writeq)
 	{
-		int	len;
+		struct iovec	iov[DCB_MAX_IOV];
+		int		niov;
+		int		len;
 		/*
 		 * Loop over the buffer chain in the pending writeq
 		 * Send as much of the data in that chain as possible and
-		 * leave any balance on the write queue.
+		 * leave any balance on the write queue. Up to DCB_MAX_IOV
+		 * buffers are written with each system call.
 		 */
 		while (dcb->writeq != NULL)
 		{
-			len = GWBUF_LENGTH(dcb->writeq);
-			GW_NOINTR_CALL(w = gw_write(dcb, GWBUF_DATA(dcb->writeq), len););
+			niov = dcb_fill_iovec(dcb->writeq, iov, &len);
+			GW_NOINTR_CALL(
+				w = gw_writev(dcb, iov, niov);
+				dcb->stats.n_writes++;
+				);
 			saved_errno = errno;
                         errno = 0;
                         
@@ -1789,9 +2155,9 @@ int	above_water;
 			}
 			/*
 			 * Pull the number of bytes we have written from
-			 * queue with have.
+			 * the buffers in the queue.
 			 */
-			dcb->writeq = gwbuf_consume(dcb->writeq, w);
+			dcb->writeq = dcb_consume_written(dcb->writeq, w);
                         LOGIF(LD, (skygw_log_write(
                                 LOGFILE_DEBUG,
                                 "%lu [dcb_drain_writeq] Wrote %d Bytes to dcb %p "
@@ -2078,8 +2444,6 @@ DCB	*dcb;
 #if SPINLOCK_PROFILE
 	dcb_printf(pdcb, "DCB List Spinlock Statistics:\n");
 	spinlock_stats(&dcbspin, spin_reporter, pdcb);
-	dcb_printf(pdcb, "Zombie Queue Lock Statistics:\n");
-	spinlock_stats(&zombiespin, spin_reporter, pdcb);
 #endif
 	dcb = allDCBs;
 	while (dcb)
@@ -2261,6 +2625,8 @@ gw_dcb_state2string (int state) {
 			return "DCB memory could be freed";
 		case DCB_STATE_ZOMBIE:
 			return "DCB Zombie";
+		case DCB_STATE_PERSISTENT:
+			return "DCB in persistent pool";
 		default:
 			return "DCB (unknown)";
 	}
@@ -2320,25 +2686,22 @@ void dcb_hashtable_stats(
         DCB*  dcb,
         void* table)
 {
-        int total;
-        int longest;
-        int hashsize;
-
-        total = 0;
-	longest = 0;
+        HASHTABLE_STATS stats;
 
-        hashtable_get_stats(table, &hashsize, &total, &longest);
+        hashtable_get_stats(table, &stats);
 
         dcb_printf(dcb,
                    "Hashtable: %p, size %d\n",
                    table,
-                   hashsize);
+                   stats.hashsize);
         
-	dcb_printf(dcb, "\tNo. of entries:     	%d\n", total);
-	dcb_printf(dcb, 
-		"\tAverage chain length:	%.1f\n", 
-		(hashsize == 0 ? (float)hashsize : (float)total / hashsize));
-	dcb_printf(dcb, "\tLongest chain length:	%d\n", longest);
+	dcb_printf(dcb, "\tNo. of entries:     	%d\n", stats.nelems);
+	dcb_printf(dcb, "\tLoad factor:        	%.2f\n", stats.load_factor);
+	dcb_printf(dcb, "\tAverage chain length:	%.1f\n", stats.avg_chain);
+	dcb_printf(dcb, "\tLongest chain length:	%d\n", stats.longest);
+	dcb_printf(dcb, "\tNo. of resizes:     	%d%s\n",
+		stats.n_resizes,
+		stats.resizing ? " (in progress)" : "");
 }
 
 
@@ -2444,6 +2807,8 @@ static bool dcb_set_state_nomutex(
         case DCB_STATE_ZOMBIE:
                 switch (new_state) {
 			case DCB_STATE_DISCONNECTED: /*< fall through */
+			/** for connections kept in the persistent pool */
+			case DCB_STATE_PERSISTENT: /*< fall through */
 				dcb->state = new_state;
 			case DCB_STATE_POLLING: /*< ok to try but state can't change */
 				succp = true;
@@ -2454,6 +2819,21 @@ static bool dcb_set_state_nomutex(
                 }
                 break;
 
+        case DCB_STATE_PERSISTENT:
+                switch (new_state) {
+			/** reused by a new session */
+			case DCB_STATE_POLLING: /*< fall through */
+			/** removed from the pool to be closed */
+			case DCB_STATE_NOPOLLING:
+				dcb->state = new_state;
+				succp = true;
+				break;
+			default:
+				ss_dassert(old_state != NULL);
+				break;
+                }
+                break;
+
         case DCB_STATE_DISCONNECTED:
                 switch (new_state) {
 			case DCB_STATE_FREED:
@@ -2616,6 +2996,93 @@ gw_write(DCB *dcb, const void *buf, size_t nbytes)
         return w;
 }
 
+/**
+ * Write a vector of data to a DCB with a single system call
+ *
+ * The fault injection and packet tracing of gw_write only deal with a
+ * single buffer, when those are compiled in only the first element of
+ * the vector is written.
+ *
+ * @param dcb		The DCB to write to
+ * @param iov		The data to write
+ * @param niov		Number of elements in iov
+ * @return Number of written bytes
+ */
+int
+gw_writev(DCB *dcb, const struct iovec *iov, int niov)
+{
+        int w = 0;
+
+#if defined(FAKE_CODE) || defined(SS_DEBUG_MYSQL)
+	if (niov > 0)
+	{
+		w = gw_write(dcb, iov[0].iov_base, iov[0].iov_len);
+	}
+#else
+	int fd = dcb->fd;
+
+	if (fd > 0)
+	{
+		w = (niov == 1) ? write(fd, iov[0].iov_base, iov[0].iov_len)
+				: writev(fd, iov, niov);
+	}
+#endif
+        return w;
+}
+
+/**
+ * Fill an I/O vector with the buffers at the head of a queue
+ *
+ * @param queue		The buffer chain to write
+ * @param iov		The vector to fill, at least DCB_MAX_IOV elements
+ * @param nbytes	Set to the number of bytes described by the vector
+ * @return The number of elements used in the vector
+ */
+static int
+dcb_fill_iovec(GWBUF *queue, struct iovec *iov, int *nbytes)
+{
+int	n = 0;
+
+	*nbytes = 0;
+	while (queue && n < DCB_MAX_IOV)
+	{
+		iov[n].iov_base = GWBUF_DATA(queue);
+		iov[n].iov_len = GWBUF_LENGTH(queue);
+		*nbytes += iov[n].iov_len;
+		n++;
+		queue = queue->next;
+	}
+	return n;
+}
+
+/**
+ * Remove written data from the head of a buffer chain. A single write may
+ * span several buffers, each fully written buffer is freed. Empty buffers
+ * at the head of the chain are freed as well.
+ *
+ * @param queue		The buffer chain
+ * @param nbytes	The number of bytes written
+ * @return The remainder of the chain
+ */
+static GWBUF *
+dcb_consume_written(GWBUF *queue, int nbytes)
+{
+unsigned int	len;
+
+	while (queue && (nbytes > 0 || GWBUF_EMPTY(queue)))
+	{
+		len = GWBUF_LENGTH(queue);
+
+		if (len > (unsigned int)nbytes)
+		{
+			len = nbytes;
+		}
+		queue = gwbuf_consume(queue, len);
+		nbytes -= len;
+	}
+	return queue;
+}
+
 /**
  * Add a callback
  *
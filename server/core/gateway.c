@@ -169,6 +169,7 @@ static struct option long_options[] = {
   {"language",required_argument, 0, 'N'},
   {"syslog",   required_argument, 0, 's'},
   {"maxscalelog",required_argument,0,'S'},
+  {"binarylog",required_argument,0,'b'},
   {"user",required_argument,0,'U'},
   {"version",  no_argument,       0, 'v'},
   {"help",     no_argument,       0, '?'},
@@ -963,6 +964,8 @@ static void usage(void)
 		"                             The user ID and group ID of this user are used to run MaxScale.\n"
 		"  -s, --syslog=[yes|no]      log messages to syslog (default:yes)\n"
 		"  -S, --maxscalelog=[yes|no] log messages to MaxScale log (default: yes)\n"
+		"  -b, --binarylog=LOGS       write the listed logs in binary format, e.g.\n"
+		"                             LOGFILE_TRACE,LOGFILE_DEBUG (default: none)\n"
 		"  -v, --version              print version info and exit\n"
                 "  -?, --help                 show this help\n"
 		, progname);
@@ -1023,6 +1026,7 @@ int main(int argc, char **argv)
 	int	 logtofile = 0;	      	      /* Use shared memory or file */
 	int	 syslog_enabled = 0; /** Log to syslog */
 	int	 maxscalelog_enabled = 1; /** Log with MaxScale */
+	char*	 binarylog_ids = NULL; /** Logs written in binary format */
         ssize_t  log_flush_timeout_ms = 0;
         sigset_t sigset;
         sigset_t sigpipe_mask;
@@ -1065,7 +1069,7 @@ int main(int argc, char **argv)
                 }
         }
 
-        while ((opt = getopt_long(argc, argv, "dc:f:l:vs:S:?L:D:C:B:U:A:P:",
+        while ((opt = getopt_long(argc, argv, "dc:f:l:vs:S:b:?L:D:C:B:U:A:P:",
 				 long_options, &option_index)) != -1)
         {
                 bool succp = true;
@@ -1178,6 +1182,10 @@ int main(int argc, char **argv)
                 }
             }
 		    break;
+		case 'b':
+			/** Decoded with maxlogdecode */
+			binarylog_ids = optarg;
+			break;
 		case 's':
             {
                 char* tok = strstr(optarg,"=");
@@ -1525,7 +1533,8 @@ int main(int argc, char **argv)
          */
         {
                 char buf[1024];
-                char *argv[8];
+                char *argv[10];
+		int log_argc;
 		bool succp;
 		
 		/** Use default log directory /var/log/maxscale/ */
@@ -1563,8 +1572,7 @@ int main(int argc, char **argv)
 			/** Logs that should be syslogged */
 			argv[4] = "LOGFILE_MESSAGE,LOGFILE_ERROR"
 				"LOGFILE_DEBUG,LOGFILE_TRACE"; 
-			argv[5] = NULL;
-			succp = skygw_logmanager_init(5, argv);
+			log_argc = 5;
 		}
 		else
 		{
@@ -1572,9 +1580,16 @@ int main(int argc, char **argv)
 			argv[4] = "LOGFILE_DEBUG,LOGFILE_TRACE"; /*< to shm */
 			argv[5] = "-l"; /*< write to syslog */
 			argv[6] = "LOGFILE_MESSAGE,LOGFILE_ERROR"; /*< to syslog */
-			argv[7] = NULL;
-			succp = skygw_logmanager_init(7, argv);
+			log_argc = 7;
+		}
+
+		if (binarylog_ids != NULL)
+		{
+			argv[log_argc++] = "-x"; /*< write in binary format */
+			argv[log_argc++] = binarylog_ids;
 		}
+		argv[log_argc] = NULL;
+		succp = skygw_logmanager_init(log_argc, argv);
 		
 		if (!succp)
 		{
@@ -32,9 +32,9 @@
  * and value and to free them.
  *
  * The hashtable is arrange as a set of linked lists, the number of linked
- * lists being the hashsize as requested by the user. Entries are hashed by
- * calling the hash function that is passed in by the user, this is used as
- * an index into the array of linked lists, usign modulo hashsize.
+ * lists being at least the hashsize as requested by the user. Entries are
+ * hashed by calling the hash function that is passed in by the user, this is
+ * mixed and used as an index into the array of linked lists.
  *
  * The linked lists are searched using the key comparison function that is
  * passed into the hash table creation routine.
@@ -45,10 +45,16 @@
  * the key and the value, if the actions required are different the called functions
  * must understand how to differenate the key and value.
  *
- * The hash table implements a single write, multiple reader locking policy by
- * using a pair of counters and a spinlock. The spinlock is used to protect the
- * number of readers and writers counters when taking out locks. Releasing of
- * locks uses pure atomic actions and thus does not require spinlock protection.
+ * The number of linked lists is a power of two and doubles when the number
+ * of entries exceeds it. The entries are moved to the larger table
+ * incrementally by the following updates, see hashtable_grow.
+ *
+ * The linked lists are divided into stripes, each with its own single write,
+ * multiple reader lock, so that operations on different stripes do not
+ * contend. The lock uses a pair of counters and a spinlock. The spinlock is
+ * used to protect the number of readers and writers counters when taking out
+ * locks. Releasing of locks uses pure atomic actions and thus does not
+ * require spinlock protection.
  *
  * @verbatim
  * Revision History
@@ -64,10 +70,22 @@
  * @endverbatim
  */
 
-static	void hashtable_read_lock(HASHTABLE *table);
-static	void hashtable_read_unlock(HASHTABLE *table);
-static	void hashtable_write_lock(HASHTABLE *table);
-static	void hashtable_write_unlock(HASHTABLE *table);
+/** Maximum number of stripe locks of a hashtable */
+#define HASHTABLE_NLOCKS	16
+/** The table grows when it has more entries than chains times this */
+#define HASHTABLE_MAX_LOAD	1
+/** Number of old chains moved by each update during a resize */
+#define HASHTABLE_MIGRATE_STEP	4
+
+static	void hashtable_read_lock(HASHLOCK *lock);
+static	void hashtable_read_unlock(HASHLOCK *lock);
+static	void hashtable_write_lock(HASHLOCK *lock);
+static	void hashtable_write_unlock(HASHLOCK *lock);
+static	void hashtable_lock_all(HASHTABLE *table);
+static	void hashtable_unlock_all(HASHTABLE *table);
+static	bool hashtable_migrate(HASHTABLE *table, int stripe, int nchains);
+static	void hashtable_grow(HASHTABLE *table);
+static	void hashtable_resize_done(HASHTABLE *table);
 static HASHTABLE *hashtable_alloc_real(HASHTABLE* target, 
 					int size, 
 					int (*hashfn)(), 
@@ -87,12 +105,32 @@ nullfn(void *data)
 	return data;
 }
 
+/**
+ * Mix the bits of the value returned by the user supplied hash function.
+ * The table size is a power of two so the chain is chosen by the low bits,
+ * which are poorly distributed by many simple hash functions.
+ *
+ * @param hash	The value returned by the hash function
+ * @return The mixed hash value
+ */
+static unsigned int
+hashtable_mix(unsigned int hash)
+{
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35;
+	hash ^= hash >> 16;
+	return hash;
+}
+
 /**
  * Allocate a new hash table.
  *
  * The hashtable must have a size of at least one, however to be of any
  * practical use a larger size sould be chosen as the size relates to the number
- * of has buckets in the table.
+ * of has buckets in the table. The size is rounded up to a power of two and
+ * the table grows when the number of entries exceeds the number of buckets.
  *
  * @param size		The size of the hash table, msut be > 0
  * @param hashfn	The user supplied hash function
@@ -122,6 +160,7 @@ hashtable_alloc_real(
 	int (*cmpfn)())
 {
 	HASHTABLE       *rval;
+	int		i;
 	
 	if (target == NULL)
 	{
@@ -139,22 +178,38 @@ hashtable_alloc_real(
 	rval->ht_chk_top = CHK_NUM_HASHTABLE;
 	rval->ht_chk_tail = CHK_NUM_HASHTABLE;
 #endif
-	rval->hashsize = size > 0 ? size : 1;
+	rval->hashsize = 1;
+	while (rval->hashsize < size)
+		rval->hashsize <<= 1;
+	rval->nlocks = rval->hashsize < HASHTABLE_NLOCKS ?
+		rval->hashsize : HASHTABLE_NLOCKS;
 	rval->hashfn = hashfn;
 	rval->cmpfn = cmpfn;
 	rval->kcopyfn = nullfn;
 	rval->vcopyfn = nullfn;
 	rval->kfreefn = nullfn;
 	rval->vfreefn = nullfn;
-	rval->n_readers = 0;
-	rval->writelock = 0;
+	rval->old_entries = NULL;
+	rval->old_size = 0;
+	rval->nelems = 0;
+	rval->n_migrated = 0;
+	rval->n_resizes = 0;
 	spinlock_init(&rval->spin);
-	if ((rval->entries = (HASHENTRIES **)calloc(rval->hashsize, sizeof(HASHENTRIES *))) == NULL)
+	rval->entries = (HASHENTRIES **)calloc(rval->hashsize, sizeof(HASHENTRIES *));
+	rval->locks = (HASHLOCK *)calloc(rval->nlocks, sizeof(HASHLOCK));
+
+	if (rval->entries == NULL || rval->locks == NULL)
 	{
-		free(rval);
+		free(rval->entries);
+		free(rval->locks);
+		if (!rval->ht_isflat)
+			free(rval);
 		return NULL;
 	}
-	memset(rval->entries, 0, rval->hashsize * sizeof(HASHENTRIES *));
+	for (i = 0; i < rval->nlocks; i++)
+	{
+		spinlock_init(&rval->locks[i].spin);
+	}
 
 	return rval;
 }
@@ -170,10 +225,11 @@ hashtable_free(HASHTABLE *table)
 int		i;
 HASHENTRIES	*entry, *ptr;
 
-	hashtable_write_lock(table);
-	for (i = 0; i < table->hashsize; i++)
+	hashtable_lock_all(table);
+	for (i = 0; i < table->old_size + table->hashsize; i++)
 	{
-		entry = table->entries[i];
+		entry = i < table->old_size ? table->old_entries[i] :
+			table->entries[i - table->old_size];
 		while (entry)
 		{
 			ptr = entry->next;
@@ -184,8 +240,10 @@ HASHENTRIES	*entry, *ptr;
 		}
 	}
 	free(table->entries);
+	free(table->old_entries);
 	
-	hashtable_write_unlock(table);
+	hashtable_unlock_all(table);
+	free(table->locks);
 	if (!table->ht_isflat)
 	{
 		free(table);
@@ -221,6 +279,39 @@ hashtable_memory_fns(
 		table->vfreefn = vfreefn;
 }
 
+/**
+ * Find the entry with a given key. The lock of the stripe the key
+ * belongs to must be held.
+ *
+ * If a resize is in progress the key may still be in the old chains,
+ * the previous entry is then looked up in the old chain.
+ *
+ * @param table		The hash table
+ * @param key		The key to find
+ * @param hash		The mixed hash value of the key
+ * @param prevp		If not NULL, set to the address of the pointer to the entry
+ * @return The entry or NULL if not found
+ */
+static HASHENTRIES *
+hashtable_find(HASHTABLE *table, void *key, unsigned int hash, HASHENTRIES ***prevp)
+{
+HASHENTRIES	**prev;
+
+	prev = &table->entries[hash & (table->hashsize - 1)];
+	while (*prev && ((*prev)->hash != hash || table->cmpfn(key, (*prev)->key) != 0))
+		prev = &(*prev)->next;
+
+	if (*prev == NULL && table->old_entries)
+	{
+		prev = &table->old_entries[hash & (table->old_size - 1)];
+		while (*prev && ((*prev)->hash != hash || table->cmpfn(key, (*prev)->key) != 0))
+			prev = &(*prev)->next;
+	}
+	if (prevp)
+		*prevp = prev;
+	return *prev;
+}
+
 /**
  * Add an item to the hash table.
  *
@@ -232,68 +323,72 @@ hashtable_memory_fns(
 int
 hashtable_add(HASHTABLE *table, void *key, void *value)
 {
-        unsigned int		hashkey;
-        HASHENTRIES	*entry;
+        unsigned int	hashkey;
+        HASHLOCK	*lock;
+        HASHENTRIES	*ptr;
+        bool		migrated = false;
 
         if (key == NULL || value == NULL)
             return 0;
 
-        if (table->hashsize <= 0) {            
-            return 0;
-        } else {
-            hashkey = table->hashfn(key) % table->hashsize;
-        }
-	hashtable_write_lock(table);
-	entry = table->entries[hashkey % table->hashsize];
-	while (entry && table->cmpfn(key, entry->key) != 0)
-	{
-		entry = entry->next;
-	}
-	if (entry && table->cmpfn(key, entry->key) == 0)
+	hashkey = hashtable_mix(table->hashfn(key));
+	lock = &table->locks[hashkey & (table->nlocks - 1)];
+	hashtable_write_lock(lock);
+
+	if (hashtable_find(table, key, hashkey, NULL) != NULL)
 	{
 		/* Duplicate key value */
-		hashtable_write_unlock(table);
+		hashtable_write_unlock(lock);
 		return 0;
 	}
-	else
+
+	if ((ptr = (HASHENTRIES *)malloc(sizeof(HASHENTRIES))) == NULL)
 	{
-		HASHENTRIES	*ptr = (HASHENTRIES *)malloc(sizeof(HASHENTRIES));
-		if (ptr == NULL)
-		{
-			hashtable_write_unlock(table);
-			return 0;
-		}
+		hashtable_write_unlock(lock);
+		return 0;
+	}
 
-		/* copy the key */
-		ptr->key = table->kcopyfn(key);
+	/* copy the key */
+	ptr->key = table->kcopyfn(key);
 
-		/* check succesfull key copy */
-		if ( ptr->key  == NULL) {
-			free(ptr);
-			hashtable_write_unlock(table);
+	/* check succesfull key copy */
+	if ( ptr->key  == NULL) {
+		free(ptr);
+		hashtable_write_unlock(lock);
 
-			return 0;
-		}
+		return 0;
+	}
 
-		/* copy the value */
-		ptr->value = table->vcopyfn(value);
+	/* copy the value */
+	ptr->value = table->vcopyfn(value);
 
-		/* check succesfull value copy */
-		if  ( ptr->value == NULL) {
-			/* remove the key ! */
-			table->kfreefn(ptr->key);
-			free(ptr);
+	/* check succesfull value copy */
+	if  ( ptr->value == NULL) {
+		/* remove the key ! */
+		table->kfreefn(ptr->key);
+		free(ptr);
 
-			/* value not copied, return */
-			hashtable_write_unlock(table);
+		/* value not copied, return */
+		hashtable_write_unlock(lock);
 
-			return 0;
-		}
+		return 0;
+	}
 
-		ptr->next = table->entries[hashkey % table->hashsize];
-		table->entries[hashkey % table->hashsize] = ptr;
+	ptr->hash = hashkey;
+	ptr->next = table->entries[hashkey & (table->hashsize - 1)];
+	table->entries[hashkey & (table->hashsize - 1)] = ptr;
+
+	if (table->old_entries)
+	{
+		migrated = hashtable_migrate(table, hashkey & (table->nlocks - 1),
+					HASHTABLE_MIGRATE_STEP);
 	}
-	hashtable_write_unlock(table);
+	hashtable_write_unlock(lock);
+
+	if (migrated)
+		hashtable_resize_done(table);
+	if (atomic_add(&table->nelems, 1) >= table->hashsize * HASHTABLE_MAX_LOAD)
+		hashtable_grow(table);
 
 	return 1;
 }
@@ -308,54 +403,33 @@ hashtable_add(HASHTABLE *table, void *key, void *value)
 int
 hashtable_delete(HASHTABLE *table, void *key)
 {
-unsigned int		hashkey = table->hashfn(key) % table->hashsize;
-HASHENTRIES	*entry, *ptr;
+unsigned int	hashkey = hashtable_mix(table->hashfn(key));
+HASHLOCK	*lock = &table->locks[hashkey & (table->nlocks - 1)];
+HASHENTRIES	*entry, **prev;
+bool		migrated = false;
 
-	hashtable_write_lock(table);
-	entry = table->entries[hashkey % table->hashsize];
-	while (entry && entry->key && table->cmpfn(key, entry->key) != 0)
-	{
-		entry = entry->next;
-	}
-	if (entry == NULL)
+	hashtable_write_lock(lock);
+	if ((entry = hashtable_find(table, key, hashkey, &prev)) == NULL)
 	{
 		/* Not found */
-		hashtable_write_unlock(table);
+		hashtable_write_unlock(lock);
 		return 0;
 	}
+	*prev = entry->next;
+	table->kfreefn(entry->key);
+	table->vfreefn(entry->value);
+	free(entry);
 
-	if (entry == table->entries[hashkey % table->hashsize])
-	{
-		/* We are removing from the first entry */
-		table->entries[hashkey % table->hashsize] = entry->next;
-		table->kfreefn(entry->key);
-		table->vfreefn(entry->value);
-
-                if (entry->next != NULL) {
-                    entry->key = entry->next->key;
-                    entry->value = entry->next->value;
-                } else {
-                    entry->key = NULL;
-                    entry->value = NULL;
-                }
-		free(entry);
-	}
-	else
+	if (table->old_entries)
 	{
-		ptr = table->entries[hashkey % table->hashsize];
-		while (ptr && ptr->next != entry)
-			ptr = ptr->next;
-		if (ptr == NULL)
-		{
-			hashtable_write_unlock(table);
-			return 0;	/* This should never happen */
-		}
-		ptr->next = entry->next;
-		table->kfreefn(entry->key);
-		table->vfreefn(entry->value);
-		free(entry);
+		migrated = hashtable_migrate(table, hashkey & (table->nlocks - 1),
+					HASHTABLE_MIGRATE_STEP);
 	}
-	hashtable_write_unlock(table);
+	hashtable_write_unlock(lock);
+	atomic_add(&table->nelems, -1);
+
+	if (migrated)
+		hashtable_resize_done(table);
 	return 1;
 }
 
@@ -369,130 +443,209 @@ HASHENTRIES	*entry, *ptr;
 void *
 hashtable_fetch(HASHTABLE *table, void *key)
 {
-unsigned int		hashkey = table->hashfn(key) % table->hashsize;
+unsigned int	hashkey = hashtable_mix(table->hashfn(key));
+HASHLOCK	*lock = &table->locks[hashkey & (table->nlocks - 1)];
 HASHENTRIES	*entry;
 
-	hashtable_read_lock(table);
-	entry = table->entries[hashkey % table->hashsize];
-	while (entry && entry->key && table->cmpfn(key, entry->key) != 0)
-	{
-		entry = entry->next;
-	}
-	if (entry == NULL)
+	hashtable_read_lock(lock);
+	entry = hashtable_find(table, key, hashkey, NULL);
+	hashtable_read_unlock(lock);
+
+	return entry ? entry->value : NULL;
+}
+
+/**
+ * Move old chains of a stripe to the resized table. The write lock of
+ * the stripe must be held.
+ *
+ * Since both table sizes are multiples of the number of stripes, the
+ * entries of an old chain stay in the same stripe.
+ *
+ * @param table		The hash table
+ * @param stripe	The stripe to migrate
+ * @param nchains	Maximum number of old chains to move
+ * @return True if this call moved the last old chain of the table and
+ * the old chains can be released with hashtable_resize_done
+ */
+static bool
+hashtable_migrate(HASHTABLE *table, int stripe, int nchains)
+{
+HASHLOCK	*lock = &table->locks[stripe];
+HASHENTRIES	*entry, *next;
+int		i;
+
+	if (lock->migrate_next >= table->old_size)
+		return false;
+
+	while (nchains-- > 0 && lock->migrate_next < table->old_size)
 	{
-		hashtable_read_unlock(table);
-		return NULL;
+		i = lock->migrate_next;
+		for (entry = table->old_entries[i]; entry; entry = next)
+		{
+			next = entry->next;
+			entry->next = table->entries[entry->hash & (table->hashsize - 1)];
+			table->entries[entry->hash & (table->hashsize - 1)] = entry;
+		}
+		table->old_entries[i] = NULL;
+		lock->migrate_next += table->nlocks;
 	}
-	else
+
+	return lock->migrate_next >= table->old_size &&
+		atomic_add(&table->n_migrated, 1) == table->nlocks - 1;
+}
+
+/**
+ * Release the old chains once a resize has moved all of them.
+ *
+ * @param table		The hash table
+ */
+static void
+hashtable_resize_done(HASHTABLE *table)
+{
+	spinlock_acquire(&table->spin);
+	hashtable_lock_all(table);
+	if (table->old_entries && table->n_migrated == table->nlocks)
 	{
-		hashtable_read_unlock(table);
-		return entry->value;
+		free(table->old_entries);
+		table->old_entries = NULL;
+		table->old_size = 0;
 	}
+	hashtable_unlock_all(table);
+	spinlock_release(&table->spin);
 }
 
 /**
- * Print hash table statistics to the standard output
+ * Double the number of chains in the hash table.
+ *
+ * Only the chain array is replaced here, the entries are moved a few
+ * chains at a time by the following updates of each stripe. Lookups
+ * check both the new and the old chain of a key until then. If the
+ * previous resize is still in progress it is completed first.
  *
  * @param table		The hash table
  */
-void
-hashtable_stats(HASHTABLE *table)
+static void
+hashtable_grow(HASHTABLE *table)
 {
-int		total, longest, i, j;
-HASHENTRIES	*entries;
+HASHENTRIES	**entries;
+int		i;
+
+	spinlock_acquire(&table->spin);
+	hashtable_lock_all(table);
 
-	printf("Hashtable: %p, size %d\n", table, table->hashsize);
-	total = 0;
-	longest = 0;
-	hashtable_read_lock(table);
-	for (i = 0; i < table->hashsize; i++)
+	if (table->nelems > table->hashsize * HASHTABLE_MAX_LOAD &&
+		(entries = (HASHENTRIES **)calloc(table->hashsize * 2,
+						sizeof(HASHENTRIES *))) != NULL)
 	{
-		j = 0;
-		entries = table->entries[i];
-		while (entries)
+		if (table->old_entries)
 		{
-			j++;
-			entries = entries->next;
+			for (i = 0; i < table->nlocks; i++)
+				hashtable_migrate(table, i, table->old_size);
+			free(table->old_entries);
 		}
-		total += j;
-		if (j > longest)
-			longest = j;
+		table->old_entries = table->entries;
+		table->old_size = table->hashsize;
+		table->entries = entries;
+		table->hashsize *= 2;
+		table->n_migrated = 0;
+		table->n_resizes++;
+
+		for (i = 0; i < table->nlocks; i++)
+			table->locks[i].migrate_next = i;
 	}
-	hashtable_read_unlock(table);
-	printf("\tNo. of entries:     	%d\n", total);
-	printf("\tAverage chain length:	%.1f\n", (float)total / table->hashsize);
-	printf("\tLongest chain length:	%d\n", longest);
+	hashtable_unlock_all(table);
+	spinlock_release(&table->spin);
+}
+
+/**
+ * Print hash table statistics to the standard output
+ *
+ * @param table		The hash table
+ */
+void
+hashtable_stats(HASHTABLE *table)
+{
+HASHTABLE_STATS	stats;
+
+	hashtable_get_stats(table, &stats);
+	printf("Hashtable: %p, size %d\n", table, stats.hashsize);
+	printf("\tNo. of entries:     	%d\n", stats.nelems);
+	printf("\tLoad factor:        	%.2f\n", stats.load_factor);
+	printf("\tAverage chain length:	%.1f\n", stats.avg_chain);
+	printf("\tLongest chain length:	%d\n", stats.longest);
+	printf("\tNo. of resizes:     	%d%s\n", stats.n_resizes,
+		stats.resizing ? " (in progress)" : "");
 }
 
 /** 
  * Produces stat output about hashtable 
  *
- * Parameters:
- * @param table - <usage>
- *          <description>
- *
- * @param hashsize - <usage>
- *          <description>
- *
- * @param nelems - <usage>
- *          <description>
- *
- * @param longest - <usage>
- *          <description>
- *
- * @return void
- *
+ * The chain lengths are counted one stripe at a time, so the
+ * figures of a table that is being updated are approximate.
  *
+ * @param table	The hash table
+ * @param stats	The statistics to fill in
  */
 void hashtable_get_stats(
-        void* table,
-        int*  hashsize,
-        int*  nelems,
-        int*  longest)
+        void*            table,
+        HASHTABLE_STATS* stats)
 {
         HASHTABLE*   ht;
         HASHENTRIES* entries;
         int          i;
         int          j;
+        int          s;
 
-	*nelems = 0;
-	*longest = 0;
-	*hashsize = 0;
+	memset(stats, 0, sizeof(*stats));
 	
 	if (table != NULL)
 	{
 		ht = (HASHTABLE *)table;
 		CHK_HASHTABLE(ht);
-		hashtable_read_lock(ht);
-		
-		for (i = 0; i < ht->hashsize; i++)
+
+		for (s = 0; s < ht->nlocks; s++)
 		{
-			j = 0;
-			entries = ht->entries[i];
-			while (entries)
+			hashtable_read_lock(&ht->locks[s]);
+
+			for (i = s; i < ht->old_size + ht->hashsize; i += ht->nlocks)
 			{
-				j++;
-				entries = entries->next;
+				j = 0;
+				entries = i < ht->old_size ? ht->old_entries[i] :
+					ht->entries[i - ht->old_size];
+				while (entries)
+				{
+					j++;
+					entries = entries->next;
+				}
+				stats->nelems += j;
+				if (j > 0)
+					stats->nchains++;
+				if (j > stats->longest)
+					stats->longest = j;
 			}
-			*nelems += j;
-			if (j > *longest) {
-				*longest = j;
+			if (s == 0)
+			{
+				stats->hashsize = ht->hashsize;
+				stats->resizing = ht->old_entries != NULL;
+				stats->n_resizes = ht->n_resizes;
 			}
+			hashtable_read_unlock(&ht->locks[s]);
 		}
-		*hashsize = ht->hashsize;
-		hashtable_read_unlock(ht);
+		stats->load_factor = (float)stats->nelems / stats->hashsize;
+		stats->avg_chain = stats->nchains ?
+			(float)stats->nelems / stats->nchains : 0;
 	}
 }
 
 
 /**
- * Take a read lock on the hashtable.
+ * Take a read lock on a stripe of the hashtable.
  *
- * The hashtable support multiple readers and a single writer,
+ * Each stripe supports multiple readers and a single writer,
  * we have a spinlock to protect the two counts, n_readers and
  * writelock.
  *
- * We take the hashtable spinlock and then check that writelock
+ * We take the stripe spinlock and then check that writelock
  * is set to zero. If not we release the spinlock and do dirty
  * reads of writelock until it goes to 0. Once it is zero we
  * acquire the spinlock again and test that writelock is still
@@ -501,40 +654,40 @@ void hashtable_get_stats(
  * With writelock set to zero we increment n_readers with the
  * spinlock still held.
  *
- * @param table		The hashtable to lock.
+ * @param lock		The stripe to lock.
  */
 static void
-hashtable_read_lock(HASHTABLE *table)
+hashtable_read_lock(HASHLOCK *lock)
 {
-	spinlock_acquire(&table->spin);
-	while (table->writelock)
+	spinlock_acquire(&lock->spin);
+	while (lock->writelock)
 	{
-		spinlock_release(&table->spin);
-		while (table->writelock)
+		spinlock_release(&lock->spin);
+		while (*(volatile int *)&lock->writelock)
 			;
-		spinlock_acquire(&table->spin);
+		spinlock_acquire(&lock->spin);
 	}
-	atomic_add(&table->n_readers, 1);
-	spinlock_release(&table->spin);
+	atomic_add(&lock->n_readers, 1);
+	spinlock_release(&lock->spin);
 }
 
 /**
  * Release a previously obtained readlock.
  *
- * Simply decrement the n_readers value for the hash table
+ * Simply decrement the n_readers value for the stripe
  *
- * @param table		The hash table to unlock
+ * @param lock		The stripe to unlock
  */
 static void
-hashtable_read_unlock(HASHTABLE *table)
+hashtable_read_unlock(HASHLOCK *lock)
 {
-	atomic_add(&table->n_readers, -1);
+	atomic_add(&lock->n_readers, -1);
 }
 
 /**
- * Obtain an exclusive write lock for the hash table.
+ * Obtain an exclusive write lock for a stripe of the hash table.
  *
- * We acquire the hashtable spinlock, check for the number of
+ * We acquire the stripe spinlock, check for the number of
  * readers beign zero. If it is not we hold the spinlock and
  * loop waiting for the n_readers to reach zero. This will prevent
  * any new readers beign granted access but will not prevent current
@@ -545,33 +698,61 @@ hashtable_read_unlock(HASHTABLE *table)
  * the spinlock throughout the process since both read and write
  * locks do not require the spinlock to be acquired.
  *
- * @param table	The table to lock for updates
+ * @param lock	The stripe to lock for updates
  */
 static void
-hashtable_write_lock(HASHTABLE *table)
+hashtable_write_lock(HASHLOCK *lock)
 {
 int	available;
 
-	spinlock_acquire(&table->spin);
+	spinlock_acquire(&lock->spin);
 	do {
-		while (table->n_readers)
+		while (*(volatile int *)&lock->n_readers)
 			;
-		available = atomic_add(&table->writelock, 1);
+		available = atomic_add(&lock->writelock, 1);
 		if (available != 0)
-			atomic_add(&table->writelock, -1);
+			atomic_add(&lock->writelock, -1);
 	} while (available != 0);
-	spinlock_release(&table->spin);
+	spinlock_release(&lock->spin);
 }
 
 /**
- * Release the write lock on the hash table.
+ * Release the write lock on a stripe of the hash table.
  *
- * @param table The hash table to unlock
+ * @param lock The stripe to unlock
  */
 static void
-hashtable_write_unlock(HASHTABLE *table)
+hashtable_write_unlock(HASHLOCK *lock)
 {
-	atomic_add(&table->writelock, -1);
+	atomic_add(&lock->writelock, -1);
+}
+
+/**
+ * Write lock all the stripes of the hash table, always in the same order.
+ *
+ * @param table	The table to lock
+ */
+static void
+hashtable_lock_all(HASHTABLE *table)
+{
+int	i;
+
+	for (i = 0; i < table->nlocks; i++)
+		hashtable_write_lock(&table->locks[i]);
+}
+
+/**
+ * Release the write locks of all stripes of the hash table.
+ *
+ * @param table	The table to unlock
+ */
+static void
+hashtable_unlock_all(HASHTABLE *table)
+{
+int	i;
+
+	for (i = table->nlocks - 1; i >= 0; i--)
+		hashtable_write_unlock(&table->locks[i]);
 }
 
 /**
@@ -597,6 +778,9 @@ HASHITERATOR	*rval;
 /**
  * Return the next key for a hashtable iterator
  *
+ * The chains of a resize in progress are walked before the chains of
+ * the new table. Chain i of either belongs to the stripe i % nlocks.
+ *
  * @param iter	The hashtable iterator
  * @return	The next key value or NULL
  */
@@ -604,32 +788,37 @@ void *
 hashtable_next(HASHITERATOR *iter)
 {
 int		i;
+HASHTABLE	*table = iter->table;
+HASHLOCK	*lock;
 HASHENTRIES	*entries;
+void		*key;
 
 	iter->depth++;
-	while (iter->chain < iter->table->hashsize)
+	while (true)
 	{
-		hashtable_read_lock(iter->table);
-		if ((entries = iter->table->entries[iter->chain]) != NULL)
+		lock = &table->locks[iter->chain & (table->nlocks - 1)];
+		hashtable_read_lock(lock);
+		if (iter->chain >= table->old_size + table->hashsize)
 		{
-			i = 0;
-			while (entries && i < iter->depth)
-			{
-				entries = entries->next;
-				i++;
-			}
-			hashtable_read_unlock(iter->table);
-			if (entries)
-				return entries->key;
+			hashtable_read_unlock(lock);
+			return NULL;
 		}
-		else
+		entries = iter->chain < table->old_size ?
+			table->old_entries[iter->chain] :
+			table->entries[iter->chain - table->old_size];
+		i = 0;
+		while (entries && i < iter->depth)
 		{
-			hashtable_read_unlock(iter->table);
+			entries = entries->next;
+			i++;
 		}
+		key = entries ? entries->key : NULL;
+		hashtable_read_unlock(lock);
+		if (key)
+			return key;
 		iter->depth = 0;
 		iter->chain++;
 	}
-	return NULL;
 }
 
 /**
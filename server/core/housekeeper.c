@@ -20,6 +20,7 @@
 #include <housekeeper.h>
 #include <thread.h>
 #include <spinlock.h>
+#include <timer.h>
 
 /**
  * @file housekeeper.c  Provide a mechanism to run periodic tasks
@@ -33,6 +34,10 @@
  * The housekeeper also maintains a global variable, hkheartbeat, that
  * is incremented every 100ms.
  *
+ * The tasks are scheduled with a timer wheel of their own, so that the
+ * housekeeper thread sleeps until the next task is due or the heartbeat
+ * must be incremented and only visits the tasks that are due.
+ *
  * @verbatim
  * Revision History
  *
@@ -51,11 +56,16 @@ static HKTASK	*tasks = NULL;
  * Spinlock to protect the tasks list
  */
 static SPINLOCK	tasklock = SPINLOCK_INIT;
+/**
+ * The wheel that holds the timers of the tasks
+ */
+static TIMER_WHEEL	hkwheel;
 
 static int	do_shutdown = 0;
 unsigned long	hkheartbeat = 0;
 
 static	void	hkthread(void *);
+static	void	hkrun(TIMER *, void *);
 
 /**
  * Initialise the housekeeper thread
@@ -130,6 +140,8 @@ HKTASK	*task, *ptr;
 	{
 		tasks = task;
 	}
+	timer_init(&task->timer, hkrun, task);
+	timer_wheel_add(&hkwheel, &task->timer, timer_now() + frequency * 1000UL);
 	spinlock_release(&tasklock);
 
 	return task->nextdue;
@@ -184,6 +196,8 @@ HKTASK	*task, *ptr;
 		ptr->next = task;
 	else
 		tasks = task;
+	timer_init(&task->timer, hkrun, task);
+	timer_wheel_add(&hkwheel, &task->timer, timer_now() + when * 1000UL);
 	spinlock_release(&tasklock);
 
 	return task->nextdue;
@@ -212,6 +226,8 @@ HKTASK	*ptr, *lptr = NULL;
 		lptr->next = ptr->next;
 	else if (ptr)
 		tasks = ptr->next;
+	if (ptr)
+		timer_cancel(&ptr->timer);
 	spinlock_release(&tasklock);
 
 	if (ptr)
@@ -228,59 +244,65 @@ HKTASK	*ptr, *lptr = NULL;
 
 
 /**
- * The housekeeper thread implementation.
+ * Run a task whose timer has expired.
+ *
+ * The function is called by the housekeeper thread without the tasklock
+ * spinlock or the lock of the wheel being held, which allows manipulation
+ * of the housekeeper task list during execution of the task. A repeated
+ * task is scheduled for its next run before it is run.
  *
- * This function is responsible for executing the housekeeper tasks.
+ * @param timer	The timer of the task
+ * @param data	The task
+ */
+static void
+hkrun(TIMER *timer, void *data)
+{
+HKTASK	*task = (HKTASK *)data;
+
+	if (task->type == HK_REPEATED)
+	{
+		spinlock_acquire(&tasklock);
+		task->nextdue = time(0) + task->frequency;
+		spinlock_release(&tasklock);
+		timer_wheel_add(&hkwheel, timer, timer_now() + task->frequency * 1000UL);
+	}
+	(*task->task)(task->data);
+	if (task->type == HK_ONESHOT)
+		hktask_remove(task->name);
+}
+
+/**
+ * The housekeeper thread implementation.
  *
- * The implementation of the callng of the task functions is such that
- * the tasks are called without the tasklock spinlock being held. This
- * allows manipulation of the housekeeper task list during execution of
- * one of the tasks. The resutl is that upon completion of a task the
- * search for tasks to run must restart from the start of the queue.
- * It is vital that the task->nextdue tiem is updated before the task
- * is run.
+ * This function is responsible for maintaining the heartbeat and for
+ * executing the housekeeper tasks. The thread sleeps until either the
+ * next task is due or the next heartbeat, the heartbeat is derived from
+ * the monotonic clock so that the time spent running tasks does not make
+ * it drift.
  *
  * @param	data		Unused, here to satisfy the thread system
  */
 void
 hkthread(void *data)
 {
-HKTASK	*ptr;
-time_t	now;
-void	(*taskfn)(void *);
-void	*taskdata;
-int	i;
+unsigned long	start, now;
+long		wait, next;
 
+	start = timer_now();
 	for (;;)
 	{
-		for (i = 0; i < 10; i++)
-		{
-			if (do_shutdown)
-				return;
-			thread_millisleep(100);
-			hkheartbeat++;
-		}
-		now = time(0);
-		spinlock_acquire(&tasklock);
-		ptr = tasks;
-		while (ptr)
-		{
-			if (ptr->nextdue <= now)
-			{
-				ptr->nextdue = now + ptr->frequency;
-				taskfn = ptr->task;
-				taskdata = ptr->data;
-				spinlock_release(&tasklock);
-				(*taskfn)(taskdata);
-				if (ptr->type == HK_ONESHOT)
-					hktask_remove(ptr->name);
-				spinlock_acquire(&tasklock);
-				ptr = tasks;
-			}
-			else
-				ptr = ptr->next;
-		}
-		spinlock_release(&tasklock);
+		if (do_shutdown)
+			return;
+		now = timer_now();
+		hkheartbeat = (now - start) / 100;
+		timer_wheel_process(&hkwheel, now);
+
+		now = timer_now();
+		wait = 100 - (now - start) % 100;
+		if ((next = timer_wheel_next(&hkwheel, now)) >= 0 && next < wait)
+			wait = next;
+		if (wait > 0)
+			thread_millisleep(wait);
 	}
 }
 
@@ -464,6 +464,8 @@ int modutil_send_mysql_err_packet (
  * Buffer contains at least one of the following:
  * complete [complete] [partial] mysql packet
  * 
+ * A packet that fills the first buffer is returned without copying it.
+ * 
  * return pointer to gwbuf containing a complete packet or
  *   NULL if no complete packet was found.
  */
@@ -504,6 +506,21 @@ GWBUF* modutil_get_next_MySQL_packet(
 		goto return_packetbuf;
 	}
 	
+	/**
+	 * The packet fills the first buffer of the chain, unlink the buffer
+	 * and return it as it is instead of copying it.
+	 */
+	if (packetlen == GWBUF_LENGTH(readbuf))
+	{
+		*p_readbuf = readbuf->next;
+		if (readbuf->next)
+			readbuf->next->tail = readbuf->tail;
+		readbuf->next = NULL;
+		readbuf->tail = readbuf;
+		packetbuf = readbuf;
+		goto return_packetbuf;
+	}
+	
 	packetbuf = gwbuf_alloc(packetlen);
 	target    = GWBUF_DATA(packetbuf);
 	packetbuf->gwbuf_type = readbuf->gwbuf_type; /*< Copy the type too */
@@ -842,3 +859,143 @@ int modutil_count_statements(GWBUF* buffer)
 
     return num;
 }
+
+/**
+ * Skip a length encoded integer
+ *
+ * @param ptr	Pointer to the integer
+ * @return Pointer to the byte following the integer
+ */
+static uint8_t *
+skip_lenenc(uint8_t *ptr)
+{
+	switch (*ptr)
+	{
+		case 0xfc:
+			return ptr + 3;
+		case 0xfd:
+			return ptr + 4;
+		case 0xfe:
+			return ptr + 9;
+		default:
+			return ptr + 1;
+	}
+}
+
+/**
+ * Follow the replies a server sends to a command and count the replies that
+ * end in the buffer. An OK or error packet ends a reply and so does the EOF
+ * packet after the rows of a result set, unless the server announces more
+ * results of a multi-statement or a stored procedure. The reply to
+ * COM_FIELD_LIST ends at the EOF after the column definitions and so does
+ * the reply to a COM_STMT_EXECUTE that opens a cursor. The rows of a
+ * COM_STMT_FETCH reply begin with the same byte as an OK packet and are
+ * not mistaken for one. The buffer must hold complete packets only.
+ *
+ * @param buf	The reply packets
+ * @param cmd	The command the server is replying to
+ * @param state	The state of the reply, kept between calls
+ * @return The number of replies that ended in the buffer
+ */
+int
+modutil_count_replies(GWBUF *buf, int cmd, reply_state_t *state)
+{
+uint8_t	*ptr, *end, *status;
+bool	done;
+int	nreplies = 0;
+
+	for (; buf != NULL; buf = buf->next)
+	{
+		ptr = (uint8_t *)GWBUF_DATA(buf);
+		end = (uint8_t *)buf->end;
+
+		while (end - ptr > 4)
+		{
+			done = false;
+
+			switch (*state)
+			{
+			case REPLY_STATE_START:
+				if (PTR_IS_ERR(ptr))
+				{
+					done = true;
+				}
+				else if (cmd == MYSQL_COM_STMT_FETCH)
+				{
+					*state = REPLY_STATE_RSET_ROWS;
+					done = PTR_IS_EOF(ptr);
+				}
+				else if (PTR_IS_OK(ptr))
+				{
+					status = skip_lenenc(skip_lenenc(ptr + 5));
+					/** SERVER_MORE_RESULTS_EXIST */
+					done = status + 2 > end || !(status[0] & 0x08);
+				}
+				else if (PTR_IS_LOCAL_INFILE(ptr))
+				{
+					done = true;
+				}
+				else if (cmd == MYSQL_COM_FIELD_LIST)
+				{
+					done = PTR_IS_EOF(ptr);
+					*state = REPLY_STATE_RSET_COLDEF;
+				}
+				else if (cmd == MYSQL_COM_QUERY ||
+					cmd == MYSQL_COM_STMT_EXECUTE)
+				{
+					*state = REPLY_STATE_RSET_COLDEF;
+				}
+				else
+				{
+					done = true;
+				}
+				break;
+
+			case REPLY_STATE_RSET_COLDEF:
+				if (PTR_IS_ERR(ptr))
+				{
+					done = true;
+				}
+				else if (PTR_IS_EOF(ptr))
+				{
+					/**
+					 * SERVER_STATUS_CURSOR_EXISTS, the rows are
+					 * read with COM_STMT_FETCH
+					 */
+					done = cmd == MYSQL_COM_FIELD_LIST ||
+						(cmd == MYSQL_COM_STMT_EXECUTE &&
+						(ptr[7] & 0x40));
+					*state = REPLY_STATE_RSET_ROWS;
+				}
+				break;
+
+			case REPLY_STATE_RSET_ROWS:
+				if (PTR_IS_ERR(ptr))
+				{
+					done = true;
+				}
+				else if (PTR_IS_EOF(ptr))
+				{
+					/** SERVER_MORE_RESULTS_EXIST */
+					if (ptr[7] & 0x08)
+					{
+						*state = REPLY_STATE_START;
+					}
+					else
+					{
+						done = true;
+					}
+				}
+				break;
+			}
+
+			if (done)
+			{
+				*state = REPLY_STATE_START;
+				nreplies += 1;
+			}
+			ptr += gw_mysql_get_byte3(ptr) + 4;
+		}
+	}
+	return nreplies;
+}
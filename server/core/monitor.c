@@ -197,6 +197,8 @@ monitorAddServer(MONITOR *mon, SERVER *server)
         db->mon_prev_status = -1;
 	/* pending status is updated by get_replication_tree */
 	db->pending_status = 0;
+	db->probe_time = 0;
+	db->probe_max = 0;
 
 	spinlock_acquire(&mon->lock);
 
@@ -327,7 +329,10 @@ monitorSetInterval (MONITOR *mon, unsigned long interval)
 }
 
 /**
- * Set Monitor timeouts for connect/read/write
+ * Set Monitor timeouts for connect/read/write. The timeouts are lowered
+ * below the monitor interval, unless the interval is shorter than a second.
+ * The servers are probed in parallel and a probe that takes longer than the
+ * interval only delays the next cycle.
  *
  * @param mon		The monitor instance
  * @param type		The timeout handling type
@@ -344,7 +349,7 @@ monitorSetNetworkTimeout(MONITOR *mon, int type, int value) {
 
     switch(type) {
     case MONITOR_CONNECT_TIMEOUT:
-	if (value < max_timeout) {
+	if (value < max_timeout || max_timeout == 0) {
 	    memcpy(&mon->connect_timeout, &value, sizeof(int));
 	} else {
 	    memcpy(&mon->connect_timeout, &new_timeout, sizeof(int));
@@ -356,7 +361,7 @@ monitorSetNetworkTimeout(MONITOR *mon, int type, int value) {
 	break;
 
     case MONITOR_READ_TIMEOUT:
-	if (value < max_timeout) {
+	if (value < max_timeout || max_timeout == 0) {
 	    memcpy(&mon->read_timeout, &value, sizeof(int));
 	} else {
 	    memcpy(&mon->read_timeout, &new_timeout, sizeof(int));
@@ -368,7 +373,7 @@ monitorSetNetworkTimeout(MONITOR *mon, int type, int value) {
 	break;
 
     case MONITOR_WRITE_TIMEOUT:
-	if (value < max_timeout) {
+	if (value < max_timeout || max_timeout == 0) {
 	    memcpy(&mon->write_timeout, &value, sizeof(int));
 	} else {
 	    memcpy(&mon->write_timeout, &new_timeout, sizeof(int));
@@ -19,10 +19,13 @@
 #include <string.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <sys/epoll.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <poll.h>
 #include <dcb.h>
+#include <session.h>
 #include <atomic.h>
 #include <gwbitmask.h>
 #include <skygw_utils.h>
@@ -33,6 +36,7 @@
 #include <maxconfig.h>
 #include <mysql.h>
 #include <resultset.h>
+#include <timer.h>
 
 #define		PROFILE_POLL	0
 
@@ -89,12 +93,73 @@ static	GWBITMASK	poll_mask;
 static  simple_mutex_t  epoll_wait_mutex; /*< serializes calls to epoll_wait */
 #endif
 static	int		n_waiting = 0;	  /*< No. of threads in epoll_wait */
-static	int		process_pollq(int thread_id);
-static	void		poll_add_event_to_dcb(DCB* dcb, GWBUF* buf, __uint32_t ev);
 
+/**
+ * An event queue, a circular list of DCB's that have events pending
+ * processing, linked through the evq member of the DCB.
+ */
+typedef struct {
+	SPINLOCK	lock;		/*< Protects the queue */
+	DCB		*head;		/*< The first DCB in the queue */
+	int		pending;	/*< No. of DCBs in the queue with pending events */
+} POLL_QUEUE;
 
-DCB		*eventq = NULL;
-SPINLOCK	pollqlock = SPINLOCK_INIT;
+/**
+ * The shared event queue. All DCB's use this queue unless poll affinity is
+ * enabled, in which case only the DCB's without an owning thread, such as
+ * the listeners, use it.
+ */
+static	POLL_QUEUE	sharedq = { SPINLOCK_INIT, NULL, 0 };
+
+/**
+ * The per-thread polling data used when poll affinity is enabled. Each
+ * polling thread then has an epoll set and event queue of its own and the
+ * client and backend DCB's of a session are all assigned to the same thread.
+ *
+ * The epoll set of the thread also contains the shared epoll set, used for
+ * the listeners, and the read end of a wakeup pipe. Events injected into the
+ * queue of a thread by another thread are handed over by writing to the
+ * wakeup pipe, which makes a thread blocked in epoll_wait return and
+ * process its queue.
+ *
+ * A thread that has nothing to do steals work from the queues of the other
+ * threads that are busy processing an event while more DCB's are waiting in
+ * their queues. The processing flag of the DCB still guarantees that only
+ * one thread at a time processes the events of a DCB.
+ */
+typedef struct {
+	int		epoll_fd;	/*< The epoll set of the thread */
+	int		wakeup[2];	/*< The wakeup pipe of the thread */
+	POLL_QUEUE	queue;		/*< The event queue of the thread */
+	int		n_dcbs;		/*< No. of DCBs assigned to the thread */
+	int		n_wakeups;	/*< No. of wakeups sent to the thread */
+	int		n_steals;	/*< No. of DCBs stolen by the thread */
+	int		n_stolen;	/*< No. of DCBs stolen from the thread */
+} POLL_THREAD;
+
+static	POLL_THREAD	*poll_threads = NULL;	/*< Per-thread data, NULL if affinity is off */
+static	int		next_owner = 0;		/*< Round robin thread assignment */
+static	__thread int	current_thread = -1;	/*< Thread id of the calling polling thread */
+
+/** Markers used as the epoll data for the non-DCB descriptors in thread epoll sets */
+static	int		shared_marker;
+static	int		wakeup_marker;
+#define	SHARED_MARKER	((void *)&shared_marker)
+#define	WAKEUP_MARKER	((void *)&wakeup_marker)
+
+static	int		process_pollq(int thread_id);
+static	int		poll_process_queue(int thread_id, POLL_QUEUE *queue);
+static	void		poll_add_event_to_dcb(DCB* dcb, GWBUF* buf, __uint32_t ev);
+static	void		poll_queue_events(struct epoll_event *events, int nfds);
+static	int		poll_queue_dcb(POLL_QUEUE *queue, DCB *dcb, __uint32_t ev);
+static	int		poll_queue_dcb_nolock(POLL_QUEUE *queue, DCB *dcb, __uint32_t ev);
+static	void		poll_show_queue(DCB *pdcb, POLL_QUEUE *queue);
+static	POLL_QUEUE	*poll_dcb_queue(DCB *dcb);
+static	void		poll_wakeup(DCB *dcb);
+static	int		poll_pending(int thread_id);
+static	int		poll_stealable(int victim);
+static	int		poll_steal(int thread_id);
+static	int		poll_thread_init(POLL_THREAD *thr);
 
 /**
  * Thread load average, this is the average number of descriptors in each
@@ -163,6 +228,7 @@ static struct {
 	int	evq_max;	/*< Maximum event queue length */
 	int	wake_evqpending;/*< Woken from epoll_wait with pending events in queue */
 	int	blockingpolls;	/*< Number of epoll_waits with a timeout specified */
+	int	n_steals;	/*< Number of DCBs stolen from other threads */
 } pollStats;
 
 #define	N_QUEUE_TIMES	30
@@ -215,6 +281,28 @@ int	i;
 			thread_data[i].state = THREAD_STOPPED;
 		}
 	}
+	if (dcb_zombies_init(n_threads) != 0)
+	{
+		perror("dcb_zombies_init");
+		exit(-1);
+	}
+	if (config_poll_affinity() && n_threads > 0)
+	{
+		if ((poll_threads = (POLL_THREAD *)calloc(n_threads,
+						sizeof(POLL_THREAD))) == NULL)
+		{
+			perror("calloc");
+			exit(-1);
+		}
+		for (i = 0; i < n_threads; i++)
+		{
+			if (poll_thread_init(&poll_threads[i]) != 0)
+			{
+				perror("poll_thread_init");
+				exit(-1);
+			}
+		}
+	}
 #if MUTEX_EPOLL
         simple_mutex_init(&epoll_wait_mutex, "epoll_wait_mutex");        
 #endif
@@ -236,6 +324,104 @@ int	i;
 #endif
 }
 
+/**
+ * Create the epoll set, the wakeup pipe and the event queue of a polling
+ * thread. The shared epoll set is added to the epoll set of the thread so
+ * that the thread also sees the events of the listeners.
+ *
+ * @param thr	The thread data to initialise
+ * @return	0 on success, -1 on error
+ */
+static int
+poll_thread_init(POLL_THREAD *thr)
+{
+struct	epoll_event	ev;
+int			i;
+
+	spinlock_init(&thr->queue.lock);
+	thr->queue.head = NULL;
+	thr->queue.pending = 0;
+	thr->n_dcbs = 0;
+	thr->n_wakeups = 0;
+	thr->n_steals = 0;
+	thr->n_stolen = 0;
+
+	if ((thr->epoll_fd = epoll_create(MAX_EVENTS)) == -1)
+		return -1;
+	if (pipe(thr->wakeup) == -1)
+		return -1;
+	for (i = 0; i < 2; i++)
+	{
+		fcntl(thr->wakeup[i], F_SETFL,
+			fcntl(thr->wakeup[i], F_GETFL) | O_NONBLOCK);
+	}
+
+	ev.events = EPOLLIN;
+	ev.data.ptr = WAKEUP_MARKER;
+	if (epoll_ctl(thr->epoll_fd, EPOLL_CTL_ADD, thr->wakeup[0], &ev) == -1)
+		return -1;
+
+	ev.events = EPOLLIN;
+	ev.data.ptr = SHARED_MARKER;
+	if (epoll_ctl(thr->epoll_fd, EPOLL_CTL_ADD, epoll_fd, &ev) == -1)
+		return -1;
+
+	return 0;
+}
+
+/**
+ * Choose the polling thread that will own a DCB when poll affinity is
+ * enabled. Backend DCB's are assigned to the thread of the client DCB of
+ * the session, so that all events of a session are processed by the same
+ * thread. Client DCB's are distributed round robin over the threads.
+ * Listeners are not owned by any thread and use the shared queue.
+ *
+ * @param dcb	The DCB that is being added to the poll set
+ * @return	The owning thread id or -1 for the shared queue
+ */
+static int
+poll_select_owner(DCB *dcb)
+{
+SESSION	*session = dcb->session;
+
+	if (dcb->dcb_role != DCB_ROLE_REQUEST_HANDLER)
+		return -1;
+	if (session && session->client && session->client != dcb &&
+		session->client->evq.owner >= 0)
+	{
+		return session->client->evq.owner;
+	}
+	return (atomic_add(&next_owner, 1) & INT_MAX) % n_threads;
+}
+
+/**
+ * Return the epoll set a DCB belongs to
+ *
+ * @param dcb	The DCB
+ * @return	The epoll file descriptor
+ */
+static int
+poll_dcb_epoll_fd(DCB *dcb)
+{
+	if (poll_threads && dcb->evq.owner >= 0)
+		return poll_threads[dcb->evq.owner].epoll_fd;
+	return epoll_fd;
+}
+
+/**
+ * Return the event queue of a DCB
+ *
+ * @param dcb	The DCB
+ * @return	The queue the events of the DCB are placed in
+ */
+static POLL_QUEUE *
+poll_dcb_queue(DCB *dcb)
+{
+	if (poll_threads && dcb->evq.owner >= 0)
+		return &poll_threads[dcb->evq.owner].queue;
+	return &sharedq;
+}
+
 /**
  * Add a DCB to the set of descriptors within the polling
  * environment.
@@ -274,7 +460,15 @@ poll_add_dcb(DCB *dcb)
          * is not polling anymore.
          */
         if (dcb_set_state(dcb, new_state, &old_state)) {
-                rc = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, dcb->fd, &ev);
+                /*<
+                 * With poll affinity the DCB is bound to a thread the first
+                 * time it is added and it keeps that thread until it is freed.
+                 */
+                if (poll_threads && dcb->evq.owner < 0 && !DCB_POLL_BUSY(dcb))
+                {
+                        dcb->evq.owner = poll_select_owner(dcb);
+                }
+                rc = epoll_ctl(poll_dcb_epoll_fd(dcb), EPOLL_CTL_ADD, dcb->fd, &ev);
 
                 if (rc != 0) {
                         int eno = errno;
@@ -289,6 +483,10 @@ poll_add_dcb(DCB *dcb)
                                 eno,
                                 strerror(eno))));
                 } else {
+                        if (poll_threads && dcb->evq.owner >= 0)
+                        {
+                                atomic_add(&poll_threads[dcb->evq.owner].n_dcbs, 1);
+                        }
                         LOGIF(LD, (skygw_log_write(
                                 LOGFILE_DEBUG,
                                 "%lu [poll_add_dcb] Added dcb %p in state %s to "
@@ -350,7 +548,8 @@ poll_remove_dcb(DCB *dcb)
 		 */		 
 		if (dcb->fd > 0) 
 		{
-			rc = epoll_ctl(epoll_fd, EPOLL_CTL_DEL, dcb->fd, &ev);
+			rc = epoll_ctl(poll_dcb_epoll_fd(dcb), EPOLL_CTL_DEL,
+					dcb->fd, &ev);
 
 			if (rc != 0) {
 				int eno = errno;
@@ -361,6 +560,10 @@ poll_remove_dcb(DCB *dcb)
 					eno,
 					strerror(eno))));
 			}
+			else if (poll_threads && dcb->evq.owner >= 0)
+			{
+				atomic_add(&poll_threads[dcb->evq.owner].n_dcbs, -1);
+			}
 			ss_dassert(rc == 0); /*< trap in debug */
 		}
         }
@@ -372,9 +575,6 @@ poll_remove_dcb(DCB *dcb)
                 rc = 0;
                 goto return_rc;
         }
-        
-        /*< Set bit for each maxscale thread */
-        bitmask_copy(&dcb->memdata.bitmask, poll_bitmask()); 
         rc = 0;
 return_rc:
         return rc;
@@ -439,13 +639,22 @@ void
 poll_waitevents(void *arg)
 {
 struct epoll_event events[MAX_EVENTS];
-int		   i, nfds, timeout_bias = 1;
+int		   nfds, timeout_bias = 1;
+long		   timeout;
 intptr_t	   thread_id = (intptr_t)arg;
 DCB                *zombies = NULL;
 int		   poll_spins = 0;
+int		   efd = epoll_fd;
+
+	current_thread = thread_id;
+	if (poll_threads)
+	{
+		efd = poll_threads[thread_id].epoll_fd;
+	}
 
 	/** Add this thread to the bitmask of running polling threads */
 	bitmask_set(&poll_mask, thread_id);
+	dcb_zombies_thread_start(thread_id);
 	if (thread_data)
 	{
 		thread_data[thread_id].state = THREAD_IDLE;
@@ -456,14 +665,14 @@ int		   poll_spins = 0;
 	
 	while (1)
 	{
-		if (pollStats.evq_pending == 0 && timeout_bias < 10)
+		if (poll_pending(thread_id) == 0 && timeout_bias < 10)
 		{
 			timeout_bias++;
 		}
 
 		atomic_add(&n_waiting, 1);
 #if BLOCKINGPOLL
-		nfds = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+		nfds = epoll_wait(efd, events, MAX_EVENTS, -1);
 		atomic_add(&n_waiting, -1);
 #else /* BLOCKINGPOLL */
 #if MUTEX_EPOLL
@@ -475,7 +684,7 @@ int		   poll_spins = 0;
 		}
                 
 		atomic_add(&pollStats.n_polls, 1);
-		if ((nfds = epoll_wait(epoll_fd, events, MAX_EVENTS, 0)) == -1)
+		if ((nfds = epoll_wait(efd, events, MAX_EVENTS, 0)) == -1)
 		{
 			atomic_add(&n_waiting, -1);
                         int eno = errno;
@@ -497,14 +706,18 @@ int		   poll_spins = 0;
 		 * We calculate a timeout bias to alter the length of the blocking
 		 * call based on the time since we last received an event to process
 		 */
-		else if (nfds == 0 && pollStats.evq_pending == 0 && poll_spins++ > number_poll_spins)
+		else if (nfds == 0 && poll_pending(thread_id) == 0 && poll_spins++ > number_poll_spins)
 		{
 			atomic_add(&pollStats.blockingpolls, 1);
-			nfds = epoll_wait(epoll_fd,
+			/* Do not sleep past the next timer */
+			timeout = timer_next();
+			if (timeout < 0 || timeout > (max_poll_sleep * timeout_bias) / 10)
+				timeout = (max_poll_sleep * timeout_bias) / 10;
+			nfds = epoll_wait(efd,
                                                   events,
                                                   MAX_EVENTS,
-                                                  (max_poll_sleep * timeout_bias) / 10);
-			if (nfds == 0 && pollStats.evq_pending)
+                                                  timeout);
+			if (nfds == 0 && poll_pending(thread_id))
 			{
 				atomic_add(&pollStats.wake_evqpending, 1);
 				poll_spins = 0;
@@ -548,57 +761,7 @@ int		   poll_spins = 0;
 			atomic_add(&load_samples, 1);
 			atomic_add(&load_nfds, nfds);
 
-			/*
-			 * Process every DCB that has a new event and add
-			 * it to the poll queue.
-			 * If the DCB is currently being processed then we
-			 * or in the new eent bits to the pending event bits
-			 * and leave it in the queue.
-			 * If the DCB was not already in the queue then it was
-			 * idle and is added to the queue to process after
-			 * setting the event bits.
-			 */
-			for (i = 0; i < nfds; i++)
-			{
-				DCB 	*dcb = (DCB *)events[i].data.ptr;
-				__uint32_t	ev = events[i].events;
-
-				spinlock_acquire(&pollqlock);
-				if (DCB_POLL_BUSY(dcb))
-				{
-					if (dcb->evq.pending_events == 0)
-					{
-						pollStats.evq_pending++;
-						dcb->evq.inserted = hkheartbeat;
-					}
-					dcb->evq.pending_events |= ev;
-				}
-				else
-				{
-					dcb->evq.pending_events = ev;
-					if (eventq)
-					{
-						dcb->evq.prev = eventq->evq.prev;
-						eventq->evq.prev->evq.next = dcb;
-						eventq->evq.prev = dcb;
-						dcb->evq.next = eventq;
-					}
-					else
-					{
-						eventq = dcb;
-						dcb->evq.prev = dcb;
-						dcb->evq.next = dcb;
-					}
-					pollStats.evq_length++;
-					pollStats.evq_pending++;
-					dcb->evq.inserted = hkheartbeat;
-					if (pollStats.evq_length > pollStats.evq_max)
-					{
-						pollStats.evq_max = pollStats.evq_length;
-					}
-				}
-				spinlock_release(&pollqlock);
-			}
+			poll_queue_events(events, nfds);
 		}
 
 		/*
@@ -610,6 +773,13 @@ int		   poll_spins = 0;
 		if (process_pollq(thread_id))
 			timeout_bias = 1;
 
+		/*
+		 * Run the expired timers before the zombies are processed,
+		 * the DCBs they use can not be freed before this thread has
+		 * passed the end of the loop.
+		 */
+		timer_process();
+
 		if (thread_data)
 			thread_data[thread_id].state = THREAD_ZPROCESSING;
 		zombies = dcb_process_zombies(thread_id);
@@ -627,6 +797,7 @@ int		   poll_spins = 0;
 				thread_data[thread_id].state = THREAD_STOPPED;
 			}
 			bitmask_clear(&poll_mask, thread_id);
+			dcb_zombies_thread_stop(thread_id);
 			/** Release mysql thread context */
 			mysql_thread_end();
 			return;
@@ -638,6 +809,229 @@ int		   poll_spins = 0;
 	} /*< while(1) */
 }
 
+/**
+ * Add the events returned by epoll_wait to the event queues.
+ *
+ * Process every DCB that has a new event and add it to the poll queue.
+ * If the DCB is currently being processed then we or in the new eent bits
+ * to the pending event bits and leave it in the queue.
+ * If the DCB was not already in the queue then it was idle and is added to
+ * the queue to process after setting the event bits.
+ *
+ * With poll affinity the epoll set of a thread also returns the wakeup pipe,
+ * which is simply drained, and the shared epoll set, the events of which
+ * are collected with a non-blocking epoll_wait and added to the shared queue.
+ *
+ * @param events	The events returned by epoll_wait
+ * @param nfds		The number of events
+ */
+static void
+poll_queue_events(struct epoll_event *events, int nfds)
+{
+int	i;
+
+	for (i = 0; i < nfds; i++)
+	{
+		DCB 	*dcb = (DCB *)events[i].data.ptr;
+		__uint32_t	ev = events[i].events;
+
+		if (dcb == WAKEUP_MARKER)
+		{
+			char	buf[64];
+
+			while (read(poll_threads[current_thread].wakeup[0],
+					buf, sizeof(buf)) > 0)
+				;
+		}
+		else if (dcb == SHARED_MARKER)
+		{
+			struct epoll_event	shared[MAX_EVENTS];
+			int			n;
+
+			if ((n = epoll_wait(epoll_fd, shared, MAX_EVENTS, 0)) > 0)
+			{
+				poll_queue_events(shared, n);
+			}
+		}
+		else
+		{
+			poll_queue_dcb(poll_dcb_queue(dcb), dcb, ev);
+		}
+	}
+}
+
+/**
+ * Add events for a DCB to an event queue. If the DCB is already in the queue
+ * the events are added to the pending events of the DCB, otherwise the DCB
+ * is added to the end of the queue.
+ *
+ * @param queue	The event queue of the DCB
+ * @param dcb	The DCB
+ * @param ev	The events to add
+ * @return	1 if the queue had no pending events before, 0 otherwise
+ */
+static int
+poll_queue_dcb(POLL_QUEUE *queue, DCB *dcb, __uint32_t ev)
+{
+int	was_idle;
+
+	spinlock_acquire(&queue->lock);
+	was_idle = poll_queue_dcb_nolock(queue, dcb, ev);
+	spinlock_release(&queue->lock);
+
+	return was_idle;
+}
+
+/**
+ * Add events for a DCB to an event queue, the caller must hold the queue
+ * spinlock.
+ *
+ * @param queue	The event queue of the DCB
+ * @param dcb	The DCB
+ * @param ev	The events to add
+ * @return	1 if the queue had no pending events before, 0 otherwise
+ */
+static int
+poll_queue_dcb_nolock(POLL_QUEUE *queue, DCB *dcb, __uint32_t ev)
+{
+int	was_idle = (queue->pending == 0);
+
+	if (DCB_POLL_BUSY(dcb))
+	{
+		if (dcb->evq.pending_events == 0)
+		{
+			queue->pending++;
+			atomic_add(&pollStats.evq_pending, 1);
+			dcb->evq.inserted = hkheartbeat;
+		}
+		dcb->evq.pending_events |= ev;
+	}
+	else
+	{
+		dcb->evq.pending_events = ev;
+		if (queue->head)
+		{
+			dcb->evq.prev = queue->head->evq.prev;
+			queue->head->evq.prev->evq.next = dcb;
+			queue->head->evq.prev = dcb;
+			dcb->evq.next = queue->head;
+		}
+		else
+		{
+			queue->head = dcb;
+			dcb->evq.prev = dcb;
+			dcb->evq.next = dcb;
+		}
+		queue->pending++;
+		atomic_add(&pollStats.evq_length, 1);
+		atomic_add(&pollStats.evq_pending, 1);
+		dcb->evq.inserted = hkheartbeat;
+		if (pollStats.evq_length > pollStats.evq_max)
+		{
+			pollStats.evq_max = pollStats.evq_length;
+		}
+	}
+	return was_idle;
+}
+
+/**
+ * Hand an event over to the thread that owns the DCB. If the event was
+ * queued by another thread into an idle queue the owner may be blocked in
+ * epoll_wait, it is woken up by writing to its wakeup pipe. A queue that
+ * already had pending events is processed before the owner blocks again.
+ *
+ * @param dcb	The DCB that had an event added to its queue
+ */
+static void
+poll_wakeup(DCB *dcb)
+{
+int	owner = dcb->evq.owner;
+
+	if (poll_threads && owner >= 0 && owner != current_thread)
+	{
+		atomic_add(&poll_threads[owner].n_wakeups, 1);
+		if (write(poll_threads[owner].wakeup[1], "", 1) == -1 &&
+			errno != EAGAIN)
+		{
+			int eno = errno;
+			errno = 0;
+			LOGIF(LE, (skygw_log_write_flush(
+				LOGFILE_ERROR,
+				"Error : Failed to wake up polling thread %d "
+				"due %d, %s.",
+				owner,
+				eno,
+				strerror(eno))));
+		}
+	}
+}
+
+/**
+ * Return the number of DCB's with pending events that a thread may process
+ *
+ * @param thread_id	The thread ID of the calling thread
+ * @return		The number of DCB's with pending events
+ */
+static int
+poll_pending(int thread_id)
+{
+int	i, n;
+
+	if (poll_threads == NULL)
+		return sharedq.pending;
+
+	n = poll_threads[thread_id].queue.pending + sharedq.pending;
+	for (i = 0; n == 0 && i < n_threads; i++)
+	{
+		if (i != thread_id && poll_stealable(i))
+			n++;
+	}
+	return n;
+}
+
+/**
+ * Check whether other threads may steal work from the queue of a thread. This
+ * is the case when the owning thread is busy processing an event and there
+ * are DCB's with pending events waiting in its queue.
+ *
+ * @param victim	The thread ID of the thread to check
+ * @return		Non-zero if work may be stolen from the thread
+ */
+static int
+poll_stealable(int victim)
+{
+	return poll_threads[victim].queue.pending > 0 &&
+		thread_data && thread_data[victim].state == THREAD_PROCESSING;
+}
+
+/**
+ * Steal a DCB from the queue of another thread and process it. The other
+ * threads are tried in turn starting from the next thread, so that the
+ * threads do not all pick the same victim.
+ *
+ * @param thread_id	The thread ID of the calling thread
+ * @return		0 if no DCB's have been processed
+ */
+static int
+poll_steal(int thread_id)
+{
+int	i, victim;
+
+	for (i = 1; i < n_threads; i++)
+	{
+		victim = (thread_id + i) % n_threads;
+		if (poll_stealable(victim) &&
+			poll_process_queue(thread_id, &poll_threads[victim].queue))
+		{
+			atomic_add(&poll_threads[thread_id].n_steals, 1);
+			atomic_add(&poll_threads[victim].n_stolen, 1);
+			atomic_add(&pollStats.n_steals, 1);
+			return 1;
+		}
+	}
+	return 0;
+}
+
 /**
  * Set the number of non-blocking poll cycles that will be done before
  * a blocking poll will take place. Whenever an event arrives on a thread
@@ -666,6 +1060,30 @@ poll_set_maxwait(unsigned int maxwait)
 	max_poll_sleep = maxwait;
 }
 
+/**
+ * Process the next DCB with outstanding events. Without poll affinity all the
+ * threads process the shared queue. With poll affinity a thread processes
+ * the DCB's it owns first and only takes a DCB from the shared queue when
+ * there is nothing to do in its own queue. If the shared queue is also empty
+ * the thread tries to steal work from the other threads.
+ *
+ * @param thread_id	The thread ID of the calling thread
+ * @return 		0 if no DCB's have been processed
+ */
+static int
+process_pollq(int thread_id)
+{
+	if (poll_threads == NULL)
+		return poll_process_queue(thread_id, &sharedq);
+
+	if (poll_process_queue(thread_id, &poll_threads[thread_id].queue) ||
+		poll_process_queue(thread_id, &sharedq))
+	{
+		return 1;
+	}
+	return poll_steal(thread_id);
+}
+
 /**
  * Process of the queue of DCB's that have outstanding events
  *
@@ -686,24 +1104,29 @@ poll_set_maxwait(unsigned int maxwait)
  * time log is written to particular log.
  *
  * @param thread_id	The thread ID of the calling thread
+ * @param queue		The event queue to process
  * @return 		0 if no DCB's have been processed
  */
 static int
-process_pollq(int thread_id)
+poll_process_queue(int thread_id, POLL_QUEUE *queue)
 {
 DCB		*dcb;
 int		found = 0;
 uint32_t	ev;
 unsigned long	qtime;
 
-	spinlock_acquire(&pollqlock);
-	if (eventq == NULL)
+	/* Dirty read to avoid taking the lock of an empty queue */
+	if (queue->head == NULL)
+		return 0;
+
+	spinlock_acquire(&queue->lock);
+	if (queue->head == NULL)
 	{
 		/* Nothing to process */
-		spinlock_release(&pollqlock);
+		spinlock_release(&queue->lock);
 		return 0;
 	}
-	dcb = eventq;
+	dcb = queue->head;
 	if (dcb->evq.next == dcb->evq.prev && dcb->evq.processing == 0)
 	{
 		found = 1;
@@ -712,14 +1135,14 @@ unsigned long	qtime;
 	else if (dcb->evq.next == dcb->evq.prev)
 	{
 		/* Only item in queue is being processed */
-		spinlock_release(&pollqlock);
+		spinlock_release(&queue->lock);
 		return 0;
 	}
 	else
 	{
 		do {
 			dcb = dcb->evq.next;
-		} while (dcb != eventq && dcb->evq.processing == 1);
+		} while (dcb != queue->head && dcb->evq.processing == 1);
 
 		if (dcb->evq.processing == 0)
 		{
@@ -733,10 +1156,11 @@ unsigned long	qtime;
 		ev = dcb->evq.pending_events;
 		dcb->evq.processing_events = ev;
 		dcb->evq.pending_events = 0;
-		pollStats.evq_pending--;
-		ss_dassert(pollStats.evq_pending >= 0);
+		queue->pending--;
+		atomic_add(&pollStats.evq_pending, -1);
+		ss_dassert(queue->pending >= 0);
 	}
-	spinlock_release(&pollqlock);
+	spinlock_release(&queue->lock);
 
 	if (found == 0)
 		return 0;
@@ -984,7 +1408,7 @@ unsigned long	qtime;
 	if (qtime > queueStats.maxexectime)
 		queueStats.maxexectime = qtime;
 
-	spinlock_acquire(&pollqlock);
+	spinlock_acquire(&queue->lock);
 	dcb->evq.processing_events = 0;
 
 	if (dcb->evq.pending_events == 0)
@@ -994,16 +1418,16 @@ unsigned long	qtime;
 		{
 			dcb->evq.prev->evq.next = dcb->evq.next;
 			dcb->evq.next->evq.prev = dcb->evq.prev;
-			if (eventq == dcb)
-				eventq = dcb->evq.next;
+			if (queue->head == dcb)
+				queue->head = dcb->evq.next;
 		}
 		else
 		{
-			eventq = NULL;
+			queue->head = NULL;
 		}
 		dcb->evq.next = NULL;
 		dcb->evq.prev = NULL;
-		pollStats.evq_length--;
+		atomic_add(&pollStats.evq_length, -1);
 	}
 	else
 	{
@@ -1012,19 +1436,19 @@ unsigned long	qtime;
 		 * if there are any other DCB's in the queue.
 		 *
 		 * If we are the first item on the queue this is easy, we
-		 * just bump the eventq pointer.
+		 * just bump the queue head pointer.
 		 */
 		if (dcb->evq.prev != dcb)
 		{
-			if (eventq == dcb)
-				eventq = dcb->evq.next;
+			if (queue->head == dcb)
+				queue->head = dcb->evq.next;
 			else
 			{
 				dcb->evq.prev->evq.next = dcb->evq.next;
 				dcb->evq.next->evq.prev = dcb->evq.prev;
-				dcb->evq.prev = eventq->evq.prev;
-				dcb->evq.next = eventq;
-				eventq->evq.prev = dcb;
+				dcb->evq.prev = queue->head->evq.prev;
+				dcb->evq.next = queue->head;
+				queue->head->evq.prev = dcb;
 				dcb->evq.prev->evq.next = dcb;
 			}
 		}
@@ -1032,7 +1456,7 @@ unsigned long	qtime;
 	dcb->evq.processing = 0;
 	/** Reset session id from thread's local storage */
 	LOGIF(LT, tls_log_info.li_sesid = 0);
-	spinlock_release(&pollqlock);
+	spinlock_release(&queue->lock);
 
 	return 1;
 }
@@ -1110,6 +1534,11 @@ int	i;
 							pollStats.evq_pending);
 	dcb_printf(dcb, "No. of wakeups with pending queue:		%d\n",
 							pollStats.wake_evqpending);
+	if (poll_threads)
+	{
+		dcb_printf(dcb, "No. of events stolen by idle threads:		%d\n",
+							pollStats.n_steals);
+	}
 
 	dcb_printf(dcb, "No of poll completions with descriptors\n");
 	dcb_printf(dcb, "\tNo. of descriptors\tNo. of poll completions.\n");
@@ -1122,7 +1551,7 @@ int	i;
 
 #if SPINLOCK_PROFILE
 	dcb_printf(dcb, "Event queue lock statistics:\n");
-	spinlock_stats(&pollqlock, spin_reporter, dcb);
+	spinlock_stats(&sharedq.lock, spin_reporter, dcb);
 #endif
 }
 
@@ -1293,6 +1722,21 @@ double	qavg1 = 0.0, qavg5 = 0.0, qavg15 = 0.0;
 			}
 		}
 	}
+
+	if (poll_threads == NULL)
+		return;
+	dcb_printf(dcb, "\nPoll affinity enabled.\n\n");
+	dcb_printf(dcb, " ID | # DCBs | Pending  | Wakeups    | Steals     | Stolen\n");
+	dcb_printf(dcb, "----+--------+----------+------------+------------+-----------\n");
+	for (i = 0; i < n_threads; i++)
+	{
+		dcb_printf(dcb, " %2d | %6d | %8d | %10d | %10d | %d\n", i,
+				poll_threads[i].n_dcbs,
+				poll_threads[i].queue.pending,
+				poll_threads[i].n_wakeups,
+				poll_threads[i].n_steals,
+				poll_threads[i].n_stolen);
+	}
 }
 
 /**
@@ -1354,44 +1798,12 @@ static void poll_add_event_to_dcb(
 	spinlock_acquire(&dcb->authlock);
 	dcb->dcb_readqueue = gwbuf_append(dcb->dcb_readqueue, buf);
 	spinlock_release(&dcb->authlock);
-		
-	spinlock_acquire(&pollqlock);
-	
-	/** Set event to DCB */
-	if (DCB_POLL_BUSY(dcb))
-	{
-		if (dcb->evq.pending_events == 0)
-		{
-			pollStats.evq_pending++;
-		}
-		dcb->evq.pending_events |= ev;
-	}
-	else
+
+	/** Set event to DCB and add it to its event queue */
+	if (poll_queue_dcb(poll_dcb_queue(dcb), dcb, ev))
 	{
-		dcb->evq.pending_events = ev;
-		/** Add DCB to eventqueue if it isn't already there */
-		if (eventq)
-		{
-			dcb->evq.prev = eventq->evq.prev;
-			eventq->evq.prev->evq.next = dcb;
-			eventq->evq.prev = dcb;
-			dcb->evq.next = eventq;
-		}
-		else
-		{
-			eventq = dcb;
-			dcb->evq.prev = dcb;
-			dcb->evq.next = dcb;
-		}
-		pollStats.evq_length++;
-		pollStats.evq_pending++;
-		
-		if (pollStats.evq_length > pollStats.evq_max)
-		{
-			pollStats.evq_max = pollStats.evq_length;
-		}
+		poll_wakeup(dcb);
 	}
-	spinlock_release(&pollqlock);
 }
 
 /*
@@ -1410,9 +1822,11 @@ static void poll_add_event_to_dcb(
 void
 poll_fake_write_event(DCB *dcb)
 {
-uint32_t ev = EPOLLOUT;
+uint32_t	ev = EPOLLOUT;
+POLL_QUEUE	*queue = poll_dcb_queue(dcb);
+int		was_idle;
 
-	spinlock_acquire(&pollqlock);
+	spinlock_acquire(&queue->lock);
 	/*
 	 * If the DCB is already on the queue, there are no pending events and
 	 * there are other events on the queue, then
@@ -1422,67 +1836,63 @@ uint32_t ev = EPOLLOUT;
 	{
 		dcb->evq.prev->evq.next = dcb->evq.next;
 		dcb->evq.next->evq.prev = dcb->evq.prev;
-		if (eventq == dcb)
-			eventq = dcb->evq.next;
+		if (queue->head == dcb)
+			queue->head = dcb->evq.next;
 		dcb->evq.next = NULL;
 		dcb->evq.prev = NULL;
-		pollStats.evq_length--;
+		atomic_add(&pollStats.evq_length, -1);
 	}
+	was_idle = poll_queue_dcb_nolock(queue, dcb, ev);
+	spinlock_release(&queue->lock);
 
-	if (DCB_POLL_BUSY(dcb))
+	if (was_idle)
 	{
-		if (dcb->evq.pending_events == 0)
-			pollStats.evq_pending++;
-		dcb->evq.pending_events |= ev;
+		poll_wakeup(dcb);
 	}
-	else
+}
+
+/**
+ * Print the event queue contents
+ *
+ * @param pdcb		The DCB to print the event queue to
+ */
+void
+dShowEventQ(DCB *pdcb)
+{
+int		i;
+
+	dcb_printf(pdcb, "\nEvent Queue.\n");
+	poll_show_queue(pdcb, &sharedq);
+	if (poll_threads)
 	{
-		dcb->evq.pending_events = ev;
-		dcb->evq.inserted = hkheartbeat;
-		if (eventq)
-		{
-			dcb->evq.prev = eventq->evq.prev;
-			eventq->evq.prev->evq.next = dcb;
-			eventq->evq.prev = dcb;
-			dcb->evq.next = eventq;
-		}
-		else
-		{
-			eventq = dcb;
-			dcb->evq.prev = dcb;
-			dcb->evq.next = dcb;
-		}
-		pollStats.evq_length++;
-		pollStats.evq_pending++;
-		dcb->evq.inserted = hkheartbeat;
-		if (pollStats.evq_length > pollStats.evq_max)
+		for (i = 0; i < n_threads; i++)
 		{
-			pollStats.evq_max = pollStats.evq_length;
+			dcb_printf(pdcb, "\nEvent Queue of thread %d.\n", i);
+			poll_show_queue(pdcb, &poll_threads[i].queue);
 		}
 	}
-	spinlock_release(&pollqlock);
 }
 
 /**
- * Print the event queue contents
+ * Print the contents of an event queue
  *
  * @param pdcb		The DCB to print the event queue to
+ * @param queue		The event queue to print
  */
-void
-dShowEventQ(DCB *pdcb)
+static void
+poll_show_queue(DCB *pdcb, POLL_QUEUE *queue)
 {
 DCB		*dcb;
 char		*tmp1, *tmp2;
 
-	spinlock_acquire(&pollqlock);
-	if (eventq == NULL)
+	spinlock_acquire(&queue->lock);
+	if (queue->head == NULL)
 	{
 		/* Nothing to process */
-		spinlock_release(&pollqlock);
+		spinlock_release(&queue->lock);
 		return;
 	}
-	dcb = eventq;
-	dcb_printf(pdcb, "\nEvent Queue.\n");
+	dcb = queue->head;
 	dcb_printf(pdcb, "%-16s | %-10s | %-18s | %s\n", "DCB", "Status", "Processing Events",
 				"Pending Events");
 	dcb_printf(pdcb, "-----------------+------------+--------------------+-------------------\n");
@@ -1494,11 +1904,10 @@ char		*tmp1, *tmp2;
 		free(tmp1);
 		free(tmp2);
 		dcb = dcb->evq.next;
-	} while (dcb != eventq);
-	spinlock_release(&pollqlock);
+	} while (dcb != queue->head);
+	spinlock_release(&queue->lock);
 }
 
-
 /**
  * Print the event queue statistics
  *
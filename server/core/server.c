@@ -39,6 +39,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <session.h>
 #include <server.h>
 #include <spinlock.h>
@@ -79,6 +80,10 @@ SERVER 	*server;
 	server->rlag = -2;
 	server->master_id = -1;
 	server->depth = -1;
+	server->persistent = NULL;
+	server->persistpoolmax = 0;
+	server->persistmaxtime = 0;
+	spinlock_init(&server->persistlock);
 
 	spinlock_acquire(&server_spin);
 	server->next = allServers;
@@ -118,6 +123,9 @@ SERVER *ptr;
 	}
 	spinlock_release(&server_spin);
 
+	/* Close the connections in the persistent pool */
+	dcb_persistent_clean_count(server, true);
+
 	/* Clean up session and free the memory */
 	free(server->name);
 	free(server->protocol);
@@ -289,6 +297,9 @@ char	*stat;
 							ptr->stats.n_current);
                 dcb_printf(dcb, "\tCurrent no. of operations:	%d\n",
 						ptr->stats.n_current_ops);
+		if (ptr->stats.avg_response > 0)
+			dcb_printf(dcb, "\tAverage response time:		%d us\n",
+						ptr->stats.avg_response);
                 ptr = ptr->next;
 	}
 	spinlock_release(&server_spin);
@@ -362,8 +373,10 @@ int	el = 1;
 						ptr->stats.n_connections);
 		dcb_printf(dcb, "    \"currentConnections\": \"%d\",\n",
 							ptr->stats.n_current);
-                dcb_printf(dcb, "    \"currentOps\": \"%d\"\n",
+                dcb_printf(dcb, "    \"currentOps\": \"%d\",\n",
 						ptr->stats.n_current_ops);
+		dcb_printf(dcb, "    \"avgResponseTime\": \"%d\"\n",
+						ptr->stats.avg_response);
 		if (el < len) {
 			dcb_printf(dcb, "  },\n");
 		}
@@ -440,6 +453,22 @@ SERVER_PARAM	*param;
 	dcb_printf(dcb, "\tCurrent no. of conns:		%d\n",
 						server->stats.n_current);
         dcb_printf(dcb, "\tCurrent no. of operations:	%d\n", server->stats.n_current_ops);
+	if (server->stats.avg_response > 0)
+		dcb_printf(dcb, "\tAverage response time:		%d us\n",
+						server->stats.avg_response);
+	if (server->persistpoolmax)
+	{
+		dcb_printf(dcb, "\tPersistent pool size:		%d\n",
+						server->stats.n_persistent);
+		dcb_printf(dcb, "\tPersistent pool hits:		%d\n",
+						server->stats.n_pool_hits);
+		dcb_printf(dcb, "\tPersistent pool misses:		%d\n",
+						server->stats.n_pool_misses);
+		dcb_printf(dcb, "\tPersistent pool max size:	%ld\n",
+						server->persistpoolmax);
+		dcb_printf(dcb, "\tPersistent conn max age:	%ld\n",
+						server->persistmaxtime);
+	}
 }
 
 /**
@@ -701,6 +730,8 @@ SERVER		*ptr;
 	stat = server_status(ptr);
 	resultset_row_set(row, 4, stat);
 	free(stat);
+	sprintf(buf, "%d", ptr->stats.avg_response);
+	resultset_row_set(row, 5, buf);
 	spinlock_release(&server_spin);
 	return row;
 }
@@ -729,6 +760,7 @@ int		*data;
 	resultset_add_column(set, "Port", 5, COL_TYPE_VARCHAR);
 	resultset_add_column(set, "Connections", 8, COL_TYPE_VARCHAR);
 	resultset_add_column(set, "Status", 20, COL_TYPE_VARCHAR);
+	resultset_add_column(set, "Response Time", 13, COL_TYPE_VARCHAR);
 
 	return set;
 }
@@ -770,3 +802,24 @@ server_update_port(SERVER *server, unsigned short port)
 	spinlock_release(&server_spin);
 }
 
+/**
+ * Add the response time of a query to the moving average of the server.
+ * The first sample starts the average, after that each sample moves it by
+ * 1 / 2^SERVER_RESPONSE_SHIFT of the difference. Concurrent updates are not
+ * serialised, one of them may be lost which is harmless for an average.
+ *
+ * @param server	The server that responded
+ * @param usec		The response time in microseconds
+ */
+void
+server_add_response_time(SERVER *server, unsigned long usec)
+{
+int	avg = server->stats.avg_response;
+int	sample = usec > INT_MAX ? INT_MAX : (usec > 0 ? (int)usec : 1);
+
+	if (avg == 0)
+		avg = sample;
+	else
+		avg += (sample - avg) / (1 << SERVER_RESPONSE_SHIFT);
+	server->stats.avg_response = avg > 0 ? avg : 1;
+}
@@ -256,8 +256,7 @@ GWPROTOCOL	*funcs;
 				}
 				if (loaded == -1)
 				{
-					hashtable_free(service->users->data);
-					free(service->users);
+					users_free(service->users);
 					dcb_free(port->listener);
 					port->listener = NULL;
 					goto retblock;
@@ -341,11 +340,7 @@ GWPROTOCOL	*funcs;
 	if ((funcs=(GWPROTOCOL *)load_module(port->protocol, MODULE_PROTOCOL)) 
 		== NULL)
 	{
-		if (service->users->data)
-		{
-			hashtable_free(service->users->data);
-		}
-		free(service->users);
+		users_free(service->users);
 		dcb_free(port->listener);
 		port->listener = NULL;
 		LOGIF(LE, (skygw_log_write_flush(
@@ -380,11 +375,7 @@ GWPROTOCOL	*funcs;
 				"Error : Failed to create session to service %s.",
 				service->name)));
 			
-			if (service->users->data)
-			{
-				hashtable_free(service->users->data);
-			}
-			free(service->users);
+			users_free(service->users);
                         dcb_close(port->listener);
 			port->listener = NULL;
 			goto retblock;
@@ -398,11 +389,7 @@ GWPROTOCOL	*funcs;
 			port->port,
                         port->protocol,
                         service->name)));
-		if (service->users->data)
-		{
-			hashtable_free(service->users->data);
-		}
-		free(service->users);
+		users_free(service->users);
 		dcb_close(port->listener);
 		port->listener = NULL;
         }
@@ -461,12 +448,6 @@ if(service->ssl_mode != SSL_DISABLED)
 		service->stats.started = time(0);
 	}
 
-	/** Add the task that monitors session timeouts */
-	if(service->conn_timeout > 0)
-	{
-	    hktask_add("connection_timeout",session_close_timeouts,NULL,5);
-	}
-
 	return listeners;
 }
 
@@ -43,6 +43,7 @@
 #include <skygw_utils.h>
 #include <log_manager.h>
 #include <housekeeper.h>
+#include <timer.h>
 
 /** Defined in log_manager.cc */
 extern int            lm_enabled_logfiles_bitmask;
@@ -57,6 +58,7 @@ static SESSION	*allSessions = NULL;
 
 
 static int session_setup_filters(SESSION *session);
+static void session_timeout(TIMER *timer, void *data);
 
 /**
  * Allocate a new session for a new client of the specified service.
@@ -236,7 +238,10 @@ session_alloc(SERVICE *service, DCB *client_dcb)
 		spinlock_acquire(&session_spin);
 		/** Assign a session id and increase */
 		session->ses_id = ++session_id; 
+		session->prev = NULL;
 		session->next = allSessions;
+		if (allSessions)
+			allSessions->prev = session;
                 allSessions = session;
                 spinlock_release(&session_spin);
                 
@@ -261,6 +266,13 @@ session_alloc(SERVICE *service, DCB *client_dcb)
 		atomic_add(&service->stats.n_sessions, 1);
                 atomic_add(&service->stats.n_current, 1);
                 CHK_SESSION(session);
+
+		if (service->conn_timeout > 0 &&
+			client_dcb->dcb_role == DCB_ROLE_REQUEST_HANDLER)
+		{
+			timer_init(&client_dcb->timer, session_timeout, client_dcb);
+			timer_add(&client_dcb->timer, service->conn_timeout * 1000);
+		}
         }        
 return_session:
 	return session;
@@ -369,7 +381,6 @@ bool session_free(
         SESSION *session)
 {
         bool    succp = false;
-        SESSION *ptr;
         int     nlink;
 	int	i;
 
@@ -385,21 +396,20 @@ bool session_free(
                 goto return_succp;
         }
         
-	/* First of all remove from the linked list */
+	/**
+	 * First of all remove from the linked list. A session that failed
+	 * in session_alloc was never linked and must not touch the list.
+	 */
 	spinlock_acquire(&session_spin);
-	if (allSessions == session)
-	{
-		allSessions = session->next;
-	}
-	else
+	if (allSessions == session || session->prev != NULL)
 	{
-		ptr = allSessions;
-		while (ptr && ptr->next != session)
-		{
-			ptr = ptr->next;
-		}
-		if (ptr)
-			ptr->next = session->next;
+		if (session->prev)
+			session->prev->next = session->next;
+		else
+			allSessions = session->next;
+		if (session->next)
+			session->next->prev = session->prev;
+		session->next = session->prev = NULL;
 	}
 	spinlock_release(&session_spin);
 	atomic_add(&session->service->stats.n_current, -1);
@@ -941,35 +951,39 @@ SESSION *get_all_sessions()
 }
 
 /**
- * Close sessions that have been idle for too long.
- * 
- * If the time since a session last sent data is grater than the set value in the
- * service, it is disconnected. The default value for the timeout for a service is 0.
- * This means that connections are never timed out.
- * @param data NULL, this is only here to satisfy the housekeeper function requirements.
+ * Close a session that has been idle for too long.
+ *
+ * Called when the timer of the client DCB expires, which is armed with the
+ * timeout of the service when the session is created. Reads do not touch
+ * the timer, they only record the time of the read, so the timer is armed
+ * again for the rest of the timeout if the client has sent data since.
+ * Only the sessions whose timeout expires are ever visited.
+ *
+ * @param timer	The timer of the client DCB
+ * @param data	The client DCB
  */
-void session_close_timeouts(void* data)
+static void
+session_timeout(TIMER *timer, void *data)
 {
-    SESSION* ses;
-    
-    spinlock_acquire(&session_spin);
-    ses = get_all_sessions();
-    spinlock_release(&session_spin);
-    
-    while(ses)
-    {
-	if(ses->client && ses->client->state == DCB_STATE_POLLING &&
-	 ses->service->conn_timeout > 0 && 
-	 hkheartbeat - ses->client->last_read > ses->service->conn_timeout * 10)
+DCB		*dcb = (DCB *)data;
+SESSION		*ses = dcb->session;
+unsigned long	idle, timeout;
+
+	if (ses == NULL || dcb->state != DCB_STATE_POLLING ||
+		ses->service->conn_timeout <= 0)
 	{
-	    ses->client->func.hangup(ses->client);
+		return;
+	}
+	timeout = ses->service->conn_timeout * 1000;
+	idle = (hkheartbeat - dcb->last_read) * 100;
+	if (idle > timeout)
+	{
+		dcb->func.hangup(dcb);
+	}
+	else
+	{
+		timer_add(timer, timeout - idle + 100);
 	}
-	
-	spinlock_acquire(&session_spin);
-	ses = ses->next;
-	spinlock_release(&session_spin);
-	
-    }
 }
 
 /**
@@ -0,0 +1,218 @@
+/*
+ * This file is distributed as part of MaxScale.  It is free
+ * software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation,
+ * version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright MariaDB Corporation Ab 2015
+ */
+
+/**
+ * @file benchbuffer.c - Micro-benchmark of the buffer allocation
+ *
+ * Compares the pooled gwbuf_alloc/gwbuf_clone/gwbuf_free with the previous
+ * scheme of three separate malloc calls per buffer and a calloc per clone.
+ * Both a single thread workload and a workload where buffers are freed by
+ * a different thread than the one that allocated them are measured.
+ *
+ * Usage: bench_buffer [iterations] [size]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <sched.h>
+
+#include <buffer.h>
+#include <atomic.h>
+
+#define	BATCH	64
+
+/**
+ * The buffer allocation as it was done before the buffer pools
+ */
+static GWBUF *
+old_alloc(unsigned int size)
+{
+GWBUF		*rval;
+SHARED_BUF	*sbuf;
+
+	rval = (GWBUF *)malloc(sizeof(GWBUF));
+	sbuf = (SHARED_BUF *)malloc(sizeof(SHARED_BUF));
+	sbuf->data = (unsigned char *)malloc(size);
+	spinlock_init(&rval->gwbuf_lock);
+	rval->start = sbuf->data;
+	rval->end = (void *)((char *)rval->start + size);
+	sbuf->refcount = 1;
+	rval->sbuf = sbuf;
+	rval->next = NULL;
+	rval->tail = rval;
+	rval->hint = NULL;
+	rval->properties = NULL;
+	rval->gwbuf_type = GWBUF_TYPE_UNDEFINED;
+	rval->gwbuf_info = GWBUF_INFO_NONE;
+	rval->gwbuf_bufobj = NULL;
+	return rval;
+}
+
+static GWBUF *
+old_clone(GWBUF *buf)
+{
+GWBUF	*rval = (GWBUF *)calloc(1, sizeof(GWBUF));
+
+	atomic_add(&buf->sbuf->refcount, 1);
+	rval->sbuf = buf->sbuf;
+	rval->start = buf->start;
+	rval->end = buf->end;
+	rval->tail = rval;
+	return rval;
+}
+
+static void
+old_free(GWBUF *buf)
+{
+	if (atomic_add(&buf->sbuf->refcount, -1) == 1)
+	{
+		free(buf->sbuf->data);
+		free(buf->sbuf);
+	}
+	free(buf);
+}
+
+typedef struct {
+	GWBUF	*(*alloc)(unsigned int);
+	GWBUF	*(*clone)(GWBUF *);
+	void	(*free)(GWBUF *);
+	char	*name;
+} ALLOCATOR;
+
+static ALLOCATOR allocators[] = {
+	{ old_alloc, old_clone, old_free, "malloc" },
+	{ gwbuf_alloc, gwbuf_clone, gwbuf_free, "pooled" },
+	{ NULL, NULL, NULL, NULL }
+};
+
+static int	iterations = 1000000;
+static int	bufsize = 256;
+
+static double
+now()
+{
+struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Allocate, clone and free buffers in batches on a single thread
+ */
+static double
+bench_local(ALLOCATOR *a)
+{
+GWBUF	*bufs[BATCH], *clones[BATCH];
+double	start = now();
+int	i, j;
+
+	for (i = 0; i < iterations; i += BATCH)
+	{
+		for (j = 0; j < BATCH; j++)
+		{
+			bufs[j] = a->alloc(bufsize + j);
+			clones[j] = a->clone(bufs[j]);
+		}
+		for (j = 0; j < BATCH; j++)
+		{
+			a->free(bufs[j]);
+			a->free(clones[j]);
+		}
+	}
+	return now() - start;
+}
+
+/**
+ * Buffers handed from a producer thread to a consumer thread that frees them
+ */
+static GWBUF		*handoff[BATCH];
+static volatile int	handoff_full = 0;
+
+static void *
+consumer(void *arg)
+{
+ALLOCATOR	*a = (ALLOCATOR *)arg;
+int		i, j;
+
+	for (i = 0; i < iterations; i += BATCH)
+	{
+		while (!handoff_full)
+			sched_yield();
+		for (j = 0; j < BATCH; j++)
+			a->free(handoff[j]);
+		__sync_synchronize();
+		handoff_full = 0;
+	}
+	return NULL;
+}
+
+static double
+bench_remote(ALLOCATOR *a)
+{
+pthread_t	thr;
+double		start = now();
+int		i, j;
+
+	pthread_create(&thr, NULL, consumer, a);
+	for (i = 0; i < iterations; i += BATCH)
+	{
+		while (handoff_full)
+			sched_yield();
+		for (j = 0; j < BATCH; j++)
+			handoff[j] = a->alloc(bufsize + j);
+		__sync_synchronize();
+		handoff_full = 1;
+	}
+	pthread_join(thr, NULL);
+	return now() - start;
+}
+
+int
+main(int argc, char **argv)
+{
+GWBUF_POOL_STATS	stats;
+ALLOCATOR		*a;
+double			t;
+
+	if (argc > 1)
+		iterations = atoi(argv[1]);
+	if (argc > 2)
+		bufsize = atoi(argv[2]);
+
+	printf("%d iterations, buffer size %d bytes\n\n", iterations, bufsize);
+	printf("%-10s %-20s %s\n", "Allocator", "Workload", "ns/buffer");
+	for (a = allocators; a->name; a++)
+	{
+		t = bench_local(a);
+		printf("%-10s %-20s %.1f\n", a->name, "alloc+clone+free",
+						t * 1e9 / iterations);
+		t = bench_remote(a);
+		printf("%-10s %-20s %.1f\n", a->name, "cross-thread free",
+						t * 1e9 / iterations);
+	}
+
+	gwbuf_pool_stats(&stats);
+	printf("\nPool allocations %d, hits %d, misses %d, remote frees %d, "
+		"released %d\n", stats.n_alloc, stats.n_hit, stats.n_miss,
+		stats.n_remote_free, stats.n_released);
+	return 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * This file is distributed as part of MaxScale.  It is free
+ * software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation,
+ * version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright MariaDB Corporation Ab 2015
+ */
+
+/**
+ * @file benchdcbread.c - Micro-benchmark of the DCB read path
+ *
+ * Compares the system calls made and the time taken by dcb_read with the
+ * previous read loop that asked the kernel for the number of available
+ * bytes with ioctl(FIONREAD) before every read. Each round writes a burst
+ * of data to one end of a socket pair and reads it from the other end.
+ *
+ * Usage: bench_dcbread [rounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+#include <dcb.h>
+#include <gw.h>
+
+static int	n_syscalls;
+
+/**
+ * The read loop of dcb_read as it was before the FIONREAD call was removed
+ */
+static int
+old_read(int fd, GWBUF **head)
+{
+GWBUF	*buffer;
+int	b, n, bufsize;
+
+	while (true)
+	{
+		n_syscalls++;
+		if (ioctl(fd, FIONREAD, &b) == -1)
+			return -1;
+		if (b == 0)
+			return 0;
+		bufsize = MIN(b, MAX_BUFFER_SIZE);
+		buffer = gwbuf_alloc(bufsize);
+		n_syscalls++;
+		if ((n = read(fd, GWBUF_DATA(buffer), bufsize)) <= 0)
+		{
+			gwbuf_free(buffer);
+			return n;
+		}
+		*head = gwbuf_append(*head, buffer);
+	}
+}
+
+static void
+free_chain(GWBUF *head)
+{
+	while (head)
+		head = gwbuf_consume(head, GWBUF_LENGTH(head));
+}
+
+static double
+now()
+{
+struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef struct {
+	char	*name;
+	int	size;		/*< Bytes written to the socket per round */
+} WORKLOAD;
+
+static WORKLOAD workloads[] = {
+	{ "query 100B", 100 },
+	{ "query 2KB", 2048 },
+	{ "result 64KB", 65536 },
+	{ "result 150KB", 150000 },
+	{ NULL, 0 }
+};
+
+int
+main(int argc, char **argv)
+{
+WORKLOAD	*w;
+DCB		*dcb;
+GWBUF		*head;
+char		*data;
+int		sv[2];
+int		rounds = 20000, i, old_calls, new_calls;
+double		t, old_time, new_time;
+
+	if (argc > 1)
+		rounds = atoi(argv[1]);
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+	{
+		perror("socketpair");
+		return 1;
+	}
+	i = 256 * 1024;
+	setsockopt(sv[1], SOL_SOCKET, SO_SNDBUF, &i, sizeof(i));
+	setsockopt(sv[0], SOL_SOCKET, SO_RCVBUF, &i, sizeof(i));
+	fcntl(sv[0], F_SETFL, fcntl(sv[0], F_GETFL) | O_NONBLOCK);
+	dcb = dcb_alloc(DCB_ROLE_REQUEST_HANDLER);
+	dcb->fd = sv[0];
+	data = calloc(1, 150000);
+
+	printf("%d rounds\n\n", rounds);
+	printf("%-14s %14s %14s %12s %12s\n", "Workload", "old syscalls",
+		"new syscalls", "old us", "new us");
+	for (w = workloads; w->name; w++)
+	{
+		n_syscalls = 0;
+		old_time = new_time = 0;
+		dcb->stats.n_reads = 0;
+		for (i = 0; i < rounds; i++)
+		{
+			if (write(sv[1], data, w->size) != w->size)
+			{
+				perror("write");
+				return 1;
+			}
+			head = NULL;
+			t = now();
+			old_read(sv[0], &head);
+			old_time += now() - t;
+			free_chain(head);
+
+			if (write(sv[1], data, w->size) != w->size)
+			{
+				perror("write");
+				return 1;
+			}
+			head = NULL;
+			t = now();
+			dcb_read(dcb, &head);
+			new_time += now() - t;
+			free_chain(head);
+		}
+		old_calls = n_syscalls;
+		new_calls = dcb->stats.n_reads;
+		printf("%-14s %14.2f %14.2f %12.2f %12.2f\n", w->name,
+			(double)old_calls / rounds, (double)new_calls / rounds,
+			old_time * 1e6 / rounds, new_time * 1e6 / rounds);
+	}
+
+	dcb->fd = DCBFD_CLOSED;
+	close(sv[0]);
+	close(sv[1]);
+	free(data);
+	return 0;
+}
@@ -269,6 +269,61 @@ int set_and_get_mysql_users_wildcards(char *username, char *hostname, char *pass
 	return ret;
 }
 
+char *match_mysql_user(USERS *mysql_users, char *username, char *from, char *db, int wildcard_hosts) {
+	MYSQL_USER_HOST key;
+
+	memset(&key, 0, sizeof(key));
+	key.user = username;
+	key.netmask = 32;
+	key.resource = db;
+
+	if(!setipaddress(&key.ipv4.sin_addr, from)) {
+		fprintf(stderr, "setipaddress failed for host [%s]\n", from);
+		return NULL;
+	}
+
+	return mysql_users_match(mysql_users, &key, wildcard_hosts);
+}
+
+int check_mysql_users_match() {
+	USERS *mysql_users;
+	char *pwd;
+	int ret = 1;
+
+	mysql_users = mysql_users_alloc();
+
+	add_mysql_users_with_host_ipv4(mysql_users, "pippo", "192.168.1.%", "c", "N", "sales");
+	add_mysql_users_with_host_ipv4(mysql_users, "pippo", "192.168.%.%", "b", "Y", NULL);
+	add_mysql_users_with_host_ipv4(mysql_users, "pippo", "10.0.0.5", "exact", "N", "test%");
+	add_mysql_users_with_host_ipv4(mysql_users, "pippo", "%", "any", "N", NULL);
+	add_mysql_users_with_host_ipv4(mysql_users, "pluto", "%", "pluto", "Y", NULL);
+
+	/* the most specific user@host with a grant for the database wins */
+	if ((pwd = match_mysql_user(mysql_users, "pippo", "192.168.1.7", "sales", 1)) == NULL || strcmp(pwd, "c"))
+		goto done;
+	if ((pwd = match_mysql_user(mysql_users, "pippo", "192.168.1.7", "other", 1)) == NULL || strcmp(pwd, "b"))
+		goto done;
+	if ((pwd = match_mysql_user(mysql_users, "pippo", "10.0.0.5", "TEST_db", 1)) == NULL || strcmp(pwd, "exact"))
+		goto done;
+	if (match_mysql_user(mysql_users, "pippo", "10.0.0.5", "other", 1) != NULL)
+		goto done;
+	if ((pwd = match_mysql_user(mysql_users, "pippo", "10.0.0.6", NULL, 1)) == NULL || strcmp(pwd, "any"))
+		goto done;
+	/* only the client address itself without the wildcard hosts */
+	if (match_mysql_user(mysql_users, "pippo", "10.0.0.6", NULL, 0) != NULL)
+		goto done;
+	if (match_mysql_user(mysql_users, "pluto", "127.0.0.1", "db", 0) != NULL)
+		goto done;
+	if (match_mysql_user(mysql_users, "paperino", "10.0.0.5", NULL, 1) != NULL)
+		goto done;
+
+	ret = 0;
+done:
+	users_free(mysql_users);
+
+	return ret;
+}
+
 int main() {
 	int ret;
 	int i = 0;
@@ -416,6 +471,9 @@ int main() {
 	if (!ret) fprintf(stderr, "\t-- Expecting ok\n");
 	assert(ret == 0);
 
+	ret = check_mysql_users_match();
+	assert(ret == 0);
+
 	fprintf(stderr, "----------------\n");
 	fprintf(stderr, "<<< Test completed\n");
 
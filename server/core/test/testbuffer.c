@@ -30,6 +30,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 
 #include <buffer.h>
 #include <hint.h>
@@ -154,11 +155,79 @@ int     buflen;
 	return 0;
 }
 
+#define	N_TEST2_BUFS	1000
+
+static GWBUF	*test2_bufs[N_TEST2_BUFS];
+
+static void *
+test2_free_thread(void *arg)
+{
+int	i;
+
+	for (i = 0; i < N_TEST2_BUFS; i++)
+		gwbuf_free(test2_bufs[i]);
+	return NULL;
+}
+
+/**
+ * test2	Free buffers on a thread other than the one that allocated them
+ *		and check that they are returned to the pool of the allocator
+ *
+ */
+static int
+test2()
+{
+GWBUF_POOL_STATS	before, after;
+GWBUF			*buffer, *clone;
+pthread_t		thr;
+int			i;
+
+        ss_dfprintf(stderr, "testbuffer : buffers freed by another thread");
+	gwbuf_pool_stats(&before);
+	for (i = 0; i < N_TEST2_BUFS; i++)
+	{
+		test2_bufs[i] = gwbuf_alloc(100 + i);
+		memset(GWBUF_DATA(test2_bufs[i]), i & 0xff, 100 + i);
+	}
+	pthread_create(&thr, NULL, test2_free_thread, NULL);
+	pthread_join(thr, NULL);
+	gwbuf_pool_stats(&after);
+        ss_info_dassert(after.n_remote_free - before.n_remote_free == N_TEST2_BUFS,
+			"All buffers should have been freed to a remote pool");
+
+	/* The freed blocks must now be reused by this thread */
+	gwbuf_pool_stats(&before);
+	for (i = 0; i < N_TEST2_BUFS; i++)
+	{
+		test2_bufs[i] = gwbuf_alloc(100 + i);
+	}
+	gwbuf_pool_stats(&after);
+        ss_info_dassert(after.n_hit - before.n_hit == N_TEST2_BUFS,
+			"All buffers should come from the pool");
+	for (i = 0; i < N_TEST2_BUFS; i++)
+	{
+		gwbuf_free(test2_bufs[i]);
+	}
+
+	/* A clone must keep the data alive after the original is freed */
+	buffer = gwbuf_alloc(50);
+	strcpy(GWBUF_DATA(buffer), "The quick brown fox");
+	clone = gwbuf_clone(buffer);
+	gwbuf_free(buffer);
+        ss_info_dassert(strcmp(GWBUF_DATA(clone), "The quick brown fox") == 0,
+			"Clone must still see the data");
+	gwbuf_free(clone);
+        ss_dfprintf(stderr, "\t..done\n");
+
+	return 0;
+}
+
 int main(int argc, char **argv)
 {
 int	result = 0;
 
 	result += test1();
+	result += test2();
 
 	exit(result);
 }
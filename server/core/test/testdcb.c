@@ -30,8 +30,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
 
 #include <dcb.h>
+#include <server.h>
 
 /**
  * test1	Allocate a dcb and do lots of other things
@@ -75,11 +79,294 @@ int     buflen;
 	return 0;
 }
 
+/**
+ * test2	Write a chain of small buffers, larger than the socket buffer,
+ *		and check that it is written with few system calls and that
+ *		the write queue drains in order.
+ */
+static int
+test2()
+{
+DCB	*dcb;
+GWBUF	*head = NULL, *buf;
+int	sv[2];
+int	nbufs = 2000, bufsize = 100, total, got = 0, n, i, j, rc;
+unsigned char	rbuf[4096];
+
+	ss_dfprintf(stderr, "testdcb : vectored writes of a buffer chain");
+	rc = socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+	ss_info_dassert(rc == 0, "socketpair must succeed");
+	n = 4096;
+	setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &n, sizeof(n));
+	fcntl(sv[0], F_SETFL, fcntl(sv[0], F_GETFL) | O_NONBLOCK);
+
+	dcb = dcb_alloc(DCB_ROLE_REQUEST_HANDLER);
+	dcb->fd = sv[0];
+	for (i = 0; i < nbufs; i++)
+	{
+		buf = gwbuf_alloc(bufsize);
+		for (j = 0; j < bufsize; j++)
+			((unsigned char *)GWBUF_DATA(buf))[j] = (i * bufsize + j) & 0xff;
+		head = gwbuf_append(head, buf);
+	}
+	total = nbufs * bufsize;
+	rc = dcb_write(dcb, head);
+	ss_info_dassert(rc == 1, "dcb_write must succeed");
+	ss_info_dassert(dcb->writeq != NULL, "Write queue must hold the unwritten data");
+
+	while (got < total)
+	{
+		n = read(sv[1], rbuf, sizeof(rbuf));
+		ss_info_dassert(n > 0, "Peer must receive data");
+		for (j = 0; j < n; j++)
+			ss_info_dassert(rbuf[j] == ((got + j) & 0xff), "Data must arrive in order");
+		got += n;
+		if (dcb->writeq)
+			dcb_drain_writeq(dcb);
+	}
+	ss_info_dassert(dcb->writeq == NULL, "Write queue must be empty");
+	ss_info_dassert(dcb->writeqlen == 0, "Write queue length must be zero");
+	ss_info_dassert(dcb->stats.n_writes < nbufs / 4,
+			"Buffers must be written with vectored writes");
+	ss_dfprintf(stderr, "\t..done\n");
+
+	dcb->fd = DCBFD_CLOSED;
+	close(sv[0]);
+	close(sv[1]);
+	dcb_free(dcb);
+	return 0;
+}
+
+/**
+ * test3	Read data of varying sizes from a socket and check that all of
+ *		it arrives and that the read size follows the amount of data.
+ */
+static int
+test3()
+{
+DCB	*dcb;
+GWBUF	*head = NULL;
+int	sv[2];
+int	total = 100000, n, i;
+unsigned char	*data, *ptr;
+
+	ss_dfprintf(stderr, "testdcb : reads without FIONREAD");
+	n = socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+	ss_info_dassert(n == 0, "socketpair must succeed");
+	fcntl(sv[0], F_SETFL, fcntl(sv[0], F_GETFL) | O_NONBLOCK);
+	dcb = dcb_alloc(DCB_ROLE_REQUEST_HANDLER);
+	dcb->fd = sv[0];
+
+	n = dcb_read(dcb, &head);
+	ss_info_dassert(n == 0, "Empty socket must read nothing");
+	ss_info_dassert(head == NULL, "Empty socket must not produce buffers");
+
+	data = (unsigned char *)malloc(total);
+	for (i = 0; i < total; i++)
+		data[i] = i & 0xff;
+	n = write(sv[1], data, total);
+	ss_info_dassert(n == total, "Write to peer must succeed");
+
+	n = dcb_read(dcb, &head);
+	ss_info_dassert(n == total, "All data must be read");
+	ss_info_dassert(gwbuf_length(head) == total, "All data must be buffered");
+	head = gwbuf_make_contiguous(head);
+	ss_info_dassert(memcmp(GWBUF_DATA(head), data, total) == 0, "Data must be intact");
+	gwbuf_free(head);
+	head = NULL;
+	ss_info_dassert(dcb->read_size > DCB_MIN_READ_SIZE, "Large reads must grow the read size");
+
+	for (i = 0; i < 20; i++)
+	{
+		n = write(sv[1], data, 10);
+		ss_info_dassert(n == 10, "Write to peer must succeed");
+		n = dcb_read(dcb, &head);
+		ss_info_dassert(n == 10, "Small read must return the data");
+		ptr = GWBUF_DATA(head);
+		ss_info_dassert(memcmp(ptr, data, 10) == 0, "Data must be intact");
+		gwbuf_free(head);
+		head = NULL;
+	}
+	ss_info_dassert(dcb->read_size == DCB_MIN_READ_SIZE, "Small reads must shrink the read size");
+
+	n = write(sv[1], data, 100);
+	ss_info_dassert(n == 100, "Write to peer must succeed");
+	n = dcb_read_n(dcb, &head, 40);
+	ss_info_dassert(n == 40, "dcb_read_n must read at most n bytes");
+	n = dcb_read(dcb, &head);
+	ss_info_dassert(n == 60, "dcb_read must read the rest");
+	ss_info_dassert(gwbuf_length(head) == 100, "All data must be buffered");
+	gwbuf_free(head);
+	ss_dfprintf(stderr, "\t..done\n");
+
+	free(data);
+	dcb->fd = DCBFD_CLOSED;
+	close(sv[0]);
+	close(sv[1]);
+	dcb_free(dcb);
+	return 0;
+}
+
+/**
+ * test4	Check that a zombie DCB is freed only after every running polling
+ *		thread has processed the zombie list and that stopped threads
+ *		do not hold it back.
+ */
+static int
+test4()
+{
+DCB		*dcb;
+ZOMBIESTATS	stats;
+int		freed, rc;
+
+	ss_dfprintf(stderr, "testdcb : epoch based zombie reclamation");
+	rc = dcb_zombies_init(2);
+	ss_info_dassert(rc == 0, "Zombie epochs must be allocated");
+	dcb_zombies_thread_start(0);
+	dcb_zombies_thread_start(1);
+	dcb_zombie_stats(&stats);
+	freed = stats.n_freed;
+
+	dcb = dcb_alloc(DCB_ROLE_REQUEST_HANDLER);
+	dcb->state = DCB_STATE_NOPOLLING;
+	dcb_add_to_zombieslist(dcb);
+	dcb_add_to_zombieslist(dcb);
+	ss_info_dassert(dcb_get_zombies() == dcb, "DCB must be on the zombie list");
+	ss_info_dassert(dcb->memdata.next == NULL, "DCB must be added only once");
+	dcb_process_zombies(0);
+	ss_info_dassert(dcb_isvalid(dcb), "DCB must not be freed before all threads have seen it");
+	dcb_process_zombies(0);
+	ss_info_dassert(dcb_isvalid(dcb), "DCB must not be freed before all threads have seen it");
+	dcb_process_zombies(1);
+	ss_info_dassert(!dcb_isvalid(dcb), "DCB must be freed once all threads have seen it");
+	ss_info_dassert(dcb_get_zombies() == NULL, "Zombie list must be empty");
+
+	dcb_zombies_thread_stop(1);
+	dcb = dcb_alloc(DCB_ROLE_REQUEST_HANDLER);
+	dcb->state = DCB_STATE_NOPOLLING;
+	dcb_add_to_zombieslist(dcb);
+	dcb_process_zombies(0);
+	ss_info_dassert(!dcb_isvalid(dcb), "Stopped threads must not hold back zombies");
+
+	dcb_zombie_stats(&stats);
+	ss_info_dassert(stats.n_freed == freed + 2, "Freed zombies must be counted");
+	ss_info_dassert(stats.n_zombies == 0, "No zombies must be left");
+	ss_dfprintf(stderr, "\t..done\n");
+	return 0;
+}
+
+/**
+ * test5	Check that a backend DCB marked to be kept is put in the
+ *		persistent pool of its server instead of being freed, that
+ *		the pool size is limited and that the pool can be purged.
+ */
+static int
+test5()
+{
+SERVER	*server;
+DCB	*dcb[3];
+int	sv[3][2];
+int	i, rc;
+
+	ss_dfprintf(stderr, "testdcb : persistent connection pool");
+	server = server_alloc("127.0.0.1", "MySQLBackend", 3306);
+	server->persistpoolmax = 1;
+
+	for (i = 0; i < 3; i++)
+	{
+		rc = socketpair(AF_UNIX, SOCK_STREAM, 0, sv[i]);
+		ss_info_dassert(rc == 0, "socketpair must succeed");
+		dcb[i] = dcb_alloc(DCB_ROLE_REQUEST_HANDLER);
+		dcb[i]->fd = sv[i][0];
+		dcb[i]->server = server;
+		dcb[i]->user = strdup("maxuser");
+		dcb[i]->state = DCB_STATE_NOPOLLING;
+		rc = dcb_persistent_keep(dcb[i]);
+		ss_info_dassert(rc, "Idle DCB must be kept");
+	}
+	/** The peer of the second connection has sent data */
+	rc = write(sv[1][1], "x", 1);
+	ss_info_dassert(rc == 1, "Write to peer must succeed");
+
+	for (i = 0; i < 3; i++)
+	{
+		dcb_add_to_zombieslist(dcb[i]);
+		dcb_process_zombies(0);
+	}
+	ss_info_dassert(dcb_isvalid(dcb[0]), "Idle DCB must be kept in the pool");
+	ss_info_dassert(dcb[0]->state == DCB_STATE_PERSISTENT, "Pooled DCB must be persistent");
+	ss_info_dassert(server->persistent == dcb[0], "DCB must be in the pool of the server");
+	ss_info_dassert(!dcb_isvalid(dcb[1]), "DCB with unread data must be freed");
+	ss_info_dassert(!dcb_isvalid(dcb[2]), "DCB must be freed when the pool is full");
+	ss_info_dassert(server->stats.n_persistent == 1, "Pool size must be counted");
+	rc = dcb_persistent_clean_count(server, false);
+	ss_info_dassert(rc == 1, "Pool must keep connections that have not expired");
+
+	rc = dcb_persistent_clean_count(server, true);
+	ss_info_dassert(rc == 0, "Pool must be emptied");
+	ss_info_dassert(server->persistent == NULL, "Pool must be empty");
+	ss_info_dassert(server->stats.n_persistent == 0, "Pool size must be counted");
+	dcb_process_zombies(0);
+	ss_info_dassert(!dcb_isvalid(dcb[0]), "Purged DCB must be freed");
+	ss_info_dassert(dcb_get_zombies() == NULL, "Zombie list must be empty");
+
+	for (i = 0; i < 3; i++)
+	{
+		close(sv[i][1]);
+	}
+	server_free(server);
+	ss_dfprintf(stderr, "\t..done\n");
+	return 0;
+}
+
+/**
+ * test6	Free DCBs from the start, the middle and the end of the chain
+ *		of allocated DCBs and check that the rest of the chain is intact.
+ */
+static int
+test6()
+{
+DCB	*dcb[5];
+int	count, i;
+
+	ss_dfprintf(stderr, "testdcb : chain of allocated DCBs");
+	count = dcb_count_by_usage(DCB_USAGE_ALL);
+	for (i = 0; i < 5; i++)
+	{
+		dcb[i] = dcb_alloc(DCB_ROLE_REQUEST_HANDLER);
+	}
+	ss_info_dassert(dcb_count_by_usage(DCB_USAGE_ALL) == count + 5,
+			"Allocated DCBs must be in the chain");
+	dcb_free(dcb[2]);
+	dcb_free(dcb[4]);
+	dcb_free(dcb[0]);
+	ss_info_dassert(!dcb_isvalid(dcb[0]) && !dcb_isvalid(dcb[2]) && !dcb_isvalid(dcb[4]),
+			"Freed DCBs must not be valid");
+	ss_info_dassert(dcb_isvalid(dcb[1]) && dcb_isvalid(dcb[3]),
+			"The other DCBs must stay valid");
+	ss_info_dassert(dcb_count_by_usage(DCB_USAGE_ALL) == count + 2,
+			"Freed DCBs must be removed from the chain");
+	dcb[4] = dcb_alloc(DCB_ROLE_REQUEST_HANDLER);
+	dcb_free(dcb[3]);
+	dcb_free(dcb[1]);
+	ss_info_dassert(dcb_isvalid(dcb[4]), "New DCB must be valid");
+	dcb_free(dcb[4]);
+	ss_info_dassert(dcb_count_by_usage(DCB_USAGE_ALL) == count,
+			"Chain must be back to its original length");
+	ss_dfprintf(stderr, "\t..done\n");
+	return 0;
+}
+
 int main(int argc, char **argv)
 {
 int	result = 0;
 
 	result += test1();
+	result += test2();
+	result += test3();
+	result += test4();
+	result += test5();
+	result += test6();
 
 	exit(result);
 }
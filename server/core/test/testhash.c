@@ -32,30 +32,10 @@
 #include <string.h>
 #include <math.h>
 #include <time.h>
+#include <pthread.h>
 
 #include <hashtable.h>
 
-static void
-read_lock(HASHTABLE *table)
-{
-	spinlock_acquire(&table->spin);
-	while (table->writelock)
-	{
-		spinlock_release(&table->spin);
-		while (table->writelock)
-			;
-		spinlock_acquire(&table->spin);
-	}
-	table->n_readers++;
-	spinlock_release(&table->spin);
-}
-
-static void
-read_unlock(HASHTABLE *table)
-{
-	atomic_add(&table->n_readers, -1);
-}
-
 static int hfun(void* key);
 static int cmpfun (void *, void *);
 
@@ -100,11 +80,9 @@ static bool do_hashtest(
 {
         bool       succp = true;
         HASHTABLE* h;
-        int        nelems;
         int        i;
         int*       val_arr;
-        int        hsize;
-        int        longest;
+        HASHTABLE_STATS stats;
         int*       iter;
         
         ss_dfprintf(stderr,
@@ -128,27 +106,33 @@ static bool do_hashtest(
         
         ss_dfprintf(stderr, "\t..done\nRead hash table statistics.");
         
-        hashtable_get_stats((void *)h, &hsize, &nelems, &longest);
+        hashtable_get_stats((void *)h, &stats);
 
         ss_dfprintf(stderr, "\t..done\nValidate read values.");
         
-        ss_info_dassert(hsize == (argsize > 0 ? argsize: 1), "Invalid hash size");
-        ss_info_dassert((nelems == argelems) || (nelems == 0 && argsize == 0),
-                        "Invalid element count");
-        ss_info_dassert(longest <= nelems, "Too large longest list value");
+        ss_info_dassert(stats.hashsize >= argsize &&
+                        (stats.hashsize & (stats.hashsize - 1)) == 0,
+                        "Invalid hash size");
+        ss_info_dassert(stats.nelems <= stats.hashsize || stats.resizing,
+                        "Hash table did not grow");
+        ss_info_dassert(stats.nelems == argelems, "Invalid element count");
+        ss_info_dassert(stats.longest <= stats.nelems, "Too large longest list value");
+
+        for (i=0; i<argelems; i++) {
+            ss_info_dassert(hashtable_fetch(h, (void *)&val_arr[i]) == &val_arr[i],
+                            "Added element not found");
+        }
         if (argelems > 1000) ss_dfprintf(stderr, "\t..done\nOperation took %g", (double)clock()-start);
 
         ss_dfprintf(stderr, "\t..done\nValidate iterator.");
         
         HASHITERATOR *iterator = hashtable_iterator(h);
-        read_lock(h);
         for (i=0; i < (argelems+1); i++) {
             iter = (int *)hashtable_next(iterator);
             if (iter == NULL) break;
             if (argelems < 100) ss_dfprintf(stderr, "\nNext item, iter = %d, i = %d", *iter, i);
         }
-        read_unlock(h);
-        ss_info_dassert((i == argelems) || (i == 0 && argsize == 0), "\nIncorrect number of elements from iterator");
+        ss_info_dassert(i == argelems, "\nIncorrect number of elements from iterator");
         hashtable_iterator_free(iterator);
         if (argelems > 1000) ss_dfprintf(stderr, "\t..done\nOperation took %g", (double)clock()-start);
 
@@ -162,6 +146,83 @@ static bool do_hashtest(
         return succp;
 }
 
+#define NTHREADS 8
+#define NKEYS    20000
+
+static HASHTABLE* thr_table;
+static int        thr_keys[NTHREADS][NKEYS];
+
+/**
+ * Add, fetch and delete keys of its own while the other threads do the
+ * same, so that the table grows while it is being updated and read.
+ */
+static void* hash_thread(
+        void* data)
+{
+        int* keys = (int *)data;
+        int  i;
+        int  rc;
+        void* val;
+
+        for (i = 0; i < NKEYS; i++) {
+            rc = hashtable_add(thr_table, &keys[i], &keys[i]);
+            ss_info_dassert(rc == 1, "Adding a new key failed");
+            val = hashtable_fetch(thr_table, &keys[i/2]);
+            ss_info_dassert(val == &keys[i/2], "Added key not found");
+        }
+        for (i = 0; i < NKEYS; i += 2) {
+            rc = hashtable_delete(thr_table, &keys[i]);
+            ss_info_dassert(rc == 1, "Deleting a key failed");
+            val = hashtable_fetch(thr_table, &keys[i]);
+            ss_info_dassert(val == NULL, "Deleted key found");
+        }
+        return NULL;
+}
+
+/**
+ * Test concurrent updates of a table that starts small and resizes.
+ */
+static bool do_threadtest(void)
+{
+        pthread_t       thr[NTHREADS];
+        HASHTABLE_STATS stats;
+        int             i;
+        int             j;
+
+        thr_table = hashtable_alloc(4, hfun, cmpfun);
+
+        for (i = 0; i < NTHREADS; i++) {
+            for (j = 0; j < NKEYS; j++) {
+                thr_keys[i][j] = i * NKEYS + j;
+            }
+            pthread_create(&thr[i], NULL, hash_thread, thr_keys[i]);
+        }
+        for (i = 0; i < NTHREADS; i++) {
+            pthread_join(thr[i], NULL);
+        }
+        hashtable_get_stats(thr_table, &stats);
+
+        ss_dfprintf(stderr,
+                    "testhash : %d threads, %d elements in %d chains after %d resizes, "
+                    "longest chain %d.\n",
+                    NTHREADS,
+                    stats.nelems,
+                    stats.hashsize,
+                    stats.n_resizes,
+                    stats.longest);
+        ss_info_dassert(stats.nelems == NTHREADS * NKEYS / 2, "Invalid element count");
+        ss_info_dassert(stats.n_resizes > 0, "Hash table did not grow");
+
+        for (i = 0; i < NTHREADS; i++) {
+            for (j = 1; j < NKEYS; j += 2) {
+                ss_info_dassert(hashtable_fetch(thr_table, &thr_keys[i][j]) == &thr_keys[i][j],
+                                "Remaining key not found");
+            }
+        }
+        hashtable_free(thr_table);
+        return true;
+}
+
 /** 
  * @node Simple test which creates hashtable and frees it. Size and number of entries
  * sre specified by user and passed as arguments.
@@ -188,6 +249,8 @@ int main(void)
         if (!do_hashtest(10000, 133))   goto return_rc;
         if (!do_hashtest(1000, 1000))   goto return_rc;
         if (!do_hashtest(1000, 100000)) goto return_rc;
+        if (!do_hashtest(60000, 52))    goto return_rc;
+        if (!do_threadtest())           goto return_rc;
         
         rc = 0;
 return_rc:
@@ -32,6 +32,7 @@
 #include <string.h>
 
 #include <modutil.h>
+#include <mysql_client_server_protocol.h>
 #include <buffer.h>
 
 /**
@@ -93,12 +94,174 @@ char query[129];
 
 }
 
+/**
+ * test3	Split a read of pipelined packets and check that a packet that
+ *		fills a whole buffer is returned without copying and that a
+ *		packet spanning two buffers and a partial packet are handled.
+ */
+static int
+test3()
+{
+GWBUF	*buffer, *tail, *packet;
+uint8_t	*data, *first;
+
+	ss_dfprintf(stderr, "testmodutil : splitting pipelined packets");
+	/** A buffer with one packet of 10 bytes of payload */
+	buffer = gwbuf_alloc(14);
+	first = GWBUF_DATA(buffer);
+	memcpy(first, "\x0a\x00\x00\x00", 4);
+	memset(first + 4, 'a', 10);
+	/** Packets of 20 and 30 bytes, the second continues in the next buffer */
+	tail = gwbuf_alloc(54);
+	data = GWBUF_DATA(tail);
+	memcpy(data, "\x14\x00\x00\x00", 4);
+	memset(data + 4, 'b', 20);
+	memcpy(data + 24, "\x1e\x00\x00\x00", 4);
+	memset(data + 28, 'c', 26);
+	buffer = gwbuf_append(buffer, tail);
+	/** The rest of the third packet and the start of a fourth one */
+	tail = gwbuf_alloc(6);
+	memcpy(GWBUF_DATA(tail), "cccc\x05\x00", 6);
+	buffer = gwbuf_append(buffer, tail);
+
+	packet = modutil_get_next_MySQL_packet(&buffer);
+	ss_info_dassert(packet != NULL && GWBUF_LENGTH(packet) == 14, "First packet must be complete");
+	ss_info_dassert(GWBUF_DATA(packet) == first, "Packet filling a buffer must not be copied");
+	ss_info_dassert(packet->next == NULL, "Packet must be unlinked from the chain");
+	ss_info_dassert(gwbuf_length(buffer) == 60, "Rest of the chain must be left");
+	gwbuf_free(packet);
+	packet = modutil_get_next_MySQL_packet(&buffer);
+	ss_info_dassert(packet != NULL && GWBUF_LENGTH(packet) == 24, "Second packet must be complete");
+	ss_info_dassert(((uint8_t *)GWBUF_DATA(packet))[4] == 'b', "Second packet must hold its payload");
+	gwbuf_free(packet);
+	packet = modutil_get_next_MySQL_packet(&buffer);
+	ss_info_dassert(packet != NULL && GWBUF_LENGTH(packet) == 34, "Spanning packet must be copied");
+	ss_info_dassert(((uint8_t *)GWBUF_DATA(packet))[33] == 'c', "Spanning packet must be intact");
+	gwbuf_free(packet);
+	packet = modutil_get_next_MySQL_packet(&buffer);
+	ss_info_dassert(packet == NULL, "Partial packet must not be returned");
+	ss_info_dassert(buffer != NULL && gwbuf_length(buffer) == 2, "Partial packet must be left in the buffer");
+	gwbuf_free(buffer);
+	ss_dfprintf(stderr, "\t..done\n");
+	return 0;
+}
+
+static const uint8_t ok_packet[] = {0x07, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00};
+static const uint8_t ok_more_packet[] = {0x07, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00};
+static const uint8_t err_packet[] = {0x09, 0x00, 0x00, 0x01, 0xff, 0x15, 0x04, '#', '2', '8', '0', '0', '0'};
+static const uint8_t colcount_packet[] = {0x01, 0x00, 0x00, 0x01, 0x01};
+static const uint8_t coldef_packet[] = {0x03, 0x00, 0x00, 0x02, 'd', 'e', 'f'};
+static const uint8_t eof_packet[] = {0x05, 0x00, 0x00, 0x03, 0xfe, 0x00, 0x00, 0x02, 0x00};
+static const uint8_t eof_more_packet[] = {0x05, 0x00, 0x00, 0x03, 0xfe, 0x00, 0x00, 0x0a, 0x00};
+static const uint8_t eof_cursor_packet[] = {0x05, 0x00, 0x00, 0x03, 0xfe, 0x00, 0x00, 0x42, 0x00};
+static const uint8_t row_packet[] = {0x02, 0x00, 0x00, 0x04, 0x01, '1'};
+static const uint8_t binary_row_packet[] = {0x03, 0x00, 0x00, 0x04, 0x00, 0x00, 0x01};
+
+/**
+ * Build a buffer from a NULL terminated list of packets
+ */
+static GWBUF *
+make_reply(const uint8_t **packets)
+{
+GWBUF	*buf;
+uint8_t	*ptr;
+int	i, len = 0;
+
+	for (i = 0; packets[i]; i++)
+		len += gw_mysql_get_byte3(packets[i]) + 4;
+	buf = gwbuf_alloc(len);
+	ptr = GWBUF_DATA(buf);
+	for (i = 0; packets[i]; i++)
+	{
+		memcpy(ptr, packets[i], gw_mysql_get_byte3(packets[i]) + 4);
+		ptr += gw_mysql_get_byte3(packets[i]) + 4;
+	}
+	return buf;
+}
+
+/**
+ * Count the replies in a list of packets
+ */
+static int
+count_replies(int cmd, const uint8_t **packets, reply_state_t *state)
+{
+GWBUF	*buf = make_reply(packets);
+int	n;
+
+	n = modutil_count_replies(buf, cmd, state);
+	gwbuf_free(buf);
+	return n;
+}
+
+/**
+ * test4	Find the end of the replies to the commands of a session
+ */
+static int
+test4()
+{
+reply_state_t	state = REPLY_STATE_START;
+int		n;
+const uint8_t	*ok[] = {ok_packet, NULL};
+const uint8_t	*err[] = {err_packet, NULL};
+const uint8_t	*two_ok[] = {ok_packet, ok_packet, NULL};
+const uint8_t	*rset[] = {colcount_packet, coldef_packet, eof_packet,
+			   row_packet, row_packet, eof_packet, NULL};
+const uint8_t	*rset_head[] = {colcount_packet, coldef_packet, eof_packet, row_packet, NULL};
+const uint8_t	*rset_tail[] = {row_packet, eof_packet, NULL};
+const uint8_t	*rset_err[] = {colcount_packet, coldef_packet, eof_packet, row_packet, err_packet, NULL};
+const uint8_t	*multi[] = {colcount_packet, coldef_packet, eof_packet, row_packet, eof_more_packet,
+			    ok_more_packet, colcount_packet, coldef_packet, eof_packet, eof_more_packet,
+			    ok_packet, NULL};
+const uint8_t	*field_list[] = {coldef_packet, coldef_packet, eof_packet, NULL};
+const uint8_t	*binary_rset[] = {colcount_packet, coldef_packet, eof_packet,
+				  binary_row_packet, eof_packet, NULL};
+const uint8_t	*cursor[] = {colcount_packet, coldef_packet, eof_cursor_packet, NULL};
+const uint8_t	*fetch[] = {binary_row_packet, binary_row_packet, eof_packet, NULL};
+const uint8_t	*fetch_split[] = {binary_row_packet, NULL};
+
+	ss_dfprintf(stderr, "testmodutil : counting replies");
+	n = count_replies(MYSQL_COM_QUERY, ok, &state);
+	ss_info_dassert(n == 1 && state == REPLY_STATE_START, "OK packet ends a reply");
+	n = count_replies(MYSQL_COM_QUERY, err, &state);
+	ss_info_dassert(n == 1 && state == REPLY_STATE_START, "ERR packet ends a reply");
+	n = count_replies(MYSQL_COM_QUERY, two_ok, &state);
+	ss_info_dassert(n == 2, "Pipelined OK packets end two replies");
+	n = count_replies(MYSQL_COM_QUERY, rset, &state);
+	ss_info_dassert(n == 1 && state == REPLY_STATE_START, "Result set ends at the EOF after the rows");
+	n = count_replies(MYSQL_COM_QUERY, rset_head, &state);
+	ss_info_dassert(n == 0 && state == REPLY_STATE_RSET_ROWS, "Partial result set must not end a reply");
+	n = count_replies(MYSQL_COM_QUERY, rset_tail, &state);
+	ss_info_dassert(n == 1 && state == REPLY_STATE_START, "Rest of the result set ends the reply");
+	n = count_replies(MYSQL_COM_QUERY, rset_err, &state);
+	ss_info_dassert(n == 1 && state == REPLY_STATE_START, "ERR packet ends a result set");
+	n = count_replies(MYSQL_COM_QUERY, multi, &state);
+	ss_info_dassert(n == 1 && state == REPLY_STATE_START, "Multiple results end in one reply");
+	n = count_replies(MYSQL_COM_FIELD_LIST, field_list, &state);
+	ss_info_dassert(n == 1 && state == REPLY_STATE_START, "Field list ends at the EOF");
+	n = count_replies(MYSQL_COM_STMT_EXECUTE, binary_rset, &state);
+	ss_info_dassert(n == 1 && state == REPLY_STATE_START, "Binary result set ends at the EOF after the rows");
+	n = count_replies(MYSQL_COM_STMT_EXECUTE, cursor, &state);
+	ss_info_dassert(n == 1 && state == REPLY_STATE_START, "Execute opening a cursor ends at the EOF");
+	n = count_replies(MYSQL_COM_STMT_FETCH, fetch, &state);
+	ss_info_dassert(n == 1 && state == REPLY_STATE_START, "Fetched rows end at the EOF");
+	n = count_replies(MYSQL_COM_STMT_FETCH, fetch_split, &state);
+	ss_info_dassert(n == 0 && state == REPLY_STATE_RSET_ROWS, "Fetched row must not end a reply");
+	n = count_replies(MYSQL_COM_STMT_FETCH, fetch, &state);
+	ss_info_dassert(n == 1 && state == REPLY_STATE_START, "Rest of the fetched rows end the reply");
+	n = count_replies(MYSQL_COM_STMT_FETCH, err, &state);
+	ss_info_dassert(n == 1 && state == REPLY_STATE_START, "ERR packet ends a fetch");
+	ss_dfprintf(stderr, "\t..done\n");
+	return 0;
+}
+
 int main(int argc, char **argv)
 {
 int	result = 0;
 
 	result += test1();
 	result += test2();
+	result += test3();
+	result += test4();
 	exit(result);
 }
 
@@ -78,6 +78,14 @@ char    *status;
         skygw_log_sync_all();
         ss_info_dassert(0 == strcmp("Running", status), "Status of Server should be Running after master status cleared.");
         if (NULL != status) free(status);
+        ss_dfprintf(stderr, "\t..done\nTesting Response Time Average for Server.");
+        ss_info_dassert(0 == server->stats.avg_response, "Response time should not be measured yet.");
+        server_add_response_time(server, 800);
+        ss_info_dassert(800 == server->stats.avg_response, "First sample should start the average.");
+        server_add_response_time(server, 1600);
+        ss_info_dassert(900 == server->stats.avg_response, "Sample should move the average by an eighth.");
+        server_add_response_time(server, 0);
+        ss_info_dassert(788 == server->stats.avg_response, "Zero sample should count as one microsecond.");
         ss_dfprintf(stderr, "\t..done\nRun Prints for Server and all Servers.");
         printServer(server);
         printAllServers();
@@ -33,6 +33,7 @@
 #include <maxscale_test.h>
 #include <test_utils.h>
 #include <service.h>
+#include <timer.h>
 
 
 static bool success = false;
@@ -55,6 +56,7 @@ SESSION	    *session;
 DCB	    *dcb;
 int	    result;
 int	    argc = 3;
+int	    i;
 
 init_test_env(NULL);
 /* char*	    argv[] = */
@@ -116,7 +118,13 @@ init_test_env(NULL);
         ss_info_dassert(session != NULL, "Session allocation failed");
         session->client->state = DCB_STATE_POLLING;
         session->client->func.hangup = hup;
-        sleep(15);
+
+        /** No polling threads are running, advance the timer wheel here */
+        for (i = 0; i < 150 && !success; i++)
+        {
+                thread_millisleep(100);
+                timer_process();
+        }
         
         ss_info_dassert(success, "Session timeout failed");
 
@@ -0,0 +1,188 @@
+/*
+ * This file is distributed as part of MaxScale.  It is free
+ * software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation,
+ * version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <timer.h>
+
+#define START	1000
+#define NTIMERS	10
+
+static unsigned long	now;
+static unsigned long	fired[NTIMERS];
+static int		nfired[NTIMERS];
+
+static void
+expired(TIMER *timer, void *data)
+{
+int	n = (int)(long)data;
+
+	fired[n] = now;
+	nfired[n]++;
+}
+
+static void
+periodic(TIMER *timer, void *data)
+{
+	nfired[0]++;
+	if (nfired[0] < 5)
+		timer_wheel_add((TIMER_WHEEL *)data, timer, now + 10);
+}
+
+/**
+ * test1	Timers expire once, on time, at every level of the wheel
+ *
+ */
+static int
+test1()
+{
+TIMER_WHEEL	wheel;
+TIMER		timers[NTIMERS];
+unsigned long	delay[NTIMERS] = { 0, 1, 63, 64, 65, 4095, 4096, 300000,
+				   20000000, 17000000 };
+int		i;
+
+	memset(nfired, 0, sizeof(nfired));
+	timer_wheel_init(&wheel, START);
+	for (i = 0; i < NTIMERS; i++)
+	{
+		timer_init(&timers[i], expired, (void *)(long)i);
+		timer_wheel_add(&wheel, &timers[i], START + delay[i]);
+	}
+	for (now = START; now <= START + 20000100; now += 7)
+		timer_wheel_process(&wheel, now);
+	for (i = 0; i < NTIMERS; i++)
+	{
+		if (nfired[i] != 1)
+		{
+			fprintf(stderr, "timer: test 1.1 failed, timer %d expired %d times.\n",
+				i, nfired[i]);
+			return 1;
+		}
+		if (fired[i] < START + delay[i] || fired[i] >= START + delay[i] + 7)
+		{
+			fprintf(stderr, "timer: test 1.2 failed, timer %d expired at %lu.\n",
+				i, fired[i] - START);
+			return 1;
+		}
+		if (TIMER_ARMED(&timers[i]))
+		{
+			fprintf(stderr, "timer: test 1.3 failed.\n");
+			return 1;
+		}
+	}
+	if (wheel.count != 0)
+	{
+		fprintf(stderr, "timer: test 1.4 failed.\n");
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * test2	Cancelling and re-arming timers
+ *
+ */
+static int
+test2()
+{
+TIMER_WHEEL	wheel;
+TIMER		timers[3];
+
+	memset(nfired, 0, sizeof(nfired));
+	timer_wheel_init(&wheel, START);
+	timer_init(&timers[0], periodic, &wheel);
+	timer_init(&timers[1], expired, (void *)1L);
+	timer_init(&timers[2], expired, (void *)2L);
+	timer_wheel_add(&wheel, &timers[0], START + 10);
+	timer_wheel_add(&wheel, &timers[1], START + 100);
+	timer_wheel_add(&wheel, &timers[2], START + 100);
+	if (timer_cancel(&timers[1]) != 1 || timer_cancel(&timers[1]) != 0)
+	{
+		fprintf(stderr, "timer: test 2.1 failed.\n");
+		return 1;
+	}
+	/* Re-arming moves the timer instead of adding it twice */
+	timer_wheel_add(&wheel, &timers[2], START + 5000);
+	if (wheel.count != 2)
+	{
+		fprintf(stderr, "timer: test 2.2 failed.\n");
+		return 1;
+	}
+	for (now = START; now <= START + 6000; now++)
+		timer_wheel_process(&wheel, now);
+	if (nfired[0] != 5 || nfired[1] != 0 || nfired[2] != 1 ||
+		fired[2] != START + 5000)
+	{
+		fprintf(stderr, "timer: test 2.3 failed.\n");
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * test3	The time until the wheel must next be advanced
+ *
+ */
+static int
+test3()
+{
+TIMER_WHEEL	wheel;
+TIMER		timers[2];
+long		next;
+
+	timer_wheel_init(&wheel, START);
+	if (timer_wheel_next(&wheel, START) != -1)
+	{
+		fprintf(stderr, "timer: test 3.1 failed.\n");
+		return 1;
+	}
+	timer_init(&timers[0], expired, 0);
+	timer_init(&timers[1], expired, (void *)1L);
+	timer_wheel_add(&wheel, &timers[0], START + 30);
+	if (timer_wheel_next(&wheel, START) != 30)
+	{
+		fprintf(stderr, "timer: test 3.2 failed.\n");
+		return 1;
+	}
+	timer_wheel_add(&wheel, &timers[0], START + 10000);
+	next = timer_wheel_next(&wheel, START);
+	if (next <= 0 || next > 10000)
+	{
+		fprintf(stderr, "timer: test 3.3 failed.\n");
+		return 1;
+	}
+	timer_wheel_add(&wheel, &timers[1], START + 2);
+	if (timer_wheel_next(&wheel, START) != 2)
+	{
+		fprintf(stderr, "timer: test 3.4 failed.\n");
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+int	result = 0;
+
+	result += test1();
+	result += test2();
+	result += test3();
+
+	exit(result);
+}
@@ -0,0 +1,414 @@
+/*
+ * This file is distributed as part of the MariaDB Corporation MaxScale.  It is free
+ * software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation,
+ * version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <timer.h>
+
+/**
+ * @file timer.c  Hierarchical timer wheel
+ *
+ * A wheel has TIMER_LEVELS levels of TIMER_SLOTS slots. A slot of level 0
+ * holds the timers that expire in one particular millisecond, a slot of
+ * level n holds the timers that expire within a span of TIMER_SLOTS ^ n
+ * milliseconds. Whenever the level 0 index wraps the next slot of level 1
+ * is cascaded, i.e. its timers are re-inserted and thus moved to lower
+ * levels, and so on for the higher levels.
+ *
+ * The expired timers are moved to a list from which they are removed one
+ * at a time and their functions called without the wheel lock being held,
+ * so that the functions may arm and cancel timers. Only one thread at a
+ * time advances a wheel, others return immediately in the same way as
+ * with the processing of the zombie DCBs.
+ *
+ * The polling threads share a wheel that is advanced at the end of each
+ * iteration of the polling loop, before the zombies are processed. A
+ * timer function called from that wheel may therefore use a DCB that is
+ * closed by another thread, as long as the timer of the DCB is cancelled
+ * before the DCB is added to the zombie list.
+ */
+
+#define TIMER_MASK	(TIMER_SLOTS - 1)
+#define TIMER_SPAN(l)	(1UL << (TIMER_SLOT_BITS * (l)))
+#define TIMER_INDEX(t, l) (((t) >> (TIMER_SLOT_BITS * (l))) & TIMER_MASK)
+
+/** The wheel of the polling threads */
+static TIMER_WHEEL	poll_wheel;
+
+/**
+ * Return the time in milliseconds from the monotonic clock
+ *
+ * @return The current time in milliseconds
+ */
+unsigned long
+timer_now()
+{
+struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Return the time in microseconds from the monotonic clock, used where
+ * a millisecond is too coarse, such as when timing queries
+ *
+ * @return The current time in microseconds
+ */
+unsigned long
+timer_now_usec()
+{
+struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * Initialise a timer
+ *
+ * @param timer	The timer
+ * @param fn	The function to call when the timer expires
+ * @param data	The data passed to the function
+ */
+void
+timer_init(TIMER *timer, void (*fn)(TIMER *, void *), void *data)
+{
+	memset(timer, 0, sizeof(TIMER));
+	timer->fn = fn;
+	timer->data = data;
+}
+
+/**
+ * Initialise a timer wheel. A wheel that is not initialised, such as the
+ * static wheel of the polling threads, starts at the time it is first used.
+ *
+ * @param wheel	The wheel
+ * @param now	The start time of the wheel in milliseconds
+ */
+void
+timer_wheel_init(TIMER_WHEEL *wheel, unsigned long now)
+{
+	memset(wheel, 0, sizeof(TIMER_WHEEL));
+	spinlock_init(&wheel->lock);
+	wheel->current = now;
+}
+
+/**
+ * Add a timer to a list of the wheel. The caller must hold the wheel lock.
+ *
+ * @param list	The list
+ * @param timer	The timer
+ */
+static void
+timer_link(TIMER **list, TIMER *timer)
+{
+	timer->prev = NULL;
+	timer->next = *list;
+	if (*list)
+		(*list)->prev = timer;
+	*list = timer;
+	timer->slot = list;
+}
+
+/**
+ * Remove a timer from the list it is in. The caller must hold the wheel lock.
+ *
+ * @param timer	The timer
+ */
+static void
+timer_unlink(TIMER *timer)
+{
+	if (timer->prev)
+		timer->prev->next = timer->next;
+	else
+		*timer->slot = timer->next;
+	if (timer->next)
+		timer->next->prev = timer->prev;
+	timer->next = timer->prev = NULL;
+	timer->slot = NULL;
+}
+
+/**
+ * Insert a timer in the slot of the wheel that matches its expiry time.
+ * The caller must hold the wheel lock.
+ *
+ * @param wheel	The wheel
+ * @param timer	The timer
+ */
+static void
+timer_insert(TIMER_WHEEL *wheel, TIMER *timer)
+{
+unsigned long	expires = timer->expires;
+unsigned long	delta;
+int		level;
+
+	if (expires < wheel->current)
+		expires = wheel->current;
+	delta = expires - wheel->current;
+	if (delta >= TIMER_SPAN(TIMER_LEVELS))
+	{
+		/* Wait in the furthest slot and be cascaded again from there */
+		delta = TIMER_SPAN(TIMER_LEVELS) - 1;
+		expires = wheel->current + delta;
+	}
+	for (level = 0; delta >= TIMER_SPAN(level + 1); level++)
+		;
+	timer_link(&wheel->slots[level][TIMER_INDEX(expires, level)], timer);
+}
+
+/**
+ * Arm a timer in a wheel. A timer that is already armed is re-armed with
+ * the new expiry time.
+ *
+ * @param wheel		The wheel
+ * @param timer		The timer
+ * @param expires	The expiry time in milliseconds
+ */
+void
+timer_wheel_add(TIMER_WHEEL *wheel, TIMER *timer, unsigned long expires)
+{
+	spinlock_acquire(&wheel->lock);
+	if (wheel->current == 0)
+		wheel->current = timer_now();
+	if (timer->wheel == wheel)
+	{
+		timer_unlink(timer);
+	}
+	else
+	{
+		timer->wheel = wheel;
+		wheel->count++;
+	}
+	timer->expires = expires;
+	timer_insert(wheel, timer);
+	spinlock_release(&wheel->lock);
+}
+
+/**
+ * Cancel a timer. Once this returns the function of the timer will not be
+ * called, unless it is already running in another thread.
+ *
+ * @param timer	The timer
+ * @return	1 if the timer was armed, 0 otherwise
+ */
+int
+timer_cancel(TIMER *timer)
+{
+TIMER_WHEEL	*wheel = timer->wheel;
+int		rval = 0;
+
+	if (wheel == NULL)
+		return 0;
+	spinlock_acquire(&wheel->lock);
+	if (timer->wheel == wheel)
+	{
+		timer_unlink(timer);
+		timer->wheel = NULL;
+		wheel->count--;
+		rval = 1;
+	}
+	spinlock_release(&wheel->lock);
+	return rval;
+}
+
+/**
+ * Move the timers of a slot to lower levels. The caller must hold the
+ * wheel lock.
+ *
+ * @param wheel	The wheel
+ * @param level	The level of the slot
+ * @return	The index of the slot that was cascaded
+ */
+static int
+timer_cascade(TIMER_WHEEL *wheel, int level)
+{
+int	index = TIMER_INDEX(wheel->current, level);
+TIMER	*timer, *next;
+
+	timer = wheel->slots[level][index];
+	wheel->slots[level][index] = NULL;
+	while (timer)
+	{
+		next = timer->next;
+		timer_insert(wheel, timer);
+		timer = next;
+	}
+	return index;
+}
+
+/**
+ * Advance a wheel up to the given time and call the functions of the
+ * timers that have expired.
+ *
+ * @param wheel	The wheel
+ * @param now	The current time in milliseconds
+ * @return	The number of timer functions called
+ */
+int
+timer_wheel_process(TIMER_WHEEL *wheel, unsigned long now)
+{
+TIMER	*timer, *next, *tail = NULL;
+int	level, n = 0;
+
+	spinlock_acquire(&wheel->lock);
+	if (wheel->current == 0)
+		wheel->current = now;
+	if (wheel->running || wheel->current > now)
+	{
+		spinlock_release(&wheel->lock);
+		return 0;
+	}
+	if (wheel->count == 0)
+	{
+		wheel->current = now + 1;
+		spinlock_release(&wheel->lock);
+		return 0;
+	}
+	wheel->running = 1;
+
+	while (wheel->current <= now)
+	{
+		if (TIMER_INDEX(wheel->current, 0) == 0)
+		{
+			for (level = 1; level < TIMER_LEVELS &&
+				timer_cascade(wheel, level) == 0; level++)
+				;
+		}
+		timer = wheel->slots[0][TIMER_INDEX(wheel->current, 0)];
+		wheel->slots[0][TIMER_INDEX(wheel->current, 0)] = NULL;
+		while (timer)
+		{
+			next = timer->next;
+			timer->next = NULL;
+			timer->prev = tail;
+			timer->slot = &wheel->expired;
+			if (tail)
+				tail->next = timer;
+			else
+				wheel->expired = timer;
+			tail = timer;
+			timer = next;
+		}
+		wheel->current++;
+	}
+
+	while ((timer = wheel->expired) != NULL)
+	{
+		timer_unlink(timer);
+		timer->wheel = NULL;
+		wheel->count--;
+		spinlock_release(&wheel->lock);
+		timer->fn(timer, timer->data);
+		n++;
+		spinlock_acquire(&wheel->lock);
+	}
+	wheel->running = 0;
+	spinlock_release(&wheel->lock);
+	return n;
+}
+
+/**
+ * Return the time until a wheel next needs to be advanced, either because
+ * a timer expires or because a slot must be cascaded.
+ *
+ * @param wheel	The wheel
+ * @param now	The current time in milliseconds
+ * @return	The time in milliseconds or -1 if no timers are armed
+ */
+long
+timer_wheel_next(TIMER_WHEEL *wheel, unsigned long now)
+{
+unsigned long	when = 0, t;
+int		level, i, found = 0;
+
+	spinlock_acquire(&wheel->lock);
+	if (wheel->count == 0)
+	{
+		spinlock_release(&wheel->lock);
+		return -1;
+	}
+	if (wheel->expired)
+	{
+		spinlock_release(&wheel->lock);
+		return 0;
+	}
+	for (level = 0; level < TIMER_LEVELS; level++)
+	{
+		for (i = 0; i < TIMER_SLOTS; i++)
+		{
+			if (wheel->slots[level][(TIMER_INDEX(wheel->current, level) + i) & TIMER_MASK])
+				break;
+		}
+		if (i == TIMER_SLOTS)
+			continue;
+		if (level == 0)
+		{
+			t = wheel->current + i;
+		}
+		else
+		{
+			/* The slot of the current span was cascaded when it began */
+			if (i == 0 && (wheel->current & (TIMER_SPAN(level) - 1)) != 0)
+				i = TIMER_SLOTS;
+			t = ((wheel->current >> (TIMER_SLOT_BITS * level)) + i)
+				<< (TIMER_SLOT_BITS * level);
+		}
+		if (!found || t < when)
+		{
+			when = t;
+			found = 1;
+		}
+	}
+	spinlock_release(&wheel->lock);
+	return when > now ? (long)(when - now) : 0;
+}
+
+/**
+ * Arm a timer in the wheel of the polling threads
+ *
+ * @param timer	The timer
+ * @param ms	Milliseconds from now until the timer expires
+ */
+void
+timer_add(TIMER *timer, unsigned long ms)
+{
+	timer_wheel_add(&poll_wheel, timer, timer_now() + ms);
+}
+
+/**
+ * Advance the wheel of the polling threads. Called by each polling
+ * thread at the end of every iteration of the polling loop.
+ *
+ * @return	The number of timer functions called
+ */
+int
+timer_process()
+{
+	return timer_wheel_process(&poll_wheel, timer_now());
+}
+
+/**
+ * Return the time until the wheel of the polling threads next needs to
+ * be advanced, used to limit the time the polling threads block.
+ *
+ * @return	The time in milliseconds or -1 if no timers are armed
+ */
+long
+timer_next()
+{
+	return timer_wheel_next(&poll_wheel, timer_now());
+}
@@ -80,6 +80,8 @@ USERS 	*rval;
 void
 users_free(USERS *users)
 {
+	if (users->usersIndexFree)
+		users->usersIndexFree(users->index);
 	hashtable_free(users->data);
 	free(users);
 }
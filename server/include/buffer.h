@@ -112,7 +112,8 @@ typedef enum
  */
 typedef enum 
 {
-        GWBUF_PARSING_INFO
+        GWBUF_PARSING_INFO,
+        GWBUF_CLASSIFIER_CACHE	/*< Cached classification of the query */
 } bufobj_id_t;
 
 typedef struct buffer_object_st buffer_object_t;
@@ -174,10 +175,27 @@ typedef struct gwbuf {
 #define GWBUF_RTRIM(b, bytes)	((b)->end = bytes > ((char *)(b)->end - (char *)(b)->start) ? (b)->start : (void *)((char *)(b)->end - (bytes)));
 
 #define GWBUF_TYPE(b) (b)->gwbuf_type
+
+/**
+ * The statistics of the per-thread buffer pools
+ */
+typedef struct {
+	int	n_pools;	/*< Number of active thread pools */
+	int	n_alloc;	/*< Number of blocks allocated through the pools */
+	int	n_hit;		/*< Number of allocations served from a free list */
+	int	n_miss;		/*< Number of allocations that called malloc */
+	int	n_oversize;	/*< Number of allocations too large to be pooled */
+	int	n_remote_free;	/*< Number of blocks freed by a thread other than the owner */
+	int	n_released;	/*< Number of blocks returned to malloc from full free lists */
+} GWBUF_POOL_STATS;
+
+struct dcb;
+
 /*<
  * Function prototypes for the API to maniplate the buffers
  */
 extern GWBUF		*gwbuf_alloc(unsigned int size);
+extern unsigned int	gwbuf_pool_fit(unsigned int size);
 extern void		gwbuf_free(GWBUF *buf);
 extern GWBUF		*gwbuf_clone(GWBUF *buf);
 extern GWBUF		*gwbuf_append(GWBUF *head, GWBUF *tail);
@@ -199,6 +217,8 @@ void                    gwbuf_add_buffer_object(GWBUF* buf,
                                                 void*  data,
                                                 void (*donefun_fp)(void *));
 void*                   gwbuf_get_buffer_object_data(GWBUF* buf, bufobj_id_t id);
+extern void		gwbuf_pool_stats(GWBUF_POOL_STATS *stats);
+extern void		dprintBufferStats(struct dcb *);
 EXTERN_C_BLOCK_END
 
 
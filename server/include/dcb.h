@@ -21,8 +21,10 @@
 #include <buffer.h>
 #include <modinfo.h>
 #include <gwbitmask.h>
+#include <timer.h>
 #include <skygw_utils.h>
 #include <netinet/in.h>
+#include <time.h>
 #include <openssl/crypto.h>
 #include <openssl/ssl.h>
 #include <openssl/err.h>
@@ -76,7 +78,9 @@ struct dcb;
 	 *	hangup		EPOLLHUP handler for the socket
 	 *	accept		Accept handler for listener socket only
 	 *	connect		Create a connection to the specified server
-	 *			for the session pased in
+	 *			for the session pased in, or reset a
+	 *			persistent connection that already has its
+	 *			protocol data for use by the session
 	 *	close		MaxScale close entry point for the socket
 	 *	listen		Create a listener for the protocol
 	 *	auth		Authentication entry point
@@ -113,6 +117,8 @@ typedef struct gw_protocol {
  *	eventqlock		Spinlock to protect this structure
  *	inserted		Insertion time for logging purposes
  *	started			Time that the processign started
+ *	owner			The polling thread that owns the DCB when poll
+ *				affinity is used, -1 for the shared queue
  */
 typedef struct {
 	struct	dcb	*next;
@@ -123,6 +129,7 @@ typedef struct {
 	SPINLOCK	eventqlock;
 	unsigned long	inserted;
 	unsigned long	started;
+	int		owner;
 } DCBEVENTQ;
 
 /**
@@ -158,17 +165,33 @@ typedef struct dcbstats {
  * processing an event that will access the DCB.
  *
  * We solve this issue by making the dcb_free routine merely mark a DCB as a zombie and
- * place it on a special zombie list. Before placing the DCB on the zombie list we create
- * a bitmask with a bit set in it for each active polling thread. Each thread will call
- * a routine to process the zombie list at the end of the polling loop. This routine
- * will clear the bit value that corresponds to the calling thread. Once the bitmask
- * is completely cleared the DCB can finally be freed and removed from the zombie list.
+ * place it on a special zombie list. The DCB is stamped with the current zombie epoch
+ * and the epoch is advanced. Each polling thread records the epoch it has seen when it
+ * calls the routine to process the zombie list at the end of the polling loop, which is
+ * a point where it holds no references to DCBs. Once every running polling thread has
+ * recorded a later epoch than the one of the DCB, the DCB can finally be freed and
+ * removed from the zombie list.
  */
 typedef struct {
-	GWBITMASK	bitmask;	/*< The bitmask of threads */
+	unsigned long	epoch;		/*< The zombie epoch when the DCB became a zombie */
+	unsigned long	added;		/*< Heartbeat when the DCB became a zombie */
 	struct dcb	*next;		/*< Next pointer for the zombie list */
 } DCBMM;
 
+/**
+ * The statistics of the zombie DCB reclamation. The ages are in housekeeper
+ * heartbeats, which are tenths of a second.
+ */
+typedef struct {
+	int		n_zombies;	/*< Current number of zombie DCBs */
+	int		n_added;	/*< Number of DCBs that became zombies */
+	int		n_freed;	/*< Number of zombie DCBs freed */
+	int		n_batches;	/*< Number of reclamations that freed DCBs */
+	int		max_batch;	/*< Largest number of DCBs freed at once */
+	unsigned long	total_age;	/*< Sum of the ages of the freed DCBs */
+	unsigned long	max_age;	/*< Age of the oldest freed DCB */
+} ZOMBIESTATS;
+
 /* DCB states */
 typedef enum {
         DCB_STATE_UNDEFINED,    /*< State variable with no state */
@@ -178,6 +201,7 @@ typedef enum {
         DCB_STATE_DISCONNECTED, /*< The socket is now closed */
         DCB_STATE_NOPOLLING,    /*< Removed from poll mask */
         DCB_STATE_ZOMBIE,       /*< DCB is no longer active, waiting to free it */
+        DCB_STATE_PERSISTENT,   /*< Idle in the persistent pool of the server */
         DCB_STATE_FREED         /*< Memory freed */
 } dcb_state_t;
 
@@ -252,6 +276,7 @@ typedef struct dcb {
 	DCBSTATS	stats;		/**< DCB related statistics */
         unsigned int    dcb_server_status; /*< the server role indicator from SERVER */
 	struct dcb	*next;		/**< Next DCB in the chain of allocated DCB's */
+	struct dcb	*prev;		/**< Previous DCB in the chain of allocated DCB's */
 	struct service	*service;	/**< The related service */
 	void		*data;		/**< Specific client data */
 	DCBMM		memdata;	/**< The data related to DCB memory management */
@@ -265,9 +290,13 @@ typedef struct dcb {
 	int		polloutbusy;
 	int		writecheck;
         unsigned long          last_read;      /*< Last time the DCB received data */
+	TIMER		timer;		/**< Timer of the DCB, e.g. the idle timeout of a client */
+	int		read_size;	/**< Size of the next read, adapted to recent reads */
 	unsigned int	high_water;	/**< High water mark */
 	unsigned int	low_water;	/**< Low water mark */
 	struct server	*server;	/**< The associated backend server */
+	struct dcb	*nextpersistent;	/**< Next DCB in the persistent pool */
+	time_t		persistentstart;	/**< Time when the DCB was put in the pool */
         SSL* ssl; /*< SSL struct for connection */
 #if defined(SS_DEBUG)
         int             dcb_port;       /**< port of target server */
@@ -308,8 +337,17 @@ int           fail_accept_errno;
 
 #define	DCB_POLL_BUSY(x)		((x)->evq.next != NULL)
 
+/** Maximum number of buffers written with a single system call */
+#define	DCB_MAX_IOV			64
+
+/** Initial and smallest adaptive read size of a DCB */
+#define	DCB_MIN_READ_SIZE		512
+
+struct iovec;
+
 DCB             *dcb_get_zombies(void);
 int             gw_write(DCB *, const void *, size_t);
+int             gw_writev(DCB *, const struct iovec *, int);
 int             dcb_write(DCB *, GWBUF *);
 DCB             *dcb_alloc(dcb_role_t);
 void            dcb_free(DCB *);
@@ -320,6 +358,11 @@ int             dcb_read_n(DCB*,GWBUF **,int);
 int             dcb_drain_writeq(DCB *);
 void            dcb_close(DCB *);
 DCB		*dcb_process_zombies(int);		/* Process Zombies except the one behind the pointer */
+int		dcb_zombies_init(int);			/* Allocate the epochs of the polling threads */
+void		dcb_zombies_thread_start(int);		/* Polling thread starts to reference DCBs */
+void		dcb_zombies_thread_stop(int);		/* Polling thread no longer references DCBs */
+void		dcb_zombie_stats(ZOMBIESTATS *);	/* Get the zombie reclamation statistics */
+void		dprintZombieStats(DCB *);		/* Print the zombie reclamation statistics */
 void		printAllDCBs();				/* Debug to print all DCB in the system */
 void		printDCB(DCB *);			/* Debug print routine */
 void		dprintAllDCBs(DCB *);			/* Debug to print all DCB in the system */
@@ -331,6 +374,8 @@ void		dcb_printf(DCB *, const char *, ...);	/* DCB version of printf */
 int		dcb_isclient(DCB *);			/* the DCB is the client of the session */
 void		dcb_hashtable_stats(DCB *, void *);	/**< Print statisitics */
 void            dcb_add_to_zombieslist(DCB* dcb);
+bool		dcb_persistent_keep(DCB *);		/* Keep a closing backend DCB for reuse */
+int		dcb_persistent_clean_count(struct server *, bool);	/* Purge the persistent pool of a server */
 int		dcb_add_callback(DCB *, DCB_REASON, int	(*)(struct dcb *, DCB_REASON, void *),
 			 void *);
 int		dcb_remove_callback(DCB *, DCB_REASON, int (*)(struct dcb *, DCB_REASON, void *),
@@ -357,6 +402,7 @@ int dcb_drain_writeq_SSL(DCB *dcb);
 #define	DCBF_CLONE		0x0001	/*< DCB is a clone */
 #define DCBF_HUNG		0x0002	/*< Hangup has been dispatched */
 #define DCBF_REPLIED    0x0004	/*< DCB was written to */
+#define DCBF_PERSISTENT	0x0008	/*< DCB goes to the persistent pool when freed */
 
 #define DCB_IS_CLONE(d) ((d)->flags & DCBF_CLONE)
 #define DCB_REPLIED(d) ((d)->flags & DCBF_REPLIED)
@@ -47,9 +47,21 @@
 typedef struct hashentry {
 	void			*key;	/**< The value of the key or NULL if empty entry */
 	void			*value;	/**< The value associated with key */
+	unsigned int		hash;	/**< The mixed hash value of the key */
 	struct	hashentry	*next;	/**< The overflow chain */
 } HASHENTRIES;
 
+/**
+ * The lock of a stripe of hash chains. Chain i belongs to the stripe
+ * i % nlocks, the number of chains is always a multiple of nlocks.
+ */
+typedef struct hashlock {
+	SPINLOCK	spin;		/**< Protects the reader and writer counts */
+	int		n_readers;	/**< Number of clients reading the stripe */
+	int		writelock;	/**< The stripe is locked by a writer */
+	int		migrate_next;	/**< Next old chain of the stripe to migrate */
+} HASHLOCK;
+
 /**
  * HASHTABLE iterator - used to walk the hashtable in a thread safe
  * way
@@ -57,10 +69,25 @@ typedef struct hashentry {
 typedef struct hashiterator {
 	struct hashtable
 			*table;		/**< The hashtable the iterator refers to */
-	int		chain;		/**< The current chain we are walking */
+	int		chain;		/**< The current chain we are walking, the chains
+					 * of a resize in progress come first */
 	int		depth;		/**< The current depth down the chain */
 } HASHITERATOR;
 
+/**
+ * Hashtable statistics
+ */
+typedef struct hashtable_stats {
+	int		hashsize;	/**< The number of hash chains */
+	int		nelems;		/**< The number of entries */
+	int		longest;	/**< Length of the longest chain */
+	int		nchains;	/**< The number of chains that are not empty */
+	float		load_factor;	/**< Entries per hash chain */
+	float		avg_chain;	/**< Average length of the chains that are not empty */
+	int		n_resizes;	/**< Number of times the table has grown */
+	bool		resizing;	/**< Entries are being moved to a larger table */
+} HASHTABLE_STATS;
+
 /**
  * The type definition for the memory allocation functions
  */
@@ -75,15 +102,20 @@ typedef struct hashtable {
 #endif
 	int		hashsize;			/**< The number of HASHENTRIES */
 	HASHENTRIES	**entries;			/**< The entries themselves */
+	int		old_size;			/**< Size of the table being resized */
+	HASHENTRIES	**old_entries;			/**< Entries not yet moved by a resize */
+	int		nlocks;				/**< The number of stripe locks */
+	HASHLOCK	*locks;				/**< The stripe locks */
+	int		nelems;				/**< The number of entries */
+	int		n_migrated;			/**< Stripes moved by the resize */
+	int		n_resizes;			/**< Number of times the table has grown */
 	int		(*hashfn)(void *);		/**< The hash function */
 	int		(*cmpfn)(void *, void *);	/**< The key comparison function */
 	HASHMEMORYFN	kcopyfn;			/**< Optional key copy function */
 	HASHMEMORYFN	vcopyfn;			/**< Optional value copy function */
 	HASHMEMORYFN	kfreefn;			/**< Optional key free function */
 	HASHMEMORYFN	vfreefn;			/**< Optional value free function */
-	SPINLOCK	spin;				/**< Internal spinlock for the hashtable */
-	int		n_readers;			/**< Number of clients reading the table */
-	int		writelock;			/**< The table is locked by a writer */
+	SPINLOCK	spin;				/**< Serialises resizing of the hashtable */
 	bool            ht_isflat;			/**< Indicates whether hashtable is in stack or heap */
 #if defined(SS_DEBUG)
         skygw_chk_t     ht_chk_tail;
@@ -112,10 +144,8 @@ extern void		*hashtable_fetch(HASHTABLE *, void *);
 				/**< Fetch the data for a given key */
 extern void		hashtable_stats(HASHTABLE *);			/**< Print statisitics */
 void hashtable_get_stats(
-        void* hashtable,
-        int*  hashsize,
-        int*  nelems,
-        int*  longest);
+        void*            hashtable,
+        HASHTABLE_STATS* stats);
 extern int		hashtable_save(HASHTABLE *,
 					char *,
 					int (*keywrite)(int, void*),
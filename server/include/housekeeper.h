@@ -20,6 +20,7 @@
 #include <time.h>
 #include <dcb.h>
 #include <hk_heartbeat.h>
+#include <timer.h>
 /**
  * @file housekeeper.h A mechanism to have task run periodically
  *
@@ -46,6 +47,7 @@ typedef struct hktask {
 	void	*data;			/*< Data to pass the task */
 	int	frequency;		/*< How often to call the tasks (seconds) */
 	time_t	nextdue;		/*< When the task should be next run */
+	TIMER	timer;			/*< Timer for the next run of the task */
 	HKTASK_TYPE
 		type;			/*< The task type */
 	struct	hktask
@@ -38,6 +38,7 @@
 
 #define		DEFAULT_NBPOLLS		3	/**< Default number of non block polls before we block */
 #define		DEFAULT_POLLSLEEP	1000	/**< Default poll wait time (milliseconds) */
+#define		DEFAULT_QC_CACHE_SIZE	4096	/**< Default number of cached query classifications */
 #define		_SYSNAME_STR_LENGTH	256	/**< sysname len */
 #define		_RELEASE_STR_LENGTH	256	/**< release len */
 /**
@@ -104,6 +105,8 @@ typedef struct {
 	unsigned long		id;					/**< MaxScale ID */
 	unsigned int		n_nbpoll;		/**< Tune number of non-blocking polls */
 	unsigned int		pollsleep;		/**< Wait time in blocking polls */
+	int			poll_affinity;		/**< Per-thread epoll sets and event queues */
+	int			qc_cache_size;		/**< Entries in the query classification cache */
 } GATEWAY_CONF;
 
 extern int		config_load(char *);
@@ -111,6 +114,8 @@ extern int		config_reload();
 extern int		config_threadcount();
 extern unsigned int	config_nbpolls();
 extern unsigned int	config_pollsleep();
+extern int		config_poll_affinity();
+extern int		config_qc_cache_size();
 CONFIG_PARAMETER*	config_get_param(CONFIG_PARAMETER* params, const char* name);
 config_param_type_t 	config_get_paramtype(CONFIG_PARAMETER* param);
 CONFIG_PARAMETER*	config_clone_param(CONFIG_PARAMETER* param);
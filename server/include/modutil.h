@@ -43,6 +43,16 @@
 #define IS_FULL_RESPONSE(buf) (modutil_count_signal_packets(buf,0,0) == 2)
 #define PTR_EOF_MORE_RESULTS(b) ((PTR_IS_EOF(b) && ptr[7] & 0x08))
 
+/**
+ * The state of the reply a server is sending to a command, used to find
+ * where each reply ends.
+ */
+typedef enum reply_state {
+	REPLY_STATE_START = 0,	/*< Waiting for the first packet of a reply */
+	REPLY_STATE_RSET_COLDEF,/*< Reading the column definitions */
+	REPLY_STATE_RSET_ROWS	/*< Reading the rows of a result set */
+} reply_state_t;
+
 
 extern int	modutil_is_SQL(GWBUF *);
 extern int	modutil_is_SQL_prepare(GWBUF *);
@@ -68,4 +78,5 @@ GWBUF *modutil_create_mysql_err_msg(
 	const char	*msg);
 
 int modutil_count_signal_packets(GWBUF*,int,int,int*);
+int modutil_count_replies(GWBUF *, int, reply_state_t *);
 #endif
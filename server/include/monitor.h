@@ -128,6 +128,8 @@ typedef struct monitor_servers {
 	int		mon_err_count;
 	unsigned int	mon_prev_status;
 	unsigned int	pending_status; /**< Pending Status flag bitmap */
+	unsigned long	probe_time;	/**< Duration of the last probe in microseconds */
+	unsigned long	probe_max;	/**< Longest probe in microseconds */
 	struct monitor_servers
 			*next;		/**< The next server in the list */
 } MONITOR_SERVERS;
@@ -67,8 +67,19 @@ typedef struct {
 	int		n_connections;	/**< Number of connections */
 	int		n_current;	/**< Current connections */
 	int             n_current_ops;  /**< Current active operations */
+	int		n_persistent;	/**< Current persistent pool */
+	int		n_pool_hits;	/**< Connections taken from the pool */
+	int		n_pool_misses;	/**< Connections the pool could not provide */
+	int		avg_response;	/**< Moving average of the response time in
+					 *   microseconds, 0 until measured */
 } SERVER_STATS;
 
+/**
+ * The weight of a new sample in the moving average of the response time
+ * is 1 / 2^SERVER_RESPONSE_SHIFT
+ */
+#define SERVER_RESPONSE_SHIFT	3
+
 /**
  * The SERVER structure defines a backend server. Each server has a name
  * or IP address for the server, a port that the server listens on and
@@ -95,6 +106,10 @@ typedef struct server {
 	int		depth;		/**< Replication level in the tree */
 	long		*slaves;	/**< Slaves of this node */
 	bool            master_err_is_logged; /*< If node failed, this indicates whether it is logged */
+	DCB		*persistent;	/**< List of unused persistent connections to the server */
+	SPINLOCK	persistlock;	/**< Lock for adjusting the persistent connections list */
+	long		persistpoolmax;	/**< Maximum size of persistent connections pool */
+	long		persistmaxtime;	/**< Maximum number of seconds connection can live */
 } SERVER;
 
 /**
@@ -193,4 +208,5 @@ extern void     server_set_unique_name(SERVER *, char *);
 extern void	server_update_address(SERVER *, char *);
 extern void	server_update_port(SERVER *,  unsigned short);
 extern RESULTSET	*serverGetList();
+extern void	server_add_response_time(SERVER *, unsigned long);
 #endif
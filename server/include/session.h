@@ -134,6 +134,7 @@ typedef struct session {
 	DOWNSTREAM	head;		  /*< Head of the filter chain */
 	UPSTREAM	tail;		  /*< The tail of the filter chain */
 	struct session	*next;		  /*< Linked list of all sessions */
+	struct session	*prev;		  /*< Previous session in the list */
 	int		refcount;	  /*< Reference count on the session */
 	bool            ses_is_child;	  /*< this is a child session */
 #if defined(SS_DEBUG)
@@ -177,7 +178,6 @@ bool	session_link_dcb(SESSION *, struct dcb *);
 SESSION* get_session_by_router_ses(void* rses);
 void session_enable_log(SESSION* ses, logfile_id_t id);
 void session_disable_log(SESSION* ses, logfile_id_t id);
-void session_close_timeouts(void* data);
 RESULTSET	*sessionGetList(SESSIONLISTFILTER);
 
 #endif
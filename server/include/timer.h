@@ -0,0 +1,79 @@
+#ifndef _TIMER_H
+#define _TIMER_H
+/*
+ * This file is distributed as part of the MariaDB Corporation MaxScale.  It is free
+ * software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation,
+ * version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#include <spinlock.h>
+
+/**
+ * @file timer.h	Hierarchical timer wheel
+ *
+ * Timers are embedded in the structures they belong to, arming, re-arming
+ * and cancelling a timer are constant time operations and advancing a
+ * wheel only visits the timers that expire. The resolution of the wheels
+ * is one millisecond.
+ */
+
+#define TIMER_SLOT_BITS	6
+#define TIMER_SLOTS	(1 << TIMER_SLOT_BITS)	/*< Slots in each level */
+#define TIMER_LEVELS	4			/*< Levels in a wheel */
+
+struct timer_wheel;
+
+/**
+ * A timer. The function is called with the timer and the data once
+ * the timer has expired, the timer may be re-armed from the function.
+ */
+typedef struct timer {
+	struct timer	*next;		/*< Next timer in the slot */
+	struct timer	*prev;		/*< Previous timer in the slot */
+	struct timer	**slot;		/*< The slot the timer is in */
+	struct timer_wheel
+			*wheel;		/*< The wheel the timer is armed in */
+	unsigned long	expires;	/*< Expiry time in milliseconds */
+	void		(*fn)(struct timer *, void *);
+					/*< Function called on expiry */
+	void		*data;		/*< Data passed to the function */
+} TIMER;
+
+/**
+ * A timer wheel. Level 0 has a slot for each millisecond, every further
+ * level has slots that span the whole of the level below it. Timers that
+ * expire beyond the last level wait in its furthest slot.
+ */
+typedef struct timer_wheel {
+	SPINLOCK	lock;		/*< Protects the wheel */
+	unsigned long	current;	/*< Time up to which timers have expired */
+	int		running;	/*< A thread is advancing the wheel */
+	int		count;		/*< Number of armed timers */
+	TIMER		*slots[TIMER_LEVELS][TIMER_SLOTS];
+					/*< Timers by expiry time */
+	TIMER		*expired;	/*< Expired timers waiting to be called */
+} TIMER_WHEEL;
+
+#define TIMER_ARMED(t)	((t)->wheel != NULL)
+
+extern unsigned long	timer_now();
+extern unsigned long	timer_now_usec();
+extern void	timer_init(TIMER *, void (*)(TIMER *, void *), void *);
+extern void	timer_wheel_init(TIMER_WHEEL *, unsigned long);
+extern void	timer_wheel_add(TIMER_WHEEL *, TIMER *, unsigned long);
+extern int	timer_wheel_process(TIMER_WHEEL *, unsigned long);
+extern long	timer_wheel_next(TIMER_WHEEL *, unsigned long);
+extern int	timer_cancel(TIMER *);
+extern void	timer_add(TIMER *, unsigned long);
+extern int	timer_process();
+extern long	timer_next();
+#endif
@@ -56,6 +56,8 @@ typedef struct {
 typedef struct users {
 	HASHTABLE	*data;			/**< The hashtable containing the actual data */
         char *(*usersCustomUserFormat)(void *);	/**< Optional username format routine */	
+	void		*index;			/**< Optional lookup index of the users */
+	void		(*usersIndexFree)(void *);	/**< Routine that frees the index */
 	USERS_STATS	stats;			/**< The statistics for the users table */
 	unsigned char
 		cksum[SHA_DIGEST_LENGTH];	/**< The users' table ckecksum */
@@ -46,6 +46,9 @@
 
 #define BINLOG_EVENT_HDR_LEN	19
 
+/** Size of the chunks of binlog files read ahead for slaves in catchup mode */
+#define BLR_READAHEAD_SIZE	(256 * 1024)
+
 /**
  * Binlog event types
  */
@@ -134,6 +137,23 @@
 #define DEF_LONG_BURST		500
 #define DEF_BURST_SIZE		1024000	/* 1 Mb */
 
+/**
+ * Binlog durability modes, set with the router option flushmode.
+ *
+ * BLR_FLUSH_SYNC	fsync the binlog after each read from the master
+ * BLR_FLUSH_GROUP	fsync from a background thread every flushinterval
+ *			milliseconds or flushbytes bytes
+ * BLR_FLUSH_DURABLE	coalesce the events of each read from the master,
+ *			write and fsync them together and only then send
+ *			them to the slaves
+ */
+#define BLR_FLUSH_SYNC		0
+#define BLR_FLUSH_GROUP		1
+#define BLR_FLUSH_DURABLE	2
+
+#define DEF_FLUSH_INTERVAL	1000	/* milliseconds */
+#define DEF_FLUSH_BYTES		1048576	/* 1 Mb */
+
 /**
  * master reconnect backoff constants
  * BLR_MASTER_BACKOFF_TIME	The increments of the back off time (seconds)
@@ -198,6 +218,16 @@ typedef struct blfile {
 	struct blfile	*next;				/*< Next file in list */
 } BLFILE;
 
+/**
+ * A chunk of a binlog file read ahead for a slave in catchup mode. The
+ * events are sliced out of the chunk without copying them.
+ */
+typedef struct {
+	char		binlogname[BINLOG_FNAMELEN+1];	/*< Name of the binlog file */
+	unsigned long	pos;				/*< File position of the chunk */
+	GWBUF		*buf;				/*< The chunk or NULL */
+} BLREADAHEAD;
+
 /**
  * Slave statistics
  */
@@ -213,6 +243,8 @@ typedef struct {
 	int		n_dcb;
 	int		n_above;
 	int		n_failed_read;
+	uint64_t	n_catchup_bytes;/*< Number of bytes sent in catchup mode */
+	uint64_t	catchup_usecs;	/*< Time spent sending in catchup mode */
 	int		n_overrun;
 	int		n_caughtup;
 	int		n_actions[3];
@@ -236,6 +268,7 @@ typedef struct router_slave {
 					/*< Current binlog file for this slave */
 	char		*uuid;		/*< Slave UUID */
 	BLFILE		*file;		/*< Currently open binlog file */
+	BLREADAHEAD	readahead;	/*< Binlog data read ahead in catchup */
 	int		serverid;	/*< Server-id of the slave */
 	char		*hostname;	/*< Hostname of the slave, if known */
 	char		*user;		/*< Username if given */
@@ -283,6 +316,13 @@ typedef struct {
 	uint64_t	n_fakeevents;	/*< Fake events not written to disk */
 	uint64_t	n_artificial;	/*< Artificial events not written to disk */
 	int		n_badcrc;	/*< No. of bad CRC's from master */
+	uint64_t	n_catchup_bytes;/*< Bytes sent to slaves in catchup mode */
+	uint64_t	catchup_usecs;	/*< Time spent sending to slaves in catchup mode */
+	uint64_t	n_fsyncs;	/*< Number of binlog fsync calls */
+	uint64_t	n_fsync_bytes;	/*< Bytes made durable by those calls */
+	uint64_t	fsync_usecs;	/*< Time spent in fsync */
+	uint64_t	n_groups;	/*< Number of durable group commits */
+	uint64_t	n_group_events;	/*< Events written by group commits */
 	uint64_t	events[MAX_EVENT_TYPE_END + 1];	/*< Per event counters */
 	uint64_t	lastsample;
 	int		minno;
@@ -312,6 +352,21 @@ typedef struct {
 	int		fde_len;	/*< Length of fde_event */
 } MASTER_RESPONSES;
 
+/**
+ * The binlog write state used by the group and durable flush modes
+ */
+typedef struct {
+	uint8_t		*buf;		/*< Coalesced events not yet written */
+	unsigned int	size;		/*< Allocated size of buf */
+	unsigned int	len;		/*< Bytes of event data in buf */
+	uint64_t	start;		/*< Binlog position of the first byte in buf */
+	REP_HEADER	*events;	/*< Headers of the events in buf */
+	int		n_events;	/*< Number of events in buf */
+	int		max_events;	/*< Allocated size of events */
+	uint64_t	unsynced;	/*< Bytes written since the last fsync */
+	void		*flusher;	/*< Background flusher thread */
+} BLRGROUP;
+
 /**
  * The per instance data for the router.
  */
@@ -357,6 +412,10 @@ typedef struct router_instance {
 	unsigned int		long_burst;	/*< Long burst for slave catchup */
 	unsigned long		burst_size;	/*< Maximum size of burst to send */
 	unsigned long		heartbeat;	/*< Configured heartbeat value */
+	int			flush_mode;	/*< Binlog durability mode */
+	int			flush_interval;	/*< Group fsync interval in ms */
+	unsigned long		flush_bytes;	/*< Group fsync/commit size */
+	BLRGROUP		group;		/*< Pending binlog writes */
 	ROUTER_STATS		stats;		/*< Statistics for this router */
 	int			active_logs;
 	int			reconnect_pending;
@@ -468,9 +527,15 @@ extern void blr_init_cache(ROUTER_INSTANCE *);
 extern int  blr_file_init(ROUTER_INSTANCE *);
 extern int  blr_write_binlog_record(ROUTER_INSTANCE *, REP_HEADER *,uint8_t *);
 extern int  blr_file_rotate(ROUTER_INSTANCE *, char *, uint64_t);
-extern void blr_file_flush(ROUTER_INSTANCE *);
+extern int  blr_file_flush(ROUTER_INSTANCE *);
+extern int  blr_file_sync(ROUTER_INSTANCE *);
+extern void blr_file_start_flusher(ROUTER_INSTANCE *);
+extern void blr_distribute_binlog_record(ROUTER_INSTANCE *, REP_HEADER *, uint8_t *, GWBUF *);
 extern BLFILE *blr_open_binlog(ROUTER_INSTANCE *, char *);
 extern GWBUF *blr_read_binlog(ROUTER_INSTANCE *, BLFILE *, unsigned int, REP_HEADER *);
+extern GWBUF *blr_read_binlog_ahead(ROUTER_INSTANCE *, BLFILE *, unsigned int, REP_HEADER *,
+					BLREADAHEAD *);
+extern void blr_readahead_free(BLREADAHEAD *);
 extern void blr_close_binlog(ROUTER_INSTANCE *, BLFILE *);
 extern unsigned long blr_file_size(BLFILE *);
 extern int blr_statistics(ROUTER_INSTANCE *, ROUTER_SLAVE *, GWBUF *);
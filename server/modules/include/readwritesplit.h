@@ -31,6 +31,7 @@
 
 #include <dcb.h>
 #include <hashtable.h>
+#include <modutil.h>
 #include <math.h>
 
 #undef PREP_STMT_CACHING
@@ -116,8 +117,9 @@ typedef enum select_criteria {
         LEAST_ROUTER_CONNECTIONS, /*< connections established by this router */
         LEAST_BEHIND_MASTER,
         LEAST_CURRENT_OPERATIONS,
+        LEAST_RESPONSE_TIME, /*< response time times active operations */
         DEFAULT_CRITERIA=LEAST_CURRENT_OPERATIONS,
-        LAST_CRITERIA /*< not used except for an index */
+        LAST_CRITERIA=LEAST_RESPONSE_TIME+1 /*< not used except for an index */
 } select_criteria_t;
 
 
@@ -134,7 +136,9 @@ typedef enum select_criteria {
         strncmp(s,"LEAST_ROUTER_CONNECTIONS", strlen("LEAST_ROUTER_CONNECTIONS")) == 0 ?        \
         LEAST_ROUTER_CONNECTIONS : (                                                            \
         strncmp(s,"LEAST_CURRENT_OPERATIONS", strlen("LEAST_CURRENT_OPERATIONS")) == 0 ?        \
-        LEAST_CURRENT_OPERATIONS : UNDEFINED_CRITERIA))))
+        LEAST_CURRENT_OPERATIONS : (                                                            \
+        strncmp(s,"LEAST_RESPONSE_TIME", strlen("LEAST_RESPONSE_TIME")) == 0 ?                  \
+        LEAST_RESPONSE_TIME : UNDEFINED_CRITERIA)))))
         
 /**
  * Session variable command
@@ -234,6 +238,9 @@ typedef struct backend_ref_st {
         int             bref_num_result_wait;
         sescmd_cursor_t bref_sescmd_cur;
 	GWBUF*          bref_pending_cmd; /*< For stmt which can't be routed due active sescmd execution */
+	unsigned long   bref_sent;	/*< Time the active query was sent in microseconds */
+	reply_state_t   bref_reply_state; /*< State of the reply being read */
+	unsigned char   bref_query_cmd;	/*< Command of the active query */
         unsigned char
 		reply_cmd;	/*< The reply the backend server sent to a session command.
                                  * Used to detect slaves that fail to execute session command. */
@@ -253,6 +260,7 @@ typedef struct rwsplit_config_st {
         bool disable_sescmd_hist;
         bool disable_slave_recovery;
         bool master_reads; /*< Use master for reads */
+        bool balance_reads; /*< Balance each read over the connected slaves */
 } rwsplit_config_t;
      
 
@@ -297,6 +305,7 @@ struct router_client_session {
         bool             rses_transaction_active;
         DCB* client_dcb;
         int             pos_generator;
+        int              rses_next_read; /*< Backend the next balanced read is tried on first */
 #if defined(PREP_STMT_CACHING)
         HASHTABLE*       rses_prep_stmt[2];
 #endif
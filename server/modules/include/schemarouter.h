@@ -32,6 +32,8 @@
 #include <dcb.h>
 #include <hashtable.h>
 #include <mysql_client_server_protocol.h>
+#include <query_classifier.h>
+#include <modutil.h>
 
 /**
  * Bitmask values for the router session's initialization. These values are used
@@ -46,6 +48,16 @@ typedef enum init_mask
 
 } init_mask_t;
 
+/**
+ * How the values of an aggregated column of a scattered statement are combined
+ */
+typedef enum sg_merge_kind {
+        SG_MERGE_NONE = 0,  /*< The values can't be combined exactly */
+        SG_MERGE_EXACT,     /*< Integers and decimals, added and compared exactly */
+        SG_MERGE_FLOAT,     /*< Floating point numbers */
+        SG_MERGE_BINARY     /*< Binary strings and dates, compared byte by byte */
+} sg_merge_kind_t;
+
 /** 
  * The state of the backend server reference
  */
@@ -227,6 +239,10 @@ typedef struct backend_ref_st {
         int             bref_num_result_wait; /*< Number of not yet received results */
         sescmd_cursor_t bref_sescmd_cur; /*< Session command cursor */
 	GWBUF*          bref_pending_cmd; /*< For stmt which can't be routed due active sescmd execution */
+        GWBUF*          sg_reply; /*< Unprocessed part of the reply to a scattered statement */
+        GWBUF*          sg_header; /*< Column definitions of the reply to a scattered statement */
+        reply_state_t   sg_state; /*< State of the reply to a scattered statement */
+        bool            sg_waiting; /*< Waiting for the reply to a scattered statement */
 #if defined(SS_DEBUG)
         skygw_chk_t     bref_chk_tail;
 #endif
@@ -241,8 +257,24 @@ typedef struct schemarouter_config_st {
 	target_t          rw_use_sql_variables_in;
         int max_sescmd_hist;
         bool disable_sescmd_hist;
+        int refresh_interval; /*< Seconds before the shard map is refreshed */
 } schemarouter_config_t;
 
+/**
+ * A map of the databases to the servers that contain them. The map of the
+ * router instance is loaded with the credentials of the service and shared
+ * by the router sessions. It is not modified after it has been published,
+ * a session that needs a new map generates one of its own.
+ */
+typedef struct shard_map_st {
+        HASHTABLE*      hash;         /*< Database names mapped to server names */
+        HASHTABLE*      shards;       /*< Databases on more than one server mapped to
+                                       * comma separated lists of the servers */
+        int             refcount;     /*< Number of references to the map */
+        int             generation;   /*< Map generation when loading started */
+        time_t          last_updated; /*< When the map was published */
+} shard_map_t;
+
 /**
  * The statistics for this router instance
  */
@@ -256,6 +288,9 @@ typedef struct {
         double          ses_longest;      /*< Longest session */
         double          ses_shortest; /*< Shortest session */
         double          ses_average; /*< Average session length */
+        int             shmap_cache_hit; /*< Sessions that used the shared shard map */
+        int             shmap_cache_miss; /*< Sessions that mapped the databases */
+        int             n_scattered; /*< Statements scattered to several servers */
 } ROUTER_STATS;
 
 /**
@@ -282,11 +317,27 @@ struct router_client_session {
 	struct router_instance	 *router;	/*< The router instance */
         struct router_client_session* next; /*< List of router sessions */
         HASHTABLE*      dbhash; /*< Database hash containing names of the databases mapped to the servers that contain them */
+        HASHTABLE*      shardhash; /*< Databases that are on more than one server mapped to the servers that contain them */
+        shard_map_t*    shard_map; /*< Shared map that dbhash belongs to, NULL if the session maps the databases itself */
+        bool            map_invalidate; /*< Invalidate the instance map on the next reply */
         char            connect_db[MYSQL_DATABASE_MAXLEN+1]; /*< Database the user was trying to connect to */
         init_mask_t    init; /*< Initialization state bitmask */
         GWBUF*          queue; /*< Query that was received before the session was ready */
         DCB*            dcb_route; /*< Internal DCB used to trigger re-routing of buffers */
         DCB*            dcb_reply; /*< Internal DCB used to send replies to the client */
+        int             sg_pending; /*< Servers that have not replied to a scattered statement */
+        skygw_query_agg_t* sg_aggs; /*< Aggregates merged into one row, NULL if the rows are concatenated */
+        int             sg_naggs; /*< Number of columns in sg_aggs */
+        sg_merge_kind_t* sg_kinds; /*< How each column of sg_aggs is combined */
+        int             sg_ncols; /*< Number of columns in the reply to a scattered statement */
+        GWBUF*          sg_header; /*< Column definitions of an aggregated reply */
+        char**          sg_row; /*< Aggregated row, NULL if the rows are streamed */
+        HASHTABLE*      sg_seen; /*< Rows already sent, NULL unless duplicates are left out */
+        GWBUF*          sg_error; /*< First error returned by a server */
+        uint8_t         sg_seqno; /*< Sequence number of the next packet sent to the client */
+        uint16_t        sg_status; /*< Server status of the final EOF packet */
+        bool            sg_failed; /*< The reply ends in an error */
+        bool            sg_incomplete; /*< A server failed to reply to a scattered statement */
         ROUTER_STATS    stats;     /*< Statistics for this router         */
         int             n_sescmd;
         int             pos_generator;
@@ -312,6 +363,11 @@ typedef struct router_instance {
 	ROUTER_STATS            stats;       /*< Statistics for this router         */
         struct router_instance* next;        /*< Next router on the list            */
 	bool			available_slaves; /*< The router has some slaves available */
+	shard_map_t*		shard_map;   /*< Latest published map of databases */
+	int			map_generation; /*< Incremented when the map becomes invalid */
+	bool			map_refreshing; /*< The map is being loaded */
+	void*			map_thread;  /*< Thread that loads the map, NULL if none */
+	time_t			map_retry;   /*< No refresh is started before this time */
 
 } ROUTER_INSTANCE;
 
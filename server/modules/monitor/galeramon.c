@@ -140,6 +140,7 @@ startMonitor(void *arg,void* opt)
 	handle->master = NULL;
 	handle->script = NULL;
 	memset(handle->events,false,sizeof(handle->events));
+	memset(&handle->prober,0,sizeof(handle->prober));
 	spinlock_init(&handle->lock);
     }
 
@@ -267,6 +268,7 @@ char		*sep;
 		db = db->next;
 	}
 	dcb_printf(dcb, "\n");
+	mon_print_probe_times(dcb, mon, &handle->prober);
 }
 
 /**
@@ -455,6 +457,7 @@ monitorMain(void *arg)
 GALERA_MONITOR		*handle;
 MONITOR_SERVERS		*ptr;
 size_t			nrounds = 0;
+unsigned long		cycle_start = 0;
 MONITOR_SERVERS		*candidate_master = NULL;
 int			master_stickiness;
 int			is_cluster=0;
@@ -473,6 +476,7 @@ monitor_event_t evtype;
                                    "module. Exiting.\n")));
                 return;
 	}                         
+	mon_prober_start(&handle->prober, mon);
 	handle->status = MONITOR_RUNNING;
 	
 	while (1)
@@ -480,26 +484,22 @@ monitor_event_t evtype;
 		if (handle->shutdown)
 		{
 			handle->status = MONITOR_STOPPING;
+			mon_prober_stop(&handle->prober);
 			mysql_thread_end();
 			handle->status = MONITOR_STOPPED;
 			return;
 		}
-		/** Wait base interval */
-		thread_millisleep(MON_BASE_INTERVAL_MS);
-		/** 
-		 * Calculate how far away the monitor interval is from its full 
-		 * cycle and if monitor interval time further than the base 
-		 * interval, then skip monitoring checks. Excluding the first
-		 * round.
-		 */ 
-
-		if (nrounds != 0 && ((nrounds*MON_BASE_INTERVAL_MS)%mon->interval) >= MON_BASE_INTERVAL_MS)
+		/**
+		 * Wait until the monitor interval has passed since the start
+		 * of the previous cycle. Excluding the first round.
+		 */
+		if (nrounds != 0 && mon_wait_interval(mon, cycle_start, &handle->shutdown))
 		{
-			nrounds += 1;
 			continue;
 		}
 
 		nrounds += 1;
+		cycle_start = timer_now();
 
 		/* reset cluster members counter */
 		is_cluster=0;
@@ -509,9 +509,16 @@ monitor_event_t evtype;
 		while (ptr)
 		{
 			ptr->mon_prev_status = ptr->server->status;
+			ptr = ptr->next;
+		}
 
-			monitorDatabase(mon, ptr);
+		/* probe all the nodes at the same time */
+		mon_probe_servers(&handle->prober, monitorDatabase, true);
 
+		ptr = mon->databases;
+
+		while (ptr)
+		{
 			/* clear bits for non member nodes */
 			if ( ! SERVER_IN_MAINT(ptr->server) && (ptr->server->node_id < 0 || ! SERVER_IS_JOINED(ptr->server))) {
 				ptr->server->depth = -1;
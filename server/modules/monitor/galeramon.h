@@ -62,6 +62,7 @@ typedef struct {
 	MONITOR_SERVERS *master;	/**< Master server for MySQL Master/Slave replication */
         char* script;
         bool events[MAX_MONITOR_EVENT]; /*< enabled events */
+	MON_PROBER prober;		/**< Probes the servers in parallel */
 } GALERA_MONITOR;
 
 #endif
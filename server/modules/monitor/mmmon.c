@@ -128,6 +128,7 @@ startMonitor(void *arg,void* opt)
 	handle->master = NULL;
 	handle->script = NULL;
 	memset(handle->events,false,sizeof(handle->events));
+	memset(&handle->prober,0,sizeof(handle->prober));
 	spinlock_init(&handle->lock);
     }
 
@@ -247,6 +248,7 @@ char		*sep;
 		db = db->next;
 	}
 	dcb_printf(dcb, "\n");
+	mon_print_probe_times(dcb, mon, &handle->prober);
 }
 
 /**
@@ -567,6 +569,7 @@ MONITOR_SERVERS	*ptr;
 int detect_stale_master;
 MONITOR_SERVERS *root_master;
 size_t nrounds = 0;
+unsigned long cycle_start = 0;
 
 spinlock_acquire(&mon->lock);
 handle = (MM_MONITOR *)mon->handle;
@@ -582,33 +585,30 @@ detect_stale_master = handle->detectStaleMaster;
 		return;
 	}                         
 
+	mon_prober_start(&handle->prober, mon);
 	handle->status = MONITOR_RUNNING;
 	while (1)
 	{
 		if (handle->shutdown)
 		{
 			handle->status = MONITOR_STOPPING;
+			mon_prober_stop(&handle->prober);
 			mysql_thread_end();
 			handle->status = MONITOR_STOPPED;
 			return;
 		}
 
-		/** Wait base interval */
-		thread_millisleep(MON_BASE_INTERVAL_MS);
 		/**
-		 * Calculate how far away the monitor interval is from its full
-		 * cycle and if monitor interval time further than the base
-		 * interval, then skip monitoring checks. Excluding the first
-		 * round.
+		 * Wait until the monitor interval has passed since the start
+		 * of the previous cycle. Excluding the first round.
 		 */
                 if (nrounds != 0 &&
-                        ((nrounds*MON_BASE_INTERVAL_MS)%mon->interval) >=
-                        MON_BASE_INTERVAL_MS)
+                        mon_wait_interval(mon, cycle_start, &handle->shutdown))
                 {
-                        nrounds += 1;
                         continue;
                 }
                 nrounds += 1;
+                cycle_start = timer_now();
 
 		/* start from the first server in the list */
 		ptr = mon->databases;
@@ -617,10 +617,16 @@ detect_stale_master = handle->detectStaleMaster;
 		{
 			/* copy server status into monitor pending_status */
 			ptr->pending_status = ptr->server->status;
+			ptr = ptr->next;
+		}
+
+		/* monitor all the nodes at the same time */
+		mon_probe_servers(&handle->prober, monitorDatabase, true);
 
-			/* monitor current node */
-			monitorDatabase(mon, ptr);
+		ptr = mon->databases;
 
+		while (ptr)
+		{
                         if (mon_status_changed(ptr))
                         {
                                 dcb_call_foreach(ptr->server,DCB_REASON_NOT_RESPONDING);
@@ -47,6 +47,7 @@ typedef struct {
 	MONITOR_SERVERS *master;	/**< Master server for Master/Slave replication */
     char* script; /*< Script to call when state changes occur on servers */
     bool events[MAX_MONITOR_EVENT]; /*< enabled events */
+	MON_PROBER prober;		/**< Probes the servers in parallel */
 } MM_MONITOR;
 
 #endif
@@ -17,6 +17,13 @@
  */
 
 #include <monitor_common.h>
+#include <thread.h>
+#include <atomic.h>
+
+/** Defined in log_manager.cc */
+extern int            lm_enabled_logfiles_bitmask;
+extern size_t         log_ses_count[];
+extern __thread log_info_t tls_log_info;
 
 monitor_event_t mon_name_to_event(char* tok);
 
@@ -407,3 +414,270 @@ monitor_event_t mon_name_to_event(char* tok)
 
     }
 
+/**
+ * Probe one server and record the time the probe took
+ *
+ * @param prober	The prober
+ * @param db		The server to probe
+ */
+static void mon_probe_one(MON_PROBER *prober, MONITOR_SERVERS *db)
+{
+    unsigned long start = timer_now_usec();
+    unsigned long elapsed;
+
+    prober->probe(prober->monitor, db);
+    if (prober->timed)
+    {
+	elapsed = timer_now_usec() - start;
+	db->probe_time = elapsed;
+	if (elapsed > db->probe_max)
+	    db->probe_max = elapsed;
+    }
+}
+
+/**
+ * The thread that probes one server. It waits for the start of a round,
+ * probes the server and the last thread of the round to finish wakes up
+ * the monitor thread.
+ *
+ * @param arg	The MON_PROBE_THREAD of the thread
+ */
+static void mon_probe_thread(void *arg)
+{
+    MON_PROBE_THREAD *pt = (MON_PROBE_THREAD *)arg;
+    MON_PROBER *prober = pt->prober;
+    bool mysql_init_done = true;
+
+    if (mysql_thread_init())
+    {
+	LOGIF(LE, (skygw_log_write_flush(
+		LOGFILE_ERROR,
+		"Error : mysql_thread_init failed in the probe thread of "
+		"server %s:%d.",
+		pt->db->server->name,
+		pt->db->server->port)));
+	mysql_init_done = false;
+    }
+
+    while (1)
+    {
+	skygw_message_wait(pt->start);
+	if (prober->shutdown)
+	    break;
+	mon_probe_one(prober, pt->db);
+	if (atomic_add(&prober->pending, -1) == 1)
+	    skygw_message_send(prober->done);
+    }
+
+    if (mysql_init_done)
+	mysql_thread_end();
+}
+
+/**
+ * Start a probe thread for each server of a monitor. If the threads can not
+ * be started the servers are probed one after another from the monitor
+ * thread.
+ *
+ * @param prober	The prober
+ * @param mon		The monitor
+ * @return True if the threads were started
+ */
+bool mon_prober_start(MON_PROBER *prober, MONITOR *mon)
+{
+    MONITOR_SERVERS *db;
+    MON_PROBE_THREAD *pt;
+    int n = 0;
+
+    prober->monitor = mon;
+    prober->threads = NULL;
+    prober->nthreads = 0;
+    prober->pending = 0;
+    prober->shutdown = false;
+    prober->done = NULL;
+
+    for (db = mon->databases; db; db = db->next)
+	n++;
+    if (n == 0)
+	return true;
+
+    if ((prober->threads = calloc(n, sizeof(MON_PROBE_THREAD))) == NULL ||
+	(prober->done = skygw_message_init()) == NULL)
+    {
+	LOGIF(LE, (skygw_log_write_flush(
+		LOGFILE_ERROR,
+		"Error : Memory allocation failed for the probe threads "
+		"of monitor %s.",
+		mon->name)));
+	mon_prober_stop(prober);
+	return false;
+    }
+
+    for (db = mon->databases; db; db = db->next)
+    {
+	pt = &prober->threads[prober->nthreads];
+	pt->prober = prober;
+	pt->db = db;
+	if ((pt->start = skygw_message_init()) == NULL)
+	    break;
+	if ((pt->thread = thread_start(mon_probe_thread, pt)) == NULL)
+	{
+	    skygw_message_done(pt->start);
+	    pt->start = NULL;
+	    break;
+	}
+	prober->nthreads++;
+    }
+
+    if (prober->nthreads < n)
+    {
+	LOGIF(LE, (skygw_log_write_flush(
+		LOGFILE_ERROR,
+		"Error : Failed to start the probe threads of monitor %s, "
+		"the servers are probed one after another.",
+		mon->name)));
+	mon_prober_stop(prober);
+	return false;
+    }
+    return true;
+}
+
+/**
+ * Stop the probe threads of a prober and wait for them to exit. The
+ * prober must not be in the middle of a round.
+ *
+ * @param prober	The prober
+ */
+void mon_prober_stop(MON_PROBER *prober)
+{
+    int i;
+
+    prober->shutdown = true;
+    for (i = 0; i < prober->nthreads; i++)
+	skygw_message_send(prober->threads[i].start);
+    for (i = 0; i < prober->nthreads; i++)
+    {
+	thread_wait(prober->threads[i].thread);
+	skygw_message_done(prober->threads[i].start);
+    }
+    free(prober->threads);
+    prober->threads = NULL;
+    prober->nthreads = 0;
+    if (prober->done)
+	skygw_message_done(prober->done);
+    prober->done = NULL;
+}
+
+/**
+ * Check that the probe threads still match the servers of the monitor
+ *
+ * @param prober	The prober
+ * @return True if there is a thread for each server
+ */
+static bool mon_prober_matches(MON_PROBER *prober)
+{
+    MONITOR_SERVERS *db = prober->monitor->databases;
+    int i;
+
+    for (i = 0; i < prober->nthreads; i++, db = db->next)
+    {
+	if (db == NULL || prober->threads[i].db != db)
+	    return false;
+    }
+    return db == NULL;
+}
+
+/**
+ * Run one round of probes over all the servers of the monitor and wait
+ * for all of them to finish. The servers are probed at the same time, so
+ * a server that does not respond delays the round only by its own timeout.
+ *
+ * @param prober	The prober, started with mon_prober_start
+ * @param probe		The function that probes one server
+ * @param timed		Record the probe times of the round
+ */
+void mon_probe_servers(MON_PROBER *prober,
+		       void (*probe)(MONITOR *, MONITOR_SERVERS *),
+		       bool timed)
+{
+    MONITOR_SERVERS *db;
+    unsigned long start = timer_now_usec();
+    int i;
+
+    /** Servers added to the monitor get threads of their own */
+    if (!mon_prober_matches(prober))
+    {
+	mon_prober_stop(prober);
+	mon_prober_start(prober, prober->monitor);
+    }
+
+    prober->probe = probe;
+    prober->timed = timed;
+
+    if (prober->nthreads == 0)
+    {
+	for (db = prober->monitor->databases; db; db = db->next)
+	    mon_probe_one(prober, db);
+    }
+    else
+    {
+	prober->pending = prober->nthreads;
+	for (i = 0; i < prober->nthreads; i++)
+	    skygw_message_send(prober->threads[i].start);
+	skygw_message_wait(prober->done);
+    }
+
+    if (timed)
+	prober->round_time = timer_now_usec() - start;
+}
+
+/**
+ * Print the probe times of a monitor
+ *
+ * @param dcb		The DCB to print to
+ * @param mon		The monitor
+ * @param prober	The prober of the monitor
+ */
+void mon_print_probe_times(DCB *dcb, MONITOR *mon, MON_PROBER *prober)
+{
+    MONITOR_SERVERS *db;
+    char *sep = "";
+
+    dcb_printf(dcb, "\tProbe threads:\t\t%d\n", prober->nthreads);
+    dcb_printf(dcb, "\tLast probe round:\t%lu microseconds\n", prober->round_time);
+    dcb_printf(dcb, "\tProbe times (last/max):\t");
+    for (db = mon->databases; db; db = db->next)
+    {
+	dcb_printf(dcb, "%s%s:%d %lu/%lu us",
+		   sep,
+		   db->server->name,
+		   db->server->port,
+		   db->probe_time,
+		   db->probe_max);
+	sep = ", ";
+    }
+    dcb_printf(dcb, "\n");
+}
+
+/**
+ * Wait until the monitor interval, counted from the start of the cycle,
+ * has passed. A cycle that took longer than the interval is followed by
+ * the next one at once. The wait is done in slices of MON_BASE_INTERVAL_MS
+ * so that the monitor stops promptly.
+ *
+ * @param mon		The monitor
+ * @param start		Start of the cycle from timer_now()
+ * @param shutdown	The shutdown flag of the monitor
+ * @return True if the monitor is shutting down
+ */
+bool mon_wait_interval(MONITOR *mon, unsigned long start, int *shutdown)
+{
+    unsigned long end = start + mon->interval;
+    unsigned long now;
+
+    while (!*shutdown && (now = timer_now()) < end)
+    {
+	thread_millisleep(end - now < MON_BASE_INTERVAL_MS ?
+			  end - now : MON_BASE_INTERVAL_MS);
+    }
+    return *shutdown != 0;
+}
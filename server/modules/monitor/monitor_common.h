@@ -23,6 +23,8 @@
 #include <monitor.h>
 #include <log_manager.h>
 #include <externcmd.h>
+#include <skygw_utils.h>
+#include <timer.h>
 /**
  * @file monitor_common.h - The generic monitor structures all monitors use
  *
@@ -63,6 +65,34 @@ typedef enum {
   NEW_NDB_EVENT,
   MAX_MONITOR_EVENT
 }monitor_event_t;
+struct mon_prober;
+
+/** A thread that probes one monitored server */
+typedef struct mon_probe_thread {
+	struct mon_prober *prober;	/**< The prober the thread belongs to */
+	MONITOR_SERVERS	  *db;		/**< The server the thread probes */
+	void		  *thread;	/**< The thread */
+	skygw_message_t	  *start;	/**< Sent to start a probe */
+} MON_PROBE_THREAD;
+
+/**
+ * Probes all servers of a monitor at the same time, each server from a
+ * thread of its own, so that a round of probes takes as long as the
+ * slowest server instead of the sum of all servers.
+ */
+typedef struct mon_prober {
+	MONITOR		  *monitor;	/**< The monitor */
+	MON_PROBE_THREAD  *threads;	/**< One thread for each server */
+	int		  nthreads;	/**< Number of threads */
+	int		  pending;	/**< Probes of the round still running */
+	bool		  shutdown;	/**< The threads are stopping */
+	bool		  timed;	/**< Record the probe times of the round */
+	void		  (*probe)(MONITOR *, MONITOR_SERVERS *);
+					/**< The probe of the round */
+	skygw_message_t	  *done;	/**< Sent when the round has finished */
+	unsigned long	  round_time;	/**< Duration of the last round in microseconds */
+} MON_PROBER;
+
 void mon_append_node_names(MONITOR_SERVERS* start,char* str, int len);
 monitor_event_t mon_get_event_type(MONITOR_SERVERS* node);
 char* mon_get_event_name(MONITOR_SERVERS* node);
@@ -72,4 +102,9 @@ bool mon_status_changed(MONITOR_SERVERS* mon_srv);
 bool mon_print_fail_status(MONITOR_SERVERS* mon_srv);
 void monitor_launch_script(MONITOR* mon,MONITOR_SERVERS* ptr, char* script);
 int mon_parse_event_string(bool* events, size_t count,char* string);
+bool mon_prober_start(MON_PROBER *prober, MONITOR *mon);
+void mon_prober_stop(MON_PROBER *prober);
+void mon_probe_servers(MON_PROBER *prober, void (*probe)(MONITOR *, MONITOR_SERVERS *), bool timed);
+void mon_print_probe_times(DCB *dcb, MONITOR *mon, MON_PROBER *prober);
+bool mon_wait_interval(MONITOR *mon, unsigned long start, int *shutdown);
 #endif
@@ -79,6 +79,7 @@ static	MONITOR_SERVERS   *getSlaveOfNodeId(MONITOR_SERVERS *, long);
 static MONITOR_SERVERS *get_replication_tree(MONITOR *, int);
 static void set_master_heartbeat(MYSQL_MONITOR *, MONITOR_SERVERS *);
 static void set_slave_heartbeat(MONITOR *, MONITOR_SERVERS *);
+static void probe_slave_heartbeat(MONITOR *, MONITOR_SERVERS *);
 static int add_slave_to_master(long *, int, long);
 bool isMySQLEvent(monitor_event_t event);
 static bool report_version_err = true;
@@ -159,6 +160,7 @@ startMonitor(void *arg, void* opt)
 	handle->script = NULL;
 	handle->mysql51_replication = false;
 	memset(handle->events,false,sizeof(handle->events));
+	memset(&handle->prober,0,sizeof(handle->prober));
 	spinlock_init(&handle->lock);
     }
 
@@ -286,6 +288,7 @@ static void diagnostics(DCB *dcb, void *arg)
 	db = db->next;
     }
     dcb_printf(dcb, "\n");
+    mon_print_probe_times(dcb, mon, &handle->prober);
 }
 /**
  * Connect to a database
@@ -770,6 +773,7 @@ int detect_stale_master;
 int num_servers=0;
 MONITOR_SERVERS *root_master = NULL;
 size_t nrounds = 0;
+unsigned long cycle_start = 0;
 int log_no_master = 1;
 
 spinlock_acquire(&mon->lock);
@@ -786,6 +790,7 @@ detect_stale_master = handle->detectStaleMaster;
                                    "module. Exiting.\n")));
 		return;
 	}                         
+	mon_prober_start(&handle->prober, mon);
 	handle->status = MONITOR_RUNNING;
 	
 	while (1)
@@ -793,26 +798,22 @@ detect_stale_master = handle->detectStaleMaster;
 		if (handle->shutdown)
 		{
 			handle->status = MONITOR_STOPPING;
+			mon_prober_stop(&handle->prober);
 			mysql_thread_end();
 			handle->status = MONITOR_STOPPED;
 			return;
 		}
-		/** Wait base interval */
-		thread_millisleep(MON_BASE_INTERVAL_MS);
-		/** 
-		 * Calculate how far away the monitor interval is from its full 
-		 * cycle and if monitor interval time further than the base 
-		 * interval, then skip monitoring checks. Excluding the first
-		 * round.
+		/**
+		 * Wait until the monitor interval has passed since the start
+		 * of the previous cycle. Excluding the first round.
 		 */
-		if (nrounds != 0 && 
-			((nrounds*MON_BASE_INTERVAL_MS)%mon->interval) >=
-			MON_BASE_INTERVAL_MS) 
+		if (nrounds != 0 &&
+			mon_wait_interval(mon, cycle_start, &handle->shutdown))
 		{
-			nrounds += 1;
 			continue;
 		}
 		nrounds += 1;
+		cycle_start = timer_now();
 		/* reset num_servers */
 		num_servers = 0;
 
@@ -826,9 +827,16 @@ detect_stale_master = handle->detectStaleMaster;
 			/* copy server status into monitor pending_status */
 			ptr->pending_status = ptr->server->status;
 
-			/* monitor current node */
-			monitorDatabase(mon, ptr);
+			ptr = ptr->next;
+		}
+
+		/* monitor all the nodes at the same time */
+		mon_probe_servers(&handle->prober, monitorDatabase, true);
 
+		ptr = mon->databases;
+
+		while (ptr)
+		{
 			/* reset the slave list of current node */
 			if (ptr->server->slaves) {
 				free(ptr->server->slaves);
@@ -1027,20 +1035,9 @@ detect_stale_master = handle->detectStaleMaster;
 				SERVER_IS_RELAY_SERVER(root_master->server))) 
 		{
 			set_master_heartbeat(handle, root_master);
-			ptr = mon->databases;
-			
-			while (ptr) {
-				if( (! SERVER_IN_MAINT(ptr->server)) && SERVER_IS_RUNNING(ptr->server))
-				{
-					if (ptr->server->node_id != root_master->server->node_id && 
-						(SERVER_IS_SLAVE(ptr->server) || 
-							SERVER_IS_RELAY_SERVER(ptr->server))) 
-					{
-						set_slave_heartbeat(mon, ptr);
-					}
-				}
-				ptr = ptr->next;
-			}
+
+			/* read the heartbeat from all the slaves at the same time */
+			mon_probe_servers(&handle->prober, probe_slave_heartbeat, false);
                 }
 	} /*< while (1) */
 }
@@ -1340,6 +1337,29 @@ static void set_slave_heartbeat(MONITOR* mon, MONITOR_SERVERS *database) {
 	}
 }
 
+/*******
+ * Read the replication heartbeat of one server if it is a running slave
+ * of the current master. Used by the parallel heartbeat round, in which
+ * every server is visited.
+ *
+ * @param mon   	The monitor
+ * @param database   	The database server
+ */
+static void probe_slave_heartbeat(MONITOR* mon, MONITOR_SERVERS *database) {
+	MYSQL_MONITOR *handle = (MYSQL_MONITOR*)mon->handle;
+
+	if ((! SERVER_IN_MAINT(database->server)) && SERVER_IS_RUNNING(database->server))
+	{
+		if ((handle->master == NULL ||
+			database->server->node_id != handle->master->server->node_id) &&
+			(SERVER_IS_SLAVE(database->server) ||
+				SERVER_IS_RELAY_SERVER(database->server)))
+		{
+			set_slave_heartbeat(mon, database);
+		}
+	}
+}
+
 /*******
  * This function computes the replication tree
  * from a set of MySQL Master/Slave monitored servers
@@ -126,6 +126,7 @@ startMonitor(void *arg,void* opt)
 	handle->script = NULL;
 	handle->master = NULL;
 	memset(handle->events,false,sizeof(handle->events));
+	memset(&handle->prober,0,sizeof(handle->prober));
 	spinlock_init(&handle->lock);
     }
     while(params)
@@ -238,21 +239,23 @@ char		*sep;
 		db = db->next;
 	}
 	dcb_printf(dcb, "\n");
+	mon_print_probe_times(dcb, mon, &handle->prober);
 }
 
 /**
  * Monitor an individual server
  *
+ * @param mon		The monitor
  * @param database	The database to probe
  */
 static void
-monitorDatabase(MONITOR_SERVERS	*database, char *defaultUser, char *defaultPasswd, MONITOR *mon)
+monitorDatabase(MONITOR *mon, MONITOR_SERVERS *database)
 {
     MYSQL_MONITOR* handle = mon->handle;
 MYSQL_ROW	row;
 MYSQL_RES	*result;
 int		isjoined = 0;
-char            *uname = defaultUser, *passwd = defaultPasswd;
+char            *uname = mon->user, *passwd = mon->password;
 char 			*server_string;
 
 	if (database->server->monuser != NULL)
@@ -386,6 +389,7 @@ monitorMain(void *arg)
 MYSQL_MONITOR	*handle;
 MONITOR_SERVERS	*ptr;
 size_t nrounds = 0;
+unsigned long cycle_start = 0;
 
 spinlock_acquire(&mon->lock);
 handle = (MYSQL_MONITOR *)mon->handle;
@@ -399,6 +403,7 @@ spinlock_release(&mon->lock);
                                    "module. Exiting.\n")));
                 return;
 	}                         
+	mon_prober_start(&handle->prober, mon);
 	handle->status = MONITOR_RUNNING;
 	
 	while (1)
@@ -406,33 +411,38 @@ spinlock_release(&mon->lock);
 		if (handle->shutdown)
 		{
 			handle->status = MONITOR_STOPPING;
+			mon_prober_stop(&handle->prober);
 			mysql_thread_end();
 			handle->status = MONITOR_STOPPED;
 			return;
 		}
 
-		/** Wait base interval */
-		thread_millisleep(MON_BASE_INTERVAL_MS);
-		/** 
-		 * Calculate how far away the monitor interval is from its full 
-		 * cycle and if monitor interval time further than the base 
-		 * interval, then skip monitoring checks. Excluding the first
-		 * round.
-		 */ 
-		if (nrounds != 0 && 
-			((nrounds*MON_BASE_INTERVAL_MS)%mon->interval) >=
-			MON_BASE_INTERVAL_MS) 
+		/**
+		 * Wait until the monitor interval has passed since the start
+		 * of the previous cycle. Excluding the first round.
+		 */
+		if (nrounds != 0 &&
+			mon_wait_interval(mon, cycle_start, &handle->shutdown))
 		{
-			nrounds += 1;
 			continue;
 		}
 		nrounds += 1;
+		cycle_start = timer_now();
 		ptr = mon->databases;
 
 		while (ptr)
 		{
 			ptr->mon_prev_status = ptr->server->status;
-			monitorDatabase(ptr, mon->user, mon->password,mon);
+			ptr = ptr->next;
+		}
+
+		/* probe all the nodes at the same time */
+		mon_probe_servers(&handle->prober, monitorDatabase, true);
+
+		ptr = mon->databases;
+
+		while (ptr)
+		{
 
 			if (ptr->server->status != ptr->mon_prev_status ||
 				SERVER_IS_DOWN(ptr->server))
@@ -61,6 +61,7 @@ extern __thread log_info_t tls_log_info;
 
 static char *version_str = "V2.0.0";
 static int gw_create_backend_connection(DCB *backend, SERVER *server, SESSION *in_session);
+static int gw_reuse_backend_connection(DCB *backend_dcb, SESSION *session);
 static int gw_read_backend_event(DCB* dcb);
 static int gw_write_backend_event(DCB *dcb);
 static int gw_MySQLWrite_backend(DCB *dcb, GWBUF *queue);
@@ -727,6 +728,22 @@ gw_MySQLWrite_backend(DCB *dcb, GWBUF *queue)
                                 STRPROTOCOLSTATE(backend_protocol->protocol_auth_state))));
                         
                         spinlock_release(&dcb->authlock);
+                        /**
+                         * The COM_QUIT routed from the client is not sent to
+                         * a connection that can be kept in the persistent
+                         * pool of the server. The COM_QUIT sent when the DCB
+                         * is closed reaches the backend in the NOPOLLING state.
+                         */
+                        if (cmd == MYSQL_COM_QUIT &&
+                                dcb->state == DCB_STATE_POLLING &&
+                                protocol_get_srv_command(backend_protocol, false) ==
+                                MYSQL_COM_UNDEFINED &&
+                                dcb_persistent_keep(dcb))
+                        {
+                                gwbuf_free(queue);
+                                rc = 1;
+                                goto return_rc;
+                        }
                         /**
                          * Statement type is used in readwrite split router. 
                          * Command is *not* set for readconn router.
@@ -931,6 +948,12 @@ static int gw_create_backend_connection(
 	int           rv = -1;
         int           fd = -1;
 
+        /** A persistent connection already has its protocol */
+        if (backend_dcb->protocol != NULL)
+        {
+                return gw_reuse_backend_connection(backend_dcb, session);
+        }
+
         protocol = mysql_protocol_init(backend_dcb, -1);
         ss_dassert(protocol != NULL);
         
@@ -1020,6 +1043,72 @@ return_fd:
 	return fd;
 }
 
+/**
+ * Reset a persistent connection taken from the pool of the server for a
+ * new session. The connection is authenticated again with COM_CHANGE_USER,
+ * which also resets the session state and sets the default database of
+ * the client. The reply is read as an authentication reply and the writes
+ * of the router are delayed until it has arrived.
+ *
+ * @param backend_dcb	The backend DCB taken from the pool
+ * @param session	The session the connection is reused for
+ * @return The fd of the connection or -1 if the reset failed
+ */
+static int
+gw_reuse_backend_connection(
+        DCB     *backend_dcb,
+        SESSION *session)
+{
+        MySQLProtocol *protocol = (MySQLProtocol *)backend_dcb->protocol;
+        MySQLProtocol *client_protocol;
+        GWBUF         *buffer;
+
+        CHK_PROTOCOL(protocol);
+
+        if (session->client == NULL || session->client->data == NULL)
+        {
+                return -1;
+        }
+        client_protocol = (MySQLProtocol *)session->client->protocol;
+
+        /** The commands and the history of the previous session are gone */
+        while (protocol->protocol_command.scom_cmd != MYSQL_COM_UNDEFINED ||
+               protocol->protocol_command.scom_next != NULL)
+        {
+                protocol_remove_srv_command(protocol);
+        }
+        mysql_protocol_done(backend_dcb);
+
+        spinlock_acquire(&protocol->protocol_lock);
+        protocol->protocol_cmd_history = NULL;
+        protocol->protocol_state = MYSQL_PROTOCOL_ACTIVE;
+        spinlock_release(&protocol->protocol_lock);
+
+        spinlock_acquire(&backend_dcb->authlock);
+        if (client_protocol)
+        {
+                protocol->client_capabilities = client_protocol->client_capabilities;
+                protocol->charset = client_protocol->charset;
+        }
+        protocol->protocol_auth_state = MYSQL_AUTH_RECV;
+        buffer = gw_create_change_user_packet(
+                (MYSQL_session *)session->client->data, protocol);
+        spinlock_release(&backend_dcb->authlock);
+
+        if (dcb_write(backend_dcb, buffer) == 0)
+        {
+                return -1;
+        }
+        LOGIF(LD, (skygw_log_write(
+                LOGFILE_DEBUG,
+                "%lu [gw_reuse_backend_connection] Sent COM_CHANGE_USER on "
+                "persistent connection, protocol fd %d client fd %d.",
+                pthread_self(),
+                protocol->fd,
+                session->client->fd)));
+        return backend_dcb->fd;
+}
+
 
 /**
  * Error event handler.
@@ -1143,18 +1232,23 @@ gw_backend_close(DCB *dcb)
         
         CHK_DCB(dcb);
         session = dcb->session;
-        CHK_SESSION(session);
 
 	LOGIF(LD, (skygw_log_write(LOGFILE_DEBUG,
 			"%lu [gw_backend_close]",
 			pthread_self())));                                
 	
-        quitbuf = mysql_create_com_quit(NULL, 0);
-        gwbuf_set_type(quitbuf, GWBUF_TYPE_MYSQL);
+        /**
+         * A connection that goes to the persistent pool is left open.
+         * Check again that nothing was written after the COM_QUIT.
+         */
+        if (!(dcb->flags & DCBF_PERSISTENT) || !dcb_persistent_keep(dcb))
+        {
+                quitbuf = mysql_create_com_quit(NULL, 0);
+                gwbuf_set_type(quitbuf, GWBUF_TYPE_MYSQL);
 
-        /** Send COM_QUIT to the backend being closed */
-        mysql_send_com_quit(dcb, 0, quitbuf);
-        
+                /** Send COM_QUIT to the backend being closed */
+                mysql_send_com_quit(dcb, 0, quitbuf);
+        }
         mysql_protocol_done(dcb);
 	/** 
 	 * The lock is needed only to protect the read of session->state and 
@@ -1164,6 +1258,7 @@ gw_backend_close(DCB *dcb)
 	 */
 	if(session != NULL)
 	{
+	    CHK_SESSION(session);
 	    spinlock_acquire(&session->ses_lock);
 	    /**
 	     * If session->state is STOPPING, start closing client session.
@@ -1448,6 +1448,7 @@ int gw_find_mysql_user_password_sha1(char *username, uint8_t *gateway_password,
         char *user_password = NULL;
 	MYSQL_USER_HOST key;
 	MYSQL_session *client_data = NULL;
+	int localhost;
 
 	client_data = (MYSQL_session *) dcb->data;	
 	service = (SERVICE *) dcb->service;
@@ -1468,111 +1469,41 @@ int gw_find_mysql_user_password_sha1(char *username, uint8_t *gateway_password,
 				key.resource != NULL ?" db: " :"",
 				 key.resource != NULL ?key.resource :"")));
 
-	/* look for user@current_ipv4 now */
-        user_password = mysql_users_fetch(service->users, &key);
-
-        if (!user_password) {
-		/* The user is not authenticated @ current IPv4 */
-
-		while (1) {
-			/*
-			 * (1) Check for localhost first: 127.0.0.1 (IPv4 only)
- 			 */
-
-			if ((key.ipv4.sin_addr.s_addr == 0x0100007F) && 
-				!dcb->service->localhost_match_wildcard_host) 
-			{
- 			 	/* Skip the wildcard check and return 1 */
-				LOGIF(LE,
-					(skygw_log_write_flush(
-						LOGFILE_ERROR,
-						"Error : user %s@%s not found, try set "
-						"'localhost_match_wildcard_host=1' in "
-						"service definition of the configuration "
-						"file.",
-						key.user,
-						dcb->remote)));
-
-				break;
-			}
-
-			/*
-			 * (2) check for possible IPv4 class C,B,A networks
-			 */
-
-			/* Class C check */
-			key.ipv4.sin_addr.s_addr &= 0x00FFFFFF;
-			key.netmask -= 8;
-
-			user_password = mysql_users_fetch(service->users, &key);
-
-			if (user_password) {
-				break;
-			}
-
-			/* Class B check */
-			key.ipv4.sin_addr.s_addr &= 0x0000FFFF;
-			key.netmask -= 8;
-
-			user_password = mysql_users_fetch(service->users, &key);
-
-			if (user_password) {
-				break;
-			}
-
-			/* Class A check */
-			key.ipv4.sin_addr.s_addr &= 0x000000FF;
-			key.netmask -= 8;
-
-			user_password = mysql_users_fetch(service->users, &key);
-
-			if (user_password) {
-				break;
-			}
-
-			/*
-			 * (3) Continue check for wildcard host, user@%
-			 */
+	/*
+	 * Look for user@current_ipv4 and then for the class C,B,A networks
+	 * and user@%. The wildcard hosts are not checked for 127.0.0.1 (IPv4
+	 * only) unless localhost_match_wildcard_host is set.
+	 */
+	localhost = key.ipv4.sin_addr.s_addr == 0x0100007F &&
+		!service->localhost_match_wildcard_host;
 
-			memset(&key.ipv4, 0, sizeof(struct sockaddr_in));
-			key.netmask = 0;
+	user_password = mysql_users_match(service->users, &key, !localhost);
 
+	if (!user_password) {
+		if (localhost) {
+			LOGIF(LE,
+				(skygw_log_write_flush(
+					LOGFILE_ERROR,
+					"Error : user %s@%s not found, try set "
+					"'localhost_match_wildcard_host=1' in "
+					"service definition of the configuration "
+					"file.",
+					key.user,
+					dcb->remote)));
+		} else {
 			LOGIF(LD,
 				(skygw_log_write_flush(
 					LOGFILE_DEBUG,
-					"%lu [MySQL Client Auth], checking user [%s@%s] with wildcard host [%%]",
+					"%lu [MySQL Client Auth], user [%s@%s] not existent",
 					pthread_self(),
 					key.user,
 					dcb->remote)));
 
-			user_password = mysql_users_fetch(service->users, &key);
-
-			if (user_password)
-			{
-			    break;
-			}
-
-			if (!user_password) {
-				/*
-				 * user@% not found.
- 				 */
-
-			    LOGIF(LD,
-			     (skygw_log_write_flush(
-				    LOGFILE_DEBUG,
-					      "%lu [MySQL Client Auth], user [%s@%s] not existent",
-					      pthread_self(),
-					      key.user,
-					      dcb->remote)));
-
-			    LOGIF(LT,skygw_log_write_flush(
-				    LOGFILE_ERROR,
-					     "Authentication Failed: user [%s@%s] not found.",
-					     key.user,
-					     dcb->remote));
-			    break;
-			}
-
+			LOGIF(LT,skygw_log_write_flush(
+				LOGFILE_ERROR,
+				"Authentication Failed: user [%s@%s] not found.",
+				key.user,
+				dcb->remote));
 		}
 	}
 
@@ -1695,6 +1626,8 @@ mysql_send_auth_error (
  * Buffer contains at least one of the following:
  * complete [complete] [partial] mysql packet
  * 
+ * A packet that fills the first buffer is returned without copying it.
+ * 
  * @param p_readbuf	Address of read buffer pointer
  * 
  * @return pointer to gwbuf containing a complete packet or
@@ -1737,6 +1670,21 @@ GWBUF* gw_MySQL_get_next_packet(
                 goto return_packetbuf;
         }
         
+        /**
+         * The packet fills the first buffer of the chain, unlink the buffer
+         * and return it as it is instead of copying it.
+         */
+        if (packetlen == GWBUF_LENGTH(readbuf))
+        {
+                *p_readbuf = readbuf->next;
+                if (readbuf->next)
+                        readbuf->next->tail = readbuf->tail;
+                readbuf->next = NULL;
+                readbuf->tail = readbuf;
+                packetbuf = readbuf;
+                goto return_packetbuf;
+        }
+        
         packetbuf = gwbuf_alloc(packetlen);
         target    = GWBUF_DATA(packetbuf);
         packetbuf->gwbuf_type = readbuf->gwbuf_type; /*< Copy the type too */
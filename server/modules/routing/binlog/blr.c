@@ -198,6 +198,9 @@ unsigned char	*defuuid;
 	inst->retry_backoff = 1;
 	inst->binlogdir = NULL;
 	inst->heartbeat = 300;	// Default is every 5 minutes
+	inst->flush_mode = BLR_FLUSH_SYNC;
+	inst->flush_interval = DEF_FLUSH_INTERVAL;
+	inst->flush_bytes = DEF_FLUSH_BYTES;
 	inst->mariadb10_compat = false;
 
 	inst->user = strdup(service->credentials.name);
@@ -350,6 +353,46 @@ unsigned char	*defuuid;
 				{
 					inst->binlogdir = strdup(value);
 				}
+				else if (strcmp(options[i], "flushmode") == 0)
+				{
+					if (strcmp(value, "sync") == 0)
+						inst->flush_mode = BLR_FLUSH_SYNC;
+					else if (strcmp(value, "group") == 0)
+						inst->flush_mode = BLR_FLUSH_GROUP;
+					else if (strcmp(value, "durable") == 0)
+						inst->flush_mode = BLR_FLUSH_DURABLE;
+					else
+					{
+						LOGIF(LE, (skygw_log_write(
+							LOGFILE_ERROR,
+							"Warning : Unsupported flushmode %s "
+							"for binlog router, using sync.",
+							value)));
+					}
+				}
+				else if (strcmp(options[i], "flushinterval") == 0)
+				{
+					inst->flush_interval = atoi(value);
+				}
+				else if (strcmp(options[i], "flushbytes") == 0)
+				{
+					unsigned long size = atoi(value);
+					char	*ptr = value;
+					while (*ptr && isdigit(*ptr))
+						ptr++;
+					switch (*ptr)
+					{
+					case 'M':
+					case 'm':
+						size = size * 1024 * 1024;
+						break;
+					case 'K':
+					case 'k':
+						size = size * 1024;
+						break;
+					}
+					inst->flush_bytes = size;
+				}
 				else
 				{
 					LOGIF(LE, (skygw_log_write(
@@ -415,6 +458,11 @@ unsigned char	*defuuid;
 			"Binlog router: current binlog file is: %s, current position %u\n",
 						inst->binlog_name, inst->binlog_position)));
 
+	/*
+	 * Start the background flusher if the binlog is synced periodically
+	 */
+	blr_file_start_flusher(inst);
+
 
 	/*
 	 * We have completed the creation of the instance data, so now
@@ -572,6 +620,7 @@ int			prev_val;
 		free(slave->user);
 	if (slave->passwd)
 		free(slave->passwd);
+	blr_readahead_free(&slave->readahead);
         free(slave);
 }
 
@@ -804,6 +853,30 @@ struct tm	tm;
 		   router_inst->stats.n_residuals);
 	dcb_printf(dcb, "\tAverage events per packet			%.1f\n",
 		   (double)router_inst->stats.n_binlogs / router_inst->stats.n_reads);
+	dcb_printf(dcb, "\tBytes sent to slaves in catchup mode:		%lu\n",
+		   (unsigned long)router_inst->stats.n_catchup_bytes);
+	dcb_printf(dcb, "\tSlave catchup throughput:			%.1f MB/s\n",
+		   router_inst->stats.catchup_usecs ?
+		   (double)router_inst->stats.n_catchup_bytes /
+		   router_inst->stats.catchup_usecs : 0.0);
+	dcb_printf(dcb, "\tBinlog flush mode:				%s\n",
+		   router_inst->flush_mode == BLR_FLUSH_GROUP ? "group" :
+		   (router_inst->flush_mode == BLR_FLUSH_DURABLE ? "durable" : "sync"));
+	dcb_printf(dcb, "\tNumber of binlog fsyncs:			%lu\n",
+		   (unsigned long)router_inst->stats.n_fsyncs);
+	dcb_printf(dcb, "\tAverage bytes per fsync:			%.1f\n",
+		   router_inst->stats.n_fsyncs ?
+		   (double)router_inst->stats.n_fsync_bytes /
+		   router_inst->stats.n_fsyncs : 0.0);
+	dcb_printf(dcb, "\tAverage fsync time:				%.1f usecs\n",
+		   router_inst->stats.n_fsyncs ?
+		   (double)router_inst->stats.fsync_usecs /
+		   router_inst->stats.n_fsyncs : 0.0);
+	if (router_inst->flush_mode == BLR_FLUSH_DURABLE)
+		dcb_printf(dcb, "\tAverage events per group commit:		%.1f\n",
+		   router_inst->stats.n_groups ?
+		   (double)router_inst->stats.n_group_events /
+		   router_inst->stats.n_groups : 0.0);
 	dcb_printf(dcb, "\tLast event from master at:  			%s",
 				buf);
 	dcb_printf(dcb, "\t					(%d seconds ago)\n",
@@ -950,6 +1023,10 @@ struct tm	tm;
 			dcb_printf(dcb, "\t\tNo. up to date:					%u\n", session->stats.n_upd);
 			dcb_printf(dcb, "\t\tNo. of drained cbs 				%u\n", session->stats.n_dcb);
 			dcb_printf(dcb, "\t\tNo. of failed reads				%u\n", session->stats.n_failed_read);
+			dcb_printf(dcb, "\t\tCatchup throughput:				%.1f MB/s\n",
+				session->stats.catchup_usecs ?
+				(double)session->stats.n_catchup_bytes /
+				session->stats.catchup_usecs : 0.0);
 
 #if DETAILED_DIAG
 			dcb_printf(dcb, "\t\tNo. of nested distribute events			%u\n", session->stats.n_overrun);
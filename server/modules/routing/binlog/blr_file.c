@@ -35,6 +35,7 @@
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <dirent.h>
 #include <fcntl.h>
 #include <unistd.h>
@@ -46,6 +47,7 @@
 #include <blr.h>
 #include <dcb.h>
 #include <spinlock.h>
+#include <thread.h>
 
 #include <skygw_types.h>
 #include <skygw_utils.h>
@@ -60,6 +62,10 @@ static int  blr_file_create(ROUTER_INSTANCE *router, char *file);
 static void blr_file_append(ROUTER_INSTANCE *router, char *file);
 static uint32_t extract_field(uint8_t *src, int bits);
 static void blr_log_header(logfile_id_t file, char *msg, uint8_t *ptr);
+static int  blr_group_append(ROUTER_INSTANCE *router, REP_HEADER *hdr, uint8_t *buf);
+static int  blr_group_commit(ROUTER_INSTANCE *router);
+static int  blr_file_fsync(ROUTER_INSTANCE *router, int fd, uint64_t bytes);
+static void blr_flusher(void *arg);
 
 /**
  * Initialise the binlog file for this instance. MaxScale will look
@@ -190,7 +196,7 @@ static int
 blr_file_create(ROUTER_INSTANCE *router, char *file)
 {
 char		path[1024];
-int		fd;
+int		fd, oldfd;
 
 	strcpy(path, router->binlogdir);
 	strcat(path, "/");
@@ -208,11 +214,12 @@ int		fd;
 		return 0;
 	}
 	fsync(fd);
-	close(router->binlog_fd);
 	spinlock_acquire(&router->binlog_lock);
 	strncpy(router->binlog_name, file,BINLOG_FNAMELEN);
+	oldfd = router->binlog_fd;
 	router->binlog_fd = fd;
 	spinlock_release(&router->binlog_lock);
+	close(oldfd);
 	return 1;
 }
 
@@ -266,6 +273,9 @@ int		fd;
 /**
  * Write a binlog entry to disk.
  *
+ * In the durable flush mode the entry is only added to the current group,
+ * it is written to disk by the next call to blr_file_flush().
+ *
  * @param router	The router instance
  * @param buf		The binlog record
  * @param len		The length of the binlog record
@@ -276,6 +286,9 @@ blr_write_binlog_record(ROUTER_INSTANCE *router, REP_HEADER *hdr, uint8_t *buf)
 {
 int	n;
 
+	if (router->flush_mode == BLR_FLUSH_DURABLE)
+		return blr_group_append(router, hdr, buf);
+
 	if ((n = pwrite(router->binlog_fd, buf, hdr->event_size,
 				hdr->next_pos - hdr->event_size)) != hdr->event_size)
 	{
@@ -292,19 +305,267 @@ int	n;
 	spinlock_acquire(&router->binlog_lock);
 	router->binlog_position = hdr->next_pos;
 	router->last_written = hdr->next_pos - hdr->event_size;
+	router->group.unsynced += n;
 	spinlock_release(&router->binlog_lock);
 	return n;
 }
 
 /**
- * Flush the content of the binlog file to disk.
+ * Add a binlog entry to the group of events that will be written and
+ * synced together in the durable flush mode. If the group is full, or the
+ * entry does not follow on from the events already in it, the current
+ * group is committed first.
+ *
+ * @param router	The router instance
+ * @param hdr		The event header
+ * @param buf		The binlog record
+ * @return		The number of bytes added or 0 on failure
+ */
+static int
+blr_group_append(ROUTER_INSTANCE *router, REP_HEADER *hdr, uint8_t *buf)
+{
+BLRGROUP	*group = &router->group;
+uint64_t	pos = hdr->next_pos - hdr->event_size;
+
+	if (group->n_events > 0 &&
+		(group->start + group->len != pos ||
+		 group->len + hdr->event_size > router->flush_bytes))
+	{
+		if (blr_group_commit(router) == 0)
+			return 0;
+	}
+	if (group->len + hdr->event_size > group->size)
+	{
+		unsigned int	size = group->len + hdr->event_size;
+		uint8_t		*ptr;
+
+		if (size < router->flush_bytes)
+			size = router->flush_bytes;
+		if ((ptr = realloc(group->buf, size)) == NULL)
+		{
+			LOGIF(LE, (skygw_log_write_flush(LOGFILE_ERROR,
+				"%s: Failed to allocate %d bytes for the binlog "
+				"group commit buffer.",
+				router->service->name, size)));
+			return 0;
+		}
+		group->buf = ptr;
+		group->size = size;
+	}
+	if (group->n_events == group->max_events)
+	{
+		int		max = group->max_events ? group->max_events * 2 : 64;
+		REP_HEADER	*events;
+
+		if ((events = realloc(group->events,
+				max * sizeof(REP_HEADER))) == NULL)
+		{
+			LOGIF(LE, (skygw_log_write_flush(LOGFILE_ERROR,
+				"%s: Failed to allocate the binlog group "
+				"commit event list.",
+				router->service->name)));
+			return 0;
+		}
+		group->events = events;
+		group->max_events = max;
+	}
+	if (group->n_events == 0)
+		group->start = pos;
+	memcpy(group->buf + group->len, buf, hdr->event_size);
+	group->len += hdr->event_size;
+	group->events[group->n_events++] = *hdr;
+	return hdr->event_size;
+}
+
+/**
+ * Write the events of the current group with a single write, sync them to
+ * disk and only then make them visible to the slaves, both by advancing the
+ * binlog position used for catchup and by distributing them to the slaves
+ * that are up to date.
+ *
+ * @param router	The router instance
+ * @return		Non-zero on success, 0 if the group could not be written
+ */
+static int
+blr_group_commit(ROUTER_INSTANCE *router)
+{
+BLRGROUP	*group = &router->group;
+REP_HEADER	*last;
+uint8_t		*ptr;
+int		i;
+
+	if (group->n_events == 0)
+		return 1;
+
+	if (pwrite(router->binlog_fd, group->buf, group->len, group->start)
+				!= group->len)
+	{
+		LOGIF(LE, (skygw_log_write(LOGFILE_ERROR,
+			"%s: Failed to write %d binlog events at %lu of %s, %s. "
+			"Truncating to previous record.",
+			router->service->name, group->n_events,
+			(unsigned long)group->start, router->binlog_name,
+			strerror(errno))));
+		ftruncate(router->binlog_fd, group->start);
+		group->len = 0;
+		group->n_events = 0;
+		return 0;
+	}
+	blr_file_fsync(router, router->binlog_fd, group->len);
+
+	last = &group->events[group->n_events - 1];
+	spinlock_acquire(&router->binlog_lock);
+	router->binlog_position = last->next_pos;
+	router->last_written = last->next_pos - last->event_size;
+	spinlock_release(&router->binlog_lock);
+
+	router->stats.n_groups++;
+	router->stats.n_group_events += group->n_events;
+
+	/*
+	 * A rotate event is distributed by the caller once the router has
+	 * moved to the new binlog file.
+	 */
+	ptr = group->buf;
+	for (i = 0; i < group->n_events; i++)
+	{
+		if (group->events[i].event_type != ROTATE_EVENT)
+			blr_distribute_binlog_record(router, &group->events[i],
+							ptr, NULL);
+		ptr += group->events[i].event_size;
+	}
+	group->len = 0;
+	group->n_events = 0;
+	return 1;
+}
+
+/**
+ * Sync a binlog file to disk and account for it in the router statistics.
+ *
+ * @param router	The router instance
+ * @param fd		The file descriptor to sync
+ * @param bytes		The number of bytes being made durable
+ * @return		Non-zero on success
+ */
+static int
+blr_file_fsync(ROUTER_INSTANCE *router, int fd, uint64_t bytes)
+{
+struct timeval	start, end;
+int		rval;
+
+	gettimeofday(&start, NULL);
+	if ((rval = fsync(fd)) == -1)
+	{
+		LOGIF(LE, (skygw_log_write(LOGFILE_ERROR,
+			"%s: Failed to sync binlog file %s, %s.",
+			router->service->name, router->binlog_name,
+			strerror(errno))));
+	}
+	gettimeofday(&end, NULL);
+	router->stats.n_fsyncs++;
+	router->stats.n_fsync_bytes += bytes;
+	router->stats.fsync_usecs += (end.tv_sec - start.tv_sec) * 1000000
+					+ (end.tv_usec - start.tv_usec);
+	return rval == 0;
+}
+
+/**
+ * Called at the end of each read from the master to make the events that
+ * have been received durable according to the flush mode of the router.
+ * In the group flush mode this is left to the background flusher.
  *
  * @param	router		The binlog router
+ * @return	Non-zero on success, 0 if the events could not be written
  */
-void
+int
 blr_file_flush(ROUTER_INSTANCE *router)
 {
-	fsync(router->binlog_fd);
+	switch (router->flush_mode)
+	{
+	case BLR_FLUSH_GROUP:
+		return 1;
+	case BLR_FLUSH_DURABLE:
+		return blr_group_commit(router);
+	default:
+		return blr_file_sync(router);
+	}
+}
+
+/**
+ * Write and sync everything written to the current binlog file regardless
+ * of the flush mode. Used before the binlog file is rotated.
+ *
+ * @param	router		The binlog router
+ * @return	Non-zero on success, 0 if the events could not be written
+ */
+int
+blr_file_sync(ROUTER_INSTANCE *router)
+{
+uint64_t	unsynced;
+
+	if (router->flush_mode == BLR_FLUSH_DURABLE)
+		return blr_group_commit(router);
+
+	spinlock_acquire(&router->binlog_lock);
+	unsynced = router->group.unsynced;
+	router->group.unsynced = 0;
+	spinlock_release(&router->binlog_lock);
+	blr_file_fsync(router, router->binlog_fd, unsynced);
+	return 1;
+}
+
+/**
+ * Start the background flusher of the group flush mode.
+ *
+ * @param	router		The binlog router
+ */
+void
+blr_file_start_flusher(ROUTER_INSTANCE *router)
+{
+	if (router->flush_mode != BLR_FLUSH_GROUP || router->group.flusher)
+		return;
+	router->group.flusher = thread_start(blr_flusher, router);
+}
+
+/**
+ * The background flusher thread for the group flush mode. The binlog is
+ * synced once flushinterval milliseconds have passed since the last sync
+ * or flushbytes bytes have been written, whichever comes first. The file
+ * descriptor is duplicated so that a concurrent binlog rotation can close
+ * the original while the sync is in progress.
+ *
+ * @param	arg		The binlog router
+ */
+static void
+blr_flusher(void *arg)
+{
+ROUTER_INSTANCE	*router = (ROUTER_INSTANCE *)arg;
+int		slice, waited = 0, fd;
+uint64_t	unsynced;
+
+	slice = router->flush_interval < 10 ? router->flush_interval : 10;
+	if (slice < 1)
+		slice = 1;
+	while (1)
+	{
+		thread_millisleep(slice);
+		waited += slice;
+		if (router->group.unsynced == 0 ||
+			(waited < router->flush_interval &&
+			 router->group.unsynced < router->flush_bytes))
+			continue;
+		waited = 0;
+
+		spinlock_acquire(&router->binlog_lock);
+		unsynced = router->group.unsynced;
+		router->group.unsynced = 0;
+		fd = router->binlog_fd == -1 ? -1 : dup(router->binlog_fd);
+		spinlock_release(&router->binlog_lock);
+		if (fd == -1)
+			continue;
+		blr_file_fsync(router, fd, unsynced);
+		close(fd);
+	}
 }
 
 /**
@@ -562,6 +823,146 @@ struct	stat	statb;
 	return result;
 }
 
+/**
+ * Read a chunk of a binlog file into the read ahead buffer of a slave
+ *
+ * @param file	The binlog file
+ * @param pos	The position to read from
+ * @param end	The position up to which the file may be read
+ * @param ra	The read ahead buffer
+ * @return 1 if data was read, 0 otherwise
+ */
+static int
+blr_readahead_fill(BLFILE *file, unsigned long pos, unsigned long end, BLREADAHEAD *ra)
+{
+unsigned long	len = end - pos;
+int		n;
+
+	blr_readahead_free(ra);
+	if (len > BLR_READAHEAD_SIZE)
+		len = BLR_READAHEAD_SIZE;
+	if ((ra->buf = gwbuf_alloc(len)) == NULL)
+	{
+		LOGIF(LE, (skygw_log_write(LOGFILE_ERROR,
+			"Failed to allocate memory to read ahead %lu bytes "
+			"of binlog file %s at %lu.",
+			len, file->binlogname, pos)));
+		return 0;
+	}
+	if ((n = pread(file->fd, GWBUF_DATA(ra->buf), len, pos)) <= 0)
+	{
+		if (n == -1)
+			LOGIF(LE, (skygw_log_write(LOGFILE_ERROR,
+				"Failed to read binlog file %s at position %lu"
+				" (%s).", file->binlogname,
+						pos, strerror(errno))));
+		blr_readahead_free(ra);
+		return 0;
+	}
+	if (n < len)
+		ra->buf = gwbuf_rtrim(ra->buf, len - n);
+	strcpy(ra->binlogname, file->binlogname);
+	ra->pos = pos;
+	return 1;
+}
+
+/**
+ * Read a replication event for a slave in catchup mode. The binlog file is
+ * read in chunks of BLR_READAHEAD_SIZE bytes and the events are returned as
+ * buffers that share the data of the chunk, so that a slave that is far
+ * behind the master does not need two system calls for every event.
+ *
+ * Events that do not fit in a chunk and events with a header that does not
+ * look right are read with blr_read_binlog.
+ *
+ * @param router	The router instance
+ * @param file		The binlog file
+ * @param pos		The position of the event
+ * @param hdr		The event header is extracted here
+ * @param ra		The read ahead buffer of the slave
+ * @return The event or NULL if there was no complete event to read
+ */
+GWBUF *
+blr_read_binlog_ahead(ROUTER_INSTANCE *router, BLFILE *file, unsigned int pos,
+			REP_HEADER *hdr, BLREADAHEAD *ra)
+{
+unsigned long	end, offset;
+uint8_t		*hdbuf;
+int		event_limit, filled = 0;
+
+	if (!file)
+	{
+		return NULL;
+	}
+	/* Only read the events the master has completely written */
+	if (strcmp(router->binlog_name, file->binlogname) == 0)
+		end = router->binlog_position;
+	else
+		end = blr_file_size(file);
+	if (pos >= end)
+	{
+		return NULL;
+	}
+	event_limit = router->mariadb10_compat ? MAX_EVENT_TYPE_MARIADB10 : MAX_EVENT_TYPE;
+
+	for (;;)
+	{
+		if (ra->buf && strcmp(ra->binlogname, file->binlogname) == 0 &&
+			pos >= ra->pos &&
+			pos + BINLOG_EVENT_HDR_LEN <= ra->pos + GWBUF_LENGTH(ra->buf))
+		{
+			offset = pos - ra->pos;
+			hdbuf = (uint8_t *)GWBUF_DATA(ra->buf) + offset;
+			hdr->timestamp = EXTRACT32(hdbuf);
+			hdr->event_type = hdbuf[4];
+			hdr->serverid = EXTRACT32(&hdbuf[5]);
+			hdr->event_size = extract_field(&hdbuf[9], 32);
+			hdr->next_pos = EXTRACT32(&hdbuf[13]);
+			hdr->flags = EXTRACT16(&hdbuf[17]);
+
+			if (hdr->event_type > event_limit ||
+				hdr->event_size < BINLOG_EVENT_HDR_LEN ||
+				(hdr->next_pos < pos && hdr->event_type != ROTATE_EVENT))
+			{
+				/* Let blr_read_binlog report or correct it */
+				blr_readahead_free(ra);
+				return blr_read_binlog(router, file, pos, hdr);
+			}
+			if (offset + hdr->event_size <= GWBUF_LENGTH(ra->buf))
+			{
+				return gwbuf_clone_portion(ra->buf, offset,
+							hdr->event_size);
+			}
+		}
+		if (filled)
+		{
+			/* The event is larger than a chunk or incomplete */
+			blr_readahead_free(ra);
+			return blr_read_binlog(router, file, pos, hdr);
+		}
+		if (!blr_readahead_fill(file, pos, end, ra))
+		{
+			return NULL;
+		}
+		filled = 1;
+	}
+}
+
+/**
+ * Release the binlog data read ahead for a slave
+ *
+ * @param ra	The read ahead buffer
+ */
+void
+blr_readahead_free(BLREADAHEAD *ra)
+{
+	if (ra->buf)
+		gwbuf_free(ra->buf);
+	ra->buf = NULL;
+	ra->pos = 0;
+	ra->binlogname[0] = 0;
+}
+
 /**
  * Close a binlog file that has been opened to read binlog records
  *
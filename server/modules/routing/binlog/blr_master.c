@@ -74,7 +74,7 @@ static GWBUF *blr_make_binlog_dump(ROUTER_INSTANCE *router);
 void encode_value(unsigned char *data, unsigned int value, int len);
 void blr_handle_binlog_record(ROUTER_INSTANCE *router, GWBUF *pkt);
 static int  blr_rotate_event(ROUTER_INSTANCE *router, uint8_t *pkt, REP_HEADER *hdr);
-void blr_distribute_binlog_record(ROUTER_INSTANCE *router, REP_HEADER *hdr, uint8_t *ptr);
+static GWBUF *blr_event_body(REP_HEADER *hdr, uint8_t *ptr, GWBUF *src);
 static void *CreateMySQLAuthData(char *username, char *password, char *database);
 void blr_extract_header(uint8_t *pkt, REP_HEADER *hdr);
 inline uint32_t extract_field(uint8_t *src, int bits);
@@ -117,6 +117,10 @@ GWBUF	*buf;
 	}
 	router->residual = NULL;
 
+	/* Discard any events that were never committed to the binlog */
+	router->group.len = 0;
+	router->group.n_events = 0;
+
 	spinlock_release(&router->lock);
 	if ((client = dcb_alloc(DCB_ROLE_INTERNAL)) == NULL)
 	{
@@ -193,6 +197,10 @@ GWBUF	*ptr;
 	}
 	router->residual = NULL;
 
+	/* Discard any events that were never committed to the binlog */
+	router->group.len = 0;
+	router->group.n_events = 0;
+
 	/* Now it is safe to unleash other threads on this router instance */
 	spinlock_acquire(&router->lock);
 	router->reconnect_pending = 0;
@@ -1040,7 +1048,13 @@ static REP_HEADER	phdr;
 						}
 						if (hdr.event_type == ROTATE_EVENT)
 						{
-							if (!blr_rotate_event(router, ptr, &hdr))
+							/*
+							 * Everything in the current file,
+							 * including the rotate, must be
+							 * on disk before it is closed.
+							 */
+							if (!blr_file_sync(router) ||
+								!blr_rotate_event(router, ptr, &hdr))
 							{
 								/*
 								 * Failed to write to the
@@ -1055,7 +1069,16 @@ static REP_HEADER	phdr;
 								return;
 							}
 						}
-						blr_distribute_binlog_record(router, &hdr, ptr);
+						/*
+						 * In the durable flush mode the event is
+						 * distributed by the group commit, once
+						 * it is on disk. The rotate event has
+						 * already been committed above.
+						 */
+						if (router->flush_mode != BLR_FLUSH_DURABLE ||
+							hdr.event_type == ROTATE_EVENT)
+							blr_distribute_binlog_record(router, &hdr, ptr,
+									     msg ? NULL : pkt);
 					}
 					else
 					{
@@ -1136,7 +1159,16 @@ static REP_HEADER	phdr;
 	{
 		ss_dassert(pkt_length == 0);
 	}
-	blr_file_flush(router);
+	if (blr_file_flush(router) == 0)
+	{
+		/*
+		 * Failed to write the binlog events, close the connection
+		 * with the master and fetch them again from the last
+		 * event on disk.
+		 */
+		blr_master_close(router);
+		blr_master_delayed_connect(router);
+	}
 }
 
 /**
@@ -1256,17 +1288,48 @@ MYSQL_session	*auth_info;
 	return auth_info;
 }
 
+/**
+ * Create the buffer that holds the body of a replication event for all the
+ * slaves it is sent to. If the event is within the buffer it was read into
+ * the body shares the data of that buffer, otherwise the event is copied.
+ *
+ * @param	hdr		The replication event header
+ * @param	ptr		The raw replication event data
+ * @param	src		The buffer the event was read into or NULL
+ * @return	The event body or NULL if memory allocation failed
+ */
+static GWBUF *
+blr_event_body(REP_HEADER *hdr, uint8_t *ptr, GWBUF *src)
+{
+GWBUF	*body;
+
+	if (src && src->gwbuf_bufobj == NULL &&
+		ptr >= (uint8_t *)GWBUF_DATA(src) &&
+		ptr + hdr->event_size <= (uint8_t *)GWBUF_DATA(src) + GWBUF_LENGTH(src))
+	{
+		return gwbuf_clone_portion(src, ptr - (uint8_t *)GWBUF_DATA(src),
+					hdr->event_size);
+	}
+	if ((body = gwbuf_alloc(hdr->event_size)) != NULL)
+		memcpy(GWBUF_DATA(body), ptr, hdr->event_size);
+	return body;
+}
+
 /**
  * Distribute the binlog record we have just received to all the registered slaves.
  *
+ * The event is held once in a shared buffer, each slave that is sent the
+ * event gets its own packet header chained in front of a clone of it.
+ *
  * @param	router		The router instance
  * @param	hdr		The replication event header
  * @param	ptr		The raw replication event data
+ * @param	src		The buffer that holds the event data or NULL
  */
 void
-blr_distribute_binlog_record(ROUTER_INSTANCE *router, REP_HEADER *hdr, uint8_t *ptr)
+blr_distribute_binlog_record(ROUTER_INSTANCE *router, REP_HEADER *hdr, uint8_t *ptr, GWBUF *src)
 {
-GWBUF		*pkt;
+GWBUF		*pkt, *body = NULL, *clone;
 uint8_t		*buf;
 ROUTER_SLAVE	*slave, *nextslave;
 int		action;
@@ -1311,7 +1374,7 @@ int		action;
 
 		if (action == 1)
 		{
-			if (slave->binlog_pos == router->last_written &&
+			if (slave->binlog_pos == hdr->next_pos - hdr->event_size &&
 				(strcmp(slave->binlogfile, router->binlog_name) == 0 ||
 				(hdr->event_type == ROTATE_EVENT &&
 				strcmp(slave->binlogfile, router->prevbinlog))))
@@ -1323,13 +1386,34 @@ int		action;
 				 * memory to the slave.
 				 */
 				slave->lastEventTimestamp = hdr->timestamp;
-				pkt = gwbuf_alloc(hdr->event_size + 5);
+				if (body == NULL)
+					body = blr_event_body(hdr, ptr, src);
+				pkt = gwbuf_alloc(5);
+				clone = body ? gwbuf_clone(body) : NULL;
+				if (pkt == NULL || clone == NULL)
+				{
+					if (pkt)
+						gwbuf_free(pkt);
+					if (clone)
+						gwbuf_free(clone);
+					LOGIF(LE, (skygw_log_write_flush(LOGFILE_ERROR,
+						"Failed to allocate buffer for event to "
+						"slave %d, forcing it to catchup mode.",
+						slave->serverid)));
+					spinlock_acquire(&slave->catch_lock);
+					slave->cstate &= ~(CS_UPTODATE|CS_BUSY);
+					slave->cstate |= CS_EXPECTCB;
+					spinlock_release(&slave->catch_lock);
+					poll_fake_write_event(slave->dcb);
+					slave = slave->next;
+					continue;
+				}
 				buf = GWBUF_DATA(pkt);
 				encode_value(buf, hdr->event_size + 1, 24);
 				buf += 3;
 				*buf++ = slave->seqno++;
 				*buf++ = 0;	// OK
-				memcpy(buf, ptr, hdr->event_size);
+				pkt = gwbuf_append(pkt, clone);
 				if (hdr->event_type == ROTATE_EVENT)
 				{
 					blr_slave_rotate(router, slave, ptr);
@@ -1418,6 +1502,8 @@ int		action;
 		slave = slave->next;
 	}
 	spinlock_release(&router->lock);
+	if (body)
+		gwbuf_free(body);
 }
 
 /**
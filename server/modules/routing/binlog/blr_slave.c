@@ -45,6 +45,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 #include <service.h>
 #include <server.h>
 #include <router.h>
@@ -1380,6 +1381,25 @@ uint8_t	*ptr;
 	return ptr;
 }
 
+/**
+ * Write a burst of events collected by blr_slave_catchup to the slave
+ *
+ * @param router	The router instance
+ * @param slave		The slave
+ * @param events	The events
+ * @param len		The length of the events
+ * @return The return value of the DCB write
+ */
+static int
+blr_slave_write_burst(ROUTER_INSTANCE *router, ROUTER_SLAVE *slave, GWBUF *events,
+			unsigned long len)
+{
+	slave->stats.n_bytes += len;
+	slave->stats.n_catchup_bytes += len;
+	router->stats.n_catchup_bytes += len;
+	return slave->dcb->func.write(slave->dcb, events);
+}
+
 /**
  * We have a registered slave that is behind the current leading edge of the 
  * binlog. We must replay the log entries to bring this node up to speed.
@@ -1409,12 +1429,14 @@ uint8_t	*ptr;
 int
 blr_slave_catchup(ROUTER_INSTANCE *router, ROUTER_SLAVE *slave, bool large)
 {
-GWBUF		*head, *record;
+GWBUF		*head, *record, *pending = NULL;
 REP_HEADER	hdr;
-int		written, rval = 1, burst;
+int		rval = 1, burst;
 int		rotating = 0;
-unsigned long	burst_size;
+unsigned long	burst_size, pending_len = 0;
 uint8_t		*ptr;
+struct timeval	start, end;
+uint64_t	usecs;
 
 	if (large)
 		burst = router->long_burst;
@@ -1455,8 +1477,10 @@ uint8_t		*ptr;
 		}
 	}
 	slave->stats.n_bursts++;
+	gettimeofday(&start, NULL);
 	while (burst-- && burst_size > 0 &&
-		(record = blr_read_binlog(router, slave->file, slave->binlog_pos, &hdr)) != NULL)
+		(record = blr_read_binlog_ahead(router, slave->file,
+				slave->binlog_pos, &hdr, &slave->readahead)) != NULL)
 	{
 		head = gwbuf_alloc(5);
 		ptr = GWBUF_DATA(head);
@@ -1470,6 +1494,7 @@ uint8_t		*ptr;
 		{
 unsigned long beat1 = hkheartbeat;
 			blr_close_binlog(router, slave->file);
+			blr_readahead_free(&slave->readahead);
 if (hkheartbeat - beat1 > 1) LOGIF(LE, (skygw_log_write(
                                         LOGFILE_ERROR, "blr_close_binlog took %d beats",
 				hkheartbeat - beat1)));
@@ -1477,8 +1502,12 @@ if (hkheartbeat - beat1 > 1) LOGIF(LE, (skygw_log_write(
 beat1 = hkheartbeat;
 			if ((slave->file = blr_open_binlog(router, slave->binlogfile)) == NULL)
 			{
+				gwbuf_free(record);
+				gwbuf_free(head);
 				if (rotating)
 				{
+					if (pending)
+						slave->dcb->func.write(slave->dcb, pending);
 					spinlock_acquire(&slave->catch_lock);
 					slave->cstate |= CS_EXPECTCB;
 					slave->cstate &= ~CS_BUSY;
@@ -1486,6 +1515,8 @@ beat1 = hkheartbeat;
 					poll_fake_write_event(slave->dcb);
 					return rval;
 				}
+				while (pending)
+					pending = gwbuf_consume(pending, GWBUF_LENGTH(pending));
 				LOGIF(LE, (skygw_log_write(
 					LOGFILE_ERROR,
 					"blr_slave_catchup failed to open binlog file %s",
@@ -1498,16 +1529,33 @@ if (hkheartbeat - beat1 > 1) LOGIF(LE, (skygw_log_write(
                                         LOGFILE_ERROR, "blr_open_binlog took %d beats",
 				hkheartbeat - beat1)));
 		}
-		slave->stats.n_bytes += gwbuf_length(head);
-		written = slave->dcb->func.write(slave->dcb, head);
-		if (written && hdr.event_type != ROTATE_EVENT)
+		/*
+		 * The events of the burst are collected and written to the
+		 * slave with one write per chunk of binlog data.
+		 */
+		pending_len += gwbuf_length(head);
+		pending = gwbuf_append(pending, head);
+		if (hdr.event_type != ROTATE_EVENT)
 		{
 			slave->binlog_pos = hdr.next_pos;
 		}
-		rval = written;
 		slave->stats.n_events++;
 		burst_size -= hdr.event_size;
+		if (pending_len >= BLR_READAHEAD_SIZE)
+		{
+			rval = blr_slave_write_burst(router, slave, pending, pending_len);
+			pending = NULL;
+			pending_len = 0;
+		}
+	}
+	if (pending)
+	{
+		rval = blr_slave_write_burst(router, slave, pending, pending_len);
 	}
+	gettimeofday(&end, NULL);
+	usecs = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_usec - start.tv_usec);
+	slave->stats.catchup_usecs += usecs;
+	router->stats.catchup_usecs += usecs;
 	if (record == NULL)
 		slave->stats.n_failed_read++;
 	spinlock_acquire(&slave->catch_lock);
@@ -106,6 +106,10 @@ static	void	telnetdShowUsers(DCB *);
  * The subcommands of the show command
  */
 struct subcommand showoptions[] = {
+	{ "buffers",	0, dprintBufferStats,
+		"Show the statistics of the buffer pools",
+		"Show the statistics of the buffer pools",
+				{0, 0, 0} },
         { "dcbs",	0, dprintAllDCBs,
 		"Show all descriptor control blocks (network connections)",
 		"Show all descriptor control blocks (network connections)",
@@ -194,6 +198,10 @@ struct subcommand showoptions[] = {
 			"Show statistics and user names for the debug interface",
 			"Show statistics and user names for the debug interface",
 				{0, 0, 0} },
+	{ "zombies",	0, dprintZombieStats,
+			"Show the statistics of the zombie DCB reclamation",
+			"Show the statistics of the zombie DCB reclamation",
+				{0, 0, 0} },
 	{ NULL,		0, NULL,		NULL,	NULL,
 				{0, 0, 0} }
 };
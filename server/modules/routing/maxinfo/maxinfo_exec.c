@@ -48,6 +48,7 @@
 #include <log_manager.h>
 #include <resultset.h>
 #include <maxconfig.h>
+#include <query_classifier.h>
 
 extern int lm_enabled_logfiles_bitmask;
 extern size_t         log_ses_count[];
@@ -583,6 +584,67 @@ maxinfo_max_event_exec_time()
 	return poll_get_stat(POLL_STAT_MAX_EXECTIME);
 }
 
+/**
+ * Interface to the query classifier cache stats for cache hits
+ */
+static int
+maxinfo_qc_cache_hits()
+{
+QC_CACHE_STATS	stats;
+
+	query_classifier_cache_stats(&stats);
+	return stats.hits;
+}
+
+/**
+ * Interface to the query classifier cache stats for cache misses
+ */
+static int
+maxinfo_qc_cache_misses()
+{
+QC_CACHE_STATS	stats;
+
+	query_classifier_cache_stats(&stats);
+	return stats.misses;
+}
+
+/**
+ * Interface to the query classifier cache stats for cache evictions
+ */
+static int
+maxinfo_qc_cache_evictions()
+{
+QC_CACHE_STATS	stats;
+
+	query_classifier_cache_stats(&stats);
+	return stats.evictions;
+}
+
+/**
+ * Interface to the query classifier cache stats for cache entries
+ */
+static int
+maxinfo_qc_cache_entries()
+{
+QC_CACHE_STATS	stats;
+
+	query_classifier_cache_stats(&stats);
+	return stats.entries;
+}
+
+/**
+ * Interface to the query classifier stats for statements classified
+ * without parsing
+ */
+static int
+maxinfo_qc_fast_path()
+{
+QC_CACHE_STATS	stats;
+
+	query_classifier_cache_stats(&stats);
+	return stats.fastpath;
+}
+
 /**
  * Variables that may be sent in a show status
  */
@@ -613,6 +675,11 @@ static struct {
 	{ "Max_event_queue_length", VT_INT, (STATSFUNC)maxinfo_max_event_queue_length },
 	{ "Max_event_queue_time", VT_INT, (STATSFUNC)maxinfo_max_event_queue_time },
 	{ "Max_event_execution_time", VT_INT, (STATSFUNC)maxinfo_max_event_exec_time },
+	{ "Classifier_cache_entries", VT_INT, (STATSFUNC)maxinfo_qc_cache_entries },
+	{ "Classifier_cache_hits", VT_INT, (STATSFUNC)maxinfo_qc_cache_hits },
+	{ "Classifier_cache_misses", VT_INT, (STATSFUNC)maxinfo_qc_cache_misses },
+	{ "Classifier_cache_evictions", VT_INT, (STATSFUNC)maxinfo_qc_cache_evictions },
+	{ "Classifier_fast_path", VT_INT, (STATSFUNC)maxinfo_qc_fast_path },
 	{ NULL, 0, 	NULL }
 };
 
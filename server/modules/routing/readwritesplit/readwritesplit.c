@@ -21,6 +21,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <limits.h>
 
 #include <router.h>
 #include <readwritesplit.h>
@@ -31,6 +32,7 @@
 #include <query_classifier.h>
 #include <dcb.h>
 #include <spinlock.h>
+#include <timer.h>
 #include <modinfo.h>
 #include <modutil.h>
 #include <mysql_client_server_protocol.h>
@@ -112,6 +114,24 @@ static backend_ref_t* check_candidate_bref(
 	backend_ref_t* new_bref,
 	select_criteria_t sc);
 
+static backend_ref_t* get_slave_by_two_choices(
+	ROUTER_CLIENT_SES* rses,
+	backend_ref_t*     master_bref,
+	int                max_rlag);
+
+static backend_ref_t* get_slave_by_least_load(
+	ROUTER_CLIENT_SES* rses,
+	backend_ref_t*     master_bref,
+	int                max_rlag);
+
+static bool bref_is_read_candidate(
+	ROUTER_CLIENT_SES* rses,
+	backend_ref_t*     bref,
+	backend_ref_t*     master_bref,
+	int                max_rlag);
+
+static int bref_process_reply(backend_ref_t* bref, GWBUF* buf);
+
 static skygw_query_type_t is_read_tmp_table(
 	ROUTER_CLIENT_SES* router_cli_ses,
 	GWBUF*  querybuf,
@@ -158,6 +178,10 @@ int bref_cmp_current_load(
         const void* bref1,
         const void* bref2);
 
+int bref_cmp_response_time(
+        const void* bref1,
+        const void* bref2);
+
 /**
  * The order of functions _must_ match with the order the select criteria are
  * listed in select_criteria_t definition in readwritesplit.h
@@ -168,7 +192,8 @@ int (*criteria_cmpfun[LAST_CRITERIA])(const void*, const void*)=
         bref_cmp_global_conn,
         bref_cmp_router_conn,
         bref_cmp_behind_master,
-        bref_cmp_current_load
+        bref_cmp_current_load,
+        bref_cmp_response_time
 };
 
 static bool select_connect_backend_servers(
@@ -282,6 +307,7 @@ static void refreshInstance(
 
 static void bref_clear_state(backend_ref_t* bref, bref_state_t state);
 static void bref_set_state(backend_ref_t*   bref, bref_state_t state);
+static void bref_set_query_active(backend_ref_t* bref, unsigned char cmd);
 static sescmd_cursor_t* backend_ref_get_sescmd_cursor (backend_ref_t* bref);
 
 static int  router_handle_state_switch(DCB* dcb, DCB_REASON reason, void* data);
@@ -1192,6 +1218,26 @@ static bool get_dcb(
         {
 		backend_ref_t* candidate_bref = NULL;
 
+		if (rses->rses_config.balance_reads)
+		{
+			candidate_bref = get_slave_by_least_load(rses,
+								 master_bref,
+								 max_rlag);
+		}
+		else if (rses->rses_config.rw_slave_select_criteria == LEAST_RESPONSE_TIME)
+		{
+			candidate_bref = get_slave_by_two_choices(rses,
+								  master_bref,
+								  max_rlag);
+		}
+
+		if (candidate_bref != NULL)
+		{
+			*p_dcb = candidate_bref->bref_dcb;
+			succp = true;
+			goto return_succp;
+		}
+
 		for (i=0; i<rses->rses_nbackends; i++)
 		{
 			BACKEND* b = (&backend_ref[i])->bref_backend;
@@ -1319,6 +1365,151 @@ return_succp:
 }
 
 
+/**
+ * Choose a slave for a read by comparing two slaves picked at random, the
+ * power of two choices. Always choosing the best of all slaves would send
+ * the reads of every session to the same slave until its average response
+ * time catches up with the load, comparing two random slaves spreads the
+ * reads and still steers them away from the slow and busy slaves.
+ *
+ * The two slaves are picked in one pass by reservoir sampling.
+ *
+ * @param rses		Router client session
+ * @param master_bref	Backend reference of the root master
+ * @param max_rlag	Maximum allowed replication lag or MAX_RLAG_UNDEFINED
+ *
+ * @return The chosen backend reference or NULL if there are no candidates
+ */
+static backend_ref_t* get_slave_by_two_choices(
+	ROUTER_CLIENT_SES* rses,
+	backend_ref_t*     master_bref,
+	int                max_rlag)
+{
+	backend_ref_t* choice[2] = {NULL, NULL};
+	backend_ref_t* bref;
+	int            i;
+	int            j;
+	int            n = 0;
+
+	for (i=0; i<rses->rses_nbackends; i++)
+	{
+		bref = &rses->rses_backend_ref[i];
+
+		if (!bref_is_read_candidate(rses, bref, master_bref, max_rlag))
+		{
+			continue;
+		}
+		n += 1;
+
+		if (n <= 2)
+		{
+			choice[n-1] = bref;
+		}
+		else if ((j = rand() % n) < 2)
+		{
+			choice[j] = bref;
+		}
+	}
+	return check_candidate_bref(choice[0], choice[1], LEAST_RESPONSE_TIME);
+}
+
+/**
+ * Choose a slave for a read when reads are balanced per statement. The read
+ * goes to the candidate whose server has the fewest outstanding queries
+ * relative to its weight. The search starts from the next backend for every
+ * read so that ties are spread over the slaves instead of always going to
+ * the first one.
+ *
+ * The replies must reach the client in the order of the statements, so a
+ * pipelined read follows the reads of the session that are still in flight
+ * to their backend.
+ *
+ * @param rses		Router client session
+ * @param master_bref	Backend reference of the root master
+ * @param max_rlag	Maximum allowed replication lag or MAX_RLAG_UNDEFINED
+ *
+ * @return The chosen backend reference or NULL if there are no candidates
+ */
+static backend_ref_t* get_slave_by_least_load(
+	ROUTER_CLIENT_SES* rses,
+	backend_ref_t*     master_bref,
+	int                max_rlag)
+{
+	backend_ref_t* best = NULL;
+	backend_ref_t* bref;
+	BACKEND*       b;
+	long long      load;
+	long long      best_load = 0;
+	int            n = rses->rses_nbackends;
+	int            start;
+	int            i;
+
+	if (n <= 0)
+	{
+		return NULL;
+	}
+	start = rses->rses_next_read % n;
+	rses->rses_next_read = (start + 1) % n;
+
+	for (i=0; i<n; i++)
+	{
+		bref = &rses->rses_backend_ref[(start + i) % n];
+
+		if (!bref_is_read_candidate(rses, bref, master_bref, max_rlag))
+		{
+			continue;
+		}
+		if (BREF_IS_QUERY_ACTIVE(bref))
+		{
+			return bref;
+		}
+		b = bref->bref_backend;
+		load = (b->weight == 0) ? LLONG_MAX :
+			((long long)b->backend_server->stats.n_current_ops * 1000) /
+			b->weight;
+
+		if (best == NULL || load < best_load)
+		{
+			best = bref;
+			best_load = load;
+		}
+	}
+	return best;
+}
+
+/**
+ * Check whether a backend can take a read. Slaves that are in use and within
+ * the allowed replication lag can, the master only if master_reads is set.
+ *
+ * @param rses		Router client session
+ * @param bref		The backend reference
+ * @param master_bref	Backend reference of the root master
+ * @param max_rlag	Maximum allowed replication lag or MAX_RLAG_UNDEFINED
+ *
+ * @return true if the read can be routed to the backend
+ */
+static bool bref_is_read_candidate(
+	ROUTER_CLIENT_SES* rses,
+	backend_ref_t*     bref,
+	backend_ref_t*     master_bref,
+	int                max_rlag)
+{
+	SERVER* srv = bref->bref_backend->backend_server;
+
+	if (!BREF_IS_IN_USE(bref))
+	{
+		return false;
+	}
+	if (SERVER_IS_MASTER(srv))
+	{
+		return bref == master_bref && rses->rses_config.master_reads;
+	}
+	return SERVER_IS_SLAVE(srv) &&
+		(max_rlag == MAX_RLAG_UNDEFINED ||
+		(srv->rlag != MAX_RLAG_NOT_AVAILABLE &&
+		srv->rlag <= max_rlag));
+}
+
 /**
  * Find out which of the two backend servers has smaller value for select 
  * criteria property.
@@ -1652,11 +1843,17 @@ static skygw_query_type_t is_read_tmp_table(
   data = (MYSQL_session*)master_dcb->session->data;
   dbname = (char*)data->db;
 
-  if (QUERY_IS_TYPE(qtype, QUERY_TYPE_READ) || 
+  /**
+   * The table names are only needed if the session has temporary tables,
+   * finding them out may require parsing the query.
+   */
+  if (rses_prop_tmp != NULL &&
+      rses_prop_tmp->rses_prop_data.temp_tables != NULL &&
+      (QUERY_IS_TYPE(qtype, QUERY_TYPE_READ) || 
 	  QUERY_IS_TYPE(qtype, QUERY_TYPE_LOCAL_READ) ||
 	  QUERY_IS_TYPE(qtype, QUERY_TYPE_USERVAR_READ) ||
 	  QUERY_IS_TYPE(qtype, QUERY_TYPE_SYSVAR_READ) ||
-	  QUERY_IS_TYPE(qtype, QUERY_TYPE_GSYSVAR_READ))	  
+	  QUERY_IS_TYPE(qtype, QUERY_TYPE_GSYSVAR_READ)))
     {
       tbl = skygw_get_table_names(querybuf,&tsize,false);
 
@@ -2504,7 +2701,7 @@ static bool route_single_stmt(
 			 * Add one query response waiter to backend reference
 			 */
 			bref = get_bref_from_dcb(rses, target_dcb);
-			bref_set_state(bref, BREF_QUERY_ACTIVE);
+			bref_set_query_active(bref, packet_type);
 			bref_set_state(bref, BREF_WAITING_RESULT);
 		}
 		else
@@ -2613,6 +2810,7 @@ ROUTER_INSTANCE	  *router = (ROUTER_INSTANCE *)instance;
 int		  i = 0;
 BACKEND		  *backend;
 char		  *weightby;
+QC_CACHE_STATS	  qcstats;
 
 	spinlock_acquire(&router->lock);
 	router_cli_ses = router->connections;
@@ -2641,6 +2839,22 @@ char		  *weightby;
 	dcb_printf(dcb,
                    "\tNumber of queries forwarded to all:   	%d\n",
                    router->stats.n_all);
+	query_classifier_cache_stats(&qcstats);
+	dcb_printf(dcb,
+                   "\tClassifier cache entries (size):     	%d (%d)\n",
+                   qcstats.entries, qcstats.size);
+	dcb_printf(dcb,
+                   "\tClassifier cache hits/misses:        	%d/%d\n",
+                   qcstats.hits, qcstats.misses);
+	dcb_printf(dcb,
+                   "\tClassifier cache evictions:          	%d\n",
+                   qcstats.evictions);
+	dcb_printf(dcb,
+                   "\tStatements not cached:               	%d\n",
+                   qcstats.uncacheable);
+	dcb_printf(dcb,
+                   "\tStatements classified without parsing:	%d\n",
+                   qcstats.fastpath);
 	if ((weightby = serviceGetWeightingParameter(router->service)) != NULL)
         {
                 dcb_printf(dcb,
@@ -2818,9 +3032,18 @@ static void clientReply (
          */
 	else if (BREF_IS_QUERY_ACTIVE(bref))
 	{
-                bref_clear_state(bref, BREF_QUERY_ACTIVE);
-                /** Set response status as replied */
-                bref_clear_state(bref, BREF_WAITING_RESULT);
+		int nreplies = bref_process_reply(bref, writebuf);
+
+		while (nreplies-- > 0)
+		{
+			/** Set response status as replied */
+			bref_clear_state(bref, BREF_WAITING_RESULT);
+		}
+		/** The replies to all queries sent to the backend are read */
+		if (!BREF_IS_WAITING_RESULT(bref))
+		{
+			bref_clear_state(bref, BREF_QUERY_ACTIVE);
+		}
         }
 
         if (writebuf != NULL && client_dcb != NULL)
@@ -2868,7 +3091,8 @@ static void clientReply (
 			/**
 			 * Add one query response waiter to backend reference
 			 */
-			bref_set_state(bref, BREF_QUERY_ACTIVE);
+			bref_set_query_active(bref, 
+				((uint8_t *)GWBUF_DATA(bref->bref_pending_cmd))[4]);
 			bref_set_state(bref, BREF_WAITING_RESULT);
 		}
 		else
@@ -2938,6 +3162,37 @@ int bref_cmp_current_load(
         return ((1000 * s1->stats.n_current_ops) - b1->weight)
 			- ((1000 * s2->stats.n_current_ops) - b2->weight);
 }
+
+/**
+ * The expected time a new query would take on a backend server, the
+ * average response time multiplied by the operations the query would
+ * queue behind, scaled by the weight of the server. A server without a
+ * measured response time scores zero so that it gets measured.
+ */
+static long long bref_response_score(
+        backend_ref_t* bref)
+{
+        BACKEND* b = bref->bref_backend;
+        SERVER*  s = b->backend_server;
+
+        if (b->weight == 0)
+        {
+                return LLONG_MAX;
+        }
+        return ((long long)s->stats.avg_response *
+                (s->stats.n_current_ops + 1) * 1000) / b->weight;
+}
+
+/** Compare the expected response times of backend servers */
+int bref_cmp_response_time(
+        const void* bref1,
+        const void* bref2)
+{
+        long long r1 = bref_response_score((backend_ref_t *)bref1);
+        long long r2 = bref_response_score((backend_ref_t *)bref2);
+
+        return ((r1 < r2) ? -1 : ((r1 > r2) ? 1 : 0));
+}
         
 static void bref_clear_state(
         backend_ref_t* bref,
@@ -3002,6 +3257,63 @@ static void bref_set_state(
         }
 }
 
+/**
+ * Mark a query as sent to a backend. The time and the command are those
+ * of the first query in flight, the reply of which is read first. Pipelined
+ * queries are assumed to have the same command.
+ *
+ * @param bref	The backend reference the query was written to
+ * @param cmd	The command of the query
+ */
+static void bref_set_query_active(
+        backend_ref_t* bref,
+        unsigned char  cmd)
+{
+        if (!BREF_IS_QUERY_ACTIVE(bref))
+        {
+                bref->bref_sent = timer_now_usec();
+                bref->bref_query_cmd = cmd;
+                bref->bref_reply_state = REPLY_STATE_START;
+        }
+        bref_set_state(bref, BREF_QUERY_ACTIVE);
+}
+
+/**
+ * Count the replies of a backend server that end in the buffer, see
+ * modutil_count_replies. The buffer holds complete packets only.
+ *
+ * The first packet of a reply also gives the response time of the server.
+ * The next reply in flight is timed from the end of the previous one.
+ *
+ * @param bref	The backend reference the reply came from
+ * @param buf	The reply packets
+ *
+ * @return The number of replies that ended in the buffer
+ */
+static int bref_process_reply(
+        backend_ref_t* bref,
+        GWBUF*         buf)
+{
+        int nreplies;
+
+        /** Time from sending the query to the first reply packet */
+        if (bref->bref_reply_state == REPLY_STATE_START && bref->bref_sent != 0)
+        {
+                server_add_response_time(bref->bref_backend->backend_server,
+                                         timer_now_usec() - bref->bref_sent);
+                bref->bref_sent = 0;
+        }
+        nreplies = modutil_count_replies(buf,
+                                         bref->bref_query_cmd,
+                                         &bref->bref_reply_state);
+
+        if (nreplies > 0)
+        {
+                bref->bref_sent = timer_now_usec();
+        }
+        return nreplies;
+}
+
 /** 
  * @node Search suitable backend servers from those of router instance.
  *
@@ -3144,7 +3456,8 @@ static bool select_connect_backend_servers(
                 if (select_criteria == LEAST_GLOBAL_CONNECTIONS ||
                         select_criteria == LEAST_ROUTER_CONNECTIONS ||
                         select_criteria == LEAST_BEHIND_MASTER ||
-                        select_criteria == LEAST_CURRENT_OPERATIONS)
+                        select_criteria == LEAST_CURRENT_OPERATIONS ||
+                        select_criteria == LEAST_RESPONSE_TIME)
                 {
                         LOGIF(LT, (skygw_log_write(LOGFILE_TRACE, 
                                 "Servers and %s connection counts:",
@@ -3183,6 +3496,16 @@ static bool select_connect_backend_servers(
 							STRSRVSTATUS(b->backend_server))));
                                                 break;
                                                 
+                                        case LEAST_RESPONSE_TIME:
+                                                LOGIF(LT, (skygw_log_write_flush(LOGFILE_TRACE, 
+							"response time : %d us, current operations : %d in \t%s:%d %s",
+							b->backend_server->stats.avg_response,
+							b->backend_server->stats.n_current_ops,
+							b->backend_server->name,
+							b->backend_server->port,
+							STRSRVSTATUS(b->backend_server))));
+                                                break;
+                                                
                                         case LEAST_BEHIND_MASTER:
                                                 LOGIF(LT, (skygw_log_write_flush(LOGFILE_TRACE, 
 							"replication lag : %d in \t%s:%d %s",
@@ -3267,6 +3590,7 @@ static bool select_connect_backend_servers(
                                                         &router_handle_state_switch,
                                                         (void *)&backend_ref[i]);
                                                 backend_ref[i].bref_state = 0;
+                                                backend_ref[i].bref_reply_state = REPLY_STATE_START;
                                                 bref_set_state(&backend_ref[i], 
                                                                BREF_IN_USE);
                                                /** 
@@ -3327,6 +3651,7 @@ static bool select_connect_backend_servers(
                                                 (void *)&backend_ref[i]);
 
                                         backend_ref[i].bref_state = 0;
+                                        backend_ref[i].bref_reply_state = REPLY_STATE_START;
                                         bref_set_state(&backend_ref[i], 
                                                        BREF_IN_USE);
                                         /** Increase backend connection counters */
@@ -4616,6 +4941,7 @@ static void rwsplit_process_router_options(
                                         c == LEAST_ROUTER_CONNECTIONS ||
                                         c == LEAST_BEHIND_MASTER ||
                                         c == LEAST_CURRENT_OPERATIONS ||
+                                        c == LEAST_RESPONSE_TIME ||
                                         c == UNDEFINED_CRITERIA);
                                
                                 if (c == UNDEFINED_CRITERIA)
@@ -4625,8 +4951,9 @@ static void rwsplit_process_router_options(
                                                 "slave selection criteria \"%s\". "
                                                 "Allowed values are LEAST_GLOBAL_CONNECTIONS, "
                                                 "LEAST_ROUTER_CONNECTIONS, "
-                                                "LEAST_BEHIND_MASTER,"
-                                                "and LEAST_CURRENT_OPERATIONS.",
+                                                "LEAST_BEHIND_MASTER, "
+                                                "LEAST_CURRENT_OPERATIONS "
+                                                "and LEAST_RESPONSE_TIME.",
                                                 STRCRITERIA(router->rwsplit_config.rw_slave_select_criteria))));
                                 }
                                 else
@@ -4650,6 +4977,10 @@ static void rwsplit_process_router_options(
 			{
 			    router->rwsplit_config.master_reads = config_truth_value(value);
 			}
+			else if(strcmp(options[i],"balance_reads") == 0)
+			{
+			    router->rwsplit_config.balance_reads = config_truth_value(value);
+			}
                 }
         } /*< for */
 }
@@ -21,10 +21,12 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <limits.h>
 #include <router.h>
 #include <schemarouter.h>
 #include <sharding_common.h>
 #include <secrets.h>
+#include <dbusers.h>
 #include <mysql.h>
 #include <skygw_utils.h>
 #include <log_manager.h>
@@ -32,6 +34,7 @@
 #include <dcb.h>
 #include <spinlock.h>
 #include <modinfo.h>
+#include <thread.h>
 #include <modutil.h>
 #include <mysql_client_server_protocol.h>
 
@@ -62,6 +65,13 @@ extern __thread log_info_t tls_log_info;
 
 static char *version_str = "V1.0.0";
 
+/** Default time in seconds before the shared shard map is refreshed */
+#define DEFAULT_REFRESH_INTERVAL 300
+/** Time in seconds before a failed refresh of the shard map is retried */
+#define SHARD_MAP_RETRY_INTERVAL 10
+/** Connect, read and write timeout in seconds of the shard map refresh */
+#define SHARD_MAP_TIMEOUT 3
+
 static	ROUTER* createInstance(SERVICE *service, char **options);
 static	void*   newSession(ROUTER *instance, SESSION *session);
 static	void    closeSession(ROUTER *instance, void *session);
@@ -196,6 +206,7 @@ static bool handle_error_new_connection(
         ROUTER_CLIENT_SES* rses,
         DCB*               backend_dcb,
         GWBUF*             errmsg);
+static void sg_reset(ROUTER_CLIENT_SES* rses);
 static void handle_error_reply_client(
 	SESSION*           ses, 
 	ROUTER_CLIENT_SES* rses, 
@@ -293,6 +304,71 @@ char* get_lenenc_str(void* data)
     return rval;
 }
 
+/**
+ * Check if a database is one of the system databases that every server has
+ * @param db Database name
+ * @return True if the database is a system database
+ */
+static bool is_system_db(char* db)
+{
+    return strcmp(db,"information_schema") == 0 ||
+        strcmp(db,"performance_schema") == 0 ||
+        strcmp(db,"mysql") == 0;
+}
+
+/**
+ * Record that a database that is already in the database hashtable is
+ * also on another server. The servers of such databases are kept as comma
+ * separated lists in the shard hashtable.
+ * @param dbhash Database hashtable
+ * @param shardhash Shard hashtable
+ * @param db Database name
+ * @param target Server that also has the database
+ */
+static void add_shard_server(HASHTABLE* dbhash, HASHTABLE* shardhash, char* db, char* target)
+{
+    char *servers, *first;
+
+    if((servers = hashtable_fetch(shardhash,db)) != NULL)
+    {
+        first = servers;
+    }
+    else if((first = hashtable_fetch(dbhash,db)) == NULL)
+    {
+        return;
+    }
+
+    if((servers = malloc(strlen(first) + strlen(target) + 2)) == NULL)
+    {
+        return;
+    }
+    sprintf(servers,"%s,%s",first,target);
+    hashtable_delete(shardhash,db);
+    hashtable_add(shardhash,db,servers);
+    skygw_log_write(LOGFILE_TRACE,"schemarouter: <%s, %s>",servers,db);
+    free(servers);
+}
+
+/**
+ * Add a database of a server to the database hashtable. The first server
+ * that has the database is the one queries are routed to.
+ * @param dbhash Database hashtable
+ * @param shardhash Shard hashtable
+ * @param db Database name
+ * @param target Server that has the database
+ */
+static void add_database(HASHTABLE* dbhash, HASHTABLE* shardhash, char* db, char* target)
+{
+    if(hashtable_add(dbhash,db,target))
+    {
+        skygw_log_write(LOGFILE_TRACE,"schemarouter: <%s, %s>",target,db);
+    }
+    else if(!is_system_db(db))
+    {
+        add_shard_server(dbhash,shardhash,db,target);
+    }
+}
+
 /**
  * Parses a response set to a SHOW DATABASES query and inserts them into the 
  * router client session's database hashtable. The name of the database is used 
@@ -356,10 +432,7 @@ bool parse_showdb_response(ROUTER_CLIENT_SES* rses, backend_ref_t* bref, GWBUF**
 
 	   if(data)
 	   {
-	       if(hashtable_add(rses->dbhash,data,target))
-	       {
-		   skygw_log_write(LOGFILE_TRACE,"schemarouter: <%s, %s>",target,data);
-	       }
+	       add_database(rses->dbhash,rses->shardhash,data,target);
 	       free(data);
 	   }
 	   ptr += packetlen;
@@ -430,6 +503,424 @@ int gen_databaselist(ROUTER_INSTANCE* inst, ROUTER_CLIENT_SES* session)
         return !rval;
 }
 
+/**
+ * Release a reference to a shard map, the map is freed once the last
+ * reference is released.
+ * @param map Shard map
+ */
+static void shard_map_release(shard_map_t* map)
+{
+    if(atomic_add(&map->refcount,-1) == 1)
+    {
+        if(map->hash)
+        {
+            hashtable_free(map->hash);
+        }
+        if(map->shards)
+        {
+            hashtable_free(map->shards);
+        }
+        free(map);
+    }
+}
+
+/**
+ * Allocate a hashtable with string keys and values
+ * @return The hashtable or NULL on error
+ */
+static HASHTABLE* shard_hash_alloc()
+{
+    HASHTABLE* hash;
+
+    if((hash = hashtable_alloc(100, hashkeyfun, hashcmpfun)) != NULL)
+    {
+        hashtable_memory_fns(hash,(HASHMEMORYFN)strdup,
+                             (HASHMEMORYFN)strdup,
+                             (HASHMEMORYFN)free,
+                             (HASHMEMORYFN)free);
+    }
+    return hash;
+}
+
+/**
+ * Allocate empty database hashtables for a session that maps the
+ * databases itself. The current map of the session is released.
+ * @param rses Router client session
+ * @return True if the hashtables were allocated
+ */
+static bool shard_map_private(ROUTER_CLIENT_SES* rses)
+{
+    if(rses->shard_map)
+    {
+        shard_map_release(rses->shard_map);
+        rses->shard_map = NULL;
+    }
+    else
+    {
+        if(rses->dbhash)
+        {
+            hashtable_free(rses->dbhash);
+        }
+        if(rses->shardhash)
+        {
+            hashtable_free(rses->shardhash);
+        }
+    }
+
+    rses->dbhash = shard_hash_alloc();
+    rses->shardhash = shard_hash_alloc();
+    return rses->dbhash != NULL && rses->shardhash != NULL;
+}
+
+/**
+ * Release the database hashtables of a session.
+ * @param rses Router client session
+ */
+static void shard_map_done(ROUTER_CLIENT_SES* rses)
+{
+    if(rses->shard_map)
+    {
+        shard_map_release(rses->shard_map);
+        rses->shard_map = NULL;
+    }
+    else
+    {
+        if(rses->dbhash)
+        {
+            hashtable_free(rses->dbhash);
+        }
+        if(rses->shardhash)
+        {
+            hashtable_free(rses->shardhash);
+        }
+    }
+    rses->dbhash = NULL;
+    rses->shardhash = NULL;
+}
+
+/**
+ * Map the databases of all the running servers with the credentials of the
+ * service and publish the result as the shard map of the router instance.
+ * The previous map is kept if a server could not be mapped. This is the
+ * entry point of a thread of its own so that neither the client sessions
+ * nor the housekeeper are blocked while the servers are queried.
+ * @param data Router instance
+ */
+static void shard_map_load(void* data)
+{
+    ROUTER_INSTANCE* inst = (ROUTER_INSTANCE*)data;
+    shard_map_t *map = NULL, *old = NULL;
+    SERVER* server;
+    MYSQL* con;
+    MYSQL_RES* result;
+    MYSQL_ROW row;
+    char *user, *passwd, *dpwd = NULL;
+    int i, timeout = SHARD_MAP_TIMEOUT;
+    bool succp = false, mysql_init_done = false;
+
+    if(mysql_thread_init())
+    {
+        skygw_log_write_flush(LOGFILE_ERROR,"Error : mysql_thread_init failed "
+                              "in the shard map thread of service %s.",
+                              inst->service->name);
+        goto return_map;
+    }
+    mysql_init_done = true;
+
+    if((map = calloc(1,sizeof(shard_map_t))) == NULL ||
+       (map->hash = shard_hash_alloc()) == NULL ||
+       (map->shards = shard_hash_alloc()) == NULL)
+    {
+        skygw_log_write_flush(LOGFILE_ERROR,"Error : Memory allocation failed.");
+        goto return_map;
+    }
+    map->refcount = 1;
+    map->generation = inst->map_generation;
+
+    if(serviceGetUser(inst->service,&user,&passwd) == 0)
+    {
+        skygw_log_write_flush(LOGFILE_ERROR,"Error : Service %s has no credentials "
+                              "to map the databases with.",inst->service->name);
+        goto return_map;
+    }
+    dpwd = decryptPassword(passwd);
+    succp = true;
+
+    for(i = 0; succp && inst->servers[i]; i++)
+    {
+        server = inst->servers[i]->backend_server;
+
+        if(!SERVER_IS_RUNNING(server))
+        {
+            continue;
+        }
+
+        if((con = mysql_init(NULL)) == NULL)
+        {
+            skygw_log_write_flush(LOGFILE_ERROR,"Error : mysql_init failed.");
+            succp = false;
+            break;
+        }
+        mysql_options(con,MYSQL_OPT_CONNECT_TIMEOUT,(void *)&timeout);
+        mysql_options(con,MYSQL_OPT_READ_TIMEOUT,(void *)&timeout);
+        mysql_options(con,MYSQL_OPT_WRITE_TIMEOUT,(void *)&timeout);
+        mysql_options(con,MYSQL_OPT_USE_REMOTE_CONNECTION,NULL);
+
+        if(mysql_real_connect(con,server->name,user,dpwd,NULL,
+                              server->port,NULL,0) == NULL ||
+           mysql_query(con,"SHOW DATABASES") ||
+           (result = mysql_store_result(con)) == NULL)
+        {
+            skygw_log_write_flush(LOGFILE_ERROR,"Error : Failed to map the databases "
+                                  "of server %s for service %s: %s",
+                                  server->unique_name,
+                                  inst->service->name,
+                                  mysql_error(con));
+            succp = false;
+        }
+        else
+        {
+            while((row = mysql_fetch_row(result)))
+            {
+                if(row[0])
+                {
+                    add_database(map->hash,map->shards,row[0],server->unique_name);
+                }
+            }
+            mysql_free_result(result);
+        }
+        mysql_close(con);
+    }
+
+return_map:
+    free(dpwd);
+    spinlock_acquire(&inst->lock);
+    inst->map_refreshing = false;
+    if(succp)
+    {
+        map->last_updated = time(NULL);
+        old = inst->shard_map;
+        inst->shard_map = map;
+    }
+    else
+    {
+        inst->map_retry = time(NULL) + SHARD_MAP_RETRY_INTERVAL;
+        old = map;
+    }
+    spinlock_release(&inst->lock);
+
+    if(old)
+    {
+        shard_map_release(old);
+    }
+    if(succp)
+    {
+        skygw_log_write(LOGFILE_TRACE,"schemarouter: Shard map of service %s refreshed.",
+                        inst->service->name);
+    }
+    if(mysql_init_done)
+    {
+        mysql_thread_end();
+    }
+}
+
+/**
+ * Start a refresh of the shard map of the router instance unless one is
+ * already running or a failed refresh was tried too recently.
+ * @param inst Router instance
+ */
+static void shard_map_refresh(ROUTER_INSTANCE* inst)
+{
+    void *prev = NULL, *thd;
+    bool start;
+
+    spinlock_acquire(&inst->lock);
+    start = !inst->map_refreshing && time(NULL) >= inst->map_retry;
+    if(start)
+    {
+        inst->map_refreshing = true;
+        prev = inst->map_thread;
+        inst->map_thread = NULL;
+    }
+    spinlock_release(&inst->lock);
+
+    if(start)
+    {
+        /** The previous thread has published its map and is about to exit */
+        if(prev)
+        {
+            thread_wait(prev);
+        }
+
+        /**
+         * The handle is stored before the new thread can clear map_refreshing,
+         * so that it is never overwritten before it has been waited for.
+         */
+        spinlock_acquire(&inst->lock);
+        if((thd = thread_start(shard_map_load,inst)) == NULL)
+        {
+            inst->map_refreshing = false;
+            inst->map_retry = time(NULL) + SHARD_MAP_RETRY_INTERVAL;
+        }
+        inst->map_thread = thd;
+        spinlock_release(&inst->lock);
+
+        if(thd == NULL)
+        {
+            skygw_log_write_flush(LOGFILE_ERROR,"Error : Failed to start the shard "
+                                  "map thread of service %s.",inst->service->name);
+        }
+    }
+}
+
+/**
+ * Get a reference to the shard map of the router instance. A map that is
+ * older than the refresh interval or that has been invalidated is still
+ * returned while a new one is being loaded.
+ * @param inst Router instance
+ * @return The shard map or NULL if the instance has no map yet
+ */
+static shard_map_t* shard_map_get(ROUTER_INSTANCE* inst)
+{
+    shard_map_t* map;
+    bool stale;
+
+    spinlock_acquire(&inst->lock);
+    map = inst->shard_map;
+    stale = map == NULL || map->generation != inst->map_generation ||
+        time(NULL) - map->last_updated >= inst->schemarouter_config.refresh_interval;
+
+    if(map)
+    {
+        atomic_add(&map->refcount,1);
+    }
+    spinlock_release(&inst->lock);
+
+    if(stale)
+    {
+        shard_map_refresh(inst);
+    }
+    return map;
+}
+
+/**
+ * Mark the shard map of the router instance stale and start loading a
+ * new one.
+ * @param inst Router instance
+ */
+static void shard_map_invalidate(ROUTER_INSTANCE* inst)
+{
+    atomic_add(&inst->map_generation,1);
+    shard_map_refresh(inst);
+}
+
+/**
+ * Check if the client of a session may see a database. The shared shard
+ * map is loaded with the credentials of the service, so a database in it
+ * is shown only if the user has a grant on it in the users the service
+ * has loaded for authentication. The databases mapped by the session
+ * itself are already the ones the user can see.
+ * @param rses Router client session
+ * @param db Database name
+ * @return True if the database can be shown to the client
+ */
+static bool shard_map_visible(ROUTER_CLIENT_SES* rses, char* db)
+{
+    SERVICE* service = rses->router->service;
+    MYSQL_USER_HOST key;
+    int localhost;
+
+    if(rses->shard_map == NULL || strcmp(db,"information_schema") == 0)
+    {
+        return true;
+    }
+
+    key.user = rses->rses_mysql_session->user;
+    memcpy(&key.ipv4,&rses->rses_client_dcb->ipv4,sizeof(struct sockaddr_in));
+    key.netmask = 32;
+    key.resource = db;
+
+    /** The wildcard hosts are matched as in the client authentication */
+    localhost = key.ipv4.sin_addr.s_addr == 0x0100007F &&
+        !service->localhost_match_wildcard_host;
+
+    return mysql_users_match(service->users,&key,!localhost) != NULL;
+}
+
+/**
+ * Send the database the client connected with to the server that has it.
+ * Queries are queued until the reply to the COM_INIT_DB is received. The
+ * caller must hold the router session lock.
+ * @param rses Router client session
+ * @return False if the database is unknown and the client must be hung up
+ */
+static bool send_connect_db(ROUTER_CLIENT_SES* router_cli_ses)
+{
+    char* target;
+
+    if((target = hashtable_fetch(router_cli_ses->dbhash,
+                       router_cli_ses->connect_db)) == NULL)
+    {
+        /** Unknown database, hang up on the client*/
+        skygw_log_write_flush(LOGFILE_TRACE,"schemarouter: Connecting to a non-existent database '%s'",
+                              router_cli_ses->connect_db);
+        char errmsg[128 + MYSQL_DATABASE_MAXLEN+1];
+        sprintf(errmsg,"Unknown database '%s'",router_cli_ses->connect_db);
+        GWBUF* errbuff = modutil_create_mysql_err_msg(1,0,1049,"42000",errmsg);
+        router_cli_ses->rses_client_dcb->func.write(router_cli_ses->rses_client_dcb,errbuff);
+        if(router_cli_ses->queue)
+        {
+            while((router_cli_ses->queue = gwbuf_consume(
+                   router_cli_ses->queue,gwbuf_length(router_cli_ses->queue))));
+        }
+        return false;
+    }
+
+    /* Send a COM_INIT_DB packet to the server with the right database
+     * and set it as the client's active database */
+
+    unsigned int qlen;
+    GWBUF* buffer;
+
+    qlen = strlen(router_cli_ses->connect_db);
+    buffer = gwbuf_alloc(qlen + 5);
+    if(buffer == NULL)
+    {
+        skygw_log_write_flush(LOGFILE_ERROR,"Error : Buffer allocation failed.");
+        router_cli_ses->rses_closed = true;
+        if(router_cli_ses->queue)
+            gwbuf_free(router_cli_ses->queue);
+        router_cli_ses->queue = NULL;
+        return true;
+    }
+
+    gw_mysql_set_byte3((unsigned char*)buffer->start,qlen+1);
+    gwbuf_set_type(buffer,GWBUF_TYPE_MYSQL);
+    *((unsigned char*)buffer->start + 3) = 0x0;
+    *((unsigned char*)buffer->start + 4) = 0x2;
+    memcpy(buffer->start+5,router_cli_ses->connect_db,qlen);
+    DCB* dcb = NULL;
+
+    if(get_shard_dcb(&dcb,router_cli_ses,target))
+    {
+        dcb->func.write(dcb,buffer);
+        skygw_log_write(LOGFILE_DEBUG,"schemarouter: USE '%s' sent to %s for session %p",
+                        router_cli_ses->connect_db,
+                        target,
+                        router_cli_ses->rses_client_dcb->session);
+    }
+    else
+    {
+        skygw_log_write_flush(LOGFILE_TRACE,"schemarouter: Couldn't find target DCB for '%s'.",target);
+        router_cli_ses->rses_closed = true;
+        gwbuf_free(buffer);
+        if(router_cli_ses->queue)
+            gwbuf_free(router_cli_ses->queue);
+        router_cli_ses->queue = NULL;
+    }
+    return true;
+}
+
 /**
  * Check the hashtable for the right backend for this query.
  * @param router Router instance
@@ -712,6 +1203,7 @@ createInstance(SERVICE *service, char **options)
         } 
         router->service = service;
 	router->schemarouter_config.max_sescmd_hist = 0;
+	router->schemarouter_config.refresh_interval = DEFAULT_REFRESH_INTERVAL;
 	router->stats.longest_sescmd = 0;
 	router->stats.n_hist_exceeded = 0;
 	router->stats.n_queries = 0;
@@ -753,6 +1245,10 @@ createInstance(SERVICE *service, char **options)
 	    {
 		router->schemarouter_config.disable_sescmd_hist = config_truth_value(value);
 	    }
+	    else if(strcmp(options[i],"refresh_interval") == 0)
+	    {
+		router->schemarouter_config.refresh_interval = atoi(value);
+	    }
 	    else
 	    {
 		skygw_log_write(LOGFILE_ERROR,"Error: Unknown router options for Schemarouter: %s",options[i]);
@@ -1010,12 +1506,6 @@ static void* newSession(
 					session,
 					router);
         
-        client_rses->dbhash = hashtable_alloc(100, hashkeyfun, hashcmpfun);
-        hashtable_memory_fns(client_rses->dbhash,(HASHMEMORYFN)strdup,
-                                 (HASHMEMORYFN)strdup,
-                                 (HASHMEMORYFN)free,
-                                 (HASHMEMORYFN)free);
-
         rses_end_locked_router_action(client_rses);
         
 	/** 
@@ -1047,7 +1537,30 @@ static void* newSession(
             /* Store the database the client is connecting to */
             strncpy(client_rses->connect_db,db,MYSQL_DATABASE_MAXLEN+1);
         }
-        
+
+        /**
+         * Use the shard map of the instance if it has been loaded, otherwise
+         * the session maps the databases itself.
+         */
+        if((client_rses->shard_map = shard_map_get(router)))
+        {
+            client_rses->dbhash = client_rses->shard_map->hash;
+            client_rses->shardhash = client_rses->shard_map->shards;
+            atomic_add(&router->stats.shmap_cache_hit,1);
+        }
+        else if(shard_map_private(client_rses))
+        {
+            atomic_add(&router->stats.shmap_cache_miss,1);
+        }
+        else
+        {
+            rses_end_locked_router_action(client_rses);
+            shard_map_done(client_rses);
+            free(client_rses->rses_backend_ref);
+            free(client_rses);
+            client_rses = NULL;
+            goto return_rses;
+        }
              
         rses_end_locked_router_action(client_rses);
 
@@ -1245,7 +1758,9 @@ static void freeSession(
          * all the memory and other resources associated
          * to the client session.
          */
-        hashtable_free(router_cli_ses->dbhash);
+        shard_map_done(router_cli_ses);
+
+        sg_reset(router_cli_ses);
         free(router_cli_ses->rses_backend_ref);
 	free(router_cli_ses);
         return;
@@ -1683,118 +2198,1443 @@ gen_show_dbs_response(ROUTER_INSTANCE* router, ROUTER_CLIENT_SES* client)
     *ptr++ = coldef_len >> 16;
     *ptr++ = 0x02;
 
-    memcpy((void*) ptr, catalog, 4);
-    ptr += 4;
+    memcpy((void*) ptr, catalog, 4);
+    ptr += 4;
+
+    *ptr++ = strlen(schema);
+    memcpy((void*) ptr, schema, strlen(schema));
+    ptr += strlen(schema);
+
+    *ptr++ = strlen(table);
+    memcpy((void*) ptr, table, strlen(table));
+    ptr += strlen(table);
+
+    *ptr++ = strlen(org_table);
+    memcpy((void*) ptr, org_table, strlen(org_table));
+    ptr += strlen(org_table);
+
+    *ptr++ = strlen(name);
+    memcpy((void*) ptr, name, strlen(name));
+    ptr += strlen(name);
+
+    *ptr++ = strlen(org_name);
+    memcpy((void*) ptr, org_name, strlen(org_name));
+    ptr += strlen(org_name);
+
+    *ptr++ = next_length;
+    *ptr++ = charset[0];
+    *ptr++ = charset[1];
+    *ptr++ = column_length[0];
+    *ptr++ = column_length[1];
+    *ptr++ = column_length[2];
+    *ptr++ = column_length[3];
+    *ptr++ = column_type;
+    *ptr++ = 0x01;
+    memset(ptr, 0, 4);
+    ptr += 4;
+
+    memcpy(ptr, eof, sizeof(eof));
+
+    unsigned int packet_num = 4;
+    int j = 0,ndbs = 0, bufsz = 10;
+    char** dbs;
+
+    if((dbs = malloc(sizeof(char*)*bufsz)) == NULL)
+    {
+	gwbuf_free(rval);
+	hashtable_iterator_free(iter);
+	return NULL;
+    }
+
+    while((value = (char*) hashtable_next(iter)))
+    {
+        char* bend = hashtable_fetch(ht, value);
+
+        if(!shard_map_visible(client, value))
+        {
+            continue;
+        }
+
+        for(i = 0; backends[i]; i++)
+        {
+            if(strcmp(bref[i].bref_backend->backend_server->unique_name, bend) == 0 &&
+               BREF_IS_IN_USE(&bref[i]) && !BREF_IS_CLOSED(&bref[i]))
+            {
+		ndbs++;
+
+		if(ndbs >= bufsz)
+		{
+		    bufsz += bufsz / 2;
+		    char** tmp = realloc(dbs,sizeof(char*)*bufsz);
+		    if(tmp == NULL)
+		    {
+			gwbuf_free(rval);
+			hashtable_iterator_free(iter);
+			for(i=0;i<ndbs-1;i++)free(dbs[i]);
+			free(dbs);
+			return NULL;
+		    }
+		    dbs = tmp;
+		}
+
+		dbs[j++] = strdup(value);
+            }
+        }
+    }
+
+    qsort(&dbs[0],(size_t)ndbs,sizeof(char*),cmpfn);
+
+    for(j = 0;j<ndbs;j++)
+    {
+
+	GWBUF* temp;
+	int plen = strlen(dbs[j]) + 1;
+
+	sprintf(dbname, "%s", dbs[j]);
+	temp = gwbuf_alloc(plen + 4);
+
+	ptr = temp->start;
+	*ptr++ = plen;
+	*ptr++ = plen >> 8;
+	*ptr++ = plen >> 16;
+	*ptr++ = packet_num++;
+	*ptr++ = plen - 1;
+	memcpy(ptr, dbname, plen - 1);
+
+	/** Append the row*/
+	rval = gwbuf_append(rval, temp);
+	free(dbs[j]);
+    }
+
+    eof[3] = packet_num;
+
+    GWBUF* last_packet = gwbuf_alloc(sizeof(eof));
+    memcpy(last_packet->start, eof, sizeof(eof));
+    rval = gwbuf_append(rval, last_packet);
+
+    rval = gwbuf_make_contiguous(rval);
+    hashtable_iterator_free(iter);
+    free(dbs);
+    return rval;
+}
+
+/**
+ * Read a length encoded integer and move the pointer past it.
+ * @param ptr Pointer to the integer, moved past it
+ * @param null Set to true if the value is the NULL marker
+ * @return The value of the integer
+ */
+static uint64_t sg_lenenc_int(uint8_t** ptr, bool* null)
+{
+    uint8_t* p = *ptr;
+    uint64_t val = 0;
+    int i, len = 0;
+
+    *null = false;
+    switch(*p)
+    {
+    case 0xfb:
+        *null = true;
+        break;
+    case 0xfc:
+        len = 2;
+        break;
+    case 0xfd:
+        len = 3;
+        break;
+    case 0xfe:
+        len = 8;
+        break;
+    default:
+        val = *p;
+        break;
+    }
+
+    for(i = 0; i < len; i++)
+    {
+        val |= (uint64_t)p[1 + i] << (8 * i);
+    }
+    *ptr = p + 1 + len;
+    return val;
+}
+
+/**
+ * Read the values of a row packet. A value that contains a zero byte can't
+ * be handled as a string and makes the row invalid.
+ * @param ptr Pointer to the row packet
+ * @param ncols Number of columns
+ * @return Array of ncols values, NULL values are NULL pointers, or NULL if
+ * the row is invalid or memory allocation failed
+ */
+static char** sg_parse_row(uint8_t* ptr, int ncols)
+{
+    uint8_t* end = ptr + gw_mysql_get_byte3(ptr) + 4;
+    char** row;
+    uint64_t len;
+    bool null;
+    int i;
+
+    if((row = calloc(ncols,sizeof(char*))) == NULL)
+    {
+        return NULL;
+    }
+    ptr += 4;
+
+    for(i = 0; i < ncols; i++)
+    {
+        if(ptr >= end)
+        {
+            break;
+        }
+        len = sg_lenenc_int(&ptr,&null);
+
+        if(null)
+        {
+            continue;
+        }
+        if(ptr + len > end || memchr(ptr,'\0',len) != NULL ||
+           (row[i] = strndup((char*)ptr,len)) == NULL)
+        {
+            break;
+        }
+        ptr += len;
+    }
+
+    if(i < ncols)
+    {
+        while(i >= 0)
+        {
+            free(row[i--]);
+        }
+        free(row);
+        return NULL;
+    }
+    return row;
+}
+
+/**
+ * Free the values of a row.
+ * @param row Row
+ * @param ncols Number of columns
+ */
+static void sg_free_row(char** row, int ncols)
+{
+    int i;
+
+    if(row)
+    {
+        for(i = 0; i < ncols; i++)
+        {
+            free(row[i]);
+        }
+        free(row);
+    }
+}
+
+/**
+ * Create a row packet with the values encoded as length encoded strings.
+ * @param row Values of the row, NULL values are NULL pointers
+ * @param ncols Number of columns
+ * @param seqno Sequence number of the packet
+ * @return The packet or NULL if memory allocation failed
+ */
+static GWBUF* sg_row_packet(char** row, int ncols, uint8_t seqno)
+{
+    GWBUF* pkt;
+    uint8_t* ptr;
+    int i, len = 0;
+    unsigned int vlen;
+
+    for(i = 0; i < ncols; i++)
+    {
+        vlen = row[i] ? strlen(row[i]) : 0;
+        len += 1 + vlen + (vlen < 251 ? 0 : vlen < 0x10000 ? 2 : 3);
+    }
+
+    if((pkt = gwbuf_alloc(len + 4)) == NULL)
+    {
+        return NULL;
+    }
+    ptr = GWBUF_DATA(pkt);
+    gw_mysql_set_byte3(ptr,len);
+    ptr[3] = seqno;
+    ptr += 4;
+
+    for(i = 0; i < ncols; i++)
+    {
+        if(row[i] == NULL)
+        {
+            *ptr++ = 0xfb;
+            continue;
+        }
+        vlen = strlen(row[i]);
+
+        if(vlen < 251)
+        {
+            *ptr++ = vlen;
+        }
+        else if(vlen < 0x10000)
+        {
+            *ptr++ = 0xfc;
+            *ptr++ = vlen;
+            *ptr++ = vlen >> 8;
+        }
+        else
+        {
+            *ptr++ = 0xfd;
+            *ptr++ = vlen;
+            *ptr++ = vlen >> 8;
+            *ptr++ = vlen >> 16;
+        }
+        memcpy(ptr,row[i],vlen);
+        ptr += vlen;
+    }
+    return pkt;
+}
+
+/**
+ * Create a string that identifies the values of a row.
+ * @param row Values of the row
+ * @param ncols Number of columns
+ * @return The string or NULL if memory allocation failed
+ */
+static char* sg_row_key(char** row, int ncols)
+{
+    char* key;
+    int i, len = 1;
+
+    for(i = 0; i < ncols; i++)
+    {
+        len += (row[i] ? strlen(row[i]) : 0) + 12;
+    }
+
+    if((key = malloc(len)) != NULL)
+    {
+        *key = '\0';
+        for(i = 0; i < ncols; i++)
+        {
+            if(row[i])
+            {
+                sprintf(key + strlen(key),"%d:%s",(int)strlen(row[i]),row[i]);
+            }
+            else
+            {
+                strcat(key,"-");
+            }
+        }
+    }
+    return key;
+}
+
+/**
+ * A decimal number split into its sign and digits
+ */
+typedef struct sg_decimal_st {
+    bool        neg;  /*< The number is negative */
+    const char* ip;   /*< Digits of the integer part, without leading zeros */
+    int         ilen; /*< Number of integer digits */
+    const char* fp;   /*< Digits of the fraction */
+    int         flen; /*< Number of fraction digits */
+} sg_decimal_t;
+
+/**
+ * Split a decimal number of the form [-]digits[.digits].
+ * @param str The number
+ * @param dec The parts of the number
+ * @return True if the string is a decimal number
+ */
+static bool sg_decimal_parse(const char* str, sg_decimal_t* dec)
+{
+    bool digits;
+
+    dec->neg = *str == '-';
+    if(*str == '-' || *str == '+')
+    {
+        str++;
+    }
+    dec->ilen = strspn(str,"0123456789");
+    dec->ip = str;
+    str += dec->ilen;
+    dec->fp = str;
+    dec->flen = 0;
+
+    if(*str == '.')
+    {
+        dec->fp = ++str;
+        dec->flen = strspn(str,"0123456789");
+        str += dec->flen;
+    }
+    digits = dec->ilen + dec->flen > 0;
+
+    while(dec->ilen > 0 && *dec->ip == '0')
+    {
+        dec->ip++;
+        dec->ilen--;
+    }
+    return *str == '\0' && digits;
+}
+
+/**
+ * Get a digit of a decimal number.
+ * @param dec The number
+ * @param pos Position of the digit, 0 is the last integer digit, negative
+ * positions are fraction digits and -1 is the first of them
+ * @return The digit
+ */
+static int sg_decimal_digit(sg_decimal_t* dec, int pos)
+{
+    if(pos >= 0)
+    {
+        return pos < dec->ilen ? dec->ip[dec->ilen - 1 - pos] - '0' : 0;
+    }
+    return -pos <= dec->flen ? dec->fp[-pos - 1] - '0' : 0;
+}
+
+/**
+ * Compare the absolute values of two decimal numbers.
+ * @param a First number
+ * @param b Second number
+ * @return Less than, equal to or greater than zero if |a| is smaller than,
+ * equal to or greater than |b|
+ */
+static int sg_decimal_cmp_abs(sg_decimal_t* a, sg_decimal_t* b)
+{
+    int pos, diff;
+
+    if(a->ilen != b->ilen)
+    {
+        return a->ilen - b->ilen;
+    }
+
+    for(pos = a->ilen - 1; pos >= -MAX(a->flen,b->flen); pos--)
+    {
+        if((diff = sg_decimal_digit(a,pos) - sg_decimal_digit(b,pos)) != 0)
+        {
+            return diff;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Add two decimal numbers exactly. The sum has the larger number of
+ * fraction digits of the two.
+ * @param a First number
+ * @param b Second number
+ * @return The sum or NULL if a value is not a decimal number or memory
+ * allocation failed
+ */
+static char* sg_decimal_add(const char* a, const char* b)
+{
+    sg_decimal_t x, y, *big, *small;
+    char *digits, *rval, *ptr;
+    int scale, len, pos, d, carry = 0;
+    bool neg, sub, zero = true;
+
+    if(!sg_decimal_parse(a,&x) || !sg_decimal_parse(b,&y))
+    {
+        return NULL;
+    }
+
+    /** Subtract the smaller absolute value from the larger one */
+    sub = x.neg != y.neg;
+    big = sg_decimal_cmp_abs(&x,&y) >= 0 ? &x : &y;
+    small = big == &x ? &y : &x;
+    neg = big->neg;
+    scale = MAX(x.flen,y.flen);
+    len = MAX(x.ilen,y.ilen) + 1 + scale;
+
+    if((digits = malloc(len)) == NULL || (rval = malloc(len + 3)) == NULL)
+    {
+        free(digits);
+        return NULL;
+    }
+
+    /** The digits are stored from the last one */
+    for(pos = -scale; pos < len - scale; pos++)
+    {
+        if(sub)
+        {
+            d = sg_decimal_digit(big,pos) - sg_decimal_digit(small,pos) - carry;
+            carry = d < 0;
+            d += carry ? 10 : 0;
+        }
+        else
+        {
+            d = sg_decimal_digit(big,pos) + sg_decimal_digit(small,pos) + carry;
+            carry = d >= 10;
+            d -= carry ? 10 : 0;
+        }
+        digits[pos + scale] = '0' + d;
+        zero = zero && d == 0;
+    }
+
+    /** Skip the leading zeros of the integer part */
+    for(pos = len - 1; pos > scale && digits[pos] == '0'; pos--)
+        ;
+
+    ptr = rval;
+    if(neg && !zero)
+    {
+        *ptr++ = '-';
+    }
+    for(; pos >= 0; pos--)
+    {
+        if(pos == scale - 1)
+        {
+            *ptr++ = '.';
+        }
+        *ptr++ = digits[pos];
+    }
+    *ptr = '\0';
+    free(digits);
+    return rval;
+}
+
+/**
+ * Compare two decimal numbers exactly.
+ * @param a First number
+ * @param b Second number
+ * @param cmp Set to less than, equal to or greater than zero if a is
+ * smaller than, equal to or greater than b
+ * @return False if a value is not a decimal number
+ */
+static bool sg_decimal_cmp(const char* a, const char* b, int* cmp)
+{
+    sg_decimal_t x, y;
+    bool xzero, yzero;
+
+    if(!sg_decimal_parse(a,&x) || !sg_decimal_parse(b,&y))
+    {
+        return false;
+    }
+    xzero = x.ilen == 0 && strspn(x.fp,"0") >= (size_t)x.flen;
+    yzero = y.ilen == 0 && strspn(y.fp,"0") >= (size_t)y.flen;
+    x.neg = x.neg && !xzero;
+    y.neg = y.neg && !yzero;
+
+    if(x.neg != y.neg)
+    {
+        *cmp = x.neg ? -1 : 1;
+    }
+    else
+    {
+        *cmp = x.neg ? sg_decimal_cmp_abs(&y,&x) : sg_decimal_cmp_abs(&x,&y);
+    }
+    return true;
+}
+
+/**
+ * Find out how the values of a column can be combined by an aggregate.
+ * A COUNT or a SUM is merged if the column is exact or floating point. A
+ * MIN or a MAX of strings is merged only if the strings are binary, the
+ * order of other strings depends on their collation.
+ * @param agg Aggregate of the column
+ * @param type Type of the column
+ * @param charset Character set of the column
+ * @return How the values are combined
+ */
+static sg_merge_kind_t sg_merge_kind(skygw_query_agg_t agg, uint8_t type, int charset)
+{
+    sg_merge_kind_t kind = SG_MERGE_NONE;
+
+    switch(type)
+    {
+    case MYSQL_TYPE_DECIMAL:
+    case MYSQL_TYPE_NEWDECIMAL:
+    case MYSQL_TYPE_TINY:
+    case MYSQL_TYPE_SHORT:
+    case MYSQL_TYPE_INT24:
+    case MYSQL_TYPE_LONG:
+    case MYSQL_TYPE_LONGLONG:
+    case MYSQL_TYPE_NULL:
+        kind = SG_MERGE_EXACT;
+        break;
+    case MYSQL_TYPE_FLOAT:
+    case MYSQL_TYPE_DOUBLE:
+        kind = SG_MERGE_FLOAT;
+        break;
+    case MYSQL_TYPE_YEAR:
+    case MYSQL_TYPE_DATE:
+    case MYSQL_TYPE_NEWDATE:
+    case MYSQL_TYPE_DATETIME:
+    case MYSQL_TYPE_TIMESTAMP:
+        kind = SG_MERGE_BINARY;
+        break;
+    case MYSQL_TYPE_VARCHAR:
+    case MYSQL_TYPE_VAR_STRING:
+    case MYSQL_TYPE_STRING:
+    case MYSQL_TYPE_TINY_BLOB:
+    case MYSQL_TYPE_MEDIUM_BLOB:
+    case MYSQL_TYPE_LONG_BLOB:
+    case MYSQL_TYPE_BLOB:
+        /** The binary character set */
+        kind = charset == 63 ? SG_MERGE_BINARY : SG_MERGE_NONE;
+        break;
+    default:
+        break;
+    }
+
+    if(kind == SG_MERGE_BINARY && (agg == QUERY_AGG_COUNT || agg == QUERY_AGG_SUM))
+    {
+        kind = SG_MERGE_NONE;
+    }
+    return kind;
+}
+
+/**
+ * Read how each aggregated column is combined from the column definitions
+ * of a result set.
+ * @param rses Router client session
+ * @param header Contiguous buffer with the field count, the column
+ * definitions and the EOF packet
+ * @return True if all the columns can be combined
+ */
+static bool sg_read_columns(ROUTER_CLIENT_SES* rses, GWBUF* header)
+{
+    uint8_t* ptr = (uint8_t*)GWBUF_DATA(header);
+    uint8_t* next;
+    bool null;
+    int i, col;
+
+    if((rses->sg_kinds = calloc(rses->sg_ncols,sizeof(sg_merge_kind_t))) == NULL)
+    {
+        return false;
+    }
+
+    /** Skip the field count */
+    ptr += gw_mysql_get_byte3(ptr) + 4;
+
+    for(col = 0; col < rses->sg_ncols; col++)
+    {
+        next = ptr + gw_mysql_get_byte3(ptr) + 4;
+        ptr += 4;
+
+        /** Skip the catalog, schema, table, names and the fixed length */
+        for(i = 0; i < 6; i++)
+        {
+            ptr += sg_lenenc_int(&ptr,&null);
+        }
+        ptr++;
+
+        /** The character set, column length and type follow */
+        if(ptr + 7 > next ||
+           (rses->sg_kinds[col] = sg_merge_kind(rses->sg_aggs[col],ptr[6],
+                                                gw_mysql_get_byte2(ptr))) == SG_MERGE_NONE)
+        {
+            return false;
+        }
+        ptr = next;
+    }
+    return true;
+}
+
+/**
+ * Add two values of a COUNT or a SUM.
+ * @param a First value
+ * @param b Second value
+ * @param kind How the values are combined
+ * @return The sum or NULL if the values could not be added
+ */
+static char* sg_sum(char* a, char* b, sg_merge_kind_t kind)
+{
+    char buf[64];
+
+    if(kind == SG_MERGE_FLOAT)
+    {
+        snprintf(buf,sizeof(buf),"%.17g",strtod(a,NULL) + strtod(b,NULL));
+        return strdup(buf);
+    }
+    return sg_decimal_add(a,b);
+}
+
+/**
+ * Compare two values of a MIN or a MAX.
+ * @param a First value
+ * @param b Second value
+ * @param kind How the values are combined
+ * @param cmp Set to less than, equal to or greater than zero if a is
+ * smaller than, equal to or greater than b
+ * @return False if the values could not be compared
+ */
+static bool sg_compare(char* a, char* b, sg_merge_kind_t kind, int* cmp)
+{
+    double x, y;
+
+    switch(kind)
+    {
+    case SG_MERGE_EXACT:
+        return sg_decimal_cmp(a,b,cmp);
+    case SG_MERGE_FLOAT:
+        x = strtod(a,NULL);
+        y = strtod(b,NULL);
+        *cmp = x < y ? -1 : x > y ? 1 : 0;
+        return true;
+    case SG_MERGE_BINARY:
+        *cmp = strcmp(a,b);
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * Merge the aggregates of a row into the row of merged aggregates. NULL
+ * values are ignored in the same way as the aggregate functions do.
+ * @param rses Router client session
+ * @param row Row to merge, values moved to the merged row are removed
+ * @return False if the values could not be combined
+ */
+static bool sg_aggregate(ROUTER_CLIENT_SES* rses, char** row)
+{
+    char** merged = rses->sg_row;
+    char* value;
+    int i, cmp;
+
+    for(i = 0; i < rses->sg_ncols; i++)
+    {
+        value = NULL;
+
+        if(row[i] == NULL)
+        {
+            continue;
+        }
+
+        if(merged[i] == NULL)
+        {
+            merged[i] = row[i];
+            row[i] = NULL;
+            continue;
+        }
+
+        switch(rses->sg_aggs[i])
+        {
+        case QUERY_AGG_COUNT:
+        case QUERY_AGG_SUM:
+            if((value = sg_sum(merged[i],row[i],rses->sg_kinds[i])) == NULL)
+            {
+                return false;
+            }
+            break;
+        case QUERY_AGG_MIN:
+        case QUERY_AGG_MAX:
+            if(!sg_compare(row[i],merged[i],rses->sg_kinds[i],&cmp))
+            {
+                return false;
+            }
+            if(rses->sg_aggs[i] == QUERY_AGG_MIN ? cmp < 0 : cmp > 0)
+            {
+                value = row[i];
+                row[i] = NULL;
+            }
+            break;
+        default:
+            break;
+        }
+
+        if(value)
+        {
+            free(merged[i]);
+            merged[i] = value;
+        }
+    }
+    return true;
+}
+
+/**
+ * Create an error packet for a scattered statement.
+ * @param rses Router client session
+ * @param seqno Sequence number of the packet
+ * @return The error from a server if there was one, otherwise a generic
+ * error
+ */
+static GWBUF* sg_error_packet(ROUTER_CLIENT_SES* rses, uint8_t seqno)
+{
+    GWBUF* err;
+
+    if(rses->sg_error && PTR_IS_ERR((uint8_t*)GWBUF_DATA(rses->sg_error)))
+    {
+        err = rses->sg_error;
+        rses->sg_error = NULL;
+    }
+    else
+    {
+        err = modutil_create_mysql_err_msg(1,0,1105,"HY000",
+            "Failed to merge the results of the shards.");
+        skygw_log_write(LOGFILE_ERROR,"Error : Schemarouter: Failed to merge "
+                        "the results of a scattered statement.");
+    }
+
+    if(err)
+    {
+        ((uint8_t*)GWBUF_DATA(err))[3] = seqno;
+    }
+    return err;
+}
+
+/**
+ * Handle the end of the column definitions of a server. The column
+ * definitions of the first server that sends them are passed to the client
+ * unchanged, those of the other servers must have the same number of
+ * columns. The rows that are concatenated are streamed to the client right
+ * after them.
+ * @param rses Router client session
+ * @param bref Backend that sent the column definitions
+ * @param out Chain of packets to send to the client
+ * @return The chain of packets to send
+ */
+static GWBUF* sg_columns_done(ROUTER_CLIENT_SES* rses, backend_ref_t* bref, GWBUF* out)
+{
+    GWBUF* header = gwbuf_make_contiguous(bref->sg_header);
+    uint8_t* ptr;
+    bool null;
+    int ncols;
+
+    bref->sg_header = NULL;
+
+    if(header == NULL)
+    {
+        rses->sg_failed = true;
+        return out;
+    }
+    ptr = (uint8_t*)GWBUF_DATA(header) + 4;
+    ncols = sg_lenenc_int(&ptr,&null);
+
+    if(rses->sg_ncols > 0)
+    {
+        if(ncols != rses->sg_ncols)
+        {
+            rses->sg_failed = true;
+        }
+        gwbuf_free(header);
+        return out;
+    }
+    rses->sg_ncols = ncols;
+
+    if(rses->sg_aggs)
+    {
+        if(rses->sg_naggs != ncols || !sg_read_columns(rses,header) ||
+           (rses->sg_row = calloc(ncols,sizeof(char*))) == NULL)
+        {
+            rses->sg_failed = true;
+        }
+        rses->sg_header = header;
+    }
+    else if(rses->sg_error || rses->sg_failed)
+    {
+        gwbuf_free(header);
+    }
+    else
+    {
+        /** The sequence number after the EOF that ends the column definitions */
+        rses->sg_seqno = ((uint8_t*)GWBUF_DATA(header))[gwbuf_length(header) - 6] + 1;
+        out = gwbuf_append(out,header);
+    }
+    return out;
+}
+
+/**
+ * Handle a row of a server. Rows are concatenated or merged into the row
+ * of merged aggregates.
+ * @param rses Router client session
+ * @param pkt The row packet
+ * @param out Chain of packets to send to the client
+ * @return The chain of packets to send
+ */
+static GWBUF* sg_add_row(ROUTER_CLIENT_SES* rses, GWBUF* pkt, GWBUF* out)
+{
+    uint8_t* ptr = (uint8_t*)GWBUF_DATA(pkt);
+    char** row = NULL;
+    char* key;
+    bool duplicate = false;
+
+    if(rses->sg_failed || (rses->sg_error && rses->sg_seqno == 0))
+    {
+        /** The statement ends in an error */
+    }
+    else if(rses->sg_aggs || rses->sg_seen)
+    {
+        if((row = sg_parse_row(ptr,rses->sg_ncols)) == NULL)
+        {
+            rses->sg_failed = true;
+        }
+        else if(rses->sg_aggs)
+        {
+            rses->sg_failed = !sg_aggregate(rses,row);
+        }
+        else if((key = sg_row_key(row,rses->sg_ncols)) != NULL)
+        {
+            if(!(duplicate = hashtable_fetch(rses->sg_seen,key) != NULL))
+            {
+                hashtable_add(rses->sg_seen,key,"");
+            }
+            free(key);
+        }
+    }
+
+    if(!rses->sg_aggs && !duplicate && !rses->sg_failed &&
+       rses->sg_seqno > 0 && rses->sg_error == NULL)
+    {
+        ptr[3] = rses->sg_seqno++;
+        out = gwbuf_append(out,pkt);
+        pkt = NULL;
+    }
+    sg_free_row(row,rses->sg_ncols);
+    gwbuf_free(pkt);
+    return out;
+}
+
+/**
+ * Record the reply of a server that is not a result set. The first such
+ * reply is forwarded to the client if nothing has been sent yet, otherwise
+ * the result set ends in an error.
+ * @param rses Router client session
+ * @param pkt The OK or error packet
+ */
+static void sg_add_error(ROUTER_CLIENT_SES* rses, GWBUF* pkt)
+{
+    if(rses->sg_error == NULL)
+    {
+        rses->sg_error = pkt;
+    }
+    else
+    {
+        gwbuf_free(pkt);
+    }
+}
+
+/**
+ * Handle a packet of the reply of a server to a scattered statement.
+ * @param rses Router client session
+ * @param bref Backend that replied
+ * @param pkt Contiguous buffer with the packet
+ * @param out Chain of packets to send to the client
+ * @return The chain of packets to send
+ */
+static GWBUF* sg_add_packet(ROUTER_CLIENT_SES* rses, backend_ref_t* bref,
+                            GWBUF* pkt, GWBUF* out)
+{
+    uint8_t* ptr = (uint8_t*)GWBUF_DATA(pkt);
+
+    if(PTR_IS_ERR(ptr) || (bref->sg_state == REPLY_STATE_START &&
+                           (PTR_IS_OK(ptr) || PTR_IS_LOCAL_INFILE(ptr))))
+    {
+        sg_add_error(rses,pkt);
+        bref->sg_waiting = false;
+        return out;
+    }
+
+    switch(bref->sg_state)
+    {
+    case REPLY_STATE_START:
+        bref->sg_header = pkt;
+        bref->sg_state = REPLY_STATE_RSET_COLDEF;
+        break;
+
+    case REPLY_STATE_RSET_COLDEF:
+        bref->sg_header = gwbuf_append(bref->sg_header,pkt);
+
+        if(PTR_IS_EOF(ptr))
+        {
+            bref->sg_state = REPLY_STATE_RSET_ROWS;
+            out = sg_columns_done(rses,bref,out);
+        }
+        break;
+
+    case REPLY_STATE_RSET_ROWS:
+        if(PTR_IS_EOF(ptr))
+        {
+            /** The status of the last server is sent to the client */
+            rses->sg_status = gw_mysql_get_byte2(ptr + 7) & ~0x08;
+            bref->sg_waiting = false;
+            gwbuf_free(pkt);
+        }
+        else
+        {
+            out = sg_add_row(rses,pkt,out);
+        }
+        break;
+    }
+    return out;
+}
+
+/**
+ * Create the EOF packet that ends the rows of a result set.
+ * @param seqno Sequence number of the packet
+ * @param status Server status of the packet
+ * @return The packet or NULL if memory allocation failed
+ */
+static GWBUF* sg_eof_packet(uint8_t seqno, uint16_t status)
+{
+    GWBUF* pkt;
+    uint8_t* ptr;
+
+    if((pkt = gwbuf_alloc(9)) != NULL)
+    {
+        ptr = (uint8_t*)GWBUF_DATA(pkt);
+        gw_mysql_set_byte3(ptr,5);
+        ptr[3] = seqno;
+        ptr[4] = 0xfe;
+        ptr[5] = 0;
+        ptr[6] = 0;
+        gw_mysql_set_byte2(ptr + 7,status);
+    }
+    return pkt;
+}
+
+/**
+ * Release the state of a scattered statement.
+ * @param rses Router client session
+ */
+static void sg_reset(ROUTER_CLIENT_SES* rses)
+{
+    GWBUF* buf;
+    int i;
+
+    for(i = 0; i < rses->rses_nbackends; i++)
+    {
+        buf = rses->rses_backend_ref[i].sg_reply;
+        while(buf && (buf = gwbuf_consume(buf,gwbuf_length(buf))));
+        buf = rses->rses_backend_ref[i].sg_header;
+        while(buf && (buf = gwbuf_consume(buf,gwbuf_length(buf))));
+        rses->rses_backend_ref[i].sg_reply = NULL;
+        rses->rses_backend_ref[i].sg_header = NULL;
+        rses->rses_backend_ref[i].sg_state = REPLY_STATE_START;
+        rses->rses_backend_ref[i].sg_waiting = false;
+    }
+    buf = rses->sg_header;
+    while(buf && (buf = gwbuf_consume(buf,gwbuf_length(buf))));
+    buf = rses->sg_error;
+    while(buf && (buf = gwbuf_consume(buf,gwbuf_length(buf))));
+    sg_free_row(rses->sg_row,rses->sg_ncols);
+    if(rses->sg_seen)
+    {
+        hashtable_free(rses->sg_seen);
+    }
+    free(rses->sg_kinds);
+    free(rses->sg_aggs);
+    rses->sg_header = NULL;
+    rses->sg_error = NULL;
+    rses->sg_row = NULL;
+    rses->sg_seen = NULL;
+    rses->sg_kinds = NULL;
+    rses->sg_aggs = NULL;
+    rses->sg_naggs = 0;
+    rses->sg_ncols = 0;
+    rses->sg_seqno = 0;
+    rses->sg_status = 0;
+    rses->sg_failed = false;
+    rses->sg_incomplete = false;
+}
+
+/**
+ * Finish a scattered statement once all the servers have replied or
+ * failed. The streamed rows end in an EOF packet or in an error if a
+ * server failed. If nothing has been sent yet, the merged aggregates, the
+ * reply of the servers if none of them returned a result set, or an error
+ * is sent. The caller must hold the router session lock.
+ * @param rses Router client session
+ * @return The rest of the reply to send to the client
+ */
+static GWBUF* sg_finish(ROUTER_CLIENT_SES* rses)
+{
+    GWBUF *reply, *pkt, *eof;
+    int i;
+
+    if(rses->sg_seqno > 0)
+    {
+        /** The rows were streamed, end the result set */
+        if(rses->sg_failed || rses->sg_incomplete || rses->sg_error)
+        {
+            reply = sg_error_packet(rses,rses->sg_seqno);
+        }
+        else
+        {
+            reply = sg_eof_packet(rses->sg_seqno,rses->sg_status);
+        }
+    }
+    else if(rses->sg_error && !PTR_IS_ERR((uint8_t*)GWBUF_DATA(rses->sg_error)) &&
+            rses->sg_ncols == 0 && !rses->sg_incomplete)
+    {
+        /** None of the servers returned a result set */
+        reply = rses->sg_error;
+        rses->sg_error = NULL;
+    }
+    else if(rses->sg_aggs && rses->sg_row && !rses->sg_failed &&
+            !rses->sg_incomplete && rses->sg_error == NULL)
+    {
+        /** The column definitions of the first server and the merged row */
+        for(i = 0; i < rses->sg_ncols; i++)
+        {
+            if(rses->sg_aggs[i] == QUERY_AGG_COUNT && rses->sg_row[i] == NULL)
+            {
+                rses->sg_row[i] = strdup("0");
+            }
+        }
+        reply = rses->sg_header;
+        rses->sg_header = NULL;
+        rses->sg_seqno = ((uint8_t*)GWBUF_DATA(reply))[gwbuf_length(reply) - 6] + 1;
+
+        pkt = sg_row_packet(rses->sg_row,rses->sg_ncols,rses->sg_seqno);
+        eof = sg_eof_packet(rses->sg_seqno + 1,rses->sg_status);
+
+        if(pkt == NULL || eof == NULL)
+        {
+            gwbuf_free(reply);
+            if(pkt)
+            {
+                gwbuf_free(pkt);
+            }
+            if(eof)
+            {
+                gwbuf_free(eof);
+            }
+            reply = sg_error_packet(rses,1);
+        }
+        else
+        {
+            reply = gwbuf_append(gwbuf_append(reply,pkt),eof);
+        }
+    }
+    else
+    {
+        reply = sg_error_packet(rses,1);
+    }
+    sg_reset(rses);
+    return reply;
+}
+
+/**
+ * Add a part of the reply of a server to a scattered statement. The
+ * packets are handled as they arrive and only incomplete packets and the
+ * column definitions are kept. The caller must hold the router session
+ * lock.
+ * @param rses Router client session
+ * @param bref Backend that replied
+ * @param buf Part of the reply
+ * @return The packets to send to the client, NULL if there are none yet
+ */
+static GWBUF* sg_add_reply(ROUTER_CLIENT_SES* rses, backend_ref_t* bref, GWBUF* buf)
+{
+    GWBUF *out = NULL, *pkt;
+
+    bref->sg_reply = gwbuf_append(bref->sg_reply,buf);
+
+    while(bref->sg_waiting && bref->sg_reply)
+    {
+        /** The packet length must be read from a single buffer */
+        if(GWBUF_LENGTH(bref->sg_reply) < 4)
+        {
+            bref->sg_reply = gwbuf_make_contiguous(bref->sg_reply);
+        }
+        if((pkt = modutil_get_next_MySQL_packet(&bref->sg_reply)) == NULL)
+        {
+            break;
+        }
+        out = sg_add_packet(rses,bref,pkt,out);
+    }
+
+    if(bref->sg_waiting)
+    {
+        return out;
+    }
 
-    *ptr++ = strlen(schema);
-    memcpy((void*) ptr, schema, strlen(schema));
-    ptr += strlen(schema);
+    /** The reply is complete */
+    while(bref->sg_reply &&
+          (bref->sg_reply = gwbuf_consume(bref->sg_reply,gwbuf_length(bref->sg_reply))));
+    bref_clear_state(bref, BREF_QUERY_ACTIVE);
+    bref_clear_state(bref, BREF_WAITING_RESULT);
 
-    *ptr++ = strlen(table);
-    memcpy((void*) ptr, table, strlen(table));
-    ptr += strlen(table);
+    if(--rses->sg_pending == 0)
+    {
+        out = gwbuf_append(out,sg_finish(rses));
+    }
+    return out;
+}
 
-    *ptr++ = strlen(org_table);
-    memcpy((void*) ptr, org_table, strlen(org_table));
-    ptr += strlen(org_table);
+/**
+ * Stop waiting for a server that failed to reply to a scattered statement.
+ * The rest of the reply is sent to the client if this was the last server
+ * it waited for. The caller must hold the router session lock.
+ * @param rses Router client session
+ * @param bref Backend that failed
+ * @param errmsg Error to send to the client or NULL
+ */
+static void sg_bref_failed(ROUTER_CLIENT_SES* rses, backend_ref_t* bref, GWBUF* errmsg)
+{
+    GWBUF* reply;
 
-    *ptr++ = strlen(name);
-    memcpy((void*) ptr, name, strlen(name));
-    ptr += strlen(name);
+    bref->sg_waiting = false;
+    while(bref->sg_reply &&
+          (bref->sg_reply = gwbuf_consume(bref->sg_reply,gwbuf_length(bref->sg_reply))));
+    while(bref->sg_header &&
+          (bref->sg_header = gwbuf_consume(bref->sg_header,gwbuf_length(bref->sg_header))));
+    rses->sg_incomplete = true;
 
-    *ptr++ = strlen(org_name);
-    memcpy((void*) ptr, org_name, strlen(org_name));
-    ptr += strlen(org_name);
+    if(errmsg && rses->sg_error == NULL)
+    {
+        rses->sg_error = gwbuf_clone(errmsg);
+    }
 
-    *ptr++ = next_length;
-    *ptr++ = charset[0];
-    *ptr++ = charset[1];
-    *ptr++ = column_length[0];
-    *ptr++ = column_length[1];
-    *ptr++ = column_length[2];
-    *ptr++ = column_length[3];
-    *ptr++ = column_type;
-    *ptr++ = 0x01;
-    memset(ptr, 0, 4);
-    ptr += 4;
+    if(--rses->sg_pending == 0 && (reply = sg_finish(rses)) != NULL)
+    {
+        poll_add_epollin_event_to_dcb(rses->dcb_reply,reply);
+    }
+}
 
-    memcpy(ptr, eof, sizeof(eof));
+/**
+ * Find the servers a statement is scattered to. A statement is scattered
+ * to the servers that have all the databases it uses, including the
+ * current database, if there is more than one such server.
+ * @param rses Router client session
+ * @param buffer Query
+ * @param qtype Query type
+ * @param targets Array of rses_nbackends elements, set to the backends
+ * @return Number of backends the statement is scattered to
+ */
+static int get_scatter_targets(ROUTER_CLIENT_SES* rses, GWBUF* buffer,
+                               skygw_query_type_t qtype, backend_ref_t** targets)
+{
+    char **dbnms = NULL;
+    char *query, *tok, *servers, *saveptr;
+    int *hits;
+    int i, j, sz = 0, ndbs = 0, rval = 0;
+    bool scatter = true;
 
-    unsigned int packet_num = 4;
-    int j = 0,ndbs = 0, bufsz = 10;
-    char** dbs;
+    if(QUERY_IS_TYPE(qtype, QUERY_TYPE_SHOW_TABLES))
+    {
+        /** SHOW TABLES with a specific database or the current one */
+        if((query = modutil_get_SQL(buffer)) == NULL)
+        {
+            return 0;
+        }
+        if((tok = strcasestr(query,"from")) && strtok_r(tok," ;",&saveptr) &&
+           (tok = strtok_r(NULL," ;",&saveptr)))
+        {
+            if((dbnms = malloc(sizeof(char*))) != NULL)
+            {
+                dbnms[sz++] = strdup(tok);
+            }
+        }
+        free(query);
+    }
+    else
+    {
+        dbnms = skygw_get_database_names(buffer,&sz);
+    }
 
-    if((dbs = malloc(sizeof(char*)*bufsz)) == NULL)
+    if(sz == 0 || !QUERY_IS_TYPE(qtype, QUERY_TYPE_SHOW_TABLES))
     {
-	gwbuf_free(rval);
-	hashtable_iterator_free(iter);
-	return NULL;
+        if(rses->rses_mysql_session->db[0] != '\0')
+        {
+            char** tmp = realloc(dbnms,sizeof(char*) * (sz + 1));
+
+            if(tmp)
+            {
+                dbnms = tmp;
+                dbnms[sz++] = strdup(rses->rses_mysql_session->db);
+            }
+        }
     }
 
-    while((value = (char*) hashtable_next(iter)))
+    if((hits = calloc(rses->rses_nbackends,sizeof(int))) == NULL)
     {
-        char* bend = hashtable_fetch(ht, value);
+        scatter = false;
+    }
 
-        for(i = 0; backends[i]; i++)
+    for(i = 0; i < sz; i++)
+    {
+        if(scatter && dbnms[i] && !is_system_db(dbnms[i]) &&
+           (servers = hashtable_fetch(rses->shardhash,dbnms[i])) != NULL &&
+           (servers = strdup(servers)) != NULL)
         {
-            if(strcmp(bref[i].bref_backend->backend_server->unique_name, bend) == 0 &&
-               BREF_IS_IN_USE(&bref[i]) && !BREF_IS_CLOSED(&bref[i]))
+            for(tok = strtok_r(servers,",",&saveptr); tok;
+                tok = strtok_r(NULL,",",&saveptr))
             {
-		ndbs++;
+                for(j = 0; j < rses->rses_nbackends; j++)
+                {
+                    if(strcmp(rses->rses_backend_ref[j].bref_backend->backend_server->unique_name,tok) == 0)
+                    {
+                        hits[j]++;
+                    }
+                }
+            }
+            free(servers);
+            ndbs++;
+        }
+        else
+        {
+            /** The database is on a single server */
+            scatter = false;
+        }
+        free(dbnms[i]);
+    }
+    free(dbnms);
 
-		if(ndbs >= bufsz)
-		{
-		    bufsz += bufsz / 2;
-		    char** tmp = realloc(dbs,sizeof(char*)*bufsz);
-		    if(tmp == NULL)
-		    {
-			gwbuf_free(rval);
-			hashtable_iterator_free(iter);
-			for(i=0;i<ndbs-1;i++)free(dbs[i]);
-			free(dbs);
-			return NULL;
-		    }
-		    dbs = tmp;
-		}
+    for(j = 0; scatter && ndbs > 0 && j < rses->rses_nbackends; j++)
+    {
+        backend_ref_t* bref = &rses->rses_backend_ref[j];
 
-		dbs[j++] = strdup(value);
-            }
+        if(hits[j] == ndbs && BREF_IS_IN_USE(bref) && !BREF_IS_CLOSED(bref) &&
+           SERVER_IS_RUNNING(bref->bref_backend->backend_server))
+        {
+            targets[rval++] = bref;
         }
     }
+    free(hits);
+    return rval;
+}
 
-    qsort(&dbs[0],(size_t)ndbs,sizeof(char*),cmpfn);
+/**
+ * Scatter a read-only statement to all the servers that have the databases
+ * it uses. The replies are merged in clientReply into a single reply: the
+ * rows of all the servers are streamed to the client as they arrive or, if
+ * every column of the select list is a COUNT, SUM, MIN or MAX, folded into
+ * a single row. Statements whose results can't be merged in this way are
+ * routed to a single server as before.
+ * @param inst Router instance
+ * @param rses Router client session
+ * @param querybuf Query
+ * @param qtype Query type
+ * @return -1 if the statement was not scattered, otherwise 1 on success
+ * and 0 on error
+ */
+static int route_scattered(ROUTER_INSTANCE* inst, ROUTER_CLIENT_SES* rses,
+                           GWBUF* querybuf, skygw_query_type_t qtype)
+{
+    backend_ref_t** targets;
+    backend_ref_t* bref;
+    skygw_query_agg_t* aggs = NULL;
+    int i, ntargets, naggs = 0, nmerged = 0, nplain = 0, rval = -1;
+
+    if((!QUERY_IS_TYPE(qtype, QUERY_TYPE_READ) &&
+        !QUERY_IS_TYPE(qtype, QUERY_TYPE_SHOW_TABLES)) ||
+       QUERY_IS_TYPE(qtype, QUERY_TYPE_WRITE) ||
+       QUERY_IS_TYPE(qtype, QUERY_TYPE_MASTER_READ) ||
+       QUERY_IS_TYPE(qtype, QUERY_TYPE_READ_TMP_TABLE) ||
+       querybuf->hint != NULL || rses->rses_transaction_active)
+    {
+        return -1;
+    }
 
-    for(j = 0;j<ndbs;j++)
+    if(!QUERY_IS_TYPE(qtype, QUERY_TYPE_SHOW_TABLES))
     {
+        if((naggs = skygw_get_aggregates(querybuf,&aggs)) < 0)
+        {
+            return -1;
+        }
 
-	GWBUF* temp;
-	int plen = strlen(dbs[j]) + 1;
+        for(i = 0; i < naggs; i++)
+        {
+            if(aggs[i] == QUERY_AGG_NONE)
+            {
+                nplain++;
+            }
+            else if(aggs[i] != QUERY_AGG_OTHER)
+            {
+                nmerged++;
+            }
+        }
 
-	sprintf(dbname, "%s", dbs[j]);
-	temp = gwbuf_alloc(plen + 4);
+        /** Other aggregates and aggregates mixed with plain columns can't be merged */
+        if(nplain + nmerged != naggs || (nmerged > 0 && nplain > 0))
+        {
+            free(aggs);
+            return -1;
+        }
+    }
 
-	ptr = temp->start;
-	*ptr++ = plen;
-	*ptr++ = plen >> 8;
-	*ptr++ = plen >> 16;
-	*ptr++ = packet_num++;
-	*ptr++ = plen - 1;
-	memcpy(ptr, dbname, plen - 1);
+    if(!rses_begin_locked_router_action(rses))
+    {
+        free(aggs);
+        return 0;
+    }
 
-	/** Append the row*/
-	rval = gwbuf_append(rval, temp);
-	free(dbs[j]);
+    if(rses->sg_pending > 0 ||
+       (targets = malloc(sizeof(backend_ref_t*) * rses->rses_nbackends)) == NULL)
+    {
+        rses_end_locked_router_action(rses);
+        free(aggs);
+        return -1;
     }
 
-    eof[3] = packet_num;
+    if((ntargets = get_scatter_targets(rses,querybuf,qtype,targets)) < 2)
+    {
+        rses_end_locked_router_action(rses);
+        free(targets);
+        free(aggs);
+        return -1;
+    }
 
-    GWBUF* last_packet = gwbuf_alloc(sizeof(eof));
-    memcpy(last_packet->start, eof, sizeof(eof));
-    rval = gwbuf_append(rval, last_packet);
+    if(nmerged > 0)
+    {
+        rses->sg_aggs = aggs;
+        rses->sg_naggs = naggs;
+    }
+    else
+    {
+        free(aggs);
+    }
 
-    rval = gwbuf_make_contiguous(rval);
-    hashtable_iterator_free(iter);
-    free(dbs);
+    /** The tables of a database on several servers are listed once */
+    if(QUERY_IS_TYPE(qtype, QUERY_TYPE_SHOW_TABLES) &&
+       (rses->sg_seen = shard_hash_alloc()) == NULL)
+    {
+        sg_reset(rses);
+        rses_end_locked_router_action(rses);
+        free(targets);
+        return -1;
+    }
+
+    for(i = 0; i < ntargets; i++)
+    {
+        bref = targets[i];
+
+        LOGIF(LT, (skygw_log_write(
+                LOGFILE_TRACE,
+                "Scatter query to \t%s:%d <",
+                bref->bref_backend->backend_server->name,
+                bref->bref_backend->backend_server->port)));
+
+        if(sescmd_cursor_is_active(&bref->bref_sescmd_cur))
+        {
+            /** Sent once the session command has been executed */
+            ss_dassert(bref->bref_pending_cmd == NULL);
+            bref->bref_pending_cmd = gwbuf_clone(querybuf);
+        }
+        else if(bref->bref_dcb->func.write(bref->bref_dcb,gwbuf_clone(querybuf)) == 1)
+        {
+            bref_set_state(bref, BREF_QUERY_ACTIVE);
+            bref_set_state(bref, BREF_WAITING_RESULT);
+            atomic_add(&bref->bref_backend->stats.queries, 1);
+        }
+        else
+        {
+            LOGIF(LE, (skygw_log_write_flush(
+                    LOGFILE_ERROR,
+                    "Error : Routing query to %s failed.",
+                    bref->bref_backend->backend_server->unique_name)));
+            rses->sg_incomplete = true;
+            continue;
+        }
+        bref->sg_state = REPLY_STATE_START;
+        bref->sg_waiting = true;
+        rses->sg_pending++;
+    }
+    free(targets);
+
+    if(rses->sg_pending > 0)
+    {
+        atomic_add(&inst->stats.n_queries, 1);
+        atomic_add(&inst->stats.n_scattered, 1);
+        rval = 1;
+    }
+    else
+    {
+        sg_reset(rses);
+        rval = 0;
+    }
+    rses_end_locked_router_action(rses);
     return rval;
 }
 
@@ -1836,6 +3676,7 @@ static int routeQuery(
         route_target_t     route_target = TARGET_UNDEFINED;
 	bool           	   succp          = false;
 	char* tname = NULL;
+	int scattered;
 	GWBUF*  querybuf = qbuf;
 	char db[MYSQL_DATABASE_MAXLEN + 1];
 	char errbuf[26+MYSQL_DATABASE_MAXLEN];
@@ -1861,12 +3702,31 @@ static int routeQuery(
         {
 	    if(router_cli_ses->init & INIT_UNINT)
 	    {
-		/* Generate database list */
-		gen_databaselist(inst,router_cli_ses);
-
+		if(router_cli_ses->shard_map == NULL)
+		{
+		    /* Generate database list */
+		    gen_databaselist(inst,router_cli_ses);
+		}
+		else
+		{
+		    /**
+		     * The session uses the shard map of the instance and is
+		     * ready once the database it connected with is in use.
+		     */
+		    router_cli_ses->init &= ~INIT_UNINT;
+
+		    if((router_cli_ses->init & INIT_USE_DB) &&
+		       !send_connect_db(router_cli_ses))
+		    {
+			gwbuf_free(querybuf);
+			rses_end_locked_router_action(router_cli_ses);
+			router_cli_ses->rses_client_dcb->func.hangup(router_cli_ses->rses_client_dcb);
+			return 1;
+		    }
+		}
 	    }
 
-	    if(router_cli_ses->init & INIT_MAPPING)
+	    if(router_cli_ses->init & (INIT_MAPPING|INIT_USE_DB))
 	    {
 
 		char* querystr = modutil_get_SQL(querybuf);
@@ -2008,6 +3868,12 @@ static int routeQuery(
 
         skygw_query_op_t op = query_classifier_get_operation(querybuf);
 
+        if (op == QUERY_OP_CREATE_DB || op == QUERY_OP_DROP_DB)
+        {
+            /** The shard map is invalidated once the server has replied */
+            router_cli_ses->map_invalidate = true;
+        }
+
         if (packet_type == MYSQL_COM_INIT_DB ||
 	    op == QUERY_OP_CHANGE_DB)
 	{
@@ -2048,6 +3914,16 @@ static int routeQuery(
         route_target = get_shard_route_target(qtype, 
 					router_cli_ses->rses_transaction_active,
 					querybuf->hint);
+
+        /** Read-only statements on databases that several servers have are scattered */
+        if (TARGET_IS_UNDEFINED(route_target) &&
+            packet_type == MYSQL_COM_QUERY &&
+            op != QUERY_OP_CHANGE_DB &&
+            (scattered = route_scattered(inst,router_cli_ses,querybuf,qtype)) >= 0)
+        {
+            ret = scattered;
+            goto retblock;
+        }
         
 	if (packet_type == MYSQL_COM_INIT_DB ||
 	    op == QUERY_OP_CHANGE_DB)
@@ -2393,6 +4269,26 @@ diagnostic(ROUTER *instance, DCB *dcb)
 	dcb_printf(dcb,"Session command history: disabled\n");
     }
 
+    /** Shard map statistics */
+    dcb_printf(dcb,"\n\33[1;4mShard map\33[0m\n");
+    dcb_printf(dcb,"Sessions using the shared map: %d\n",
+	       router->stats.shmap_cache_hit);
+    dcb_printf(dcb,"Sessions that mapped the databases: %d\n",
+	       router->stats.shmap_cache_miss);
+    dcb_printf(dcb,"Refresh interval: %d seconds\n",
+	       router->schemarouter_config.refresh_interval);
+    dcb_printf(dcb,"Statements scattered to several shards: %d\n",
+	       router->stats.n_scattered);
+    spinlock_acquire(&router->lock);
+    if(router->shard_map)
+    {
+	dcb_printf(dcb,"Map age: %ld seconds%s\n",
+		   (long)(time(NULL) - router->shard_map->last_updated),
+		   router->shard_map->generation != router->map_generation ?
+		   ", invalidated" : "");
+    }
+    spinlock_release(&router->lock);
+
     /** Session time statistics */
 
     if(router->stats.sessions > 0)
@@ -2549,73 +4445,16 @@ static void clientReply (
                  */
                 
                 router_cli_ses->init &= ~INIT_MAPPING;
-                
+
                 if(router_cli_ses->init & INIT_USE_DB)
                 {
-                    char* target;
-                    
-                    if((target = hashtable_fetch(router_cli_ses->dbhash,
-                                       router_cli_ses->connect_db)) == NULL)
-                    {
-			/** Unknown database, hang up on the client*/
-                        skygw_log_write_flush(LOGFILE_TRACE,"schemarouter: Connecting to a non-existent database '%s'",
-                                              router_cli_ses->connect_db);
-			char errmsg[128 + MYSQL_DATABASE_MAXLEN+1];
-			sprintf(errmsg,"Unknown database '%s'",router_cli_ses->connect_db);
-			GWBUF* errbuff = modutil_create_mysql_err_msg(1,0,1049,"42000",errmsg);
-			router_cli_ses->rses_client_dcb->func.write(router_cli_ses->rses_client_dcb,errbuff);
-                        if(router_cli_ses->queue)
-			{
-                            while((router_cli_ses->queue = gwbuf_consume(
-				   router_cli_ses->queue,gwbuf_length(router_cli_ses->queue))));
-			}
-                        rses_end_locked_router_action(router_cli_ses);
-			router_cli_ses->rses_client_dcb->func.hangup(router_cli_ses->rses_client_dcb);
-                        return;
-                    }
-                    
-                    /* Send a COM_INIT_DB packet to the server with the right database
-                     * and set it as the client's active database */   
-                    
-                    unsigned int qlen;
-                    GWBUF* buffer;
-                    
-                    qlen = strlen(router_cli_ses->connect_db);
-                    buffer = gwbuf_alloc(qlen + 5);                    
-                    if(buffer == NULL)
-                    {
-                        skygw_log_write_flush(LOGFILE_ERROR,"Error : Buffer allocation failed.");
-                        router_cli_ses->rses_closed = true;
-                        if(router_cli_ses->queue)
-                            gwbuf_free(router_cli_ses->queue);
-                        rses_end_locked_router_action(router_cli_ses);
-                        return;
-                    }
+                    bool known_db = send_connect_db(router_cli_ses);
 
-                    gw_mysql_set_byte3((unsigned char*)buffer->start,qlen+1);
-                    gwbuf_set_type(buffer,GWBUF_TYPE_MYSQL);
-                    *((unsigned char*)buffer->start + 3) = 0x0;
-                    *((unsigned char*)buffer->start + 4) = 0x2;
-                    memcpy(buffer->start+5,router_cli_ses->connect_db,qlen);
-                    DCB* dcb = NULL;
-                    
-                    if(get_shard_dcb(&dcb,router_cli_ses,target))
-                    {
-                        dcb->func.write(dcb,buffer);        
-                        skygw_log_write(LOGFILE_DEBUG,"schemarouter: USE '%s' sent to %s for session %p",
-                                        router_cli_ses->connect_db,
-                                        target,
-                                        router_cli_ses->rses_client_dcb->session);
-                    }
-                    else
+                    rses_end_locked_router_action(router_cli_ses);
+                    if(!known_db)
                     {
-                        skygw_log_write_flush(LOGFILE_TRACE,"schemarouter: Couldn't find target DCB for '%s'.",target);
-                        router_cli_ses->rses_closed = true;
-                        if(router_cli_ses->queue)
-                            gwbuf_free(router_cli_ses->queue);
+                        router_cli_ses->rses_client_dcb->func.hangup(router_cli_ses->rses_client_dcb);
                     }
-                    
-                    rses_end_locked_router_action(router_cli_ses);
                     return;
                 }
                 
@@ -2669,12 +4508,27 @@ static void clientReply (
         }
         
         CHK_BACKEND_REF(bref);
+
+        if(router_cli_ses->map_invalidate)
+        {
+            /** A database was created or dropped, refresh the shard map */
+            shard_map_invalidate(router_cli_ses->router);
+            router_cli_ses->map_invalidate = false;
+        }
         scur = &bref->bref_sescmd_cur;
+        /**
+         * Reply to a scattered statement is merged with the replies of
+         * the other servers as it arrives.
+         */
+	if (bref->sg_waiting && !sescmd_cursor_is_active(scur))
+	{
+		writebuf = sg_add_reply(router_cli_ses, bref, writebuf);
+	}
         /**
          * Active cursor means that reply is from session command 
          * execution.
          */
-	if (sescmd_cursor_is_active(scur))
+	else if (sescmd_cursor_is_active(scur))
 	{
                 if (LOG_IS_ENABLED(LOGFILE_ERROR) && 
                         MYSQL_IS_ERROR_PACKET(((uint8_t *)GWBUF_DATA(writebuf))))
@@ -2793,6 +4647,11 @@ static void clientReply (
 				LOGFILE_ERROR,
 				"Error : Routing query \"%s\" failed.",
 				bref->bref_pending_cmd)));
+
+			if (bref->sg_waiting)
+			{
+				sg_bref_failed(router_cli_ses, bref, NULL);
+			}
 		}
 		gwbuf_free(bref->bref_pending_cmd);
 		bref->bref_pending_cmd = NULL;
@@ -4183,8 +6042,21 @@ static bool handle_error_new_connection(
 	{
 		DCB* client_dcb;
 		client_dcb = ses->client;
-		client_dcb->func.write(client_dcb, gwbuf_clone(errmsg));
+
+		/**
+		 * The error of a scattered statement is sent once the other
+		 * servers have replied, after the rows already sent.
+		 */
+		if (!bref->sg_waiting)
+		{
+			client_dcb->func.write(client_dcb, gwbuf_clone(errmsg));
+		}
 		bref_clear_state(bref, BREF_WAITING_RESULT);
+
+		if (bref->sg_waiting)
+		{
+			sg_bref_failed(rses, bref, errmsg);
+		}
 	}
 	bref_clear_state(bref, BREF_IN_USE);
 	bref_set_state(bref, BREF_CLOSED);
@@ -4235,21 +6107,22 @@ static bool handle_error_new_connection(
 	    rses->rses_backend_ref[i].n_mapping_eof = 0;
         }
         
-        HASHITERATOR* iter  = hashtable_iterator(rses->dbhash);
-        char* srvnm = bref->bref_backend->backend_server->unique_name;
-        char *key, *value;
-        while((key = (char*)hashtable_next(iter)))
+        /**
+         * The databases of the failed server are no longer available. The
+         * map may be shared so the session maps the databases again into
+         * a map of its own and the instance map is refreshed.
+         */
+        shard_map_invalidate(rses->router);
+
+        if(!shard_map_private(rses))
         {
-            value = hashtable_fetch(rses->dbhash,key);
-            if(strcmp(value,srvnm) == 0)
-            {
-                hashtable_delete(rses->dbhash,key);
-            }
+            skygw_log_write(LOGFILE_ERROR,"Error : Memory allocation failed, closing session");
+            succp = false;
+            goto return_succp;
         }
-        
+
         skygw_log_write(LOGFILE_TRACE,"schemarouter: Re-mapping databases");
         gen_databaselist(rses->router,rses);
-	hashtable_iterator_free(iter);
 return_succp:
 	return succp;        
 }
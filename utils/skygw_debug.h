@@ -207,7 +207,8 @@ typedef enum skygw_chk_t {
                            ((s) == DCB_STATE_NOPOLLING ? "DCB_STATE_NOPOLLING" : \
                             ((s) == DCB_STATE_FREED ? "DCB_STATE_FREED" : \
                              ((s) == DCB_STATE_ZOMBIE ? "DCB_STATE_ZOMBIE" : \
-                              ((s) == DCB_STATE_UNDEFINED ? "DCB_STATE_UNDEFINED" : "DCB_STATE_UNKNOWN"))))))))
+                              ((s) == DCB_STATE_PERSISTENT ? "DCB_STATE_PERSISTENT" : \
+                               ((s) == DCB_STATE_UNDEFINED ? "DCB_STATE_UNDEFINED" : "DCB_STATE_UNKNOWN")))))))))
 
 #define STRSESSIONSTATE(s) ((s) == SESSION_STATE_ALLOC ? "SESSION_STATE_ALLOC" : \
                             ((s) == SESSION_STATE_READY ? "SESSION_STATE_READY" : \
@@ -268,7 +269,8 @@ typedef enum skygw_chk_t {
                         ((c) == LEAST_GLOBAL_CONNECTIONS ? "LEAST_GLOBAL_CONNECTIONS" : \
                         ((c) == LEAST_ROUTER_CONNECTIONS ? "LEAST_ROUTER_CONNECTIONS" : \
                         ((c) == LEAST_BEHIND_MASTER ? "LEAST_BEHIND_MASTER"           : \
-                        ((c) == LEAST_CURRENT_OPERATIONS ? "LEAST_CURRENT_OPERATIONS" : "Unknown criteria")))))
+                        ((c) == LEAST_CURRENT_OPERATIONS ? "LEAST_CURRENT_OPERATIONS" : \
+                        ((c) == LEAST_RESPONSE_TIME ? "LEAST_RESPONSE_TIME" : "Unknown criteria"))))))
 
 #define STRSRVSTATUS(s) (SERVER_IS_MASTER(s)  ? "RUNNING MASTER" :     \
                         (SERVER_IS_SLAVE(s)   ? "RUNNING SLAVE" :       \
@@ -28,6 +28,8 @@
 #include "skygw_debug.h"
 #include <skygw_types.h>
 #include <sys/time.h>
+#include <unistd.h>
+#include <limits.h>
 #include "skygw_utils.h"
 
 #if defined(MLIST)
@@ -1884,6 +1886,73 @@ return_rc:
         return rc;
 }
 
+/**
+ * Write a vector of buffers to a file with as few system calls as possible.
+ *
+ * @param file		file to write to
+ * @param iov		buffers to write, modified when a write is partial
+ * @param niov		number of buffers
+ * @param flush		sync the file to disk after the write
+ *
+ * @return 0 if succeed, errno of the failed write otherwise
+ */
+int skygw_file_writev(
+        skygw_file_t* file,
+        struct iovec* iov,
+        int           niov,
+        bool          flush)
+{
+        int        rc = 0;
+        int        fd;
+        ssize_t    nwritten;
+        static int writecount;
+
+        CHK_FILE(file);
+        fd = fileno(file->sf_file);
+
+        while (niov > 0)
+        {
+                nwritten = writev(fd, iov, MIN(niov, IOV_MAX));
+
+                if (nwritten == -1)
+                {
+                        if (errno == EINTR)
+                        {
+                                continue;
+                        }
+                        rc = errno;
+                        perror("Logfile write.\n");
+                        fprintf(stderr,
+                                "* Writing %d buffers to %s failed.\n",
+                                niov,
+                                file->sf_fname);
+                        goto return_rc;
+                }
+                /** Skip what was written */
+                while (niov > 0 && (size_t)nwritten >= iov->iov_len)
+                {
+                        nwritten -= iov->iov_len;
+                        iov += 1;
+                        niov -= 1;
+                }
+                if (niov > 0)
+                {
+                        iov->iov_base = (char *)iov->iov_base + nwritten;
+                        iov->iov_len -= nwritten;
+                }
+        }
+        writecount += 1;
+
+        if (flush || writecount == FSYNCLIMIT)
+        {
+                fsync(fd);
+                writecount = 0;
+        }
+        CHK_FILE(file);
+return_rc:
+        return rc;
+}
+
 skygw_file_t* skygw_file_alloc(
         char* fname)
 {
@@ -10,6 +10,7 @@
 #endif
 #define FSYNCLIMIT 10
 
+#include <sys/uio.h>
 #include "skygw_types.h"
 #include "skygw_debug.h"
 
@@ -225,6 +226,11 @@ int skygw_file_write(
         void*         data,
         size_t        nbytes,
         bool          flush);
+int skygw_file_writev(
+        skygw_file_t* file,
+        struct iovec* iov,
+        int           niov,
+        bool          flush);
 /** Skygw file routines */
 
 EXTERN_C_BLOCK_BEGIN